@@ -0,0 +1,158 @@
+package com.example.rwkvmobiletest
+
+import androidx.test.ext.junit.runners.AndroidJUnit4
+import androidx.test.platform.app.InstrumentationRegistry
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.cancelAndJoin
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.flow.take
+import kotlinx.coroutines.flow.toList
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.runBlocking
+import kotlinx.coroutines.withTimeout
+import org.junit.After
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNotNull
+import org.junit.Assert.assertTrue
+import org.junit.Before
+import org.junit.Test
+import org.junit.runner.RunWith
+import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+import java.util.Random
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Cancelling a coroutine that collects [RwkvMobile.generateStream] must stop
+ * the native generation and leave the runtime usable. Runs on a tiny random
+ * RWKV-6 model written to the cache dir, so no model has to be pushed.
+ */
+@RunWith(AndroidJUnit4::class)
+class GenerateStreamTest {
+
+    private var runtime = 0L
+
+    @Before
+    fun setUp() {
+        assertTrue(RwkvMobile.getLoadError() ?: "", RwkvMobile.isLibraryLoaded())
+        val dir = InstrumentationRegistry.getInstrumentation().targetContext.cacheDir
+        val model = writeTinyModel(File(dir, "generate_stream_test.st"))
+        val vocab = writeByteVocab(File(dir, "generate_stream_test_vocab.txt"))
+        runtime = RwkvMobile.rwkvmobile_runtime_init()
+        assertTrue(runtime != 0L)
+        val modelId = RwkvMobile.rwkvmobile_runtime_load_model_with_extra(
+            runtime, model.path, "cpu", "tokenizer=${vocab.path}")
+        assertTrue("load_model_with_extra returned $modelId", modelId >= 0)
+    }
+
+    @After
+    fun tearDown() {
+        if (runtime != 0L) {
+            RwkvMobile.rwkvmobile_runtime_release(runtime)
+        }
+    }
+
+    @Test
+    fun takeCancelsGeneration() = runBlocking {
+        // take() cancels the callbackFlow once three tokens have arrived
+        val tokens = RwkvMobile.generateStream(runtime, "abc", LONG_GENERATION).take(3).toList()
+        assertEquals(3, tokens.size)
+        awaitStopped()
+    }
+
+    @Test
+    fun cancellingCollectorStopsGeneration() = runBlocking {
+        val received = AtomicInteger()
+        val job = launch(Dispatchers.Default) {
+            RwkvMobile.generateStream(runtime, "abc", LONG_GENERATION).collect { received.incrementAndGet() }
+        }
+        withTimeout(TIMEOUT_MS) {
+            while (received.get() == 0) delay(5)
+        }
+        job.cancelAndJoin()
+        awaitStopped()
+
+        // A new generation can start once the cancelled one has finished
+        val text = RwkvMobile.rwkvmobile_runtime_gen_completion(runtime, "abc", 4)
+        assertNotNull(text)
+    }
+
+    private suspend fun awaitStopped() {
+        withTimeout(TIMEOUT_MS) {
+            while (RwkvMobile.rwkvmobile_runtime_is_generating(runtime) != 0) delay(5)
+        }
+    }
+
+    private companion object {
+        const val LONG_GENERATION = 1_000_000
+        const val TIMEOUT_MS = 10_000L
+
+        // vocab, n_embd, n_head, dim_mix, dim_decay, n_ffn, n_layer
+        const val V = 128
+        const val C = 32
+        const val H = 2
+        const val D = 4
+        const val DD = 4
+        const val F = 64
+        const val L = 2
+
+        /** Writes a random fp32 RWKV-6 safetensors file with the tensor names the runtime loads */
+        fun writeTinyModel(file: File): File {
+            val tensors = LinkedHashMap<String, IntArray>()
+            tensors["emb.weight"] = intArrayOf(V, C)
+            tensors["blocks.0.ln0.weight"] = intArrayOf(C)
+            tensors["blocks.0.ln0.bias"] = intArrayOf(C)
+            for (i in 0 until L) {
+                val p = "blocks.$i."
+                for (n in listOf("ln1.weight", "ln1.bias", "ln2.weight", "ln2.bias")) tensors[p + n] = intArrayOf(C)
+                for (n in "xwkvrg") tensors[p + "att.time_maa_$n"] = intArrayOf(1, 1, C)
+                tensors[p + "att.time_maa_w1"] = intArrayOf(C, 5 * D)
+                tensors[p + "att.time_maa_w2"] = intArrayOf(5, D, C)
+                tensors[p + "att.time_decay"] = intArrayOf(1, 1, C)
+                tensors[p + "att.time_decay_w1"] = intArrayOf(C, DD)
+                tensors[p + "att.time_decay_w2"] = intArrayOf(DD, C)
+                tensors[p + "att.time_faaaa"] = intArrayOf(H, C / H)
+                for (n in listOf("receptance", "key", "value", "gate", "output")) {
+                    tensors[p + "att.$n.weight"] = intArrayOf(C, C)
+                }
+                tensors[p + "att.ln_x.weight"] = intArrayOf(C)
+                tensors[p + "att.ln_x.bias"] = intArrayOf(C)
+                tensors[p + "ffn.time_maa_k"] = intArrayOf(1, 1, C)
+                tensors[p + "ffn.time_maa_r"] = intArrayOf(1, 1, C)
+                tensors[p + "ffn.key.weight"] = intArrayOf(F, C)
+                tensors[p + "ffn.receptance.weight"] = intArrayOf(C, C)
+                tensors[p + "ffn.value.weight"] = intArrayOf(C, F)
+            }
+            tensors["ln_out.weight"] = intArrayOf(C)
+            tensors["ln_out.bias"] = intArrayOf(C)
+            tensors["head.weight"] = intArrayOf(V, C)
+
+            val header = StringBuilder("{")
+            var offset = 0L
+            for ((name, shape) in tensors) {
+                val bytes = shape.fold(1L) { acc, d -> acc * d } * 4
+                if (header.length > 1) header.append(',')
+                header.append("\"$name\":{\"dtype\":\"F32\",\"shape\":${shape.joinToString(",", "[", "]")},")
+                header.append("\"data_offsets\":[$offset,${offset + bytes}]}")
+                offset += bytes
+            }
+            header.append('}')
+            val json = header.toString().toByteArray(Charsets.UTF_8)
+
+            val data = ByteBuffer.allocate(8 + json.size + offset.toInt()).order(ByteOrder.LITTLE_ENDIAN)
+            data.putLong(json.size.toLong())
+            data.put(json)
+            val random = Random(1)
+            while (data.hasRemaining()) data.putFloat(random.nextFloat() - 0.5f)
+            file.writeBytes(data.array())
+            return file
+        }
+
+        /** One token per byte 1..V-1, in the text vocab format the runtime reads */
+        fun writeByteVocab(file: File): File {
+            file.writeText((1 until V).joinToString("\n", postfix = "\n") { "$it b'\\x%02x' 1".format(it) })
+            return file
+        }
+    }
+}
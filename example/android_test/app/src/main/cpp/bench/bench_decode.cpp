@@ -0,0 +1,180 @@
+/**
+ * bench_decode.cpp
+ *
+ * Decode benchmark for the in-tree CPU runtime that also counts heap
+ * allocations. The global operator new is replaced with a counting version;
+ * after a few warm-up generations (which size the session's arena, scratch
+ * buffers and response blocks) a generation must not allocate at all, so
+ * any steady-state allocation is reported as an error rather than a number.
+ *
+ * The model is a small synthetic RWKV-6 checkpoint with random weights
+ * (runtime/tests/tiny_model.h) and a byte-level vocab, written to a
+ * temporary directory at start-up.
+ * Counters: allocs_per_token, allocs_per_generation, tokens (per second).
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "runtime.h"
+#include "tests/tiny_model.h"
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+// 统计所有 operator new（包括数组与 nothrow 版本，它们默认转到这里）。
+// 都不内联：否则编译器会把内联进来的 malloc/free 与 new/delete 配对检查而误报
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t align) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if (posix_memalign(&p, static_cast<size_t>(align), size != 0 ? size : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+
+namespace {
+
+using rwkvmobile::Runtime;
+using rwkvmobile::ThreadAffinity;
+using rwkvmobile::TokenRecord;
+
+constexpr int kVocab = 512;
+
+// 合成模型的尺寸；权重取 [-0.5, 0.5) 的随机数
+rwkvmobile::TinyModelShape model_shape() {
+    rwkvmobile::TinyModelShape shape;
+    shape.vocab = kVocab;
+    shape.n_embd = 256;
+    shape.n_head = 4;
+    shape.dim_mix = 32;
+    shape.dim_decay = 64;
+    shape.n_ffn = 4 * shape.n_embd;
+    shape.n_layer = 4;
+    return shape;
+}
+
+constexpr int kTokensPerGeneration = 128;
+constexpr int kWarmupGenerations = 3;
+constexpr const char* kPrompt = "The quick brown fox jumps over the lazy dog.";
+
+// 词表：1..255 为单字节，其余为两个小写字母（词表大于 256，走通用的采样路径）
+bool write_vocab(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    for (int i = 1; i < kVocab; ++i) {
+        if (i < 256) {
+            fprintf(f, "%d b'\\x%02x' 1\n", i, i);
+        } else {
+            fprintf(f, "%d b'%c%c' 2\n", i, 'a' + i % 26, 'a' + i / 26 % 26);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+// 合成模型只生成一次，所有基准共用
+const std::string& model_dir() {
+    static const std::string dir = []() {
+        char tmpl[] = "/tmp/rwkv_bench_XXXXXX";
+        if (mkdtemp(tmpl) == nullptr) {
+            return std::string();
+        }
+        const std::string d = tmpl;
+        if (!rwkvmobile::write_tiny_model(d + "/model.st", model_shape(), 1) || !write_vocab(d + "/vocab.txt")) {
+            return std::string();
+        }
+        return d;
+    }();
+    return dir;
+}
+
+// 本次回复实际生成的 token 数（遇到停止序列时可能少于 max_tokens）
+int generated_tokens(const Runtime& runtime) {
+    static TokenRecord records[kTokensPerGeneration];
+    const int n = runtime.read_tokens(0, records, kTokensPerGeneration);
+    return n > 0 ? n : 0;
+}
+
+void BM_DecodeAllocations(benchmark::State& state) {
+    const std::string& dir = model_dir();
+    if (dir.empty()) {
+        state.SkipWithError("failed to write the synthetic model");
+        return;
+    }
+    Runtime runtime;
+    const std::string extra = "tokenizer=" + dir + "/vocab.txt";
+    if (runtime.load_model(dir + "/model.st", "cpu", extra.c_str()) < 0 ||
+        runtime.set_threads(static_cast<int>(state.range(0)), ThreadAffinity::kNone) != 0) {
+        state.SkipWithError("failed to load the synthetic model");
+        return;
+    }
+    runtime.set_seed(7);
+    for (int i = 0; i < kWarmupGenerations; ++i) {
+        runtime.gen_completion(kPrompt, kTokensPerGeneration, nullptr);
+    }
+
+    uint64_t allocations = 0;
+    int64_t tokens = 0;
+    for (auto _ : state) {
+        const uint64_t before = g_allocations.load(std::memory_order_relaxed);
+        runtime.gen_completion(kPrompt, kTokensPerGeneration, nullptr);
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+        tokens += generated_tokens(runtime);
+    }
+
+    const double iterations = static_cast<double>(state.iterations());
+    state.counters["allocs_per_token"] =
+            tokens > 0 ? static_cast<double>(allocations) / static_cast<double>(tokens) : 0.0;
+    state.counters["allocs_per_generation"] = static_cast<double>(allocations) / iterations;
+    state.counters["tokens"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kIsRate);
+    if (allocations != 0) {
+        state.SkipWithError("steady-state generation allocated on the heap");
+    }
+}
+BENCHMARK(BM_DecodeAllocations)->ArgName("threads")->Arg(1)->Arg(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    // 删除启动时写出的合成模型
+    const std::string& dir = model_dir();
+    if (!dir.empty()) {
+        remove((dir + "/model.st").c_str());
+        remove((dir + "/vocab.txt").c_str());
+        rmdir(dir.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/**
+ * bench_jni.cpp
+ *
+ * Microbenchmarks for the JNI entry points of rwkv_jni.cpp / rwkv_jni.c,
+ * linked against the stub librwkv_mobile and the mock JVM so that only the
+ * bridge's own work is timed: handle casts, string marshalling, byte-array
+ * pinning, direct buffers and the streaming token trampoline.
+ *
+ * Payload sizes run from 1 B to 1 MB. Use --benchmark_format=json or
+ * --benchmark_out=<file> (JSON by default) to record results.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "jni_mock.h"
+#include "stub_rwkv_mobile.h"
+
+#define JNI_FN(name) Java_com_example_rwkvmobiletest_RwkvMobile_##name
+
+// 两个桥接导出的函数并不完全相同，缺失的入口点为弱符号，对应基准被跳过
+extern "C" {
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved);
+
+__attribute__((weak)) jlong JNI_FN(rwkvmobile_1runtime_1init)(JNIEnv*, jobject);
+__attribute__((weak)) jint JNI_FN(rwkvmobile_1runtime_1release)(JNIEnv*, jobject, jlong);
+__attribute__((weak)) jstring JNI_FN(rwkvmobile_1dump_1log)(JNIEnv*, jobject);
+__attribute__((weak)) jint JNI_FN(rwkvmobile_1runtime_1get_1available_1backend_1names)(
+        JNIEnv*, jobject, jbyteArray, jint);
+__attribute__((weak)) jint JNI_FN(rwkvmobile_1runtime_1get_1available_1backend_1names_1direct)(
+        JNIEnv*, jobject, jobject);
+__attribute__((weak)) jint JNI_FN(rwkvmobile_1runtime_1gen_1completion_1direct)(
+        JNIEnv*, jobject, jlong, jstring, jint, jobject);
+__attribute__((weak)) jint JNI_FN(rwkvmobile_1runtime_1read_1response_1since)(
+        JNIEnv*, jobject, jlong, jint, jobject);
+__attribute__((weak)) jint JNI_FN(rwkvmobile_1runtime_1gen_1completion_1async)(
+        JNIEnv*, jobject, jlong, jstring, jint, jobject);
+}
+
+namespace {
+
+constexpr int64_t kMinPayload = 1;
+constexpr int64_t kMaxPayload = 1 << 20;
+
+enum class Text { kAscii, kCjk };
+
+// 生成恰好 size 字节的 UTF-8 文本
+std::string make_text(size_t size, Text kind) {
+    static const std::string ascii = "The quick brown fox jumps over the lazy dog. ";
+    static const std::string cjk = "\xe4\xb8\xad\xe6\x96\x87\xe6\xb5\x8b\xe8\xaf\x95";  // 中文测试
+    const std::string& unit = kind == Text::kAscii ? ascii : cjk;
+    std::string text;
+    text.reserve(size);
+    while (text.size() + unit.size() <= size) {
+        text += unit;
+    }
+    // 不足一个单元的部分用 ASCII 补齐，保证不截断多字节字符
+    text.append(size - text.size(), 'x');
+    return text;
+}
+
+jstring new_jstring(JNIEnv* env, const std::string& utf8) {
+    std::vector<jchar> utf16(utf8.begin(), utf8.end());  // 基准只用 ASCII 参数
+    return env->NewString(utf16.data(), static_cast<jsize>(utf16.size()));
+}
+
+bool require(benchmark::State& state, const void* fn) {
+    if (fn == nullptr) {
+        state.SkipWithError("entry point not exported by " RWKV_BENCH_BRIDGE);
+        return false;
+    }
+    return true;
+}
+
+void set_bytes(benchmark::State& state, int64_t bytes) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * bytes);
+}
+
+// ---------------------------------------------------------------------------
+// 句柄：jlong <-> rwkvmobile_runtime_t 的转换与调用开销
+// ---------------------------------------------------------------------------
+
+void BM_RuntimeInitRelease(benchmark::State& state) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1init))) ||
+        !require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1release)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    for (auto _ : state) {
+        jlong handle = JNI_FN(rwkvmobile_1runtime_1init)(env, nullptr);
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1release)(env, nullptr, handle));
+    }
+}
+BENCHMARK(BM_RuntimeInitRelease);
+
+// 空响应上的增量读取：只剩句柄转换、direct buffer 查询与一次 C 调用
+void BM_HandleCall(benchmark::State& state) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1read_1response_1since)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    stub::set_payload(std::string());
+    jlong handle = JNI_FN(rwkvmobile_1runtime_1init)(env, nullptr);
+    char storage[16];
+    jobject buffer = env->NewDirectByteBuffer(storage, sizeof(storage));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1read_1response_1since)(env, nullptr, handle, 0, buffer));
+    }
+    env->DeleteLocalRef(buffer);
+    JNI_FN(rwkvmobile_1runtime_1release)(env, nullptr, handle);
+}
+BENCHMARK(BM_HandleCall);
+
+// ---------------------------------------------------------------------------
+// 字符串：C 字符串 -> jstring 以及 jstring 参数 -> C 字符串
+// ---------------------------------------------------------------------------
+
+void string_return(benchmark::State& state, Text kind) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1dump_1log)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    const int64_t size = state.range(0);
+    stub::set_payload(make_text(static_cast<size_t>(size), kind));
+    for (auto _ : state) {
+        jstring s = JNI_FN(rwkvmobile_1dump_1log)(env, nullptr);
+        benchmark::DoNotOptimize(s);
+        env->DeleteLocalRef(s);
+    }
+    set_bytes(state, size);
+}
+
+void BM_StringReturnAscii(benchmark::State& state) { string_return(state, Text::kAscii); }
+void BM_StringReturnCjk(benchmark::State& state) { string_return(state, Text::kCjk); }
+BENCHMARK(BM_StringReturnAscii)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+BENCHMARK(BM_StringReturnCjk)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+
+void BM_StringArgument(benchmark::State& state) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1gen_1completion_1direct)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    const int64_t size = state.range(0);
+    stub::set_payload(std::string());
+    jlong handle = JNI_FN(rwkvmobile_1runtime_1init)(env, nullptr);
+    jstring prompt = new_jstring(env, make_text(static_cast<size_t>(size), Text::kAscii));
+    char storage[16];
+    jobject buffer = env->NewDirectByteBuffer(storage, sizeof(storage));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1gen_1completion_1direct)(
+            env, nullptr, handle, prompt, 0, buffer));
+    }
+    env->DeleteLocalRef(buffer);
+    env->DeleteLocalRef(prompt);
+    JNI_FN(rwkvmobile_1runtime_1release)(env, nullptr, handle);
+    set_bytes(state, size);
+}
+BENCHMARK(BM_StringArgument)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+
+// ---------------------------------------------------------------------------
+// 输出缓冲区：byte[] (Get/ReleaseByteArrayElements) 与 direct ByteBuffer
+// ---------------------------------------------------------------------------
+
+void BM_ByteArrayPinning(benchmark::State& state) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1get_1available_1backend_1names)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    const int64_t size = state.range(0);
+    stub::set_payload(make_text(static_cast<size_t>(size), Text::kAscii));
+    jbyteArray array = env->NewByteArray(static_cast<jsize>(size));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1get_1available_1backend_1names)(
+            env, nullptr, array, static_cast<jint>(size)));
+    }
+    env->DeleteLocalRef(array);
+    set_bytes(state, size);
+}
+BENCHMARK(BM_ByteArrayPinning)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+
+void BM_DirectBuffer(benchmark::State& state) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1get_1available_1backend_1names_1direct)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    const int64_t size = state.range(0);
+    stub::set_payload(make_text(static_cast<size_t>(size), Text::kAscii));
+    std::vector<char> storage(static_cast<size_t>(size));
+    jobject buffer = env->NewDirectByteBuffer(storage.data(), size);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1get_1available_1backend_1names_1direct)(
+            env, nullptr, buffer));
+    }
+    env->DeleteLocalRef(buffer);
+    set_bytes(state, size);
+}
+BENCHMARK(BM_DirectBuffer)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+
+void BM_ReadResponseSince(benchmark::State& state) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1read_1response_1since)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    const int64_t size = state.range(0);
+    stub::set_payload(make_text(static_cast<size_t>(size), Text::kAscii));
+    jlong handle = JNI_FN(rwkvmobile_1runtime_1init)(env, nullptr);
+    std::vector<char> storage(static_cast<size_t>(size));
+    jobject buffer = env->NewDirectByteBuffer(storage.data(), size);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1read_1response_1since)(env, nullptr, handle, 0, buffer));
+    }
+    env->DeleteLocalRef(buffer);
+    JNI_FN(rwkvmobile_1runtime_1release)(env, nullptr, handle);
+    set_bytes(state, size);
+}
+BENCHMARK(BM_ReadResponseSince)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+
+// ---------------------------------------------------------------------------
+// 流式回调：生成线程 -> TokenListener.onToken，每个 token 4 字节
+// ---------------------------------------------------------------------------
+
+void stream_tokens(benchmark::State& state, Text kind) {
+    if (!require(state, reinterpret_cast<const void*>(&JNI_FN(rwkvmobile_1runtime_1gen_1completion_1async)))) {
+        return;
+    }
+    JNIEnv* env = jnimock::env();
+    const int64_t size = state.range(0);
+    stub::set_payload(make_text(static_cast<size_t>(size), kind));
+    stub::set_token_bytes(4);
+    jlong handle = JNI_FN(rwkvmobile_1runtime_1init)(env, nullptr);
+    jstring prompt = new_jstring(env, "hi");
+    jobject listener = jnimock::new_listener();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(JNI_FN(rwkvmobile_1runtime_1gen_1completion_1async)(
+            env, nullptr, handle, prompt, 0, listener));
+    }
+    const jnimock::ListenerStats& stats = jnimock::listener_stats(listener);
+    if (stats.status != 0) {
+        state.SkipWithError("onComplete was not delivered");
+    }
+    state.counters["tokens"] = benchmark::Counter(static_cast<double>(stats.tokens),
+                                                  benchmark::Counter::kIsRate);
+    jnimock::delete_listener(listener);
+    env->DeleteLocalRef(prompt);
+    JNI_FN(rwkvmobile_1runtime_1release)(env, nullptr, handle);
+    set_bytes(state, size);
+}
+
+void BM_StreamTokensAscii(benchmark::State& state) { stream_tokens(state, Text::kAscii); }
+void BM_StreamTokensCjk(benchmark::State& state) { stream_tokens(state, Text::kCjk); }
+BENCHMARK(BM_StreamTokensAscii)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+BENCHMARK(BM_StreamTokensCjk)->RangeMultiplier(8)->Range(kMinPayload, kMaxPayload);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // 与 System.loadLibrary 一样先执行 JNI_OnLoad，缓存 TokenListener 的方法 ID
+    JNI_OnLoad(jnimock::vm(), nullptr);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::AddCustomContext("jni_bridge", RWKV_BENCH_BRIDGE);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,347 @@
+#include "jni_mock.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace jnimock {
+
+namespace {
+
+enum class Kind { kClass, kString, kByteArray, kDirectBuffer, kListener };
+
+struct Object {
+    explicit Object(Kind k) : kind(k) {}
+    virtual ~Object() = default;
+    Kind kind;
+};
+
+struct String : Object {
+    String() : Object(Kind::kString) {}
+    std::u16string chars;
+};
+
+struct ByteArray : Object {
+    explicit ByteArray(jsize n) : Object(Kind::kByteArray), bytes(static_cast<size_t>(n)) {}
+    std::vector<jbyte> bytes;
+};
+
+struct DirectBuffer : Object {
+    DirectBuffer(void* a, jlong c) : Object(Kind::kDirectBuffer), address(a), capacity(c) {}
+    void* address;
+    jlong capacity;
+};
+
+struct Listener : Object {
+    Listener() : Object(Kind::kListener) {}
+    ListenerStats stats;
+};
+
+Object g_listener_class(Kind::kClass);
+
+// 每个方法名对应一个唯一的 jmethodID
+char g_on_token_id;
+char g_on_complete_id;
+
+Object* unwrap(jobject o) { return reinterpret_cast<Object*>(o); }
+jobject wrap(Object* o) { return reinterpret_cast<jobject>(o); }
+
+String* as_string(jstring s) { return static_cast<String*>(unwrap(s)); }
+ByteArray* as_bytes(jarray a) { return static_cast<ByteArray*>(unwrap(a)); }
+
+// modified UTF-8 -> UTF-16（与 JVM 一样逐字符解码；4 字节序列不合法，逐字节替换）
+std::u16string decode_modified_utf8(const char* s) {
+    std::u16string out;
+    const auto* p = reinterpret_cast<const unsigned char*>(s);
+    while (*p != 0) {
+        const unsigned char c = *p;
+        if (c < 0x80) {
+            out.push_back(c);
+            p += 1;
+        } else if ((c & 0xE0) == 0xC0 && (p[1] & 0xC0) == 0x80) {
+            out.push_back(static_cast<char16_t>(((c & 0x1F) << 6) | (p[1] & 0x3F)));
+            p += 2;
+        } else if ((c & 0xF0) == 0xE0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+            out.push_back(static_cast<char16_t>(((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F)));
+            p += 3;
+        } else {
+            out.push_back(0xFFFD);
+            p += 1;
+        }
+    }
+    return out;
+}
+
+// UTF-16 -> modified UTF-8（代理对按两个 3 字节序列编码，U+0000 编码为 C0 80）
+std::string encode_modified_utf8(const char16_t* s, size_t n) {
+    std::string out;
+    out.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const char16_t c = s[i];
+        if (c != 0 && c < 0x80) {
+            out.push_back(static_cast<char>(c));
+        } else if (c < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (c >> 6)));
+            out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xE0 | (c >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// JNIEnv
+// ---------------------------------------------------------------------------
+
+jclass find_class(JNIEnv*, const char* name) {
+    if (strcmp(name, "com/example/rwkvmobiletest/RwkvMobile$TokenListener") == 0) {
+        return static_cast<jclass>(wrap(&g_listener_class));
+    }
+    return nullptr;
+}
+
+jmethodID get_method_id(JNIEnv*, jclass, const char* name, const char*) {
+    if (strcmp(name, "onToken") == 0) return reinterpret_cast<jmethodID>(&g_on_token_id);
+    if (strcmp(name, "onComplete") == 0) return reinterpret_cast<jmethodID>(&g_on_complete_id);
+    return nullptr;
+}
+
+jboolean exception_check(JNIEnv*) { return JNI_FALSE; }
+void exception_describe(JNIEnv*) {}
+void exception_clear(JNIEnv*) {}
+
+// 引用即对象本身；global ref 不计数
+jobject new_global_ref(JNIEnv*, jobject o) { return o; }
+void delete_global_ref(JNIEnv*, jobject) {}
+
+void delete_local_ref(JNIEnv*, jobject o) {
+    Object* obj = unwrap(o);
+    // 类对象与 listener 由 mock/基准代码持有
+    if (obj != nullptr && (obj->kind == Kind::kString || obj->kind == Kind::kByteArray ||
+                           obj->kind == Kind::kDirectBuffer)) {
+        delete obj;
+    }
+}
+
+void call_void_method_v(JNIEnv*, jobject o, jmethodID m, va_list args) {
+    Object* obj = unwrap(o);
+    if (obj == nullptr || obj->kind != Kind::kListener) {
+        return;
+    }
+    ListenerStats& stats = static_cast<Listener*>(obj)->stats;
+    if (m == reinterpret_cast<jmethodID>(&g_on_token_id)) {
+        auto* text = static_cast<String*>(unwrap(va_arg(args, jobject)));
+        stats.tokens++;
+        stats.chars += text != nullptr ? text->chars.size() : 0;
+    } else if (m == reinterpret_cast<jmethodID>(&g_on_complete_id)) {
+        stats.status = va_arg(args, jint);
+    }
+}
+
+void call_void_method(JNIEnv* env, jobject o, jmethodID m, ...) {
+    va_list args;
+    va_start(args, m);
+    call_void_method_v(env, o, m, args);
+    va_end(args);
+}
+
+jstring new_string(JNIEnv*, const jchar* chars, jsize n) {
+    auto* s = new String();
+    s->chars.assign(reinterpret_cast<const char16_t*>(chars), static_cast<size_t>(n));
+    return static_cast<jstring>(wrap(s));
+}
+
+jsize get_string_length(JNIEnv*, jstring s) {
+    return static_cast<jsize>(as_string(s)->chars.size());
+}
+
+jstring new_string_utf(JNIEnv*, const char* utf) {
+    if (utf == nullptr) {
+        return nullptr;
+    }
+    auto* s = new String();
+    s->chars = decode_modified_utf8(utf);
+    return static_cast<jstring>(wrap(s));
+}
+
+jsize get_string_utf_length(JNIEnv*, jstring s) {
+    const std::u16string& chars = as_string(s)->chars;
+    return static_cast<jsize>(encode_modified_utf8(chars.data(), chars.size()).size());
+}
+
+const char* get_string_utf_chars(JNIEnv*, jstring s, jboolean* is_copy) {
+    const std::u16string& chars = as_string(s)->chars;
+    const std::string utf = encode_modified_utf8(chars.data(), chars.size());
+    char* out = static_cast<char*>(malloc(utf.size() + 1));
+    memcpy(out, utf.c_str(), utf.size() + 1);
+    if (is_copy != nullptr) *is_copy = JNI_TRUE;
+    return out;
+}
+
+void release_string_utf_chars(JNIEnv*, jstring, const char* chars) {
+    free(const_cast<char*>(chars));
+}
+
+void get_string_utf_region(JNIEnv*, jstring s, jsize start, jsize n, char* buf) {
+    const std::u16string& chars = as_string(s)->chars;
+    const std::string utf = encode_modified_utf8(chars.data() + start, static_cast<size_t>(n));
+    memcpy(buf, utf.c_str(), utf.size() + 1);
+}
+
+jsize get_array_length(JNIEnv*, jarray a) {
+    return static_cast<jsize>(as_bytes(a)->bytes.size());
+}
+
+jbyteArray new_byte_array(JNIEnv*, jsize n) {
+    return static_cast<jbyteArray>(wrap(new ByteArray(n)));
+}
+
+jfloatArray new_float_array(JNIEnv*, jsize n) {
+    // float 数组同样按字节存储
+    return static_cast<jfloatArray>(wrap(new ByteArray(n * static_cast<jsize>(sizeof(jfloat)))));
+}
+
+jlongArray new_long_array(JNIEnv*, jsize n) {
+    return static_cast<jlongArray>(wrap(new ByteArray(n * static_cast<jsize>(sizeof(jlong)))));
+}
+
+// 与 ART 的可移动数组一样返回副本，Release 时写回
+jbyte* get_byte_array_elements(JNIEnv*, jbyteArray a, jboolean* is_copy) {
+    const std::vector<jbyte>& bytes = as_bytes(a)->bytes;
+    auto* copy = static_cast<jbyte*>(malloc(bytes.size() + 1));
+    memcpy(copy, bytes.data(), bytes.size());
+    if (is_copy != nullptr) *is_copy = JNI_TRUE;
+    return copy;
+}
+
+void release_byte_array_elements(JNIEnv*, jbyteArray a, jbyte* elems, jint mode) {
+    if (mode != JNI_ABORT) {
+        std::vector<jbyte>& bytes = as_bytes(a)->bytes;
+        memcpy(bytes.data(), elems, bytes.size());
+    }
+    if (mode != JNI_COMMIT) {
+        free(elems);
+    }
+}
+
+void get_byte_array_region(JNIEnv*, jbyteArray a, jsize start, jsize n, jbyte* buf) {
+    memcpy(buf, as_bytes(a)->bytes.data() + start, static_cast<size_t>(n));
+}
+
+void set_byte_array_region(JNIEnv*, jbyteArray a, jsize start, jsize n, const jbyte* buf) {
+    memcpy(as_bytes(a)->bytes.data() + start, buf, static_cast<size_t>(n));
+}
+
+void set_float_array_region(JNIEnv*, jfloatArray a, jsize start, jsize n, const jfloat* buf) {
+    memcpy(as_bytes(a)->bytes.data() + start * sizeof(jfloat), buf, static_cast<size_t>(n) * sizeof(jfloat));
+}
+
+void set_long_array_region(JNIEnv*, jlongArray a, jsize start, jsize n, const jlong* buf) {
+    memcpy(as_bytes(a)->bytes.data() + start * sizeof(jlong), buf, static_cast<size_t>(n) * sizeof(jlong));
+}
+
+void* get_primitive_array_critical(JNIEnv*, jarray a, jboolean* is_copy) {
+    if (is_copy != nullptr) *is_copy = JNI_FALSE;
+    return as_bytes(a)->bytes.data();
+}
+
+void release_primitive_array_critical(JNIEnv*, jarray, void*, jint) {}
+
+jobject new_direct_byte_buffer(JNIEnv*, void* address, jlong capacity) {
+    return wrap(new DirectBuffer(address, capacity));
+}
+
+void* get_direct_buffer_address(JNIEnv*, jobject b) {
+    Object* obj = unwrap(b);
+    if (obj == nullptr || obj->kind != Kind::kDirectBuffer) return nullptr;
+    return static_cast<DirectBuffer*>(obj)->address;
+}
+
+jlong get_direct_buffer_capacity(JNIEnv*, jobject b) {
+    Object* obj = unwrap(b);
+    if (obj == nullptr || obj->kind != Kind::kDirectBuffer) return -1;
+    return static_cast<DirectBuffer*>(obj)->capacity;
+}
+
+const JNINativeInterface_ g_env_functions = {
+    find_class,
+    get_method_id,
+    exception_check,
+    exception_describe,
+    exception_clear,
+    new_global_ref,
+    delete_global_ref,
+    delete_local_ref,
+    call_void_method,
+    call_void_method_v,
+    new_string,
+    get_string_length,
+    new_string_utf,
+    get_string_utf_length,
+    get_string_utf_chars,
+    release_string_utf_chars,
+    get_string_utf_region,
+    get_array_length,
+    new_byte_array,
+    new_float_array,
+    new_long_array,
+    get_byte_array_elements,
+    release_byte_array_elements,
+    get_byte_array_region,
+    set_byte_array_region,
+    set_float_array_region,
+    set_long_array_region,
+    get_primitive_array_critical,
+    release_primitive_array_critical,
+    new_direct_byte_buffer,
+    get_direct_buffer_address,
+    get_direct_buffer_capacity,
+};
+
+JNIEnv g_env{&g_env_functions};
+
+// ---------------------------------------------------------------------------
+// JavaVM：所有线程视为已 attach，共用同一个 JNIEnv
+// ---------------------------------------------------------------------------
+
+jint get_env(JavaVM*, void** env, jint) {
+    *env = &g_env;
+    return JNI_OK;
+}
+
+jint attach_current_thread(JavaVM*, void** env, void*) {
+    *env = &g_env;
+    return JNI_OK;
+}
+
+jint detach_current_thread(JavaVM*) { return JNI_OK; }
+
+const JNIInvokeInterface_ g_vm_functions = {
+    get_env,
+    attach_current_thread,
+    detach_current_thread,
+};
+
+JavaVM g_vm{&g_vm_functions};
+
+} // namespace
+
+JavaVM* vm() { return &g_vm; }
+JNIEnv* env() { return &g_env; }
+
+jobject new_listener() {
+    return wrap(new Listener());
+}
+
+ListenerStats& listener_stats(jobject listener) {
+    return static_cast<Listener*>(unwrap(listener))->stats;
+}
+
+void delete_listener(jobject listener) {
+    delete unwrap(listener);
+}
+
+} // namespace jnimock
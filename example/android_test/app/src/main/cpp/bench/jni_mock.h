@@ -0,0 +1,38 @@
+/**
+ * jni_mock.h
+ *
+ * In-process fake JVM backing the mock <jni.h>. Strings are stored as
+ * UTF-16 and byte arrays as separate heap blocks, so the bridge pays for
+ * conversions and copies roughly the way it would on ART:
+ *  - NewStringUTF/GetStringUTFChars convert between (modified) UTF-8 and UTF-16
+ *  - GetByteArrayElements returns a copy that Release writes back
+ *  - direct buffers and GetPrimitiveArrayCritical hand out the storage itself
+ */
+
+#ifndef RWKV_BENCH_JNI_MOCK_H
+#define RWKV_BENCH_JNI_MOCK_H
+
+#include <jni.h>
+
+#include <cstddef>
+#include <string>
+
+namespace jnimock {
+
+JavaVM* vm();
+JNIEnv* env();
+
+// TokenListener 实例，记录收到的回调
+struct ListenerStats {
+    size_t tokens = 0;     // onToken 调用次数
+    size_t chars = 0;      // onToken 收到的 UTF-16 code unit 总数
+    int status = 1;        // onComplete 的参数，未调用时为 1
+};
+
+jobject new_listener();
+ListenerStats& listener_stats(jobject listener);
+void delete_listener(jobject listener);
+
+} // namespace jnimock
+
+#endif // RWKV_BENCH_JNI_MOCK_H
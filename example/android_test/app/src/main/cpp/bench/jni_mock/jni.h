@@ -0,0 +1,182 @@
+/**
+ * jni.h (mock)
+ *
+ * Minimal stand-in for <jni.h> so the JNI bridges can be compiled and
+ * benchmarked on a host without a JDK. Only the types and JNIEnv/JavaVM
+ * functions used by rwkv_jni.cpp and rwkv_jni.c are declared; the function
+ * tables are filled in by jni_mock.cpp. The C and C++ views of JNIEnv are
+ * layout compatible, as in the real header.
+ */
+
+#ifndef MOCK_JNI_H
+#define MOCK_JNI_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+
+#define JNI_OK         0
+#define JNI_ERR       (-1)
+#define JNI_EDETACHED (-2)
+#define JNI_VERSION_1_6 0x00010006
+
+#define JNI_FALSE 0
+#define JNI_TRUE  1
+
+#define JNI_COMMIT 1
+#define JNI_ABORT  2
+
+typedef uint8_t  jboolean;
+typedef int8_t   jbyte;
+typedef uint16_t jchar;
+typedef int16_t  jshort;
+typedef int32_t  jint;
+typedef int64_t  jlong;
+typedef float    jfloat;
+typedef double   jdouble;
+typedef jint     jsize;
+
+#ifdef __cplusplus
+class _jobject {};
+class _jclass : public _jobject {};
+class _jstring : public _jobject {};
+class _jthrowable : public _jobject {};
+class _jarray : public _jobject {};
+class _jbyteArray : public _jarray {};
+class _jfloatArray : public _jarray {};
+class _jlongArray : public _jarray {};
+typedef _jobject*     jobject;
+typedef _jclass*      jclass;
+typedef _jstring*     jstring;
+typedef _jthrowable*  jthrowable;
+typedef _jarray*      jarray;
+typedef _jbyteArray*  jbyteArray;
+typedef _jfloatArray* jfloatArray;
+typedef _jlongArray*  jlongArray;
+#else
+typedef void*   jobject;
+typedef jobject jclass;
+typedef jobject jstring;
+typedef jobject jthrowable;
+typedef jobject jarray;
+typedef jarray  jbyteArray;
+typedef jarray  jfloatArray;
+typedef jarray  jlongArray;
+#endif
+
+typedef struct _jmethodID* jmethodID;
+
+struct JNINativeInterface_;
+struct JNIInvokeInterface_;
+
+#ifdef __cplusplus
+struct _JNIEnv;
+struct _JavaVM;
+typedef _JNIEnv JNIEnv;
+typedef _JavaVM JavaVM;
+#else
+typedef const struct JNINativeInterface_* JNIEnv;
+typedef const struct JNIInvokeInterface_* JavaVM;
+#endif
+
+typedef struct {
+    jint version;
+    char* name;
+    jobject group;
+} JavaVMAttachArgs;
+
+struct JNINativeInterface_ {
+    jclass (*FindClass)(JNIEnv*, const char*);
+    jmethodID (*GetMethodID)(JNIEnv*, jclass, const char*, const char*);
+    jboolean (*ExceptionCheck)(JNIEnv*);
+    void (*ExceptionDescribe)(JNIEnv*);
+    void (*ExceptionClear)(JNIEnv*);
+    jobject (*NewGlobalRef)(JNIEnv*, jobject);
+    void (*DeleteGlobalRef)(JNIEnv*, jobject);
+    void (*DeleteLocalRef)(JNIEnv*, jobject);
+    void (*CallVoidMethod)(JNIEnv*, jobject, jmethodID, ...);
+    void (*CallVoidMethodV)(JNIEnv*, jobject, jmethodID, va_list);
+    jstring (*NewString)(JNIEnv*, const jchar*, jsize);
+    jsize (*GetStringLength)(JNIEnv*, jstring);
+    jstring (*NewStringUTF)(JNIEnv*, const char*);
+    jsize (*GetStringUTFLength)(JNIEnv*, jstring);
+    const char* (*GetStringUTFChars)(JNIEnv*, jstring, jboolean*);
+    void (*ReleaseStringUTFChars)(JNIEnv*, jstring, const char*);
+    void (*GetStringUTFRegion)(JNIEnv*, jstring, jsize, jsize, char*);
+    jsize (*GetArrayLength)(JNIEnv*, jarray);
+    jbyteArray (*NewByteArray)(JNIEnv*, jsize);
+    jfloatArray (*NewFloatArray)(JNIEnv*, jsize);
+    jlongArray (*NewLongArray)(JNIEnv*, jsize);
+    jbyte* (*GetByteArrayElements)(JNIEnv*, jbyteArray, jboolean*);
+    void (*ReleaseByteArrayElements)(JNIEnv*, jbyteArray, jbyte*, jint);
+    void (*GetByteArrayRegion)(JNIEnv*, jbyteArray, jsize, jsize, jbyte*);
+    void (*SetByteArrayRegion)(JNIEnv*, jbyteArray, jsize, jsize, const jbyte*);
+    void (*SetFloatArrayRegion)(JNIEnv*, jfloatArray, jsize, jsize, const jfloat*);
+    void (*SetLongArrayRegion)(JNIEnv*, jlongArray, jsize, jsize, const jlong*);
+    void* (*GetPrimitiveArrayCritical)(JNIEnv*, jarray, jboolean*);
+    void (*ReleasePrimitiveArrayCritical)(JNIEnv*, jarray, void*, jint);
+    jobject (*NewDirectByteBuffer)(JNIEnv*, void*, jlong);
+    void* (*GetDirectBufferAddress)(JNIEnv*, jobject);
+    jlong (*GetDirectBufferCapacity)(JNIEnv*, jobject);
+};
+
+struct JNIInvokeInterface_ {
+    jint (*GetEnv)(JavaVM*, void**, jint);
+    jint (*AttachCurrentThread)(JavaVM*, void**, void*);
+    jint (*DetachCurrentThread)(JavaVM*);
+};
+
+#ifdef __cplusplus
+struct _JNIEnv {
+    const struct JNINativeInterface_* functions;
+
+    jclass FindClass(const char* name) { return functions->FindClass(this, name); }
+    jmethodID GetMethodID(jclass c, const char* name, const char* sig) { return functions->GetMethodID(this, c, name, sig); }
+    jboolean ExceptionCheck() { return functions->ExceptionCheck(this); }
+    void ExceptionDescribe() { functions->ExceptionDescribe(this); }
+    void ExceptionClear() { functions->ExceptionClear(this); }
+    jobject NewGlobalRef(jobject o) { return functions->NewGlobalRef(this, o); }
+    void DeleteGlobalRef(jobject o) { functions->DeleteGlobalRef(this, o); }
+    void DeleteLocalRef(jobject o) { functions->DeleteLocalRef(this, o); }
+    void CallVoidMethod(jobject o, jmethodID m, ...) {
+        va_list args;
+        va_start(args, m);
+        functions->CallVoidMethodV(this, o, m, args);
+        va_end(args);
+    }
+    jstring NewString(const jchar* s, jsize n) { return functions->NewString(this, s, n); }
+    jsize GetStringLength(jstring s) { return functions->GetStringLength(this, s); }
+    jstring NewStringUTF(const char* s) { return functions->NewStringUTF(this, s); }
+    jsize GetStringUTFLength(jstring s) { return functions->GetStringUTFLength(this, s); }
+    const char* GetStringUTFChars(jstring s, jboolean* copy) { return functions->GetStringUTFChars(this, s, copy); }
+    void ReleaseStringUTFChars(jstring s, const char* c) { functions->ReleaseStringUTFChars(this, s, c); }
+    void GetStringUTFRegion(jstring s, jsize start, jsize n, char* buf) { functions->GetStringUTFRegion(this, s, start, n, buf); }
+    jsize GetArrayLength(jarray a) { return functions->GetArrayLength(this, a); }
+    jbyteArray NewByteArray(jsize n) { return functions->NewByteArray(this, n); }
+    jfloatArray NewFloatArray(jsize n) { return functions->NewFloatArray(this, n); }
+    jlongArray NewLongArray(jsize n) { return functions->NewLongArray(this, n); }
+    jbyte* GetByteArrayElements(jbyteArray a, jboolean* copy) { return functions->GetByteArrayElements(this, a, copy); }
+    void ReleaseByteArrayElements(jbyteArray a, jbyte* e, jint mode) { functions->ReleaseByteArrayElements(this, a, e, mode); }
+    void GetByteArrayRegion(jbyteArray a, jsize start, jsize n, jbyte* buf) { functions->GetByteArrayRegion(this, a, start, n, buf); }
+    void SetByteArrayRegion(jbyteArray a, jsize start, jsize n, const jbyte* buf) { functions->SetByteArrayRegion(this, a, start, n, buf); }
+    void SetFloatArrayRegion(jfloatArray a, jsize start, jsize n, const jfloat* buf) { functions->SetFloatArrayRegion(this, a, start, n, buf); }
+    void SetLongArrayRegion(jlongArray a, jsize start, jsize n, const jlong* buf) { functions->SetLongArrayRegion(this, a, start, n, buf); }
+    void* GetPrimitiveArrayCritical(jarray a, jboolean* copy) { return functions->GetPrimitiveArrayCritical(this, a, copy); }
+    void ReleasePrimitiveArrayCritical(jarray a, void* p, jint mode) { functions->ReleasePrimitiveArrayCritical(this, a, p, mode); }
+    jobject NewDirectByteBuffer(void* p, jlong n) { return functions->NewDirectByteBuffer(this, p, n); }
+    void* GetDirectBufferAddress(jobject b) { return functions->GetDirectBufferAddress(this, b); }
+    jlong GetDirectBufferCapacity(jobject b) { return functions->GetDirectBufferCapacity(this, b); }
+};
+
+struct _JavaVM {
+    const struct JNIInvokeInterface_* functions;
+
+    jint GetEnv(void** env, jint version) { return functions->GetEnv(this, env, version); }
+    jint AttachCurrentThread(void** env, void* args) { return functions->AttachCurrentThread(this, env, args); }
+    jint DetachCurrentThread() { return functions->DetachCurrentThread(this); }
+};
+#endif
+
+#endif // MOCK_JNI_H
@@ -0,0 +1,269 @@
+#include "stub_rwkv_mobile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "rwkv_mobile.h"
+
+namespace stub {
+
+namespace {
+
+std::string g_payload;
+size_t g_token_bytes = 4;
+
+struct Runtime {
+    std::string prompt;
+};
+
+// 把 payload 的 [offset, end) 拷贝到 buffer，返回写入的字节数
+int copy_payload(size_t offset, char* buffer, int buffer_size) {
+    if (buffer == nullptr || buffer_size <= 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    if (offset > g_payload.size()) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const size_t n = std::min(g_payload.size() - offset, static_cast<size_t>(buffer_size));
+    memcpy(buffer, g_payload.data() + offset, n);
+    if (n < static_cast<size_t>(buffer_size)) {
+        buffer[n] = '\0';
+    }
+    return static_cast<int>(n);
+}
+
+} // namespace
+
+void set_payload(std::string payload) {
+    g_payload = std::move(payload);
+}
+
+void set_token_bytes(size_t n) {
+    g_token_bytes = std::max<size_t>(n, 1);
+}
+
+} // namespace stub
+
+using stub::g_payload;
+
+extern "C" {
+
+const char* rwkvmobile_get_platform_name(void) { return "Stub"; }
+const char* rwkvmobile_get_soc_name(void) { return "Stub"; }
+const char* rwkvmobile_get_soc_partname(void) { return "Stub"; }
+const char* rwkvmobile_get_htp_arch(void) { return "none"; }
+
+const char* rwkvmobile_dump_log(void) { return g_payload.c_str(); }
+void rwkvmobile_set_loglevel(int) {}
+void rwkvmobile_set_cache_dir(const char*) {}
+
+rwkvmobile_runtime_t rwkvmobile_runtime_init(void) {
+    return new stub::Runtime();
+}
+
+int rwkvmobile_runtime_release(rwkvmobile_runtime_t runtime) {
+    delete static_cast<stub::Runtime*>(runtime);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_get_available_backend_names(char* buffer, int buffer_size) {
+    return stub::copy_payload(0, buffer, buffer_size);
+}
+
+int rwkvmobile_runtime_set_qnn_library_path(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_add_adsp_library_path(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_load_model(rwkvmobile_runtime_t, const char*, const char*) { return 0; }
+int rwkvmobile_runtime_load_model_with_extra(rwkvmobile_runtime_t, const char*, const char*, const char*) { return 0; }
+int rwkvmobile_runtime_release_model(rwkvmobile_runtime_t, int) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_draft_model(rwkvmobile_runtime_t, int, int) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_get_speculative_stats(rwkvmobile_runtime_t, uint64_t* passes, uint64_t* drafted,
+                                             uint64_t* accepted) {
+    if (passes) *passes = 0;
+    if (drafted) *drafted = 0;
+    if (accepted) *accepted = 0;
+    return RWKVMOBILE_SUCCESS;
+}
+int rwkvmobile_runtime_load_tokenizer(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_clear_state(rwkvmobile_runtime_t) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_load_initial_state(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_unload_initial_state(rwkvmobile_runtime_t) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_get_state_snapshot_size(rwkvmobile_runtime_t, int) { return 0; }
+int rwkvmobile_runtime_save_state_to_buffer(rwkvmobile_runtime_t, int, void*, int) { return 0; }
+int rwkvmobile_runtime_save_state(rwkvmobile_runtime_t, const char*, int) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_restore_state_from_buffer(rwkvmobile_runtime_t, const void*, int) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_restore_state(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_is_generating(rwkvmobile_runtime_t) { return 0; }
+int rwkvmobile_runtime_stop_generation(rwkvmobile_runtime_t) { return RWKVMOBILE_SUCCESS; }
+
+const char* rwkvmobile_runtime_gen_completion(rwkvmobile_runtime_t, const char*, int) {
+    return strdup(g_payload.c_str());
+}
+
+int rwkvmobile_runtime_gen_completion_to_buffer(rwkvmobile_runtime_t runtime, const char* prompt, int,
+                                                char* buffer, int buffer_size) {
+    if (runtime == nullptr || prompt == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return stub::copy_payload(0, buffer, buffer_size);
+}
+
+void rwkvmobile_runtime_free_response_buffer(char* buffer) {
+    free(buffer);
+}
+
+const char* rwkvmobile_runtime_get_response_buffer_content(rwkvmobile_runtime_t) {
+    return g_payload.c_str();
+}
+
+int rwkvmobile_runtime_read_response_since(rwkvmobile_runtime_t runtime, int offset, char* buffer, int buffer_size) {
+    if (runtime == nullptr || offset < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return stub::copy_payload(static_cast<size_t>(offset), buffer, buffer_size);
+}
+
+int rwkvmobile_runtime_read_tokens(rwkvmobile_runtime_t runtime, uint64_t first,
+                                   rwkvmobile_token_record_t* records, int max_records) {
+    if (runtime == nullptr || records == nullptr || max_records < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return first == 0 ? 0 : RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+}
+
+int rwkvmobile_runtime_set_response_capacity(rwkvmobile_runtime_t, uint64_t) { return RWKVMOBILE_SUCCESS; }
+
+// 在调用线程上同步推送全部 token，回调开销即桥接开销
+int rwkvmobile_runtime_gen_completion_async(rwkvmobile_runtime_t runtime, const char* prompt, int,
+                                            rwkvmobile_token_callback_t token_callback,
+                                            rwkvmobile_completion_callback_t completion_callback,
+                                            void* user_data) {
+    if (runtime == nullptr || prompt == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    if (token_callback != nullptr) {
+        std::string token;
+        for (size_t i = 0; i < g_payload.size(); i += stub::g_token_bytes) {
+            token.assign(g_payload, i, stub::g_token_bytes);
+            token_callback(token.c_str(), user_data);
+        }
+    }
+    if (completion_callback != nullptr) {
+        completion_callback(RWKVMOBILE_SUCCESS, user_data);
+    }
+    return RWKVMOBILE_SUCCESS;
+}
+
+// stub 会话与 runtime 使用同一结构，会话函数直接转发
+rwkvmobile_session_t rwkvmobile_runtime_session_create(rwkvmobile_runtime_t runtime) {
+    return runtime != nullptr ? new stub::Runtime() : nullptr;
+}
+
+int rwkvmobile_runtime_session_destroy(rwkvmobile_runtime_t runtime, rwkvmobile_session_t session) {
+    if (runtime == nullptr || session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    delete static_cast<stub::Runtime*>(session);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_session_clear_state(rwkvmobile_session_t) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_session_stop_generation(rwkvmobile_session_t) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_session_set_prompt(rwkvmobile_session_t session, const char* prompt) {
+    return rwkvmobile_runtime_set_prompt(session, prompt);
+}
+
+int rwkvmobile_session_gen_completion_async(rwkvmobile_session_t session, const char* prompt, int max_tokens,
+                                            rwkvmobile_token_callback_t token_callback,
+                                            rwkvmobile_completion_callback_t completion_callback,
+                                            void* user_data) {
+    return rwkvmobile_runtime_gen_completion_async(session, prompt, max_tokens,
+                                                   token_callback, completion_callback, user_data);
+}
+
+int rwkvmobile_session_read_response_since(rwkvmobile_session_t session, int offset, char* buffer, int buffer_size) {
+    return rwkvmobile_runtime_read_response_since(session, offset, buffer, buffer_size);
+}
+
+int rwkvmobile_session_read_tokens(rwkvmobile_session_t session, uint64_t first,
+                                   rwkvmobile_token_record_t* records, int max_records) {
+    return rwkvmobile_runtime_read_tokens(session, first, records, max_records);
+}
+
+int rwkvmobile_runtime_set_sampler_params(rwkvmobile_runtime_t, float, float, int) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_get_sampler_params(rwkvmobile_runtime_t, float* temperature, float* top_p, int* top_k) {
+    if (temperature) *temperature = 1.0f;
+    if (top_p) *top_p = 0.85f;
+    if (top_k) *top_k = 0;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_prompt(rwkvmobile_runtime_t runtime, const char* prompt) {
+    static_cast<stub::Runtime*>(runtime)->prompt = prompt != nullptr ? prompt : "";
+    return RWKVMOBILE_SUCCESS;
+}
+
+const char* rwkvmobile_runtime_get_prompt(rwkvmobile_runtime_t runtime) {
+    return static_cast<stub::Runtime*>(runtime)->prompt.c_str();
+}
+
+int rwkvmobile_runtime_set_bos_token(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_eos_token(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_user_role(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_response_role(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+
+float rwkvmobile_runtime_get_avg_decode_speed(rwkvmobile_runtime_t) { return 0.f; }
+float rwkvmobile_runtime_get_avg_prefill_speed(rwkvmobile_runtime_t) { return 0.f; }
+
+int rwkvmobile_runtime_get_prefix_cache_stats(rwkvmobile_runtime_t, uint64_t* hits, uint64_t* misses,
+                                              uint64_t* reused_tokens, uint64_t* cached_bytes) {
+    if (hits) *hits = 0;
+    if (misses) *misses = 0;
+    if (reused_tokens) *reused_tokens = 0;
+    if (cached_bytes) *cached_bytes = 0;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_get_perf_stats(rwkvmobile_runtime_t runtime, rwkvmobile_perf_stats_t* stats) {
+    if (runtime == nullptr || stats == nullptr || stats->size < 2 * sizeof(uint32_t)) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    rwkvmobile_perf_stats_t out = {};
+    out.version = RWKVMOBILE_PERF_STATS_VERSION;
+    out.size = static_cast<uint32_t>(std::min<size_t>(stats->size, sizeof(out)));
+    memcpy(stats, &out, out.size);
+    return static_cast<int>(out.size);
+}
+
+int rwkvmobile_runtime_set_kernel_profiling(rwkvmobile_runtime_t, int) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_prefix_cache_capacity(rwkvmobile_runtime_t, uint64_t) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_prefill_chunk_size(rwkvmobile_runtime_t, int) { return RWKVMOBILE_SUCCESS; }
+int rwkvmobile_runtime_set_threads(rwkvmobile_runtime_t, int, int) { return RWKVMOBILE_SUCCESS; }
+float rwkvmobile_runtime_get_prefill_progress(rwkvmobile_runtime_t) { return 0.f; }
+
+int rwkvmobile_runtime_set_penalty_params(rwkvmobile_runtime_t, float, float, float) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_get_penalty_params(rwkvmobile_runtime_t, float* presence, float* frequency, float* decay) {
+    if (presence) *presence = 0.f;
+    if (frequency) *frequency = 0.f;
+    if (decay) *decay = 0.996f;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_constraint(rwkvmobile_runtime_t, const char*) { return RWKVMOBILE_SUCCESS; }
+
+int rwkvmobile_runtime_set_seed(rwkvmobile_runtime_t, uint64_t) { return RWKVMOBILE_SUCCESS; }
+uint64_t rwkvmobile_runtime_get_seed(rwkvmobile_runtime_t) { return 0; }
+
+// 以下符号只被旧版 C 桥接 rwkv_jni.c 引用，不在 rwkv_mobile.h 中
+int rwkvmobile_runtime_eval_chat_with_history_async(void*, const char*) { return RWKVMOBILE_SUCCESS; }
+
+} // extern "C"
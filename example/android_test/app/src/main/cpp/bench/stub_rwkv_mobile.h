@@ -0,0 +1,31 @@
+/**
+ * stub_rwkv_mobile.h
+ *
+ * Controls for the stub librwkv_mobile used by the JNI benchmarks. The stub
+ * implements every C function the bridges call without running a model;
+ * text-returning calls hand back a configurable payload so that only the
+ * bridge's marshalling cost is measured.
+ */
+
+#ifndef RWKV_BENCH_STUB_RWKV_MOBILE_H
+#define RWKV_BENCH_STUB_RWKV_MOBILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace stub {
+
+/**
+ * Text returned by dump_log, the response buffer, gen_completion*,
+ * get_available_backend_names and streamed by gen_completion_async.
+ */
+void set_payload(std::string payload);
+
+/**
+ * Bytes per token delivered by gen_completion_async (default 4).
+ */
+void set_token_bytes(size_t n);
+
+} // namespace stub
+
+#endif // RWKV_BENCH_STUB_RWKV_MOBILE_H
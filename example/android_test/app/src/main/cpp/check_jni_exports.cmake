@@ -0,0 +1,28 @@
+# 检查 RwkvMobile.kt 中的每个 external fun 在 JNI 桥接源码里都有对应的导出函数，
+# 缺少的函数要到 Kotlin 调用时才以 UnsatisfiedLinkError 暴露。
+# 用法：cmake -DKOTLIN=<RwkvMobile.kt> -DBRIDGE=<rwkv_jni.cpp> -P check_jni_exports.cmake
+file(STRINGS ${KOTLIN} declarations REGEX "external fun [A-Za-z0-9_]+")
+file(READ ${BRIDGE} bridge)
+
+set(missing "")
+set(count 0)
+foreach(line ${declarations})
+    string(REGEX MATCH "external fun ([A-Za-z0-9_]+)" _ "${line}")
+    set(name ${CMAKE_MATCH_1})
+    # JNI 名字修饰：'_' 写作 "_1"
+    string(REPLACE "_" "_1" mangled ${name})
+    string(FIND "${bridge}" "Java_com_example_rwkvmobiletest_RwkvMobile_${mangled}(" position)
+    if(position EQUAL -1)
+        list(APPEND missing ${name})
+    endif()
+    math(EXPR count "${count} + 1")
+endforeach()
+
+if(count EQUAL 0)
+    message(FATAL_ERROR "no external fun found in ${KOTLIN}")
+endif()
+if(missing)
+    list(JOIN missing "\n  " names)
+    message(FATAL_ERROR "external fun without a JNI export in ${BRIDGE}:\n  ${names}")
+endif()
+message(STATUS "${count} external functions, all exported")
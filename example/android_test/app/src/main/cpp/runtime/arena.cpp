@@ -0,0 +1,59 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace rwkvmobile {
+
+void Arena::add_chunk(size_t min_bytes) {
+    Chunk chunk;
+    chunk.size = std::max(min_bytes, initial_bytes_);
+    chunk.data.reset(new unsigned char[chunk.size]);
+    chunks_.push_back(std::move(chunk));
+    ++chunk_allocations_;
+}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    if (bytes == 0) {
+        bytes = 1;
+    }
+    for (; current_ < chunks_.size(); ++current_, used_ = 0) {
+        Chunk& chunk = chunks_[current_];
+        const uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data.get());
+        const size_t offset = ((base + used_ + align - 1) & ~(uintptr_t(align) - 1)) - base;
+        if (offset + bytes <= chunk.size) {
+            used_ = offset + bytes;
+            return chunk.data.get() + offset;
+        }
+    }
+    // 新块至少能放下这次分配，并随已用总量翻倍
+    add_chunk(std::max(bytes + align, capacity()));
+    current_ = chunks_.size() - 1;
+    used_ = 0;
+    return allocate(bytes, align);
+}
+
+std::string_view Arena::copy(std::string_view s) {
+    char* dst = static_cast<char*>(allocate(s.size() + 1, 1));
+    memcpy(dst, s.data(), s.size());
+    dst[s.size()] = '\0';
+    return std::string_view(dst, s.size());
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (const Chunk& chunk : chunks_) total += chunk.size;
+    return total;
+}
+
+void Arena::reset() {
+    if (chunks_.size() > 1) {
+        const size_t total = capacity();
+        chunks_.clear();
+        add_chunk(total);
+    }
+    current_ = 0;
+    used_ = 0;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,94 @@
+/**
+ * arena.h
+ *
+ * Bump allocator for the transient data of one generation (prompt text and
+ * tokens, stop sequences, the token hand-off queue). Allocation is a pointer
+ * bump; nothing is freed individually. reset() at the start of the next
+ * generation rewinds it, and if the previous generation needed more than the
+ * first chunk the chunks are merged into one of the combined size, so after
+ * the first few generations the arena no longer allocates at all.
+ */
+
+#ifndef RWKVMOBILE_ARENA_H
+#define RWKVMOBILE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rwkvmobile {
+
+class Arena {
+public:
+    explicit Arena(size_t initial_bytes = 64 * 1024) : initial_bytes_(initial_bytes) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 未初始化的内存，按 align 对齐，直到 reset() 之前有效
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate_array(size_t n) {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // 拷贝一份字符串（其后补 NUL），返回指向 arena 的视图
+    std::string_view copy(std::string_view s);
+
+    // 丢弃全部分配；之前的分配跨了多块时合并成一块
+    void reset();
+
+    // 向系统申请内存块的累计次数（预热之后应保持不变）
+    uint64_t chunk_allocations() const { return chunk_allocations_; }
+    size_t capacity() const;
+
+private:
+    struct Chunk {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size = 0;
+    };
+
+    void add_chunk(size_t min_bytes);
+
+    size_t initial_bytes_;
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;  // 正在使用的块
+    size_t used_ = 0;     // 该块已用的字节
+    uint64_t chunk_allocations_ = 0;
+};
+
+// 供标准容器使用的 arena 分配器；deallocate 不做任何事
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(size_t n) { return arena_->allocate_array<T>(n); }
+    void deallocate(T*, size_t) {}
+
+    Arena* arena() const { return arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena(); }
+
+private:
+    Arena* arena_;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_ARENA_H
@@ -0,0 +1,100 @@
+/**
+ * binary_io.h
+ *
+ * Helpers shared by the on-disk formats (packed models, compiled vocabs,
+ * state snapshots): explicit little-endian field access, FNV-1a hashing,
+ * and writing a file through a temporary file and a rename so that a
+ * failed or interrupted write never leaves a partial file at the target
+ * path. Internal to the runtime.
+ */
+
+#ifndef RWKVMOBILE_BINARY_IO_H
+#define RWKVMOBILE_BINARY_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "logger.h"
+
+namespace rwkvmobile {
+
+constexpr bool kLittleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+// 头部字段一律按小端逐字节读写，与主机字节序无关
+inline void store_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline void store_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+inline uint32_t load_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+    return v;
+}
+
+inline uint64_t load_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return v;
+}
+
+// 逐字节 FNV-1a
+inline uint64_t fnv1a_bytes(const uint8_t* p, size_t n, uint64_t h = kFnvOffset) {
+    for (size_t i = 0; i < n; ++i) {
+        h = (h ^ p[i]) * kFnvPrime;
+    }
+    return h;
+}
+
+// 按 8 字节字做 FNV-1a，n 必须是 8 的倍数。字按主机字节序读取，等于小端字的结果只在小端主机上成立，
+// 用它做校验和的格式都只在小端主机上读写
+inline uint64_t fnv1a_words(const uint8_t* p, size_t n, uint64_t h = kFnvOffset) {
+    for (size_t i = 0; i < n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * kFnvPrime;
+    }
+    return h;
+}
+
+/**
+ * Create `path` + ".tmp", let `write(FILE*)` fill it (it may seek), then
+ * rename it over `path`. On any failure the temporary file is removed and
+ * `path` is left as it was.
+ * @param what  description for the error log, e.g. "state snapshot"
+ * @return false on I/O errors or if `write` returned false (logged)
+ */
+template <typename WriteFn>
+bool write_file_atomically(const std::string& path, const char* what, WriteFn&& write) {
+    const std::string tmp = path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (fp == nullptr) {
+        RWKV_LOGE("Failed to create %s", tmp.c_str());
+        return false;
+    }
+    bool ok = write(fp);
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        RWKV_LOGE("Failed to write %s %s", what, path.c_str());
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+inline bool write_file_atomically(const std::string& path, const char* what, const uint8_t* data, size_t size) {
+    return write_file_atomically(path, what, [&](FILE* fp) { return fwrite(data, 1, size, fp) == size; });
+}
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_BINARY_IO_H
@@ -0,0 +1,288 @@
+#include "compiled_vocab.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "mapped_file.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'R', 'W', 'V', 'C'};
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kChecksumOffset = 40;
+
+static_assert(sizeof(VocabUnit) == 12, "VocabUnit is stored as three int32");
+
+size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+// 各段的位置由头部的计数决定
+struct Layout {
+    size_t offsets;
+    size_t units;
+    size_t bytes;
+    size_t total;
+};
+
+Layout layout_of(size_t vocab_size, size_t unit_count, size_t bytes_size) {
+    Layout l;
+    l.offsets = kHeaderSize;
+    l.units = align8(l.offsets + (vocab_size + 1) * sizeof(uint32_t));
+    l.bytes = align8(l.units + unit_count * sizeof(VocabUnit));
+    l.total = align8(l.bytes + bytes_size);
+    return l;
+}
+
+// 整个文件的校验和，校验和字段按 0 计
+uint64_t file_checksum(const uint8_t* data, size_t size) {
+    uint64_t h = fnv1a_words(data, kChecksumOffset);
+    h *= kFnvPrime;
+    return fnv1a_words(data + kChecksumOffset + 8, size - kChecksumOffset - 8, h);
+}
+
+// 按字节序排好、去重后的 key 逐层放入双数组：每个节点的子节点一起找一个
+// base，使 base + 各子节点字节都还空闲
+class TrieBuilder {
+public:
+    explicit TrieBuilder(const std::vector<std::pair<std::string, int>>& keys) : keys_(keys) {}
+
+    bool build(std::vector<VocabUnit>* units) {
+        units_.assign(256, VocabUnit{0, -1, 0});
+        units_[0].check = 0;
+        if (!insert(0, 0, keys_.size(), 0)) {
+            return false;
+        }
+        // 去掉末尾的空闲单元；查找时 t 越界即视为不存在
+        size_t n = units_.size();
+        while (n > 1 && units_[n - 1].check < 0) --n;
+        units_.resize(n);
+        units->swap(units_);
+        return true;
+    }
+
+private:
+    size_t find_base(const uint8_t* labels, size_t n) {
+        while (first_free_ < units_.size() && units_[first_free_].check >= 0) ++first_free_;
+        size_t base = first_free_ > labels[0] ? first_free_ - labels[0] : 1;
+        for (;; ++base) {
+            const size_t last = base + labels[n - 1];
+            if (last >= units_.size()) {
+                units_.resize(std::max(last + 1, units_.size() * 2), VocabUnit{0, -1, 0});
+            }
+            bool free = true;
+            for (size_t i = 0; i < n && free; ++i) free = units_[base + labels[i]].check < 0;
+            if (free) return base;
+        }
+    }
+
+    // keys_[begin, end) 共享长度为 depth 的前缀，对应节点 node
+    bool insert(size_t node, size_t begin, size_t end, size_t depth) {
+        if (begin < end && keys_[begin].first.size() == depth) {
+            units_[node].id = keys_[begin].second;
+            ++begin;
+        }
+        if (begin == end) {
+            return true;
+        }
+        uint8_t labels[256];
+        size_t starts[257];
+        size_t n = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const uint8_t c = static_cast<uint8_t>(keys_[i].first[depth]);
+            if (n == 0 || labels[n - 1] != c) {
+                labels[n] = c;
+                starts[n++] = i;
+            }
+        }
+        starts[n] = end;
+
+        const size_t base = find_base(labels, n);
+        if (base + labels[n - 1] > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+            RWKV_LOGE("Vocab trie is too large");
+            return false;
+        }
+        units_[node].base = static_cast<int32_t>(base);
+        for (size_t i = 0; i < n; ++i) units_[base + labels[i]].check = static_cast<int32_t>(node);
+        for (size_t i = 0; i < n; ++i) {
+            if (!insert(base + labels[i], starts[i], starts[i + 1], depth + 1)) return false;
+        }
+        return true;
+    }
+
+    const std::vector<std::pair<std::string, int>>& keys_;
+    std::vector<VocabUnit> units_;
+    size_t first_free_ = 1;
+};
+
+} // namespace
+
+bool is_compiled_vocab(const uint8_t* data, size_t size) {
+    return data != nullptr && size >= sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool compile_vocab(const std::vector<std::pair<std::string, int>>& tokens, std::vector<uint8_t>* out) {
+    if (!kLittleEndian) {
+        RWKV_LOGE("Compiled vocabs can only be built on little-endian hosts");
+        return false;
+    }
+    if (tokens.empty()) {
+        RWKV_LOGE("Empty vocab");
+        return false;
+    }
+    // 同一 id 或同样字节出现多次时以后出现的为准，与逐行读入文本词表一致
+    std::vector<const std::string*> by_id;
+    for (const auto& t : tokens) {
+        if (t.second <= 0) {
+            RWKV_LOGE("Invalid token id %d", t.second);
+            return false;
+        }
+        if (static_cast<size_t>(t.second) >= by_id.size()) by_id.resize(static_cast<size_t>(t.second) + 1);
+        by_id[static_cast<size_t>(t.second)] = &t.first;
+    }
+    std::vector<std::pair<std::string, int>> keys;
+    keys.reserve(tokens.size());
+    for (const auto& t : tokens) {
+        if (!t.first.empty()) keys.push_back(t);
+    }
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b) {
+                         return a.first < b.first;
+                     });
+    size_t unique = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i + 1 < keys.size() && keys[i + 1].first == keys[i].first) continue;
+        if (unique != i) keys[unique] = std::move(keys[i]);
+        ++unique;
+    }
+    keys.resize(unique);
+
+    std::vector<VocabUnit> units;
+    if (!TrieBuilder(keys).build(&units)) {
+        return false;
+    }
+
+    const size_t vocab_size = by_id.size();
+    std::vector<uint32_t> offsets(vocab_size + 1);
+    std::string bytes;
+    size_t max_len = 0;
+    size_t count = 0;
+    for (size_t id = 0; id < vocab_size; ++id) {
+        offsets[id] = static_cast<uint32_t>(bytes.size());
+        if (by_id[id] != nullptr) {
+            bytes += *by_id[id];
+            max_len = std::max(max_len, by_id[id]->size());
+            ++count;
+        }
+        bytes += '\0';
+        if (bytes.size() > std::numeric_limits<uint32_t>::max()) {
+            RWKV_LOGE("Vocab byte table is too large");
+            return false;
+        }
+    }
+    offsets[vocab_size] = static_cast<uint32_t>(bytes.size());
+
+    const Layout l = layout_of(vocab_size, units.size(), bytes.size());
+    out->assign(l.total, 0);
+    uint8_t* p = out->data();
+    memcpy(p, kMagic, sizeof(kMagic));
+    store_u32(p + 4, kVocabLayoutVersion);
+    store_u32(p + 8, static_cast<uint32_t>(vocab_size));
+    store_u32(p + 12, static_cast<uint32_t>(count));
+    store_u32(p + 16, static_cast<uint32_t>(max_len));
+    store_u32(p + 20, static_cast<uint32_t>(units.size()));
+    store_u32(p + 24, static_cast<uint32_t>(bytes.size()));
+    store_u64(p + 32, l.total);
+    // offsets 与 trie 单元按主机布局原样写出：加载时直接把映射当作 uint32_t / VocabUnit 数组使用，
+    // 不做逐项转换；因此这个格式只在小端主机上生成和读取（缓存文件也只在本机使用）
+    memcpy(p + l.offsets, offsets.data(), offsets.size() * sizeof(uint32_t));
+    memcpy(p + l.units, units.data(), units.size() * sizeof(VocabUnit));
+    memcpy(p + l.bytes, bytes.data(), bytes.size());
+    store_u64(p + kChecksumOffset, file_checksum(p, l.total));
+    return true;
+}
+
+bool read_compiled_vocab(const uint8_t* data, size_t size, CompiledVocab* vocab) {
+    if (!kLittleEndian) {
+        RWKV_LOGE("Compiled vocabs are only supported on little-endian hosts");
+        return false;
+    }
+    if (size < kHeaderSize || !is_compiled_vocab(data, size)) {
+        RWKV_LOGE("Not a compiled RWKV vocab");
+        return false;
+    }
+    const uint32_t version = load_u32(data + 4);
+    if (version != kVocabLayoutVersion) {
+        RWKV_LOGE("Unsupported compiled vocab layout version %u", version);
+        return false;
+    }
+    const uint32_t vocab_size = load_u32(data + 8);
+    const uint32_t unit_count = load_u32(data + 20);
+    const uint32_t bytes_size = load_u32(data + 24);
+    const Layout l = layout_of(vocab_size, unit_count, bytes_size);
+    if (load_u64(data + 32) != size || l.total != size || vocab_size == 0 || unit_count == 0) {
+        RWKV_LOGE("Compiled vocab is truncated or corrupt");
+        return false;
+    }
+    if (file_checksum(data, size) != load_u64(data + kChecksumOffset)) {
+        RWKV_LOGE("Compiled vocab checksum mismatch");
+        return false;
+    }
+
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data + l.offsets);
+    const VocabUnit* units = reinterpret_cast<const VocabUnit*>(data + l.units);
+    const char* bytes = reinterpret_cast<const char*>(data + l.bytes);
+    // 每个 token 至少有结尾的 NUL，解码时可以直接当 C 字符串用
+    if (offsets[0] != 0 || offsets[vocab_size] != bytes_size) {
+        RWKV_LOGE("Compiled vocab has an invalid byte table");
+        return false;
+    }
+    for (uint32_t i = 0; i < vocab_size; ++i) {
+        if (offsets[i + 1] <= offsets[i] || offsets[i + 1] > bytes_size || bytes[offsets[i + 1] - 1] != '\0') {
+            RWKV_LOGE("Compiled vocab has an invalid byte table");
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < unit_count; ++i) {
+        if (units[i].id < 0 || static_cast<uint32_t>(units[i].id) >= vocab_size) {
+            RWKV_LOGE("Compiled vocab has an invalid trie");
+            return false;
+        }
+    }
+
+    vocab->offsets = offsets;
+    vocab->units = units;
+    vocab->bytes = bytes;
+    vocab->vocab_size = vocab_size;
+    vocab->token_count = load_u32(data + 12);
+    vocab->max_token_len = load_u32(data + 16);
+    vocab->unit_count = unit_count;
+    return true;
+}
+
+bool write_compiled_vocab(const std::string& path, const uint8_t* data, size_t size) {
+    return write_file_atomically(path, "compiled vocab", data, size);
+}
+
+std::string compiled_vocab_cache_path(const std::string& cache_dir, const std::string& vocab_path) {
+    MappedFile file;
+    if (!file.open(vocab_path)) {
+        return std::string();
+    }
+    // 文本词表只有 1 MB 左右，直接对内容做哈希
+    const uint64_t fields[2] = {static_cast<uint64_t>(file.size()), kVocabLayoutVersion};
+    uint64_t key = fnv1a_bytes(reinterpret_cast<const uint8_t*>(fields), sizeof(fields));
+    key = fnv1a_bytes(file.data(), file.size(), key);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx.rwkvvocab", static_cast<unsigned long long>(key));
+    std::string path = cache_dir;
+    if (!path.empty() && path.back() != '/') path += '/';
+    return path + name;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,89 @@
+/**
+ * compiled_vocab.h
+ *
+ * The compiled vocab format (".rwkvvocab"): an RWKV text vocab turned into
+ * a double-array trie plus a contiguous token byte table, laid out so a
+ * loader maps the file and encodes/decodes straight from the mapping.
+ *
+ * Layout (every section 8-byte aligned; the offsets and units are the
+ * host's in-memory arrays, mapped and used without conversion, so the
+ * format is little endian and only built or loaded on little-endian hosts):
+ *   [0, 64)     header: magic "RWVC", layout version, vocab size (max id +
+ *               1), token count, max token length, unit count, byte table
+ *               size, file size, checksum
+ *   offsets     uint32[vocab size + 1]; token i is bytes[offsets[i],
+ *               offsets[i + 1] - 1) followed by a NUL (ids without a token
+ *               are an empty string)
+ *   units       VocabUnit[unit count]; unit 0 is the root, the child of
+ *               unit s on byte c is t = base[s] + c if check[t] == s
+ *   bytes       the token byte table
+ *
+ * The checksum covers the whole file and is checked on every load.
+ */
+
+#ifndef RWKVMOBILE_COMPILED_VOCAB_H
+#define RWKVMOBILE_COMPILED_VOCAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rwkvmobile {
+
+constexpr uint32_t kVocabLayoutVersion = 1;
+
+struct VocabUnit {
+    int32_t base;
+    int32_t check;  // 父节点下标，-1 表示空闲
+    int32_t id;     // 在此结束的 token，0 表示没有
+};
+
+// 指向映射或内存中的编译词表，不拥有数据
+struct CompiledVocab {
+    const uint32_t* offsets = nullptr;
+    const VocabUnit* units = nullptr;
+    const char* bytes = nullptr;
+    uint32_t vocab_size = 0;
+    uint32_t token_count = 0;
+    uint32_t max_token_len = 0;
+    uint32_t unit_count = 0;
+};
+
+/**
+ * Whether `data` starts with the compiled-vocab magic.
+ */
+bool is_compiled_vocab(const uint8_t* data, size_t size);
+
+/**
+ * Compile (bytes, id) pairs into the compiled format in `out`. Ids must be
+ * positive; when two entries have the same bytes the later one wins, as
+ * with the text loader.
+ * @return false on empty input, an invalid id or an oversized table (logged)
+ */
+bool compile_vocab(const std::vector<std::pair<std::string, int>>& tokens, std::vector<uint8_t>* out);
+
+/**
+ * Validate a compiled vocab (magic, version, size, checksum, offsets) and
+ * point `vocab` into `data`.
+ */
+bool read_compiled_vocab(const uint8_t* data, size_t size, CompiledVocab* vocab);
+
+/**
+ * Write `size` bytes of a compiled vocab to `path` (via a temporary file and
+ * a rename).
+ * @return false on I/O errors (logged)
+ */
+bool write_compiled_vocab(const std::string& path, const uint8_t* data, size_t size);
+
+/**
+ * Path of the compiled copy of the text vocab `vocab_path` in `cache_dir`,
+ * named by a hash of the vocab contents and the layout version.
+ * @return empty if the vocab cannot be read
+ */
+std::string compiled_vocab_cache_path(const std::string& cache_dir, const std::string& vocab_path);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_COMPILED_VOCAB_H
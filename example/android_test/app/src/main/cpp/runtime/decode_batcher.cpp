@@ -0,0 +1,79 @@
+#include "decode_batcher.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace rwkvmobile {
+
+namespace {
+
+// leader 等待其余会话提交的最长时间。会话在两步之间只做采样和 token 回调，
+// 通常远小于此值；回调阻塞的会话不会拖住其他会话超过这个时间
+constexpr auto kGatherWindow = std::chrono::microseconds(500);
+
+} // namespace
+
+void DecodeBatcher::join() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++participants_;
+}
+
+void DecodeBatcher::leave() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --participants_;
+    // 正在等待的 leader 可能只差这个会话
+    cv_.notify_all();
+}
+
+void DecodeBatcher::forward(int model_id, const Model& model, int token, State& state, float* logits,
+                            ThreadPool* pool) {
+    Request request{token, &state, logits};
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_.push_back(&request);
+    cv_.notify_all();
+    while (!request.done) {
+        if (!leader_active_) {
+            run_batch(lock, model_id, model, pool);
+        } else {
+            cv_.wait(lock);
+        }
+    }
+}
+
+void DecodeBatcher::run_batch(std::unique_lock<std::mutex>& lock, int model_id, const Model& model,
+                              ThreadPool* pool) {
+    leader_active_ = true;
+    const int max_batch = max_batch_.load();
+    cv_.wait_for(lock, kGatherWindow, [&]() {
+        return static_cast<int>(queue_.size()) >= std::min(max_batch, participants_);
+    });
+
+    // 先到先服务；超出 max_batch 的请求留给下一个 leader
+    const int n = std::min(static_cast<int>(queue_.size()), max_batch);
+    batch_.assign(queue_.begin(), queue_.begin() + n);
+    queue_.erase(queue_.begin(), queue_.begin() + n);
+    lock.unlock();
+
+    if (scratch_model_id_ != model_id || scratch_.batch != max_batch) {
+        scratch_.init(model.config(), max_batch);
+        scratch_model_id_ = model_id;
+    }
+    tokens_.resize(n);
+    states_.resize(n);
+    logits_.resize(n);
+    for (int i = 0; i < n; ++i) {
+        tokens_[i] = batch_[i]->token;
+        states_[i] = batch_[i]->state;
+        logits_[i] = batch_[i]->logits;
+    }
+    model.forward_batch(tokens_.data(), states_.data(), n, scratch_, logits_.data(), pool);
+
+    lock.lock();
+    for (Request* request : batch_) {
+        request->done = true;
+    }
+    leader_active_ = false;
+    cv_.notify_all();
+}
+
+} // namespace rwkvmobile
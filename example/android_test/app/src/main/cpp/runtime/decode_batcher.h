@@ -0,0 +1,94 @@
+/**
+ * decode_batcher.h
+ *
+ * Gathers the next-token steps of all sessions that are decoding on the same
+ * runtime and runs them as one Model::forward_batch() call. Decode is
+ * memory-bandwidth bound (every token streams all weights), so batching N
+ * sessions costs roughly one weight pass instead of N.
+ *
+ * There is no scheduler thread: the first generation thread to submit a step
+ * becomes the leader, waits briefly for the other decoding sessions to
+ * submit theirs, runs the batch and wakes them up with their logits.
+ */
+
+#ifndef RWKVMOBILE_DECODE_BATCHER_H
+#define RWKVMOBILE_DECODE_BATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "model.h"
+
+namespace rwkvmobile {
+
+class DecodeBatcher {
+public:
+    /**
+     * Largest number of sequences per forward pass. 1 (the default)
+     * disables batching: sessions call Model::forward() directly.
+     * Only changed while no session is generating.
+     */
+    void set_max_batch(int n) { max_batch_.store(n < 1 ? 1 : n); }
+    int max_batch() const { return max_batch_.load(); }
+    bool enabled() const { return max_batch() > 1; }
+
+    /**
+     * Marks a session as decoding for its lifetime, so a leader knows how
+     * many steps to wait for before running a batch.
+     */
+    class Participant {
+    public:
+        explicit Participant(DecodeBatcher& batcher) : batcher_(batcher) { batcher_.join(); }
+        ~Participant() { batcher_.leave(); }
+
+        Participant(const Participant&) = delete;
+        Participant& operator=(const Participant&) = delete;
+
+    private:
+        DecodeBatcher& batcher_;
+    };
+
+    /**
+     * Feed `token` into `state` and write the next-token logits, batched
+     * with the steps other participants submit concurrently. Blocks until
+     * this step has run. All concurrent callers must use the same model
+     * (the caller holds the runtime's model read lock).
+     */
+    void forward(int model_id, const Model& model, int token, State& state, float* logits,
+                 ThreadPool* pool = nullptr);
+
+private:
+    struct Request {
+        int token;
+        State* state;
+        float* logits;
+        bool done = false;
+    };
+
+    void join();
+    void leave();
+    // 持有 mutex_ 调用；解锁执行一批后重新加锁
+    void run_batch(std::unique_lock<std::mutex>& lock, int model_id, const Model& model, ThreadPool* pool);
+
+    std::atomic<int> max_batch_{1};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Request*> queue_;
+    int participants_ = 0;
+    bool leader_active_ = false;
+
+    // 由当前 leader 独占使用
+    ForwardScratch scratch_;
+    int scratch_model_id_ = -1;
+    std::vector<Request*> batch_;
+    std::vector<int> tokens_;
+    std::vector<State*> states_;
+    std::vector<float*> logits_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_DECODE_BATCHER_H
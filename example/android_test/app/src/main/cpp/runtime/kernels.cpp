@@ -0,0 +1,332 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kernels_quant.h"
+#include "kernels_wkv.h"
+#include "platform.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+float dot_q8_scalar(const int8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    float sum = 0.f;
+    for (int g = 0; g < groups; ++g) {
+        int32_t acc = 0;
+        for (int i = 0; i < kQuantGroup; ++i) acc += w[i] * x[i];
+        sum += static_cast<float>(acc) * ws[g] * xs[g];
+        w += kQuantGroup;
+        x += kQuantGroup;
+    }
+    return sum;
+}
+
+// int4 组内布局：第 i 个字节的低 4 位是元素 i，高 4 位是元素 i + 16，均偏移 +8 存储
+float dot_q4_scalar(const uint8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    float sum = 0.f;
+    for (int g = 0; g < groups; ++g) {
+        int32_t acc = 0;
+        for (int i = 0; i < kQuantGroup / 2; ++i) {
+            acc += ((w[i] & 0x0F) - 8) * x[i] + ((w[i] >> 4) - 8) * x[i + kQuantGroup / 2];
+        }
+        sum += static_cast<float>(acc) * ws[g] * xs[g];
+        w += kQuantGroup / 2;
+        x += kQuantGroup;
+    }
+    return sum;
+}
+
+const QuantKernels kScalarKernels = {"scalar", dot_q8_scalar, dot_q4_scalar, nullptr, nullptr};
+
+const QuantKernels& select_quant_kernels() {
+    const uint32_t features = cpu_features();
+    const QuantKernels* k = nullptr;
+    if (!k && (features & kCpuAvx512)) k = quant_kernels_avx512();
+    if (!k && (features & kCpuAvx2)) k = quant_kernels_avx2();
+    if (!k && (features & kCpuI8mm) && (features & kCpuDotProd)) k = quant_kernels_i8mm();
+    if (!k && (features & kCpuDotProd)) k = quant_kernels_dotprod();
+    return k ? *k : kScalarKernels;
+}
+
+const QuantKernels& quant_kernels() {
+    static const QuantKernels& kernels = select_quant_kernels();
+    return kernels;
+}
+
+const WkvKernel kScalarWkv = {"scalar", [](int S, const float* r, const float* k, const float* v, const float* w,
+                                            const float* u, float* state, float* y) {
+    wkv_columns(S, 0, r, k, v, w, u, state, y);
+}};
+
+const WkvKernel& select_wkv_kernel() {
+    const uint32_t features = cpu_features();
+    const WkvKernel* k = nullptr;
+    if (!k && (features & kCpuAvx512)) k = wkv_kernel_avx512();
+    if (!k && (features & kCpuAvx2)) k = wkv_kernel_avx2();
+    if (!k && (features & kCpuNeon)) k = wkv_kernel_neon();
+    return k ? *k : kScalarWkv;
+}
+
+const WkvKernel& wkv_kernel() {
+    static const WkvKernel& kernel = select_wkv_kernel();
+    return kernel;
+}
+
+// 顺序路径（matvec / matmat）使用的激活缓冲区，每个线程一份，只增不减
+thread_local QuantizedActivations t_input;
+
+void matmat_quant(const Matrix& w, const float* x, int ldx, float* y, int ldy, int n, bool add) {
+    QuantizedActivations& in = t_input;
+    quantize_activations(x, ldx, n, w.cols, in);
+    matmat_quantized(w, in, y, ldy, add);
+}
+
+} // namespace
+
+void quantize_activations(const float* x, int ldx, int n, int cols, QuantizedActivations& out) {
+    const int groups = cols / kQuantGroup;
+    out.n = n;
+    out.cols = cols;
+    if (out.q.size() < static_cast<size_t>(n) * cols) out.q.resize(static_cast<size_t>(n) * cols);
+    if (out.scales.size() < static_cast<size_t>(n) * groups) out.scales.resize(static_cast<size_t>(n) * groups);
+    for (int b = 0; b < n; ++b) {
+        const float* xb = x + static_cast<size_t>(b) * ldx;
+        int8_t* qb = out.q.data() + static_cast<size_t>(b) * cols;
+        float* sb = out.scales.data() + static_cast<size_t>(b) * groups;
+        for (int g = 0; g < groups; ++g) {
+            const float* xg = xb + g * kQuantGroup;
+            float amax = 0.f;
+            for (int i = 0; i < kQuantGroup; ++i) amax = std::max(amax, std::fabs(xg[i]));
+            const float scale = amax / 127.f;
+            const float inv = scale > 0.f ? 1.f / scale : 0.f;
+            sb[g] = scale;
+            for (int i = 0; i < kQuantGroup; ++i) {
+                qb[g * kQuantGroup + i] = static_cast<int8_t>(std::lrintf(xg[i] * inv));
+            }
+        }
+    }
+}
+
+void matmat_quantized(const Matrix& w, const QuantizedActivations& in, float* y, int ldy, bool add) {
+    const QuantKernels& k = quant_kernels();
+    const int n = in.n;
+    const int cols = w.cols;
+    const int groups = cols / kQuantGroup;
+    const size_t row_bytes = w.row_bytes();
+
+    auto row_q = [&](int r) { return w.q + static_cast<size_t>(r) * row_bytes; };
+    auto row_s = [&](int r) { return w.scales + static_cast<size_t>(r) * groups; };
+    auto in_q = [&](int b) { return in.q.data() + static_cast<size_t>(b) * cols; };
+    auto in_s = [&](int b) { return in.scales.data() + static_cast<size_t>(b) * groups; };
+    auto put = [&](int b, int r, float v) {
+        float& dst = y[static_cast<size_t>(b) * ldy + r];
+        dst = add ? dst + v : v;
+    };
+    auto dot1 = [&](int r, int b) {
+        if (w.type == WeightType::kQ8) {
+            return k.dot_q8(reinterpret_cast<const int8_t*>(row_q(r)), row_s(r), in_q(b), in_s(b), groups);
+        }
+        return k.dot_q4(row_q(r), row_s(r), in_q(b), in_s(b), groups);
+    };
+
+    int r = 0;
+    const bool has_2x2 = w.type == WeightType::kQ8 ? k.dot_q8_2x2 != nullptr : k.dot_q4_2x2 != nullptr;
+    if (n >= 2 && has_2x2) {
+        // 两行权重 x 两个激活一起算（i8mm 的 2x2 矩阵乘）
+        for (; r + 2 <= w.rows; r += 2) {
+            int b = 0;
+            for (; b + 2 <= n; b += 2) {
+                float out[4];
+                if (w.type == WeightType::kQ8) {
+                    k.dot_q8_2x2(reinterpret_cast<const int8_t*>(row_q(r)), reinterpret_cast<const int8_t*>(row_q(r + 1)),
+                                 row_s(r), row_s(r + 1), in_q(b), in_q(b + 1), in_s(b), in_s(b + 1), groups, out);
+                } else {
+                    k.dot_q4_2x2(row_q(r), row_q(r + 1), row_s(r), row_s(r + 1),
+                                 in_q(b), in_q(b + 1), in_s(b), in_s(b + 1), groups, out);
+                }
+                put(b, r, out[0]);
+                put(b + 1, r, out[1]);
+                put(b, r + 1, out[2]);
+                put(b + 1, r + 1, out[3]);
+            }
+            for (; b < n; ++b) {
+                put(b, r, dot1(r, b));
+                put(b, r + 1, dot1(r + 1, b));
+            }
+        }
+    }
+    for (; r < w.rows; ++r) {
+        for (int b = 0; b < n; ++b) {
+            put(b, r, dot1(r, b));
+        }
+    }
+}
+
+const QuantKernels* quant_kernels_scalar() { return &kScalarKernels; }
+
+const char* quant_kernel_name() { return quant_kernels().name; }
+
+const WkvKernel* wkv_kernel_scalar() { return &kScalarWkv; }
+
+const char* wkv_kernel_name() { return wkv_kernel().name; }
+
+void wkv(int S, int T, size_t stride, const float* r, const float* k, const float* v, float* w,
+         const float* u, float* state, float* y) {
+    const WkvKernel& kernel = wkv_kernel();
+    for (int t = 0; t < T; ++t) {
+        const size_t off = static_cast<size_t>(t) * stride;
+        float* wt = w + off;
+        for (int j = 0; j < S; ++j) wt[j] = std::exp(-std::exp(wt[j]));
+        kernel.step(S, r + off, k + off, v + off, wt, u, state, y + off);
+    }
+}
+
+const char* weight_type_name(WeightType type) {
+    switch (type) {
+        case WeightType::kF32: return "fp32";
+        case WeightType::kQ8: return "int8";
+        case WeightType::kQ4: return "int4";
+    }
+    return "unknown";
+}
+
+size_t Matrix::row_bytes() const {
+    switch (type) {
+        case WeightType::kF32: return static_cast<size_t>(cols) * sizeof(float);
+        case WeightType::kQ8: return static_cast<size_t>(cols);
+        case WeightType::kQ4: return static_cast<size_t>(cols) / 2;
+    }
+    return 0;
+}
+
+size_t Matrix::bytes() const {
+    size_t n = static_cast<size_t>(rows) * row_bytes();
+    if (type != WeightType::kF32) {
+        n += static_cast<size_t>(rows) * (static_cast<size_t>(cols) / kQuantGroup) * sizeof(float);
+    }
+    return n;
+}
+
+Matrix row_slice(const Matrix& w, int begin, int end) {
+    Matrix part = w;
+    part.rows = end - begin;
+    if (w.type == WeightType::kF32) {
+        part.data = w.data + static_cast<size_t>(begin) * w.cols;
+    } else {
+        part.q = w.q + static_cast<size_t>(begin) * w.row_bytes();
+        part.scales = w.scales + static_cast<size_t>(begin) * (w.cols / kQuantGroup);
+    }
+    return part;
+}
+
+void quantize_matrix(const float* src, int rows, int cols, WeightType type,
+                     std::vector<uint8_t>& q, std::vector<float>& scales) {
+    const int groups = cols / kQuantGroup;
+    const float qmax = type == WeightType::kQ8 ? 127.f : 7.f;
+    Matrix shape;
+    shape.type = type;
+    shape.cols = cols;
+    const size_t row_bytes = shape.row_bytes();
+    q.assign(static_cast<size_t>(rows) * row_bytes, 0);
+    scales.assign(static_cast<size_t>(rows) * groups, 0.f);
+    for (int r = 0; r < rows; ++r) {
+        for (int g = 0; g < groups; ++g) {
+            const float* xg = src + static_cast<size_t>(r) * cols + g * kQuantGroup;
+            float amax = 0.f;
+            for (int i = 0; i < kQuantGroup; ++i) amax = std::max(amax, std::fabs(xg[i]));
+            const float scale = amax / qmax;
+            const float inv = scale > 0.f ? 1.f / scale : 0.f;
+            scales[static_cast<size_t>(r) * groups + g] = scale;
+            uint8_t* dst = q.data() + static_cast<size_t>(r) * row_bytes;
+            for (int i = 0; i < kQuantGroup; ++i) {
+                const int v = static_cast<int>(std::lrintf(std::min(std::max(xg[i] * inv, -qmax), qmax)));
+                if (type == WeightType::kQ8) {
+                    dst[g * kQuantGroup + i] = static_cast<uint8_t>(static_cast<int8_t>(v));
+                } else {
+                    uint8_t& byte = dst[g * (kQuantGroup / 2) + i % (kQuantGroup / 2)];
+                    byte |= static_cast<uint8_t>(v + 8) << (i < kQuantGroup / 2 ? 0 : 4);
+                }
+            }
+        }
+    }
+}
+
+float dot(const float* a, const float* b, int n) {
+    // 四路累加，便于编译器自动向量化
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+void matvec(const Matrix& w, const float* x, float* y) {
+    if (w.type != WeightType::kF32) {
+        matmat_quant(w, x, w.cols, y, w.rows, 1, false);
+        return;
+    }
+    for (int r = 0; r < w.rows; ++r) {
+        y[r] = dot(w.data + static_cast<size_t>(r) * w.cols, x, w.cols);
+    }
+}
+
+void matvec_add(const Matrix& w, const float* x, float* y) {
+    if (w.type != WeightType::kF32) {
+        matmat_quant(w, x, w.cols, y, w.rows, 1, true);
+        return;
+    }
+    for (int r = 0; r < w.rows; ++r) {
+        y[r] += dot(w.data + static_cast<size_t>(r) * w.cols, x, w.cols);
+    }
+}
+
+void matmat(const Matrix& w, const float* x, int ldx, float* y, int ldy, int n) {
+    if (w.type != WeightType::kF32) {
+        matmat_quant(w, x, ldx, y, ldy, n, false);
+        return;
+    }
+    if (n == 1) {
+        matvec(w, x, y);
+        return;
+    }
+    for (int r = 0; r < w.rows; ++r) {
+        const float* row = w.data + static_cast<size_t>(r) * w.cols;
+        for (int b = 0; b < n; ++b) {
+            y[static_cast<size_t>(b) * ldy + r] = dot(row, x + static_cast<size_t>(b) * ldx, w.cols);
+        }
+    }
+}
+
+void layer_norm(const float* x, const float* weight, const float* bias,
+                float* out, int n, float eps) {
+    float mean = 0.f;
+    for (int i = 0; i < n; ++i) mean += x[i];
+    mean /= static_cast<float>(n);
+    float var = 0.f;
+    for (int i = 0; i < n; ++i) {
+        const float d = x[i] - mean;
+        var += d * d;
+    }
+    var /= static_cast<float>(n);
+    const float inv = 1.f / std::sqrt(var + eps);
+    for (int i = 0; i < n; ++i) {
+        out[i] = (x[i] - mean) * inv * weight[i] + bias[i];
+    }
+}
+
+void group_norm(float* x, const float* weight, const float* bias,
+                int groups, int group_size, float eps) {
+    for (int g = 0; g < groups; ++g) {
+        float* xg = x + g * group_size;
+        layer_norm(xg, weight + g * group_size, bias + g * group_size, xg, group_size, eps);
+    }
+}
+
+} // namespace rwkvmobile
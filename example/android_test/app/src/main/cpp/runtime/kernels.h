@@ -0,0 +1,129 @@
+/**
+ * kernels.h
+ *
+ * CPU kernels used by the RWKV forward pass. All matrices are row-major
+ * [rows x cols] and multiply a column vector: y = W * x. Weights are fp32 or
+ * group-quantized int8/int4; quantized products run on the best kernel set
+ * for the CPU (AVX2, AVX-512, NEON dotprod/i8mm, or scalar), chosen once at
+ * startup.
+ */
+
+#ifndef RWKVMOBILE_KERNELS_H
+#define RWKVMOBILE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rwkvmobile {
+
+enum class WeightType {
+    kF32,
+    kQ8,  // 每组 kQuantGroup 个 int8 + 一个 fp32 scale
+    kQ4,  // 每组 kQuantGroup 个 4 bit（16 字节）+ 一个 fp32 scale
+};
+
+// 量化分组大小；量化矩阵的 cols 必须是它的倍数
+constexpr int kQuantGroup = 32;
+
+struct Matrix {
+    const float* data = nullptr;     // kF32
+    const uint8_t* q = nullptr;      // kQ8 / kQ4：每行 row_bytes() 字节
+    const float* scales = nullptr;   // kQ8 / kQ4：每行 cols / kQuantGroup 个
+    WeightType type = WeightType::kF32;
+    int rows = 0;
+    int cols = 0;
+
+    size_t row_bytes() const;
+    // 一次矩阵乘法读取的字节数（量化时包括 scales）
+    size_t bytes() const;
+};
+
+/**
+ * Rows [begin, end) of `w` as a matrix sharing its storage.
+ */
+Matrix row_slice(const Matrix& w, int begin, int end);
+
+/**
+ * Quantize a row-major fp32 matrix symmetrically per group of kQuantGroup
+ * (int8: scale = max|x| / 127, int4: max|x| / 7). cols must be a multiple
+ * of kQuantGroup. Point Matrix::q and ::scales at the outputs.
+ */
+void quantize_matrix(const float* src, int rows, int cols, WeightType type,
+                     std::vector<uint8_t>& q, std::vector<float>& scales);
+
+const char* weight_type_name(WeightType type);
+
+/**
+ * Name of the quantized kernel set selected for this CPU ("avx512",
+ * "avx2", "i8mm", "dotprod" or "scalar").
+ */
+const char* quant_kernel_name();
+
+// y[rows] = W[rows x cols] * x[cols]
+void matvec(const Matrix& w, const float* x, float* y);
+
+// y[rows] += W[rows x cols] * x[cols]
+void matvec_add(const Matrix& w, const float* x, float* y);
+
+/**
+ * Batched matvec: y_b = W * x_b for b in [0, n), with x_b = x + b * ldx and
+ * y_b = y + b * ldy. Each weight row is read once per call and reused for
+ * all n vectors while it is still in cache, so the memory traffic for W is
+ * that of a single matvec. Results are bit-identical to matvec (for
+ * quantized weights, up to the kernel's summation order).
+ */
+void matmat(const Matrix& w, const float* x, int ldx, float* y, int ldy, int n);
+
+// 按组量化为 int8 的 n 个激活向量，供量化矩阵乘法使用；缓冲区只增不减，可反复复用
+struct QuantizedActivations {
+    std::vector<int8_t> q;       // [n x cols]
+    std::vector<float> scales;   // [n x cols / kQuantGroup]
+    int n = 0;
+    int cols = 0;
+};
+
+/**
+ * Quantize x_b = x + b * ldx (b in [0, n), `cols` floats each) per group of
+ * kQuantGroup, as matmat() does for quantized weights.
+ */
+void quantize_activations(const float* x, int ldx, int n, int cols, QuantizedActivations& out);
+
+/**
+ * matmat() for a kQ8/kQ4 matrix on activations already quantized with
+ * quantize_activations(); `in` is only read, so the row slices of one
+ * product can share it across threads. With `add` the products are added
+ * to y.
+ */
+void matmat_quantized(const Matrix& w, const QuantizedActivations& in, float* y, int ldy, bool add = false);
+
+/**
+ * RWKV-6 WKV recurrence of one head over T consecutive tokens, on the best
+ * kernel for the CPU (AVX-512, AVX2, NEON or scalar):
+ *   y_i = sum_j r_j * (u_j * k_j * v_i + S_ji);  S_ji = k_j * v_i + w_j * S_ji
+ * with the decay w_j = exp(-exp(w_raw_j)) computed in the same pass.
+ * Token t reads r/k/v/w and writes y at offset t * stride.
+ * @param w      raw log-decay; overwritten with the decay
+ * @param u      bonus (time_faaaa), S floats
+ * @param state  [S x S], updated in place
+ */
+void wkv(int S, int T, size_t stride, const float* r, const float* k, const float* v, float* w,
+         const float* u, float* state, float* y);
+
+/**
+ * Name of the WKV kernel selected for this CPU.
+ */
+const char* wkv_kernel_name();
+
+void layer_norm(const float* x, const float* weight, const float* bias,
+                float* out, int n, float eps);
+
+// GroupNorm over `groups` contiguous groups of `group_size`, in place
+void group_norm(float* x, const float* weight, const float* bias,
+                int groups, int group_size, float eps);
+
+float dot(const float* a, const float* b, int n);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_KERNELS_H
@@ -0,0 +1,43 @@
+/**
+ * kernels_quant.h
+ *
+ * Per-ISA dot products between a group-quantized weight row and an int8
+ * activation vector (quantized per group of kQuantGroup with one fp32 scale
+ * each). Every kernel set lives in its own translation unit built with the
+ * matching target flags; a getter returns nullptr when its ISA was not
+ * compiled in. kernels.cpp picks one at startup from cpu_features().
+ */
+
+#ifndef RWKVMOBILE_KERNELS_QUANT_H
+#define RWKVMOBILE_KERNELS_QUANT_H
+
+#include <cstdint>
+
+namespace rwkvmobile {
+
+struct QuantKernels {
+    const char* name;
+
+    // sum_g ws[g] * xs[g] * dot(w_g, x_g)，共 groups 组
+    float (*dot_q8)(const int8_t* w, const float* ws, const int8_t* x, const float* xs, int groups);
+    float (*dot_q4)(const uint8_t* w, const float* ws, const int8_t* x, const float* xs, int groups);
+
+    // 可选（为空时逐个调用上面的函数）：两行权重与两个激活的 2x2 点积，
+    // out = {w0·x0, w0·x1, w1·x0, w1·x1}
+    void (*dot_q8_2x2)(const int8_t* w0, const int8_t* w1, const float* ws0, const float* ws1,
+                       const int8_t* x0, const int8_t* x1, const float* xs0, const float* xs1,
+                       int groups, float* out);
+    void (*dot_q4_2x2)(const uint8_t* w0, const uint8_t* w1, const float* ws0, const float* ws1,
+                       const int8_t* x0, const int8_t* x1, const float* xs0, const float* xs1,
+                       int groups, float* out);
+};
+
+const QuantKernels* quant_kernels_scalar();
+const QuantKernels* quant_kernels_avx2();
+const QuantKernels* quant_kernels_avx512();
+const QuantKernels* quant_kernels_dotprod();
+const QuantKernels* quant_kernels_i8mm();
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_KERNELS_QUANT_H
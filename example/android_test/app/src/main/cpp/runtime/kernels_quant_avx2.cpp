@@ -0,0 +1,72 @@
+// 编译选项：-mavx2 -mfma（见 CMakeLists.txt）
+#include "kernels_quant.h"
+
+#include "kernels.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+
+namespace rwkvmobile {
+
+namespace {
+
+inline float hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+// 32 个 int8 的点积（8 路 int32 部分和）：maddubs 需要无符号 x 有符号，
+// 把 w 的符号转移到 x 上
+inline __m256i dot32(__m256i w, __m256i x) {
+    const __m256i aw = _mm256_sign_epi8(w, w);
+    const __m256i sx = _mm256_sign_epi8(x, w);
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(aw, sx), _mm256_set1_epi16(1));
+}
+
+// 16 字节 int4 -> 32 个 int8：低 4 位为前 16 个元素，高 4 位为后 16 个
+inline __m256i unpack_q4(const uint8_t* p) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i lo = _mm_and_si128(bytes, mask);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    return _mm256_sub_epi8(_mm256_set_m128i(hi, lo), _mm256_set1_epi8(8));
+}
+
+float dot_q8(const int8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int g = 0; g < groups; ++g) {
+        const __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + g * kQuantGroup));
+        const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + g * kQuantGroup));
+        acc = _mm256_fmadd_ps(_mm256_cvtepi32_ps(dot32(wv, xv)), _mm256_set1_ps(ws[g] * xs[g]), acc);
+    }
+    return hsum(acc);
+}
+
+float dot_q4(const uint8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int g = 0; g < groups; ++g) {
+        const __m256i wv = unpack_q4(w + g * (kQuantGroup / 2));
+        const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + g * kQuantGroup));
+        acc = _mm256_fmadd_ps(_mm256_cvtepi32_ps(dot32(wv, xv)), _mm256_set1_ps(ws[g] * xs[g]), acc);
+    }
+    return hsum(acc);
+}
+
+const QuantKernels kKernels = {"avx2", dot_q8, dot_q4, nullptr, nullptr};
+
+} // namespace
+
+const QuantKernels* quant_kernels_avx2() { return &kKernels; }
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const QuantKernels* quant_kernels_avx2() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
@@ -0,0 +1,110 @@
+// 编译选项：-mavx512f -mavx512bw -mavx2 -mfma（见 CMakeLists.txt）
+#include "kernels_quant.h"
+
+#include "kernels.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+
+#include <immintrin.h>
+
+// GCC 12 对 avx512fintrin.h 内部的 _mm512_undefined_*() 误报 maybe-uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace rwkvmobile {
+
+namespace {
+
+// 一次处理两组（64 个 int8）：AVX-512 没有 sign_epi8，用 w 的符号位掩码对 x 取负
+inline __m512i dot64(__m512i w, __m512i x) {
+    const __mmask64 neg = _mm512_movepi8_mask(w);
+    const __m512i aw = _mm512_abs_epi8(w);
+    const __m512i sx = _mm512_mask_sub_epi8(x, neg, _mm512_setzero_si512(), x);
+    return _mm512_madd_epi16(_mm512_maddubs_epi16(aw, sx), _mm512_set1_epi16(1));
+}
+
+// 低 8 路属于第一组，高 8 路属于第二组
+inline __m512 pair_scale(float s0, float s1) {
+    return _mm512_mask_blend_ps(0xFF00, _mm512_set1_ps(s0), _mm512_set1_ps(s1));
+}
+
+inline __m256i unpack_q4(const uint8_t* p) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i lo = _mm_and_si128(bytes, mask);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    return _mm256_sub_epi8(_mm256_set_m128i(hi, lo), _mm256_set1_epi8(8));
+}
+
+inline __m512i join(__m256i lo, __m256i hi) {
+    return _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+}
+
+// 组数为奇数时最后一组：与 AVX2 相同的 256 位实现
+inline __m256i dot32(__m256i w, __m256i x) {
+    const __m256i aw = _mm256_sign_epi8(w, w);
+    const __m256i sx = _mm256_sign_epi8(x, w);
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(aw, sx), _mm256_set1_epi16(1));
+}
+
+inline float hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+inline float finish(__m512 acc, __m256i last, float scale) {
+    return _mm512_reduce_add_ps(acc) + hsum(_mm256_mul_ps(_mm256_cvtepi32_ps(last), _mm256_set1_ps(scale)));
+}
+
+float dot_q8(const int8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    __m512 acc = _mm512_setzero_ps();
+    int g = 0;
+    for (; g + 2 <= groups; g += 2) {
+        const __m512i wv = _mm512_loadu_si512(w + g * kQuantGroup);
+        const __m512i xv = _mm512_loadu_si512(x + g * kQuantGroup);
+        acc = _mm512_fmadd_ps(_mm512_cvtepi32_ps(dot64(wv, xv)),
+                              pair_scale(ws[g] * xs[g], ws[g + 1] * xs[g + 1]), acc);
+    }
+    if (g < groups) {
+        const __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + g * kQuantGroup));
+        const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + g * kQuantGroup));
+        return finish(acc, dot32(wv, xv), ws[g] * xs[g]);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+float dot_q4(const uint8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    __m512 acc = _mm512_setzero_ps();
+    int g = 0;
+    for (; g + 2 <= groups; g += 2) {
+        const __m512i wv = join(unpack_q4(w + g * (kQuantGroup / 2)), unpack_q4(w + (g + 1) * (kQuantGroup / 2)));
+        const __m512i xv = _mm512_loadu_si512(x + g * kQuantGroup);
+        acc = _mm512_fmadd_ps(_mm512_cvtepi32_ps(dot64(wv, xv)),
+                              pair_scale(ws[g] * xs[g], ws[g + 1] * xs[g + 1]), acc);
+    }
+    if (g < groups) {
+        const __m256i wv = unpack_q4(w + g * (kQuantGroup / 2));
+        const __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + g * kQuantGroup));
+        return finish(acc, dot32(wv, xv), ws[g] * xs[g]);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+const QuantKernels kKernels = {"avx512", dot_q8, dot_q4, nullptr, nullptr};
+
+} // namespace
+
+const QuantKernels* quant_kernels_avx512() { return &kKernels; }
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const QuantKernels* quant_kernels_avx512() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
@@ -0,0 +1,98 @@
+// 编译选项：-march=armv8.2-a+dotprod+i8mm（见 CMakeLists.txt）
+#include "kernels_quant.h"
+
+#include "kernels.h"
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_MATMUL_INT8)
+
+#include <arm_neon.h>
+
+namespace rwkvmobile {
+
+namespace {
+
+inline int8x16x2_t unpack_q4(const uint8_t* p) {
+    const uint8x16_t bytes = vld1q_u8(p);
+    const int8x16_t eight = vdupq_n_s8(8);
+    int8x16x2_t v;
+    v.val[0] = vsubq_s8(vreinterpretq_s8_u8(vandq_u8(bytes, vdupq_n_u8(0x0F))), eight);
+    v.val[1] = vsubq_s8(vreinterpretq_s8_u8(vshrq_n_u8(bytes, 4)), eight);
+    return v;
+}
+
+// 两个 16 元素向量按 8 元素交错成 SMMLA 的 2x8 操作数：{a[0..8), b[0..8)} 与 {a[8..16), b[8..16)}
+inline void interleave(int8x16_t a, int8x16_t b, int8x16_t* lo, int8x16_t* hi) {
+    *lo = vreinterpretq_s8_s64(vzip1q_s64(vreinterpretq_s64_s8(a), vreinterpretq_s64_s8(b)));
+    *hi = vreinterpretq_s8_s64(vzip2q_s64(vreinterpretq_s64_s8(a), vreinterpretq_s64_s8(b)));
+}
+
+// 16 个元素的 2x2 块：结果 {w0·x0, w0·x1, w1·x0, w1·x1}
+inline int32x4_t mmla16(int32x4_t acc, int8x16_t w0, int8x16_t w1, int8x16_t x0, int8x16_t x1) {
+    int8x16_t a_lo, a_hi, b_lo, b_hi;
+    interleave(w0, w1, &a_lo, &a_hi);
+    interleave(x0, x1, &b_lo, &b_hi);
+    acc = vmmlaq_s32(acc, a_lo, b_lo);
+    return vmmlaq_s32(acc, a_hi, b_hi);
+}
+
+inline float32x4_t scales2x2(float ws0, float ws1, float xs0, float xs1) {
+    const float s[4] = {ws0 * xs0, ws0 * xs1, ws1 * xs0, ws1 * xs1};
+    return vld1q_f32(s);
+}
+
+void dot_q8_2x2(const int8_t* w0, const int8_t* w1, const float* ws0, const float* ws1,
+                const int8_t* x0, const int8_t* x1, const float* xs0, const float* xs1,
+                int groups, float* out) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (int g = 0; g < groups; ++g) {
+        const size_t off = static_cast<size_t>(g) * kQuantGroup;
+        int32x4_t d = vdupq_n_s32(0);
+        d = mmla16(d, vld1q_s8(w0 + off), vld1q_s8(w1 + off), vld1q_s8(x0 + off), vld1q_s8(x1 + off));
+        d = mmla16(d, vld1q_s8(w0 + off + 16), vld1q_s8(w1 + off + 16),
+                   vld1q_s8(x0 + off + 16), vld1q_s8(x1 + off + 16));
+        acc = vmlaq_f32(acc, vcvtq_f32_s32(d), scales2x2(ws0[g], ws1[g], xs0[g], xs1[g]));
+    }
+    vst1q_f32(out, acc);
+}
+
+void dot_q4_2x2(const uint8_t* w0, const uint8_t* w1, const float* ws0, const float* ws1,
+                const int8_t* x0, const int8_t* x1, const float* xs0, const float* xs1,
+                int groups, float* out) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (int g = 0; g < groups; ++g) {
+        const size_t off = static_cast<size_t>(g) * kQuantGroup;
+        const int8x16x2_t a = unpack_q4(w0 + g * (kQuantGroup / 2));
+        const int8x16x2_t b = unpack_q4(w1 + g * (kQuantGroup / 2));
+        int32x4_t d = vdupq_n_s32(0);
+        d = mmla16(d, a.val[0], b.val[0], vld1q_s8(x0 + off), vld1q_s8(x1 + off));
+        d = mmla16(d, a.val[1], b.val[1], vld1q_s8(x0 + off + 16), vld1q_s8(x1 + off + 16));
+        acc = vmlaq_f32(acc, vcvtq_f32_s32(d), scales2x2(ws0[g], ws1[g], xs0[g], xs1[g]));
+    }
+    vst1q_f32(out, acc);
+}
+
+} // namespace
+
+// 单行点积沿用 dotprod 版本，批量（n >= 2）时用 SMMLA 的 2x2 块
+const QuantKernels* quant_kernels_i8mm() {
+    static const QuantKernels* kernels = []() -> const QuantKernels* {
+        const QuantKernels* base = quant_kernels_dotprod();
+        if (base == nullptr) return nullptr;
+        static QuantKernels k = *base;
+        k.name = "i8mm";
+        k.dot_q8_2x2 = dot_q8_2x2;
+        k.dot_q4_2x2 = dot_q4_2x2;
+        return &k;
+    }();
+    return kernels;
+}
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const QuantKernels* quant_kernels_i8mm() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
@@ -0,0 +1,62 @@
+// 编译选项：-march=armv8.2-a+dotprod（见 CMakeLists.txt）
+#include "kernels_quant.h"
+
+#include "kernels.h"
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_DOTPROD)
+
+#include <arm_neon.h>
+
+namespace rwkvmobile {
+
+namespace {
+
+// 16 字节 int4 -> 32 个 int8：低 4 位为前 16 个元素，高 4 位为后 16 个
+inline int8x16x2_t unpack_q4(const uint8_t* p) {
+    const uint8x16_t bytes = vld1q_u8(p);
+    const int8x16_t eight = vdupq_n_s8(8);
+    int8x16x2_t v;
+    v.val[0] = vsubq_s8(vreinterpretq_s8_u8(vandq_u8(bytes, vdupq_n_u8(0x0F))), eight);
+    v.val[1] = vsubq_s8(vreinterpretq_s8_u8(vshrq_n_u8(bytes, 4)), eight);
+    return v;
+}
+
+float dot_q8(const int8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (int g = 0; g < groups; ++g) {
+        const int8_t* wg = w + g * kQuantGroup;
+        const int8_t* xg = x + g * kQuantGroup;
+        int32x4_t d = vdotq_s32(vdupq_n_s32(0), vld1q_s8(wg), vld1q_s8(xg));
+        d = vdotq_s32(d, vld1q_s8(wg + 16), vld1q_s8(xg + 16));
+        acc = vmlaq_n_f32(acc, vcvtq_f32_s32(d), ws[g] * xs[g]);
+    }
+    return vaddvq_f32(acc);
+}
+
+float dot_q4(const uint8_t* w, const float* ws, const int8_t* x, const float* xs, int groups) {
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (int g = 0; g < groups; ++g) {
+        const int8x16x2_t wv = unpack_q4(w + g * (kQuantGroup / 2));
+        const int8_t* xg = x + g * kQuantGroup;
+        int32x4_t d = vdotq_s32(vdupq_n_s32(0), wv.val[0], vld1q_s8(xg));
+        d = vdotq_s32(d, wv.val[1], vld1q_s8(xg + 16));
+        acc = vmlaq_n_f32(acc, vcvtq_f32_s32(d), ws[g] * xs[g]);
+    }
+    return vaddvq_f32(acc);
+}
+
+const QuantKernels kKernels = {"dotprod", dot_q8, dot_q4, nullptr, nullptr};
+
+} // namespace
+
+const QuantKernels* quant_kernels_dotprod() { return &kKernels; }
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const QuantKernels* quant_kernels_dotprod() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * kernels_wkv.h
+ *
+ * Per-ISA RWKV-6 WKV step for one head and one token. The state tile of a
+ * head (head_size^2 floats, 16 KB at head_size 64) stays in L1 while a
+ * block of output columns is held in registers; each state element is
+ * read and written exactly once per token. Like kernels_quant.h, every
+ * variant is its own translation unit and kernels.cpp picks one from
+ * cpu_features().
+ */
+
+#ifndef RWKVMOBILE_KERNELS_WKV_H
+#define RWKVMOBILE_KERNELS_WKV_H
+
+#include <cstddef>
+
+namespace rwkvmobile {
+
+struct WkvKernel {
+    const char* name;
+
+    // y_i = sum_j r_j * (u_j * k_j * v_i + S_ji);  S_ji = k_j * v_i + w_j * S_ji
+    // w 为已经取过 exp(-exp(.)) 的衰减，state 为 [S x S]，按 j 行存储
+    void (*step)(int S, const float* r, const float* k, const float* v, const float* w,
+                 const float* u, float* state, float* y);
+};
+
+/**
+ * Scalar update of output columns [i0, S): the reference, and the tail of
+ * the vector kernels when S is not a multiple of their width.
+ */
+inline void wkv_columns(int S, int i0, const float* r, const float* k, const float* v, const float* w,
+                        const float* u, float* state, float* y) {
+    for (int i = i0; i < S; ++i) y[i] = 0.f;
+    for (int j = 0; j < S; ++j) {
+        float* row = state + static_cast<size_t>(j) * S;
+        const float rj = r[j];
+        const float kj = k[j];
+        const float uk = u[j] * kj;
+        const float wj = w[j];
+        for (int i = i0; i < S; ++i) {
+            y[i] += rj * (uk * v[i] + row[i]);
+            row[i] = kj * v[i] + wj * row[i];
+        }
+    }
+}
+
+const WkvKernel* wkv_kernel_scalar();
+const WkvKernel* wkv_kernel_avx2();
+const WkvKernel* wkv_kernel_avx512();
+const WkvKernel* wkv_kernel_neon();
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_KERNELS_WKV_H
@@ -0,0 +1,59 @@
+// 编译选项：-mavx2 -mfma（见 CMakeLists.txt）
+#include "kernels_wkv.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+
+namespace rwkvmobile {
+
+namespace {
+
+// 输出列 [i0, i0 + 8 * B)：y 与 v 留在寄存器里，逐行扫过状态
+template <int B>
+inline void columns(int S, int i0, const float* r, const float* k, const float* v, const float* w,
+                    const float* u, float* state, float* y) {
+    __m256 acc[B];
+    __m256 vv[B];
+    for (int b = 0; b < B; ++b) {
+        acc[b] = _mm256_setzero_ps();
+        vv[b] = _mm256_loadu_ps(v + i0 + 8 * b);
+    }
+    for (int j = 0; j < S; ++j) {
+        float* row = state + static_cast<size_t>(j) * S + i0;
+        const __m256 rj = _mm256_set1_ps(r[j]);
+        const __m256 kj = _mm256_set1_ps(k[j]);
+        const __m256 uk = _mm256_set1_ps(u[j] * k[j]);
+        const __m256 wj = _mm256_set1_ps(w[j]);
+        for (int b = 0; b < B; ++b) {
+            const __m256 s = _mm256_loadu_ps(row + 8 * b);
+            acc[b] = _mm256_fmadd_ps(rj, _mm256_fmadd_ps(uk, vv[b], s), acc[b]);
+            _mm256_storeu_ps(row + 8 * b, _mm256_fmadd_ps(wj, s, _mm256_mul_ps(kj, vv[b])));
+        }
+    }
+    for (int b = 0; b < B; ++b) _mm256_storeu_ps(y + i0 + 8 * b, acc[b]);
+}
+
+void step(int S, const float* r, const float* k, const float* v, const float* w,
+          const float* u, float* state, float* y) {
+    int i0 = 0;
+    for (; i0 + 32 <= S; i0 += 32) columns<4>(S, i0, r, k, v, w, u, state, y);
+    for (; i0 + 8 <= S; i0 += 8) columns<1>(S, i0, r, k, v, w, u, state, y);
+    if (i0 < S) wkv_columns(S, i0, r, k, v, w, u, state, y);
+}
+
+const WkvKernel kKernel = {"avx2", step};
+
+} // namespace
+
+const WkvKernel* wkv_kernel_avx2() { return &kKernel; }
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const WkvKernel* wkv_kernel_avx2() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
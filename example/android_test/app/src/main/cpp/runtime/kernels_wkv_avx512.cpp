@@ -0,0 +1,59 @@
+// 编译选项：-mavx512f -mavx2 -mfma（见 CMakeLists.txt）
+#include "kernels_wkv.h"
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+namespace rwkvmobile {
+
+namespace {
+
+// 输出列 [i0, i0 + 16 * B)：y 与 v 留在寄存器里，逐行扫过状态
+template <int B>
+inline void columns(int S, int i0, const float* r, const float* k, const float* v, const float* w,
+                    const float* u, float* state, float* y) {
+    __m512 acc[B];
+    __m512 vv[B];
+    for (int b = 0; b < B; ++b) {
+        acc[b] = _mm512_setzero_ps();
+        vv[b] = _mm512_loadu_ps(v + i0 + 16 * b);
+    }
+    for (int j = 0; j < S; ++j) {
+        float* row = state + static_cast<size_t>(j) * S + i0;
+        const __m512 rj = _mm512_set1_ps(r[j]);
+        const __m512 kj = _mm512_set1_ps(k[j]);
+        const __m512 uk = _mm512_set1_ps(u[j] * k[j]);
+        const __m512 wj = _mm512_set1_ps(w[j]);
+        for (int b = 0; b < B; ++b) {
+            const __m512 s = _mm512_loadu_ps(row + 16 * b);
+            acc[b] = _mm512_fmadd_ps(rj, _mm512_fmadd_ps(uk, vv[b], s), acc[b]);
+            _mm512_storeu_ps(row + 16 * b, _mm512_fmadd_ps(wj, s, _mm512_mul_ps(kj, vv[b])));
+        }
+    }
+    for (int b = 0; b < B; ++b) _mm512_storeu_ps(y + i0 + 16 * b, acc[b]);
+}
+
+void step(int S, const float* r, const float* k, const float* v, const float* w,
+          const float* u, float* state, float* y) {
+    int i0 = 0;
+    for (; i0 + 64 <= S; i0 += 64) columns<4>(S, i0, r, k, v, w, u, state, y);
+    for (; i0 + 16 <= S; i0 += 16) columns<1>(S, i0, r, k, v, w, u, state, y);
+    if (i0 < S) wkv_columns(S, i0, r, k, v, w, u, state, y);
+}
+
+const WkvKernel kKernel = {"avx512", step};
+
+} // namespace
+
+const WkvKernel* wkv_kernel_avx512() { return &kKernel; }
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const WkvKernel* wkv_kernel_avx512() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
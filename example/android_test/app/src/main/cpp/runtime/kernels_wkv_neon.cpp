@@ -0,0 +1,59 @@
+// AArch64 基线即包含 NEON，不需要额外编译选项
+#include "kernels_wkv.h"
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+namespace rwkvmobile {
+
+namespace {
+
+// 输出列 [i0, i0 + 4 * B)：y 与 v 留在寄存器里，逐行扫过状态（32 个向量寄存器放得下 B = 8）
+template <int B>
+inline void columns(int S, int i0, const float* r, const float* k, const float* v, const float* w,
+                    const float* u, float* state, float* y) {
+    float32x4_t acc[B];
+    float32x4_t vv[B];
+    for (int b = 0; b < B; ++b) {
+        acc[b] = vdupq_n_f32(0.f);
+        vv[b] = vld1q_f32(v + i0 + 4 * b);
+    }
+    for (int j = 0; j < S; ++j) {
+        float* row = state + static_cast<size_t>(j) * S + i0;
+        const float32x4_t rj = vdupq_n_f32(r[j]);
+        const float32x4_t kj = vdupq_n_f32(k[j]);
+        const float32x4_t uk = vdupq_n_f32(u[j] * k[j]);
+        const float32x4_t wj = vdupq_n_f32(w[j]);
+        for (int b = 0; b < B; ++b) {
+            const float32x4_t s = vld1q_f32(row + 4 * b);
+            acc[b] = vfmaq_f32(acc[b], rj, vfmaq_f32(s, uk, vv[b]));
+            vst1q_f32(row + 4 * b, vfmaq_f32(vmulq_f32(kj, vv[b]), wj, s));
+        }
+    }
+    for (int b = 0; b < B; ++b) vst1q_f32(y + i0 + 4 * b, acc[b]);
+}
+
+void step(int S, const float* r, const float* k, const float* v, const float* w,
+          const float* u, float* state, float* y) {
+    int i0 = 0;
+    for (; i0 + 32 <= S; i0 += 32) columns<8>(S, i0, r, k, v, w, u, state, y);
+    for (; i0 + 4 <= S; i0 += 4) columns<1>(S, i0, r, k, v, w, u, state, y);
+    if (i0 < S) wkv_columns(S, i0, r, k, v, w, u, state, y);
+}
+
+const WkvKernel kKernel = {"neon", step};
+
+} // namespace
+
+const WkvKernel* wkv_kernel_neon() { return &kKernel; }
+
+} // namespace rwkvmobile
+
+#else
+
+namespace rwkvmobile {
+const WkvKernel* wkv_kernel_neon() { return nullptr; }
+} // namespace rwkvmobile
+
+#endif
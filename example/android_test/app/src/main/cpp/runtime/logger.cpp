@@ -0,0 +1,81 @@
+#include "logger.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+namespace rwkvmobile {
+
+namespace {
+
+// 只保留最近的日志，避免长时间运行后无限增长
+constexpr size_t kMaxLogBytes = 64 * 1024;
+
+std::atomic<int> g_log_level{kLogInfo};
+std::mutex g_log_mutex;
+std::string g_log_buffer;
+std::string g_log_snapshot;
+
+const char* level_tag(int level) {
+    switch (level) {
+        case kLogDebug: return "D";
+        case kLogInfo: return "I";
+        case kLogWarn: return "W";
+        default: return "E";
+    }
+}
+
+} // namespace
+
+void set_log_level(int level) {
+    g_log_level.store(level, std::memory_order_relaxed);
+}
+
+int get_log_level() {
+    return g_log_level.load(std::memory_order_relaxed);
+}
+
+void log_print(int level, const char* fmt, ...) {
+    if (level < get_log_level()) {
+        return;
+    }
+
+    char message[1024];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+
+#ifdef __ANDROID__
+    static const int kPriorities[] = {
+        ANDROID_LOG_DEBUG, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR};
+    int priority = kPriorities[level < 0 ? 0 : (level > kLogError ? kLogError : level)];
+    __android_log_print(priority, "RWKV_MOBILE", "%s", message);
+#else
+    fprintf(stderr, "[rwkv_mobile][%s] %s\n", level_tag(level), message);
+#endif
+
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    g_log_buffer += '[';
+    g_log_buffer += level_tag(level);
+    g_log_buffer += "] ";
+    g_log_buffer += message;
+    g_log_buffer += '\n';
+    if (g_log_buffer.size() > kMaxLogBytes) {
+        size_t cut = g_log_buffer.find('\n', g_log_buffer.size() - kMaxLogBytes);
+        g_log_buffer.erase(0, cut == std::string::npos ? g_log_buffer.size() - kMaxLogBytes : cut + 1);
+    }
+}
+
+const char* dump_log() {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    g_log_snapshot = g_log_buffer;
+    return g_log_snapshot.c_str();
+}
+
+} // namespace rwkvmobile
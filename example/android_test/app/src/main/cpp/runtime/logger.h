@@ -0,0 +1,43 @@
+/**
+ * logger.h
+ *
+ * In-process log buffer behind rwkvmobile_dump_log / rwkvmobile_set_loglevel.
+ * Messages are mirrored to logcat on Android and to stderr elsewhere.
+ */
+
+#ifndef RWKVMOBILE_LOGGER_H
+#define RWKVMOBILE_LOGGER_H
+
+#include <string>
+
+namespace rwkvmobile {
+
+enum LogLevel {
+    kLogDebug = 0,
+    kLogInfo = 1,
+    kLogWarn = 2,
+    kLogError = 3,
+};
+
+void set_log_level(int level);
+int get_log_level();
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void log_print(int level, const char* fmt, ...);
+
+/**
+ * Snapshot of the buffered log. The returned pointer stays valid until the
+ * next call to dump_log().
+ */
+const char* dump_log();
+
+} // namespace rwkvmobile
+
+#define RWKV_LOGD(...) ::rwkvmobile::log_print(::rwkvmobile::kLogDebug, __VA_ARGS__)
+#define RWKV_LOGI(...) ::rwkvmobile::log_print(::rwkvmobile::kLogInfo, __VA_ARGS__)
+#define RWKV_LOGW(...) ::rwkvmobile::log_print(::rwkvmobile::kLogWarn, __VA_ARGS__)
+#define RWKV_LOGE(...) ::rwkvmobile::log_print(::rwkvmobile::kLogError, __VA_ARGS__)
+
+#endif // RWKVMOBILE_LOGGER_H
@@ -0,0 +1,80 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+namespace rwkvmobile {
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        RWKV_LOGE("Failed to open %s", path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        RWKV_LOGE("Failed to stat %s or file is empty", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后即可关闭 fd
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        RWKV_LOGE("Failed to mmap %s", path.c_str());
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::advise(const void* addr, size_t len, Advice advice) const {
+    if (data_ == nullptr || len == 0) {
+        return;
+    }
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+    uintptr_t end = begin + len;
+    if (advice == Advice::kDontNeed) {
+        begin = (begin + page - 1) / page * page;
+        end = end / page * page;
+    } else {
+        begin = begin / page * page;
+        end = (end + page - 1) / page * page;
+    }
+    // 映射本身从页边界开始，向外取整只需要截断末尾
+    end = std::min(end, reinterpret_cast<uintptr_t>(data_) + size_);
+    if (begin >= end) {
+        return;
+    }
+    int flag = MADV_NORMAL;
+    switch (advice) {
+        case Advice::kNormal: flag = MADV_NORMAL; break;
+        case Advice::kSequential: flag = MADV_SEQUENTIAL; break;
+        case Advice::kRandom: flag = MADV_RANDOM; break;
+        case Advice::kWillNeed: flag = MADV_WILLNEED; break;
+        case Advice::kDontNeed: flag = MADV_DONTNEED; break;
+    }
+    // 只是提示，失败不影响正确性
+    if (madvise(reinterpret_cast<void*>(begin), end - begin, flag) != 0) {
+        RWKV_LOGD("madvise(%d) failed", flag);
+    }
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+} // namespace rwkvmobile
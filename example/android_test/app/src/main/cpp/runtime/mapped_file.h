@@ -0,0 +1,62 @@
+/**
+ * mapped_file.h
+ *
+ * Read-only memory mapping of a whole file. Pages are loaded on first
+ * access, so opening a large file costs nothing until it is read, and
+ * since they are clean file pages the OS can drop them under memory
+ * pressure and fault them back in later.
+ */
+
+#ifndef RWKVMOBILE_MAPPED_FILE_H
+#define RWKVMOBILE_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rwkvmobile {
+
+class MappedFile {
+public:
+    // madvise 提示
+    enum class Advice {
+        kNormal,
+        kSequential,  // 顺序读一遍（加载时的转换）
+        kRandom,      // 零散访问（embedding 按 token 取行），关闭预读
+        kWillNeed,    // 马上会用到，后台预读
+        kDontNeed,    // 暂时不再访问，释放已驻留的页
+    };
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Map `path` read-only, replacing any previous mapping.
+     * @return false if the file cannot be opened or mapped (logged)
+     */
+    bool open(const std::string& path);
+    void close();
+
+    /**
+     * Give the kernel a paging hint for [addr, addr + len), which must lie
+     * inside the mapping. kDontNeed only covers the pages wholly inside the
+     * range so neighbouring data keeps its pages; the other hints round the
+     * range out to page boundaries.
+     */
+    void advise(const void* addr, size_t len, Advice advice) const;
+    void advise(Advice advice) const { advise(data_, size_, advice); }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_MAPPED_FILE_H
@@ -0,0 +1,760 @@
+#include "model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#include "logger.h"
+#include "packed_model.h"
+#include "safetensors.h"
+#include "thread_pool.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+constexpr float kLayerNormEps = 1e-5f;
+constexpr float kGroupNormEps = 64e-5f;
+
+constexpr bool kLittleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+const TensorInfo* find_tensor(const SafeTensors& st, const std::string& name, int64_t numel) {
+    const TensorInfo* info = st.find(name);
+    if (info == nullptr) {
+        RWKV_LOGE("Missing tensor %s", name.c_str());
+        return nullptr;
+    }
+    if (numel >= 0 && info->numel() != numel) {
+        RWKV_LOGE("Tensor %s has %lld elements, expected %lld", name.c_str(),
+                  static_cast<long long>(info->numel()), static_cast<long long>(numel));
+        return nullptr;
+    }
+    return info;
+}
+
+bool fetch(const SafeTensors& st, const std::string& name, int64_t numel, std::vector<float>& out) {
+    const TensorInfo* info = find_tensor(st, name, numel);
+    if (info == nullptr) {
+        return false;
+    }
+    out.resize(static_cast<size_t>(info->numel()));
+    convert_to_f32(info->dtype, info->data, out.data(), out.size());
+    return true;
+}
+
+// 小端 fp32 且按 float 对齐的张量已经是运行时格式，可以直接在映射上使用
+bool usable_in_place(const TensorInfo& info) {
+    return kLittleEndian && info.dtype == DType::kF32 &&
+           reinterpret_cast<uintptr_t>(info.data) % alignof(float) == 0;
+}
+
+// [rows x cols] -> [cols x rows]
+std::vector<float> transpose(const float* src, int rows, int cols) {
+    std::vector<float> out(static_cast<size_t>(rows) * cols);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            out[static_cast<size_t>(c) * rows + r] = src[static_cast<size_t>(r) * cols + c];
+        }
+    }
+    return out;
+}
+
+inline float sigmoid(float x) { return 1.f / (1.f + std::exp(-x)); }
+
+// 低于这个乘加量的矩阵乘法不值得唤醒线程池
+constexpr size_t kMinParallelWork = 1u << 16;
+
+uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// 把作用域内的耗时加到 *ns 上；ns 为空时什么也不做
+class ProfileTimer {
+public:
+    explicit ProfileTimer(uint64_t* ns) : ns_(ns), start_(ns != nullptr ? now_ns() : 0) {}
+    ~ProfileTimer() {
+        if (ns_ != nullptr) *ns_ += now_ns() - start_;
+    }
+
+    ProfileTimer(const ProfileTimer&) = delete;
+    ProfileTimer& operator=(const ProfileTimer&) = delete;
+
+private:
+    uint64_t* ns_;
+    uint64_t start_;
+};
+
+// 逐个内核（矩阵乘法、WKV、每层）的计时；关闭时前向里不读时钟
+bool kernel_timing(const ForwardProfile* profile) {
+    return profile != nullptr && profile->kernel_timing;
+}
+
+// 按权重行把 matmat 切给线程池；每个输出元素的计算与单线程完全相同
+void parallel_matmat(ThreadPool* pool, ForwardProfile* profile, const Matrix& w, const float* x, int ldx,
+                     float* y, int ldy, int n) {
+    ProfileTimer timer(kernel_timing(profile) ? &profile->matmul_ns : nullptr);
+    if (profile != nullptr) {
+        profile->weight_bytes += w.bytes();
+    }
+    if (pool == nullptr || pool->size() == 1 ||
+        static_cast<size_t>(w.rows) * w.cols * n < kMinParallelWork) {
+        matmat(w, x, ldx, y, ldy, n);
+        return;
+    }
+    if (w.type != WeightType::kF32) {
+        // 激活只量化一次，各线程只读共享；先取引用，lambda 里直接写 thread_local 会访问各工作线程自己的那份
+        static thread_local QuantizedActivations t_activations;
+        QuantizedActivations& in = t_activations;
+        quantize_activations(x, ldx, n, w.cols, in);
+        pool->parallel_for(w.rows, [&](int begin, int end) {
+            matmat_quantized(row_slice(w, begin, end), in, y + begin, ldy);
+        });
+        return;
+    }
+    pool->parallel_for(w.rows, [&](int begin, int end) {
+        matmat(row_slice(w, begin, end), x, ldx, y + begin, ldy, n);
+    });
+}
+
+// 逐行独立的计算（layer norm、逐元素变换）按行切分
+template <typename Fn>
+void for_rows(ThreadPool* pool, int n, Fn&& fn) {
+    if (pool == nullptr || n == 1) {
+        fn(0, n);
+    } else {
+        pool->parallel_for(n, fn);
+    }
+}
+
+} // namespace
+
+void State::init(const ModelConfig& cfg) {
+    att_x.assign(static_cast<size_t>(cfg.n_layer) * cfg.n_embd, 0.f);
+    att_kv.assign(static_cast<size_t>(cfg.n_layer) * cfg.n_head * cfg.head_size * cfg.head_size, 0.f);
+    ffn_x.assign(static_cast<size_t>(cfg.n_layer) * cfg.n_embd, 0.f);
+}
+
+void State::reset() {
+    std::fill(att_x.begin(), att_x.end(), 0.f);
+    std::fill(att_kv.begin(), att_kv.end(), 0.f);
+    std::fill(ffn_x.begin(), ffn_x.end(), 0.f);
+}
+
+void ForwardScratch::init(const ModelConfig& cfg, int batch_size) {
+    batch = batch_size;
+    const size_t n = static_cast<size_t>(batch_size);
+    const size_t c = static_cast<size_t>(cfg.n_embd);
+    for (auto* v : {&x, &xx, &sx, &mix, &xw, &xk, &xv, &xr, &xg, &r, &k, &v, &g, &w, &y, &tmp}) {
+        v->assign(n * c, 0.f);
+    }
+    mix_out.assign(n * cfg.dim_mix * 5, 0.f);
+    decay.assign(n * cfg.dim_decay, 0.f);
+    ffn_k.assign(n * cfg.n_ffn, 0.f);
+    logits.clear();
+}
+
+std::unique_ptr<Model> Model::load(const std::string& path) {
+    std::unique_ptr<Model> model(new Model());
+    if (!model->init_from(path)) {
+        return nullptr;
+    }
+    return model;
+}
+
+const float* Model::store(std::vector<float>&& data) {
+    storage_.push_back(std::move(data));
+    return storage_.back().data();
+}
+
+Matrix Model::store_matrix(std::vector<float>&& data, int rows, int cols) {
+    Matrix m;
+    m.data = store(std::move(data));
+    m.rows = rows;
+    m.cols = cols;
+    return m;
+}
+
+bool Model::init_from(const std::string& path) {
+    path_ = path;
+    if (!file_.open(path)) {
+        return false;
+    }
+    if (is_packed_model(file_.data(), file_.size())) {
+        return init_from_packed();
+    }
+    return init_from_safetensors();
+}
+
+template <typename Fn>
+bool Model::visit_tensors(Fn&& fn) {
+    const ModelConfig& cfg = config_;
+    const int C = cfg.n_embd;
+    const int D = cfg.dim_mix;
+    const int Dd = cfg.dim_decay;
+    const int F = cfg.n_ffn;
+    auto vec = [&](const std::string& name, const float*& data) { return fn(name, data, 1, C); };
+    auto mat = [&](const std::string& name, Matrix& m, int rows, int cols) {
+        m.rows = rows;
+        m.cols = cols;
+        return fn(name, m.data, rows, cols);
+    };
+
+    if (!fn("emb.weight", emb_, cfg.vocab_size, C) || !vec("blocks.0.ln0.weight", ln0_w_) ||
+        !vec("blocks.0.ln0.bias", ln0_b_)) {
+        return false;
+    }
+    for (int i = 0; i < cfg.n_layer; ++i) {
+        const std::string p = "blocks." + std::to_string(i) + ".";
+        LayerWeights& l = layers_[i];
+        bool ok = vec(p + "ln1.weight", l.ln1_w) && vec(p + "ln1.bias", l.ln1_b) &&
+                  vec(p + "ln2.weight", l.ln2_w) && vec(p + "ln2.bias", l.ln2_b) &&
+                  vec(p + "att.time_maa_x", l.maa_x) && vec(p + "att.time_maa_w", l.maa_w) &&
+                  vec(p + "att.time_maa_k", l.maa_k) && vec(p + "att.time_maa_v", l.maa_v) &&
+                  vec(p + "att.time_maa_r", l.maa_r) && vec(p + "att.time_maa_g", l.maa_g) &&
+                  mat(p + "att.time_maa_w1", l.maa_w1, 5 * D, C) &&
+                  vec(p + "att.time_decay", l.time_decay) &&
+                  mat(p + "att.time_decay_w1", l.decay_w1, Dd, C) &&
+                  mat(p + "att.time_decay_w2", l.decay_w2, C, Dd) &&
+                  vec(p + "att.time_faaaa", l.time_faaaa) &&
+                  mat(p + "att.receptance.weight", l.att_r, C, C) &&
+                  mat(p + "att.key.weight", l.att_k, C, C) &&
+                  mat(p + "att.value.weight", l.att_v, C, C) &&
+                  mat(p + "att.gate.weight", l.att_g, C, C) &&
+                  mat(p + "att.output.weight", l.att_o, C, C) &&
+                  vec(p + "att.ln_x.weight", l.lnx_w) && vec(p + "att.ln_x.bias", l.lnx_b) &&
+                  vec(p + "ffn.time_maa_k", l.ffn_maa_k) && vec(p + "ffn.time_maa_r", l.ffn_maa_r) &&
+                  mat(p + "ffn.key.weight", l.ffn_k, F, C) &&
+                  mat(p + "ffn.receptance.weight", l.ffn_r, C, C) &&
+                  mat(p + "ffn.value.weight", l.ffn_v, C, F);
+        for (int m = 0; ok && m < 5; ++m) {
+            ok = mat(p + "att.time_maa_w2." + std::to_string(m), l.maa_w2[m], C, D);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return vec("ln_out.weight", ln_out_w_) && vec("ln_out.bias", ln_out_b_) &&
+           mat("head.weight", head_, cfg.vocab_size, C);
+}
+
+bool Model::save_packed(const std::string& path, uint32_t required_features) const {
+    if (weight_type_ != WeightType::kF32) {
+        RWKV_LOGE("Packed models hold fp32 weights; %s is %s", path_.c_str(), weight_type_name(weight_type_));
+        return false;
+    }
+    std::vector<std::pair<std::string, PackedTensor>> tensors;
+    // 只读取各权重的指针，不做修改
+    const_cast<Model*>(this)->visit_tensors(
+        [&](const std::string& name, const float*& data, int rows, int cols) {
+            PackedTensor t;
+            t.data = data;
+            t.rows = rows;
+            t.cols = cols;
+            tensors.emplace_back(name, t);
+            return true;
+        });
+    return write_packed_model(path, config_, required_features, tensors);
+}
+
+bool Model::quantize(WeightType type) {
+    if (type == WeightType::kF32 || type == weight_type_) {
+        return true;
+    }
+    if (weight_type_ != WeightType::kF32) {
+        RWKV_LOGE("Model %s is already %s", path_.c_str(), weight_type_name(weight_type_));
+        return false;
+    }
+    std::vector<Matrix*> targets;
+    for (LayerWeights& l : layers_) {
+        for (Matrix* m : {&l.att_r, &l.att_k, &l.att_v, &l.att_g, &l.att_o, &l.ffn_k, &l.ffn_r, &l.ffn_v}) {
+            targets.push_back(m);
+        }
+    }
+    targets.push_back(&head_);
+
+    size_t f32_bytes = 0;
+    size_t quant_bytes = 0;
+    for (Matrix* m : targets) {
+        if (m->cols % kQuantGroup != 0) {
+            continue;
+        }
+        std::vector<uint8_t> q;
+        std::vector<float> scales;
+        quantize_matrix(m->data, m->rows, m->cols, type, q, scales);
+        const size_t bytes = static_cast<size_t>(m->rows) * m->cols * sizeof(float);
+        f32_bytes += bytes;
+        quant_bytes += q.size() + scales.size() * sizeof(float);
+        release(m->data, bytes);
+
+        qstorage_.push_back(std::move(q));
+        m->q = qstorage_.back().data();
+        m->scales = store(std::move(scales));
+        m->data = nullptr;
+        m->type = type;
+    }
+    weight_type_ = type;
+    RWKV_LOGI("Quantized %s to %s: %.1f MB -> %.1f MB, kernels: %s", path_.c_str(), weight_type_name(type),
+              static_cast<double>(f32_bytes) / (1 << 20), static_cast<double>(quant_bytes) / (1 << 20),
+              quant_kernel_name());
+    return true;
+}
+
+// 量化后不再使用的 fp32 权重：映射内的页交还给系统，复制出来的直接释放
+void Model::release(const float* data, size_t bytes) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    if (file_.data() != nullptr && p >= file_.data() && p < file_.data() + file_.size()) {
+        file_.advise(data, bytes, MappedFile::Advice::kDontNeed);
+        return;
+    }
+    for (std::vector<float>& v : storage_) {
+        if (v.data() == data) {
+            std::vector<float>().swap(v);
+            return;
+        }
+    }
+}
+
+bool Model::init_from_packed() {
+    std::map<std::string, PackedTensor> tensors;
+    if (!read_packed_model(file_.data(), file_.size(), &config_, &tensors)) {
+        return false;
+    }
+    layers_.resize(config_.n_layer);
+    const bool ok = visit_tensors([&](const std::string& name, const float*& data, int rows, int cols) {
+        auto it = tensors.find(name);
+        if (it == tensors.end() || it->second.rows != rows || it->second.cols != cols) {
+            RWKV_LOGE("Packed model %s: missing or mis-shaped tensor %s", path_.c_str(), name.c_str());
+            return false;
+        }
+        data = it->second.data;
+        return true;
+    });
+    if (!ok) {
+        return false;
+    }
+    // 全部权重原样映射：后台预读，embedding 只按 token 取行
+    file_.advise(MappedFile::Advice::kWillNeed);
+    file_.advise(emb_, static_cast<size_t>(config_.vocab_size) * config_.n_embd * sizeof(float),
+                 MappedFile::Advice::kRandom);
+
+    RWKV_LOGI("Loaded packed RWKV-6 model %s: n_layer=%d n_embd=%d n_head=%d vocab=%d, wkv kernel: %s",
+              path_.c_str(), config_.n_layer, config_.n_embd, config_.n_head, config_.vocab_size,
+              wkv_kernel_name());
+    return true;
+}
+
+bool Model::init_from_safetensors() {
+    const std::string& path = path_;
+    // 加载时按顺序转换需要复制的张量
+    file_.advise(MappedFile::Advice::kSequential);
+    SafeTensors st;
+    if (!st.parse(file_.data(), file_.size())) {
+        return false;
+    }
+    if (!st.contains("blocks.0.att.time_maa_x")) {
+        RWKV_LOGE("%s is not an RWKV-6 (x060) model", path.c_str());
+        return false;
+    }
+
+    const TensorInfo* emb = st.find("emb.weight");
+    const TensorInfo* faaaa = st.find("blocks.0.att.time_faaaa");
+    const TensorInfo* maa_w1 = st.find("blocks.0.att.time_maa_w1");
+    const TensorInfo* decay_w1 = st.find("blocks.0.att.time_decay_w1");
+    const TensorInfo* ffn_key = st.find("blocks.0.ffn.key.weight");
+    if (!emb || !faaaa || !maa_w1 || !decay_w1 || !ffn_key || emb->shape.size() != 2 ||
+        faaaa->shape.size() < 2 || maa_w1->shape.size() != 2 || decay_w1->shape.size() != 2 ||
+        ffn_key->shape.size() != 2) {
+        RWKV_LOGE("Unexpected tensor layout in %s", path.c_str());
+        return false;
+    }
+
+    ModelConfig& cfg = config_;
+    cfg.vocab_size = static_cast<int>(emb->shape[0]);
+    cfg.n_embd = static_cast<int>(emb->shape[1]);
+    cfg.n_head = static_cast<int>(faaaa->shape[0]);
+    cfg.head_size = static_cast<int>(faaaa->shape[1]);
+    cfg.dim_mix = static_cast<int>(maa_w1->shape[1] / 5);
+    cfg.dim_decay = static_cast<int>(decay_w1->shape[1]);
+    cfg.n_ffn = static_cast<int>(ffn_key->shape[0]);
+    while (st.contains("blocks." + std::to_string(cfg.n_layer) + ".ln1.weight")) {
+        ++cfg.n_layer;
+    }
+    if (cfg.n_head * cfg.head_size != cfg.n_embd) {
+        RWKV_LOGE("n_head * head_size (%d * %d) != n_embd (%d)", cfg.n_head, cfg.head_size, cfg.n_embd);
+        return false;
+    }
+
+    const int C = cfg.n_embd;
+    const int D = cfg.dim_mix;
+    const int Dd = cfg.dim_decay;
+    const int F = cfg.n_ffn;
+
+    // 原样使用的张量在加载后预读，已复制的张量所占的页随即释放
+    std::vector<const TensorInfo*> in_place;
+    std::vector<const TensorInfo*> copied;
+    size_t in_place_bytes = 0;
+
+    // 运行时格式的张量直接指向映射，其余转换成 fp32 存入 storage_
+    auto vec = [&](const std::string& name, int64_t n, const float*& dst) {
+        const TensorInfo* info = find_tensor(st, name, n);
+        if (info == nullptr) return false;
+        if (usable_in_place(*info)) {
+            dst = reinterpret_cast<const float*>(info->data);
+            in_place.push_back(info);
+            in_place_bytes += info->nbytes;
+        } else {
+            std::vector<float> v(static_cast<size_t>(info->numel()));
+            convert_to_f32(info->dtype, info->data, v.data(), v.size());
+            dst = store(std::move(v));
+            copied.push_back(info);
+            converted_bytes_ += info->numel() * sizeof(float);
+        }
+        return true;
+    };
+    auto mat = [&](const std::string& name, int rows, int cols, Matrix& dst) {
+        dst.rows = rows;
+        dst.cols = cols;
+        return vec(name, static_cast<int64_t>(rows) * cols, dst.data);
+    };
+    // 以 [in x out] 存储的低秩矩阵转置成 [out x in]
+    auto mat_t = [&](const std::string& name, int in, int out, Matrix& dst) {
+        std::vector<float> v;
+        if (!fetch(st, name, static_cast<int64_t>(in) * out, v)) return false;
+        dst = store_matrix(transpose(v.data(), in, out), out, in);
+        copied.push_back(st.find(name));
+        return true;
+    };
+
+    if (!vec("emb.weight", static_cast<int64_t>(cfg.vocab_size) * C, emb_) ||
+        !vec("blocks.0.ln0.weight", C, ln0_w_) || !vec("blocks.0.ln0.bias", C, ln0_b_)) {
+        return false;
+    }
+
+    layers_.resize(cfg.n_layer);
+    for (int i = 0; i < cfg.n_layer; ++i) {
+        const std::string p = "blocks." + std::to_string(i) + ".";
+        LayerWeights& l = layers_[i];
+        bool ok = vec(p + "ln1.weight", C, l.ln1_w) && vec(p + "ln1.bias", C, l.ln1_b) &&
+                  vec(p + "ln2.weight", C, l.ln2_w) && vec(p + "ln2.bias", C, l.ln2_b) &&
+                  vec(p + "att.time_maa_x", C, l.maa_x) && vec(p + "att.time_maa_w", C, l.maa_w) &&
+                  vec(p + "att.time_maa_k", C, l.maa_k) && vec(p + "att.time_maa_v", C, l.maa_v) &&
+                  vec(p + "att.time_maa_r", C, l.maa_r) && vec(p + "att.time_maa_g", C, l.maa_g) &&
+                  mat_t(p + "att.time_maa_w1", C, 5 * D, l.maa_w1) &&
+                  vec(p + "att.time_decay", C, l.time_decay) &&
+                  mat_t(p + "att.time_decay_w1", C, Dd, l.decay_w1) &&
+                  mat_t(p + "att.time_decay_w2", Dd, C, l.decay_w2) &&
+                  vec(p + "att.time_faaaa", C, l.time_faaaa) &&
+                  mat(p + "att.receptance.weight", C, C, l.att_r) &&
+                  mat(p + "att.key.weight", C, C, l.att_k) &&
+                  mat(p + "att.value.weight", C, C, l.att_v) &&
+                  mat(p + "att.gate.weight", C, C, l.att_g) &&
+                  mat(p + "att.output.weight", C, C, l.att_o) &&
+                  vec(p + "att.ln_x.weight", C, l.lnx_w) && vec(p + "att.ln_x.bias", C, l.lnx_b) &&
+                  vec(p + "ffn.time_maa_k", C, l.ffn_maa_k) && vec(p + "ffn.time_maa_r", C, l.ffn_maa_r) &&
+                  mat(p + "ffn.key.weight", F, C, l.ffn_k) &&
+                  mat(p + "ffn.receptance.weight", C, C, l.ffn_r) &&
+                  mat(p + "ffn.value.weight", C, F, l.ffn_v);
+        if (!ok) {
+            return false;
+        }
+        // time_maa_w2: [5 x D x C]，拆成 5 个 [C x D]
+        std::vector<float> w2;
+        if (!fetch(st, p + "att.time_maa_w2", static_cast<int64_t>(5) * D * C, w2)) {
+            return false;
+        }
+        for (int m = 0; m < 5; ++m) {
+            l.maa_w2[m] = store_matrix(transpose(w2.data() + static_cast<size_t>(m) * D * C, D, C), C, D);
+        }
+        copied.push_back(st.find(p + "att.time_maa_w2"));
+    }
+
+    if (!vec("ln_out.weight", C, ln_out_w_) || !vec("ln_out.bias", C, ln_out_b_) ||
+        !mat("head.weight", cfg.vocab_size, C, head_)) {
+        return false;
+    }
+
+    // 每个 token 都会顺序读完各层权重与 head：后台预读；embedding 只按 token 取行：关闭预读
+    file_.advise(MappedFile::Advice::kNormal);
+    for (const TensorInfo* info : copied) {
+        file_.advise(info->data, info->nbytes, MappedFile::Advice::kDontNeed);
+    }
+    for (const TensorInfo* info : in_place) {
+        const bool is_emb = reinterpret_cast<const float*>(info->data) == emb_;
+        file_.advise(info->data, info->nbytes,
+                     is_emb ? MappedFile::Advice::kRandom : MappedFile::Advice::kWillNeed);
+    }
+    if (in_place.empty()) {
+        // 全部权重都已复制，映射不再需要
+        file_.close();
+    }
+
+    RWKV_LOGI("Loaded RWKV-6 model %s: n_layer=%d n_embd=%d n_head=%d vocab=%d, %.1f MB mapped in place, "
+              "wkv kernel: %s",
+              path.c_str(), cfg.n_layer, cfg.n_embd, cfg.n_head, cfg.vocab_size,
+              static_cast<double>(in_place_bytes) / (1 << 20), wkv_kernel_name());
+    return true;
+}
+
+// 一次前向的 n 行输入：n 个独立序列各一个 token（sequential == false），
+// 或同一序列的 n 个连续 token（sequential == true，只用 states[0]）
+struct Model::Rows {
+    State* const* states;
+    int n;
+    bool sequential;
+    ThreadPool* pool;
+    State* checkpoints = nullptr;  // 非空时记录同一序列每个 token（最后一个除外）之后的状态
+
+    State& state(int b) const { return *states[sequential ? 0 : b]; }
+};
+
+void Model::forward(int token, State& state, ForwardScratch& s, float* logits, ThreadPool* pool) const {
+    State* states[1] = {&state};
+    float* outs[1] = {logits};
+    forward_batch(&token, states, 1, s, outs, pool);
+}
+
+void Model::forward_batch(const int* tokens, State* const* states, int n,
+                          ForwardScratch& s, float* const* logits, ThreadPool* pool) const {
+    ProfileTimer timer(s.profile != nullptr ? &s.profile->total_ns : nullptr);
+    forward_rows(tokens, Rows{states, n, false, pool}, s);
+    if (logits == nullptr) {
+        return;
+    }
+    // 只对需要 logits 的序列做 ln_out；head 是最大的矩阵，整批一起乘
+    const int C = config_.n_embd;
+    int first = -1, count = 0;
+    for (int b = 0; b < n; ++b) {
+        if (logits[b] == nullptr) continue;
+        layer_norm(s.x.data() + b * C, ln_out_w_, ln_out_b_, s.xx.data() + count * C, C, kLayerNormEps);
+        if (first < 0) first = b;
+        ++count;
+    }
+    if (count == 1) {
+        parallel_matmat(pool, s.profile, head_, s.xx.data(), C, logits[first], 0, 1);
+    } else if (count > 1) {
+        const int V = config_.vocab_size;
+        s.logits.resize(static_cast<size_t>(s.batch) * V);
+        parallel_matmat(pool, s.profile, head_, s.xx.data(), C, s.logits.data(), V, count);
+        int row = 0;
+        for (int b = 0; b < n; ++b) {
+            if (logits[b] == nullptr) continue;
+            memcpy(logits[b], s.logits.data() + static_cast<size_t>(row++) * V, V * sizeof(float));
+        }
+    }
+}
+
+void Model::forward_chunk(const int* tokens, int n, State& state, ForwardScratch& s,
+                          float* logits, ThreadPool* pool) const {
+    ProfileTimer timer(s.profile != nullptr ? &s.profile->total_ns : nullptr);
+    State* states[1] = {&state};
+    forward_rows(tokens, Rows{states, n, true, pool}, s);
+    if (logits == nullptr) {
+        return;
+    }
+    // prompt 只需要最后一个 token 的 logits
+    const int C = config_.n_embd;
+    layer_norm(s.x.data() + static_cast<size_t>(n - 1) * C, ln_out_w_, ln_out_b_, s.xx.data(), C, kLayerNormEps);
+    parallel_matmat(pool, s.profile, head_, s.xx.data(), C, logits, 0, 1);
+}
+
+void Model::forward_verify(const int* tokens, int n, State& state, ForwardScratch& s, float* logits,
+                           State* checkpoints, ThreadPool* pool) const {
+    ProfileTimer timer(s.profile != nullptr ? &s.profile->total_ns : nullptr);
+    State* states[1] = {&state};
+    forward_rows(tokens, Rows{states, n, true, pool, checkpoints}, s);
+    const int C = config_.n_embd;
+    for_rows(pool, n, [&](int b0, int b1) {
+        for (int b = b0; b < b1; ++b) {
+            layer_norm(s.x.data() + static_cast<size_t>(b) * C, ln_out_w_, ln_out_b_,
+                       s.xx.data() + static_cast<size_t>(b) * C, C, kLayerNormEps);
+        }
+    });
+    parallel_matmat(pool, s.profile, head_, s.xx.data(), C, logits, config_.vocab_size, n);
+}
+
+void Model::forward_rows(const int* tokens, const Rows& rows, ForwardScratch& s) const {
+    const int C = config_.n_embd;
+    const int n = rows.n;
+    for (int b = 0; b < n; ++b) {
+        int token = tokens[b];
+        if (token < 0 || token >= config_.vocab_size) {
+            token = 0;
+        }
+        layer_norm(emb_ + static_cast<size_t>(token) * C, ln0_w_, ln0_b_,
+                   s.x.data() + static_cast<size_t>(b) * C, C, kLayerNormEps);
+    }
+    const size_t nc = static_cast<size_t>(n) * C;
+    if (s.profile != nullptr) {
+        ++s.profile->passes;
+        s.profile->weight_bytes += nc * sizeof(float);
+    }
+
+    for (int i = 0; i < config_.n_layer; ++i) {
+        const LayerWeights& l = layers_[i];
+        ProfileTimer layer_timer(kernel_timing(s.profile) ? &s.profile->layer_ns[static_cast<size_t>(i)] : nullptr);
+        for_rows(rows.pool, n, [&](int b0, int b1) {
+            for (int b = b0; b < b1; ++b) {
+                layer_norm(s.x.data() + b * C, l.ln1_w, l.ln1_b, s.xx.data() + b * C, C, kLayerNormEps);
+            }
+        });
+        time_mix(i, s.xx.data(), rows, s, s.tmp.data());
+        for (size_t c = 0; c < nc; ++c) s.x[c] += s.tmp[c];
+
+        for_rows(rows.pool, n, [&](int b0, int b1) {
+            for (int b = b0; b < b1; ++b) {
+                layer_norm(s.x.data() + b * C, l.ln2_w, l.ln2_b, s.xx.data() + b * C, C, kLayerNormEps);
+            }
+        });
+        channel_mix(i, s.xx.data(), rows, s, s.tmp.data());
+        for (size_t c = 0; c < nc; ++c) s.x[c] += s.tmp[c];
+    }
+}
+
+void Model::time_mix(int layer, const float* x, const Rows& rows, ForwardScratch& s, float* out) const {
+    const LayerWeights& l = layers_[layer];
+    const int C = config_.n_embd;
+    const int D = config_.dim_mix;
+    const int Dd = config_.dim_decay;
+    const int H = config_.n_head;
+    const int S = config_.head_size;
+    const int n = rows.n;
+    ThreadPool* pool = rows.pool;
+    const size_t nc = static_cast<size_t>(n) * C;
+    const size_t layer_off = static_cast<size_t>(layer) * C;
+
+    // token shift：同一序列的分块里，前一个 token 就是上一行
+    for (int b = 0; b < n; ++b) {
+        const float* xb = x + b * C;
+        const float* prev = rows.sequential && b > 0 ? xb - C : rows.state(b).att_x.data() + layer_off;
+        float* sx = s.sx.data() + b * C;
+        float* mix = s.mix.data() + b * C;
+        for (int c = 0; c < C; ++c) {
+            sx[c] = prev[c] - xb[c];
+            mix[c] = xb[c] + sx[c] * l.maa_x[c];
+        }
+    }
+    for (int b = rows.sequential ? n - 1 : 0; b < n; ++b) {
+        memcpy(rows.state(b).att_x.data() + layer_off, x + b * C, C * sizeof(float));
+    }
+    if (rows.checkpoints != nullptr) {
+        for (int b = 0; b + 1 < n; ++b) {
+            memcpy(rows.checkpoints[b].att_x.data() + layer_off, x + b * C, C * sizeof(float));
+        }
+    }
+
+    // 数据相关的 token shift（ddlerp）
+    parallel_matmat(pool, s.profile, l.maa_w1, s.mix.data(), C, s.mix_out.data(), 5 * D, n);
+    for (size_t i = 0; i < static_cast<size_t>(n) * 5 * D; ++i) s.mix_out[i] = std::tanh(s.mix_out[i]);
+    const float* maa[5] = {l.maa_w, l.maa_k, l.maa_v, l.maa_r, l.maa_g};
+    float* dst[5] = {s.xw.data(), s.xk.data(), s.xv.data(), s.xr.data(), s.xg.data()};
+    for (int m = 0; m < 5; ++m) {
+        parallel_matmat(pool, s.profile, l.maa_w2[m], s.mix_out.data() + m * D, 5 * D, s.tmp.data(), C, n);
+        for (int b = 0; b < n; ++b) {
+            const float* xb = x + b * C;
+            const float* sx = s.sx.data() + b * C;
+            const float* t = s.tmp.data() + b * C;
+            float* d = dst[m] + b * C;
+            for (int c = 0; c < C; ++c) {
+                d[c] = xb[c] + sx[c] * (maa[m][c] + t[c]);
+            }
+        }
+    }
+
+    parallel_matmat(pool, s.profile, l.att_r, s.xr.data(), C, s.r.data(), C, n);
+    parallel_matmat(pool, s.profile, l.att_k, s.xk.data(), C, s.k.data(), C, n);
+    parallel_matmat(pool, s.profile, l.att_v, s.xv.data(), C, s.v.data(), C, n);
+    parallel_matmat(pool, s.profile, l.att_g, s.xg.data(), C, s.g.data(), C, n);
+
+    parallel_matmat(pool, s.profile, l.decay_w1, s.xw.data(), C, s.decay.data(), Dd, n);
+    for (size_t i = 0; i < static_cast<size_t>(n) * Dd; ++i) s.decay[i] = std::tanh(s.decay[i]);
+    parallel_matmat(pool, s.profile, l.decay_w2, s.decay.data(), Dd, s.w.data(), C, n);
+    for_rows(pool, n, [&](int b0, int b1) {
+        for (int b = b0; b < b1; ++b) {
+            float* w = s.w.data() + b * C;
+            float* g = s.g.data() + b * C;
+            for (int c = 0; c < C; ++c) {
+                w[c] += l.time_decay[c];  // exp(-exp(.)) 在 WKV 内核里与状态更新一起做
+                g[c] = g[c] * sigmoid(g[c]);
+            }
+        }
+    });
+
+    // 各 head 的状态互不相关，按 head 分给线程；同一序列的 token 在 head 内按顺序递推
+    auto run_wkv = [&](int h0, int h1) {
+        for (int h = h0; h < h1; ++h) {
+            const float* u = l.time_faaaa + h * S;
+            const size_t state_off = (static_cast<size_t>(layer) * H + h) * S * S;
+            // 连续 token 共用一个状态，整块交给内核，状态留在 L1；
+            // 需要检查点时逐个 token 递推，每步之后复制这个 head 的状态块
+            const int tokens = rows.sequential && rows.checkpoints == nullptr ? n : 1;
+            for (int b = 0; b < n; b += tokens) {
+                const size_t off = static_cast<size_t>(b) * C + h * S;
+                float* kv = rows.state(b).att_kv.data() + state_off;
+                wkv(S, tokens, C, s.r.data() + off, s.k.data() + off, s.v.data() + off, s.w.data() + off, u,
+                    kv, s.y.data() + off);
+                if (rows.checkpoints != nullptr && b + 1 < n) {
+                    memcpy(rows.checkpoints[b].att_kv.data() + state_off, kv, static_cast<size_t>(S) * S * sizeof(float));
+                }
+            }
+        }
+    };
+    {
+        ProfileTimer timer(kernel_timing(s.profile) ? &s.profile->wkv_ns : nullptr);
+        if (pool != nullptr && static_cast<size_t>(H) * S * S * n >= kMinParallelWork) {
+            pool->parallel_for(H, run_wkv, 1);
+        } else {
+            run_wkv(0, H);
+        }
+    }
+    for (int b = 0; b < n; ++b) {
+        group_norm(s.y.data() + b * C, l.lnx_w, l.lnx_b, H, S, kGroupNormEps);
+    }
+
+    for (size_t c = 0; c < nc; ++c) s.y[c] *= s.g[c];
+    parallel_matmat(pool, s.profile, l.att_o, s.y.data(), C, out, C, n);
+}
+
+void Model::channel_mix(int layer, const float* x, const Rows& rows, ForwardScratch& s, float* out) const {
+    const LayerWeights& l = layers_[layer];
+    const int C = config_.n_embd;
+    const int F = config_.n_ffn;
+    const int n = rows.n;
+    ThreadPool* pool = rows.pool;
+    const size_t layer_off = static_cast<size_t>(layer) * C;
+
+    for (int b = 0; b < n; ++b) {
+        const float* xb = x + b * C;
+        const float* prev = rows.sequential && b > 0 ? xb - C : rows.state(b).ffn_x.data() + layer_off;
+        float* xk = s.xk.data() + b * C;
+        float* xr = s.xr.data() + b * C;
+        for (int c = 0; c < C; ++c) {
+            const float sx = prev[c] - xb[c];
+            xk[c] = xb[c] + sx * l.ffn_maa_k[c];
+            xr[c] = xb[c] + sx * l.ffn_maa_r[c];
+        }
+    }
+    for (int b = rows.sequential ? n - 1 : 0; b < n; ++b) {
+        memcpy(rows.state(b).ffn_x.data() + layer_off, x + b * C, C * sizeof(float));
+    }
+    if (rows.checkpoints != nullptr) {
+        for (int b = 0; b + 1 < n; ++b) {
+            memcpy(rows.checkpoints[b].ffn_x.data() + layer_off, x + b * C, C * sizeof(float));
+        }
+    }
+
+    parallel_matmat(pool, s.profile, l.ffn_k, s.xk.data(), C, s.ffn_k.data(), F, n);
+    for (size_t i = 0; i < static_cast<size_t>(n) * F; ++i) {
+        const float v = s.ffn_k[i];
+        s.ffn_k[i] = v > 0.f ? v * v : 0.f;
+    }
+    parallel_matmat(pool, s.profile, l.ffn_r, s.xr.data(), C, s.r.data(), C, n);
+    parallel_matmat(pool, s.profile, l.ffn_v, s.ffn_k.data(), F, out, C, n);
+    for (size_t c = 0; c < static_cast<size_t>(n) * C; ++c) {
+        out[c] *= sigmoid(s.r[c]);
+    }
+}
+
+} // namespace rwkvmobile
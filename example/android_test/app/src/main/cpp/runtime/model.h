@@ -0,0 +1,248 @@
+/**
+ * model.h
+ *
+ * RWKV-6 ("x060") weights and the reference forward pass: one token, a
+ * batch of independent sequences, or a chunk of one sequence's prompt.
+ * Weights are read from a memory-mapped safetensors file with the standard
+ * RWKV-LM tensor names, or from a packed model (packed_model.h). fp32
+ * tensors that need no reshaping are used in place from the mapping;
+ * everything else is expanded to fp32 at load time. A packed model is
+ * entirely in place.
+ */
+
+#ifndef RWKVMOBILE_MODEL_H
+#define RWKVMOBILE_MODEL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+#include "mapped_file.h"
+
+namespace rwkvmobile {
+
+class ThreadPool;
+
+struct ModelConfig {
+    int n_layer = 0;
+    int n_embd = 0;
+    int n_ffn = 0;
+    int n_head = 0;
+    int head_size = 0;
+    int vocab_size = 0;
+    int dim_mix = 0;    // time_maa_w1 的低秩维度（通常为 32）
+    int dim_decay = 0;  // time_decay_w1 的低秩维度（通常为 64）
+};
+
+/**
+ * Recurrent state of one sequence. Per layer: the previous token's input to
+ * time-mix and channel-mix, plus the [n_head x head_size x head_size] WKV
+ * matrix.
+ */
+struct State {
+    std::vector<float> att_x;   // n_layer * n_embd
+    std::vector<float> att_kv;  // n_layer * n_head * head_size * head_size
+    std::vector<float> ffn_x;   // n_layer * n_embd
+
+    void init(const ModelConfig& cfg);
+    void reset();
+    bool empty() const { return att_x.empty(); }
+};
+
+struct LayerWeights {
+    const float* ln1_w;
+    const float* ln1_b;
+    const float* ln2_w;
+    const float* ln2_b;
+
+    // time-mix
+    const float* maa_x;
+    const float* maa_w;
+    const float* maa_k;
+    const float* maa_v;
+    const float* maa_r;
+    const float* maa_g;
+    Matrix maa_w1;     // [5*dim_mix x n_embd]
+    Matrix maa_w2[5];  // [n_embd x dim_mix], order: w, k, v, r, g
+    const float* time_decay;
+    Matrix decay_w1;   // [dim_decay x n_embd]
+    Matrix decay_w2;   // [n_embd x dim_decay]
+    const float* time_faaaa;  // u, [n_head x head_size]
+    Matrix att_r;
+    Matrix att_k;
+    Matrix att_v;
+    Matrix att_g;
+    Matrix att_o;
+    const float* lnx_w;
+    const float* lnx_b;
+
+    // channel-mix
+    const float* ffn_maa_k;
+    const float* ffn_maa_r;
+    Matrix ffn_k;  // [n_ffn x n_embd]
+    Matrix ffn_r;  // [n_embd x n_embd]
+    Matrix ffn_v;  // [n_embd x n_ffn]
+};
+
+/**
+ * Where the time of the forward passes run with a scratch that points here
+ * went: wall time on the calling thread in nanoseconds (with a thread pool
+ * this includes waiting for the other threads), plus the weight bytes the
+ * passes read. Accumulates until reset(). Passes, bytes and total_ns are
+ * always counted; the per-kernel breakdown (matmul_ns, wkv_ns, layer_ns)
+ * reads the clock around every matrix multiplication and only runs with
+ * kernel_timing set.
+ */
+struct ForwardProfile {
+    bool kernel_timing = false;   // 不随 reset() 清除
+    uint64_t passes = 0;
+    uint64_t total_ns = 0;
+    uint64_t matmul_ns = 0;       // 全部投影与 head 的矩阵乘法
+    uint64_t wkv_ns = 0;          // WKV 递推
+    uint64_t weight_bytes = 0;    // 矩阵乘法每次调用读一遍整张矩阵，加上 embedding 行
+    std::vector<uint64_t> layer_ns;  // 每层 time-mix + channel-mix（含层内的矩阵乘法与 WKV）
+
+    void reset(int n_layer) {
+        passes = total_ns = matmul_ns = wkv_ns = weight_bytes = 0;
+        layer_ns.assign(static_cast<size_t>(n_layer), 0);
+    }
+};
+
+/**
+ * Per-call scratch buffers for forward(). Kept separate from State so the
+ * same model can be driven from several threads. Every activation buffer
+ * holds `batch` rows, one per sequence of forward_batch() or per token of
+ * forward_chunk().
+ */
+struct ForwardScratch {
+    int batch = 0;
+    std::vector<float> x, xx, sx, mix, mix_out, xw, xk, xv, xr, xg;
+    std::vector<float> r, k, v, g, w, y, ffn_k, tmp, decay;
+    std::vector<float> logits;  // 多个序列同时需要 logits 时按需分配，[batch x vocab_size]
+    ForwardProfile* profile = nullptr;  // 非空时记录各部分耗时，层数须与模型一致
+
+    void init(const ModelConfig& cfg, int batch = 1);
+};
+
+class Model {
+public:
+    /**
+     * Load a model from a safetensors file or a packed model file (detected
+     * by its magic).
+     * @return nullptr on failure (details go to the log)
+     */
+    static std::unique_ptr<Model> load(const std::string& path);
+
+    const ModelConfig& config() const { return config_; }
+
+    /**
+     * Write the weights in the packed format, so that later loads map them
+     * without any conversion.
+     * @param required_features CpuFeature bits a loader must have (0 = portable)
+     */
+    bool save_packed(const std::string& path, uint32_t required_features) const;
+
+    // 加载时经过类型转换或复制的权重字节数；为 0 时打包没有收益
+    size_t converted_bytes() const { return converted_bytes_; }
+
+    /**
+     * Replace the large projection matrices (attention r/k/v/g/o, FFN and
+     * head) with group-quantized copies and release their fp32 data. Low-rank
+     * and per-channel tensors stay fp32. A quantized model can no longer be
+     * saved with save_packed().
+     * @param type kQ8 or kQ4; kF32 is a no-op
+     * @return false if the model was already quantized to another type
+     */
+    bool quantize(WeightType type);
+    WeightType weight_type() const { return weight_type_; }
+
+    /**
+     * Run one token through the network, updating `state`. When `logits` is
+     * non-null the output head is evaluated into it (vocab_size floats).
+     * With `pool` the rows of each matrix and the WKV heads are split
+     * across its threads.
+     */
+    void forward(int token, State& state, ForwardScratch& scratch, float* logits,
+                 ThreadPool* pool = nullptr) const;
+
+    /**
+     * Run one token for each of `n` independent sequences in a single pass,
+     * so every weight matrix is streamed from memory once for the whole
+     * batch instead of once per sequence. Results match n calls to
+     * forward().
+     * @param tokens  n token ids
+     * @param states  n distinct states, updated in place
+     * @param n       batch size, 1 <= n <= scratch.batch
+     * @param logits  null, or n pointers (each null or vocab_size floats)
+     */
+    void forward_batch(const int* tokens, State* const* states, int n,
+                       ForwardScratch& scratch, float* const* logits,
+                       ThreadPool* pool = nullptr) const;
+
+    /**
+     * Prefill `n` consecutive tokens of one sequence. Every projection runs
+     * as a GEMM over the whole chunk and the WKV recurrence is split across
+     * heads, both spread over `pool` when given. Results match n calls to
+     * forward().
+     * @param n       chunk length, 1 <= n <= scratch.batch
+     * @param logits  null, or vocab_size floats for the last token
+     * @param pool    null runs on the calling thread
+     */
+    void forward_chunk(const int* tokens, int n, State& state, ForwardScratch& scratch,
+                       float* logits, ThreadPool* pool = nullptr) const;
+
+    /**
+     * Verify drafted tokens: like forward_chunk(), but evaluate the head for
+     * every token and optionally record the state after each token, so the
+     * caller can roll back to any prefix by copying a checkpoint.
+     * @param logits       n rows of vocab_size floats
+     * @param checkpoints  null, or n - 1 states initialized for this model
+     *                     that receive the state after tokens 0 .. n-2 (the
+     *                     state after the last token is `state` itself)
+     */
+    void forward_verify(const int* tokens, int n, State& state, ForwardScratch& scratch, float* logits,
+                        State* checkpoints, ThreadPool* pool = nullptr) const;
+
+    const std::string& path() const { return path_; }
+
+private:
+    Model() = default;
+
+    bool init_from(const std::string& path);
+    bool init_from_safetensors();
+    bool init_from_packed();
+    // 按固定顺序枚举全部权重：fn(name, data, rows, cols)，返回 false 时中止
+    template <typename Fn>
+    bool visit_tensors(Fn&& fn);
+    const float* store(std::vector<float>&& data);
+    Matrix store_matrix(std::vector<float>&& data, int rows, int cols);
+    void release(const float* data, size_t bytes);
+
+    struct Rows;
+
+    void forward_rows(const int* tokens, const Rows& rows, ForwardScratch& s) const;
+    // x / out: [n x n_embd]
+    void time_mix(int layer, const float* x, const Rows& rows, ForwardScratch& s, float* out) const;
+    void channel_mix(int layer, const float* x, const Rows& rows, ForwardScratch& s, float* out) const;
+
+    std::string path_;
+    ModelConfig config_;
+    MappedFile file_;  // 原样使用的权重直接指向这里
+    std::vector<std::vector<float>> storage_;
+    std::vector<std::vector<uint8_t>> qstorage_;  // 量化权重，scales 放在 storage_
+    size_t converted_bytes_ = 0;
+    WeightType weight_type_ = WeightType::kF32;
+    std::vector<LayerWeights> layers_;
+    const float* emb_ = nullptr;  // ln0 在取出 embedding 行时再做，整张表可以原样映射
+    const float* ln0_w_ = nullptr;
+    const float* ln0_b_ = nullptr;
+    const float* ln_out_w_ = nullptr;
+    const float* ln_out_b_ = nullptr;
+    Matrix head_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_MODEL_H
@@ -0,0 +1,227 @@
+#include "packed_model.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "platform.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'R', 'W', 'P', 'K'};
+constexpr size_t kHeaderSize = 128;
+constexpr size_t kEntrySize = 64;
+constexpr size_t kTableChecksumOffset = 64;
+constexpr size_t kPayloadChecksumOffset = 72;
+
+size_t align_up(size_t n) { return (n + kPackedAlign - 1) / kPackedAlign * kPackedAlign; }
+
+// 头部（两个校验和字段按 0 计）与张量表的校验和
+uint64_t table_checksum(const uint8_t* header, const uint8_t* table, size_t table_size) {
+    uint8_t copy[kHeaderSize];
+    memcpy(copy, header, kHeaderSize);
+    memset(copy + kTableChecksumOffset, 0, 16);
+    return fnv1a_words(table, table_size, fnv1a_words(copy, kHeaderSize));
+}
+
+void store_config(uint8_t* p, const ModelConfig& cfg) {
+    const int values[8] = {cfg.n_layer, cfg.n_embd, cfg.n_ffn, cfg.n_head,
+                           cfg.head_size, cfg.vocab_size, cfg.dim_mix, cfg.dim_decay};
+    for (int i = 0; i < 8; ++i) store_u32(p + i * 4, static_cast<uint32_t>(values[i]));
+}
+
+bool load_config(const uint8_t* p, ModelConfig* cfg) {
+    int* fields[8] = {&cfg->n_layer, &cfg->n_embd, &cfg->n_ffn, &cfg->n_head,
+                      &cfg->head_size, &cfg->vocab_size, &cfg->dim_mix, &cfg->dim_decay};
+    for (int i = 0; i < 8; ++i) {
+        const uint32_t v = load_u32(p + i * 4);
+        if (v == 0 || v > (1u << 24)) return false;
+        *fields[i] = static_cast<int>(v);
+    }
+    return cfg->n_head * cfg->head_size == cfg->n_embd;
+}
+
+} // namespace
+
+bool is_packed_model(const uint8_t* data, size_t size) {
+    return data != nullptr && size >= sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool write_packed_model(const std::string& path, const ModelConfig& cfg, uint32_t required_features,
+                        const std::vector<std::pair<std::string, PackedTensor>>& tensors) {
+    if (!kLittleEndian) {
+        RWKV_LOGE("Packed models can only be written on little-endian hosts");
+        return false;
+    }
+    const size_t table_size = tensors.size() * kEntrySize;
+    const size_t payload_offset = align_up(kHeaderSize + table_size);
+
+    std::vector<uint8_t> head(payload_offset, 0);
+    uint8_t* table = head.data() + kHeaderSize;
+    size_t offset = payload_offset;
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        const std::string& name = tensors[i].first;
+        const PackedTensor& t = tensors[i].second;
+        if (name.size() >= kPackedNameSize) {
+            RWKV_LOGE("Tensor name %s is too long for the packed format", name.c_str());
+            return false;
+        }
+        const size_t bytes = static_cast<size_t>(t.rows) * t.cols * sizeof(float);
+        uint8_t* e = table + i * kEntrySize;
+        memcpy(e, name.data(), name.size());
+        store_u32(e + 40, static_cast<uint32_t>(t.rows));
+        store_u32(e + 44, static_cast<uint32_t>(t.cols));
+        store_u64(e + 48, offset);
+        store_u64(e + 56, bytes);
+        offset += align_up(bytes);
+    }
+    const size_t total = offset;
+
+    uint8_t* h = head.data();
+    memcpy(h, kMagic, sizeof(kMagic));
+    store_u32(h + 4, kPackedLayoutVersion);
+    store_u32(h + 8, static_cast<uint32_t>(payload_offset));
+    store_u32(h + 12, static_cast<uint32_t>(tensors.size()));
+    store_config(h + 16, cfg);
+    store_u32(h + 48, required_features);
+    store_u64(h + 56, total);
+
+    return write_file_atomically(path, "packed model", [&](FILE* fp) {
+        // 先写占位的头部，payload 写完后再回填校验和
+        bool ok = fwrite(head.data(), 1, head.size(), fp) == head.size();
+        uint64_t payload_sum = kFnvOffset;
+        static const uint8_t kZeros[kPackedAlign] = {0};
+        for (size_t i = 0; ok && i < tensors.size(); ++i) {
+            const PackedTensor& t = tensors[i].second;
+            const size_t bytes = static_cast<size_t>(t.rows) * t.cols * sizeof(float);
+            const size_t pad = align_up(bytes) - bytes;
+            const uint8_t* src = reinterpret_cast<const uint8_t*>(t.data);
+            ok = fwrite(src, 1, bytes, fp) == bytes && fwrite(kZeros, 1, pad, fp) == pad;
+            // 不足 8 字节的尾部与对齐填充一起计算
+            const size_t words = bytes & ~static_cast<size_t>(7);
+            uint8_t tail[8 + kPackedAlign] = {0};
+            memcpy(tail, src + words, bytes - words);
+            payload_sum = fnv1a_words(src, words, payload_sum);
+            payload_sum = fnv1a_words(tail, bytes - words + pad, payload_sum);
+        }
+        store_u64(h + kPayloadChecksumOffset, payload_sum);
+        store_u64(h + kTableChecksumOffset, table_checksum(h, table, table_size));
+        return ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(h, 1, kHeaderSize, fp) == kHeaderSize;
+    });
+}
+
+bool read_packed_model(const uint8_t* data, size_t size, ModelConfig* cfg,
+                       std::map<std::string, PackedTensor>* tensors) {
+    if (!kLittleEndian) {
+        RWKV_LOGE("Packed models are only supported on little-endian hosts");
+        return false;
+    }
+    if (size < kHeaderSize || !is_packed_model(data, size)) {
+        RWKV_LOGE("Not a packed RWKV model");
+        return false;
+    }
+    const uint32_t version = load_u32(data + 4);
+    if (version != kPackedLayoutVersion) {
+        RWKV_LOGE("Unsupported packed model layout version %u", version);
+        return false;
+    }
+    const size_t payload_offset = load_u32(data + 8);
+    const size_t count = load_u32(data + 12);
+    const size_t table_size = count * kEntrySize;
+    if (load_u64(data + 56) != size || payload_offset > size || kHeaderSize + table_size > payload_offset) {
+        RWKV_LOGE("Packed model is truncated or corrupt");
+        return false;
+    }
+    if (table_checksum(data, data + kHeaderSize, table_size) != load_u64(data + kTableChecksumOffset)) {
+        RWKV_LOGE("Packed model header checksum mismatch");
+        return false;
+    }
+    const uint32_t required = load_u32(data + 48);
+    if ((required & ~cpu_features()) != 0) {
+        RWKV_LOGE("Packed model needs CPU features %s", cpu_feature_names(required).c_str());
+        return false;
+    }
+    if (!load_config(data + 16, cfg)) {
+        RWKV_LOGE("Packed model has an invalid config");
+        return false;
+    }
+
+    tensors->clear();
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* e = data + kHeaderSize + i * kEntrySize;
+        const size_t name_len = strnlen(reinterpret_cast<const char*>(e), kPackedNameSize);
+        const uint32_t rows = load_u32(e + 40);
+        const uint32_t cols = load_u32(e + 44);
+        const uint64_t offset = load_u64(e + 48);
+        const uint64_t bytes = load_u64(e + 56);
+        if (name_len == kPackedNameSize || offset % kPackedAlign != 0 || offset < payload_offset ||
+            offset > size || bytes > size - offset ||
+            bytes != static_cast<uint64_t>(rows) * cols * sizeof(float)) {
+            RWKV_LOGE("Packed model has an invalid tensor entry %zu", i);
+            return false;
+        }
+        PackedTensor t;
+        t.data = reinterpret_cast<const float*>(data + offset);
+        t.rows = static_cast<int>(rows);
+        t.cols = static_cast<int>(cols);
+        (*tensors)[std::string(reinterpret_cast<const char*>(e), name_len)] = t;
+    }
+    return true;
+}
+
+bool verify_packed_payload(const uint8_t* data, size_t size) {
+    if (size < kHeaderSize || !is_packed_model(data, size)) {
+        return false;
+    }
+    const size_t payload_offset = load_u32(data + 8);
+    if (payload_offset > size || (size - payload_offset) % 8 != 0) {
+        return false;
+    }
+    return fnv1a_words(data + payload_offset, size - payload_offset) ==
+           load_u64(data + kPayloadChecksumOffset);
+}
+
+std::string packed_cache_path(const std::string& cache_dir, const std::string& model_path) {
+    struct stat st;
+    if (stat(model_path.c_str(), &st) != 0) {
+        return std::string();
+    }
+    FILE* fp = fopen(model_path.c_str(), "rb");
+    if (fp == nullptr) {
+        return std::string();
+    }
+    // safetensors 头部（8 字节长度 + JSON）描述了全部张量，与大小、修改时间一起作为模型的指纹
+    uint8_t len_bytes[8];
+    std::vector<uint8_t> header;
+    if (fread(len_bytes, 1, sizeof(len_bytes), fp) == sizeof(len_bytes) &&
+        memcmp(len_bytes, kMagic, sizeof(kMagic)) != 0) {
+        const uint64_t len = load_u64(len_bytes);
+        if (len < static_cast<uint64_t>(st.st_size)) {
+            header.resize(static_cast<size_t>(len));
+            if (fread(header.data(), 1, header.size(), fp) != header.size()) header.clear();
+        }
+    }
+    fclose(fp);
+    if (header.empty()) {
+        return std::string();
+    }
+
+    const uint64_t fields[3] = {static_cast<uint64_t>(st.st_size), static_cast<uint64_t>(st.st_mtime),
+                                kPackedLayoutVersion};
+    uint64_t key = fnv1a_bytes(reinterpret_cast<const uint8_t*>(fields), sizeof(fields));
+    key = fnv1a_bytes(header.data(), header.size(), key);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%08x.rwkvpack", static_cast<unsigned long long>(key),
+             cpu_features());
+    std::string path = cache_dir;
+    if (!path.empty() && path.back() != '/') path += '/';
+    return path + name;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,81 @@
+/**
+ * packed_model.h
+ *
+ * The packed model format (".rwkvpack"): every weight already in the exact
+ * layout the kernels read (fp32, low-rank matrices transposed, time_maa_w2
+ * split per projection), each tensor 64-byte aligned, so a loader maps the
+ * file and points at the tensors without touching them.
+ *
+ * Layout (little endian):
+ *   [0, 128)    header: magic "RWPK", layout version, payload offset, tensor
+ *               count, ModelConfig, required CPU features, file size,
+ *               table checksum, payload checksum
+ *   [128, ...)  tensor table, 64 bytes per tensor: name[40], rows, cols,
+ *               offset, bytes
+ *   payload     tensors, each starting on a 64-byte boundary
+ *
+ * The table checksum (header + table) is checked on every load; the payload
+ * checksum only by verify_packed_payload(), since it reads every weight.
+ */
+
+#ifndef RWKVMOBILE_PACKED_MODEL_H
+#define RWKVMOBILE_PACKED_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "model.h"
+
+namespace rwkvmobile {
+
+constexpr uint32_t kPackedLayoutVersion = 1;
+constexpr size_t kPackedAlign = 64;
+constexpr size_t kPackedNameSize = 40;
+
+struct PackedTensor {
+    const float* data = nullptr;
+    int rows = 0;
+    int cols = 0;
+};
+
+/**
+ * Whether `data` starts with the packed-model magic.
+ */
+bool is_packed_model(const uint8_t* data, size_t size);
+
+/**
+ * Write a packed model to `path` (via a temporary file and a rename).
+ * @param required_features CpuFeature bits a loader must have; 0 = portable
+ * @param tensors           name -> tensor; names shorter than kPackedNameSize
+ * @return false on I/O errors (logged)
+ */
+bool write_packed_model(const std::string& path, const ModelConfig& cfg, uint32_t required_features,
+                        const std::vector<std::pair<std::string, PackedTensor>>& tensors);
+
+/**
+ * Validate the header and tensor table of a mapped packed model and return
+ * its config and tensors (pointing into `data`). Fails on a wrong magic or
+ * version, a table checksum mismatch, truncation, misaligned or
+ * out-of-bounds tensors, or CPU features this CPU lacks.
+ */
+bool read_packed_model(const uint8_t* data, size_t size, ModelConfig* cfg,
+                       std::map<std::string, PackedTensor>* tensors);
+
+/**
+ * Check the payload checksum (reads the whole file).
+ */
+bool verify_packed_payload(const uint8_t* data, size_t size);
+
+/**
+ * Path of the packed copy of `model_path` in `cache_dir`, named by a hash of
+ * the model (size, mtime and safetensors header) and the CPU feature set.
+ * @return empty if the model file cannot be stat'ed or read
+ */
+std::string packed_cache_path(const std::string& cache_dir, const std::string& model_path);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_PACKED_MODEL_H
@@ -0,0 +1,115 @@
+/**
+ * perf_stats.h
+ *
+ * Performance counters of one generation: time to first token, a per-token
+ * latency histogram, where the forward passes spent their time, weight bytes
+ * streamed, prefix-cache reuse and allocations. The generating session fills
+ * a PerfStats as it goes and publishes it to the runtime when it finishes;
+ * rwkvmobile_runtime_get_perf_stats() copies it out.
+ */
+
+#ifndef RWKVMOBILE_PERF_STATS_H
+#define RWKVMOBILE_PERF_STATS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "model.h"
+
+namespace rwkvmobile {
+
+/**
+ * Log-linear histogram of microsecond latencies: 4 buckets per power of
+ * two from 1 us up to 2^24 us (about 17 s); a percentile read from it is off
+ * by less than one bucket (a quarter of its power of two). Fixed size, no
+ * allocation.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBuckets = 4;
+    static constexpr int kOctaves = 24;
+    static constexpr int kBuckets = kSubBuckets * kOctaves;
+
+    void clear() {
+        std::fill(counts_, counts_ + kBuckets, 0u);
+        total_ = 0;
+        max_ = 0;
+    }
+
+    void add(uint64_t us) {
+        ++counts_[bucket(us)];
+        ++total_;
+        max_ = std::max(max_, us);
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return max_; }
+    const uint32_t* counts() const { return counts_; }
+
+    // 第 q 分位（0..1），在所落的桶内线性插值；没有样本时为 0
+    uint64_t percentile(double q) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        const double rank = q * static_cast<double>(total_);
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            if (counts_[i] == 0) continue;
+            if (static_cast<double>(seen + counts_[i]) >= rank) {
+                const double lo = static_cast<double>(lower_bound(i));
+                const double hi = std::min(static_cast<double>(lower_bound(i + 1)), static_cast<double>(max_));
+                const double frac = (rank - static_cast<double>(seen)) / counts_[i];
+                return static_cast<uint64_t>(lo + std::max(hi - lo, 0.0) * frac);
+            }
+            seen += counts_[i];
+        }
+        return max_;
+    }
+
+    // 桶 i 的下界（微秒）
+    static uint64_t lower_bound(int i) {
+        const int octave = i / kSubBuckets;
+        const uint64_t base = uint64_t(1) << octave;
+        return base + base * static_cast<uint64_t>(i % kSubBuckets) / kSubBuckets;
+    }
+
+private:
+    static int bucket(uint64_t us) {
+        if (us == 0) {
+            return 0;
+        }
+        const int octave = 63 - __builtin_clzll(us);
+        if (octave >= kOctaves) {
+            return kBuckets - 1;
+        }
+        // 去掉最高位后的下两位就是 octave 内的位置；小于 4 的值左移补齐
+        const uint64_t rest = us - (uint64_t(1) << octave);
+        const int sub = octave >= 2 ? static_cast<int>(rest >> (octave - 2))
+                                    : static_cast<int>(rest << (2 - octave));
+        return octave * kSubBuckets + sub;
+    }
+
+    uint32_t counts_[kBuckets] = {};
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+};
+
+// 最近一次生成的统计；前缀缓存的累计命中数在读取时从 PrefixCache 取
+struct PerfStats {
+    uint64_t prompt_tokens = 0;     // 本次 prompt 编码后的 token 数
+    uint64_t cached_tokens = 0;     // 其中从前缀缓存恢复、没有跑前向的
+    uint64_t generated_tokens = 0;
+    uint64_t ttft_us = 0;           // 开始生成到第一个 token 输出
+    uint64_t prefill_us = 0;
+    uint64_t decode_us = 0;
+    uint64_t sampler_ns = 0;        // 采样（含约束掩码与重复惩罚）
+    uint64_t arena_allocations = 0;     // 本次生成中 arena 向系统申请内存块的次数
+    uint64_t response_allocations = 0;  // 回复缓冲区新分配的块数
+    LatencyHistogram token_latency;     // 相邻两个输出 token 之间的间隔
+    ForwardProfile forward;             // 主模型的前向（不含草稿模型与合并批处理的前向）
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_PERF_STATS_H
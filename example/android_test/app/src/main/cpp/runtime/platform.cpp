@@ -0,0 +1,173 @@
+#include "platform.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#ifdef __ANDROID__
+#include <sys/system_properties.h>
+#endif
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+namespace rwkvmobile {
+
+namespace {
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t");
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+// 读取 /proc/cpuinfo 中第一个匹配 key 的字段
+std::string cpuinfo_field(const char* key) {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t colon = line.find(':');
+        if (colon != std::string::npos && trim(line.substr(0, colon)) == key) {
+            return trim(line.substr(colon + 1));
+        }
+    }
+    return std::string();
+}
+
+#ifdef __ANDROID__
+std::string system_property(const char* name) {
+    char value[PROP_VALUE_MAX] = {0};
+    __system_property_get(name, value);
+    return value;
+}
+#endif
+
+std::string detect_soc_name() {
+#ifdef __ANDROID__
+    std::string name = system_property("ro.soc.manufacturer");
+    if (name.empty()) name = system_property("ro.board.platform");
+    if (!name.empty()) return name;
+#endif
+    std::string name = cpuinfo_field("Hardware");
+    if (name.empty()) name = cpuinfo_field("model name");
+    return name.empty() ? "Unknown" : name;
+}
+
+std::string detect_soc_partname() {
+#ifdef __ANDROID__
+    std::string name = system_property("ro.soc.model");
+    if (!name.empty()) return name;
+#endif
+    std::string name = cpuinfo_field("CPU part");
+    if (name.empty()) name = cpuinfo_field("model");
+    return name.empty() ? "Unknown" : name;
+}
+
+uint32_t detect_cpu_features() {
+    uint32_t features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        features |= kCpuAvx2;
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        features |= kCpuAvx512;
+    }
+#elif defined(__aarch64__)
+    features |= kCpuNeon;  // arm64 必有 ASIMD
+#if defined(__linux__)
+    // 旧版本内核头文件中可能没有这些宏
+    constexpr unsigned long kHwcapAsimdDp = 1ul << 20;
+    constexpr unsigned long kHwcap2I8mm = 1ul << 13;
+    if (getauxval(AT_HWCAP) & kHwcapAsimdDp) features |= kCpuDotProd;
+    if (getauxval(AT_HWCAP2) & kHwcap2I8mm) features |= kCpuI8mm;
+#endif
+#endif
+    return features;
+}
+
+std::vector<int> detect_performance_cores() {
+    long count = sysconf(_SC_NPROCESSORS_CONF);
+    if (count < 1) count = 1;
+    std::vector<int> all;
+    std::vector<long> freq;
+    for (int cpu = 0; cpu < count; ++cpu) {
+        all.push_back(cpu);
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+        std::ifstream in(path);
+        long khz = 0;
+        if (!(in >> khz) || khz <= 0) {
+            return all;
+        }
+        freq.push_back(khz);
+    }
+    const long slowest = *std::min_element(freq.begin(), freq.end());
+    std::vector<int> cores;
+    for (int cpu = 0; cpu < count; ++cpu) {
+        if (freq[static_cast<size_t>(cpu)] > slowest) cores.push_back(cpu);
+    }
+    return cores.empty() ? all : cores;
+}
+
+} // namespace
+
+uint32_t cpu_features() {
+    static const uint32_t features = detect_cpu_features();
+    return features;
+}
+
+std::string cpu_feature_names(uint32_t features) {
+    static const struct {
+        uint32_t bit;
+        const char* name;
+    } kNames[] = {
+        {kCpuNeon, "neon"}, {kCpuDotProd, "dotprod"}, {kCpuI8mm, "i8mm"},
+        {kCpuAvx2, "avx2"}, {kCpuAvx512, "avx512"},
+    };
+    std::string names;
+    for (const auto& entry : kNames) {
+        if (features & entry.bit) {
+            if (!names.empty()) names += ',';
+            names += entry.name;
+        }
+    }
+    return names.empty() ? "none" : names;
+}
+
+const std::vector<int>& performance_cores() {
+    static const std::vector<int> cores = detect_performance_cores();
+    return cores;
+}
+
+const char* platform_name() {
+#if defined(__ANDROID__)
+    return "Android";
+#elif defined(__linux__)
+    return "Linux";
+#elif defined(__APPLE__)
+    return "Darwin";
+#else
+    return "Unknown";
+#endif
+}
+
+const char* soc_name() {
+    static const std::string name = detect_soc_name();
+    return name.c_str();
+}
+
+const char* soc_partname() {
+    static const std::string name = detect_soc_partname();
+    return name.c_str();
+}
+
+const char* htp_arch() {
+    // CPU 参考实现不使用 Hexagon NPU
+    return "none";
+}
+
+} // namespace rwkvmobile
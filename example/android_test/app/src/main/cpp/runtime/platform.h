@@ -0,0 +1,50 @@
+/**
+ * platform.h
+ *
+ * Device information reported by rwkvmobile_get_platform_name and friends,
+ * and the CPU features that select kernels and key cached packed models.
+ */
+
+#ifndef RWKVMOBILE_PLATFORM_H
+#define RWKVMOBILE_PLATFORM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rwkvmobile {
+
+// cpu_features() 的位
+enum CpuFeature : uint32_t {
+    kCpuNeon = 1u << 0,
+    kCpuDotProd = 1u << 1,  // arm64 SDOT/UDOT
+    kCpuI8mm = 1u << 2,     // arm64 SMMLA
+    kCpuAvx2 = 1u << 8,     // 同时要求 FMA
+    kCpuAvx512 = 1u << 9,   // AVX-512 F + BW
+};
+
+/**
+ * CpuFeature bits supported by this CPU (detected once via CPUID or HWCAP).
+ */
+uint32_t cpu_features();
+
+/**
+ * Human-readable list of `features`, e.g. "avx2,avx512" ("none" if 0).
+ */
+std::string cpu_feature_names(uint32_t features);
+
+/**
+ * CPUs outside the slowest cluster, by cpufreq cpuinfo_max_freq: the prime
+ * and big cores of a big.LITTLE SoC. All configured CPUs when the
+ * frequencies cannot be read or are all equal.
+ */
+const std::vector<int>& performance_cores();
+
+const char* platform_name();
+const char* soc_name();
+const char* soc_partname();
+const char* htp_arch();
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_PLATFORM_H
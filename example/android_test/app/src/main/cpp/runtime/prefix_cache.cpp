@@ -0,0 +1,127 @@
+#include "prefix_cache.h"
+
+#include <algorithm>
+
+namespace rwkvmobile {
+
+namespace {
+
+// 多项式滚动哈希：hash(t[0, i+1)) = hash(t[0, i)) * kBase + t[i] + 1
+constexpr uint64_t kBase = 0x100000001b3ull;
+
+uint64_t extend(uint64_t hash, int token) {
+    return hash * kBase + static_cast<uint64_t>(static_cast<uint32_t>(token)) + 1;
+}
+
+size_t state_bytes(const State& state) {
+    return (state.att_x.size() + state.att_kv.size() + state.ffn_x.size()) * sizeof(float);
+}
+
+} // namespace
+
+void PrefixCache::set_capacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = bytes;
+    evict_locked(capacity_);
+}
+
+size_t PrefixCache::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+size_t PrefixCache::lookup(int model_id, const int* tokens, size_t max_len, State& state, uint64_t* hashes) {
+    // 所有前缀长度的哈希，一次遍历得到
+    hashes[0] = 0;
+    for (size_t i = 0; i < max_len; ++i) {
+        hashes[i + 1] = extend(hashes[i], tokens[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto best = entries_.end();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        const size_t len = it->tokens.size();
+        if (it->model_id != model_id || len > max_len || it->hash != hashes[len]) {
+            continue;
+        }
+        if (best != entries_.end() && len <= best->tokens.size()) {
+            continue;
+        }
+        // 哈希相同时再逐 token 比较，排除碰撞
+        if (std::equal(it->tokens.begin(), it->tokens.end(), tokens)) {
+            best = it;
+        }
+    }
+    if (best == entries_.end()) {
+        ++stats_.misses;
+        return 0;
+    }
+    entries_.splice(entries_.begin(), entries_, best);
+    state = best->state;
+    ++stats_.hits;
+    stats_.reused_tokens += best->tokens.size();
+    return best->tokens.size();
+}
+
+void PrefixCache::insert(int model_id, const int* tokens, size_t len, const State& state) {
+    if (len == 0) {
+        return;
+    }
+    uint64_t hash = 0;
+    for (size_t i = 0; i < len; ++i) {
+        hash = extend(hash, tokens[i]);
+    }
+    const size_t bytes = state_bytes(state) + len * sizeof(int);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes > capacity_) {
+        return;
+    }
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->model_id == model_id && it->hash == hash && it->tokens.size() == len &&
+            std::equal(it->tokens.begin(), it->tokens.end(), tokens)) {
+            // 并发的会话可能同时 prefill 了同一前缀
+            entries_.splice(entries_.begin(), entries_, it);
+            return;
+        }
+    }
+    evict_locked(capacity_ - bytes);
+    entries_.push_front(Entry{model_id, hash, std::vector<int>(tokens, tokens + len), state, bytes});
+    stats_.bytes += bytes;
+    stats_.entries = entries_.size();
+}
+
+void PrefixCache::erase_model(int model_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->model_id == model_id) {
+            stats_.bytes -= it->bytes;
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    stats_.entries = entries_.size();
+}
+
+void PrefixCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    stats_.bytes = 0;
+    stats_.entries = 0;
+}
+
+PrefixCacheStats PrefixCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void PrefixCache::evict_locked(size_t budget) {
+    while (!entries_.empty() && stats_.bytes > budget) {
+        stats_.bytes -= entries_.back().bytes;
+        entries_.pop_back();
+    }
+    stats_.entries = entries_.size();
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,83 @@
+/**
+ * prefix_cache.h
+ *
+ * LRU cache of RWKV states keyed by the token prefix that produced them
+ * from a zero state. Chats that start with the same system prompt resume
+ * from the cached state and only prefill the rest. Shared by all sessions
+ * of a runtime and bounded in bytes.
+ */
+
+#ifndef RWKVMOBILE_PREFIX_CACHE_H
+#define RWKVMOBILE_PREFIX_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include "model.h"
+
+namespace rwkvmobile {
+
+struct PrefixCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t reused_tokens = 0;  // 命中时跳过的 prefill token 数之和
+    size_t bytes = 0;
+    size_t entries = 0;
+};
+
+class PrefixCache {
+public:
+    // 默认容量，约可容纳数个 1.5B 模型的状态
+    static constexpr size_t kDefaultCapacity = 64u << 20;
+
+    /**
+     * Bound the memory used by cached states; 0 disables the cache.
+     * Shrinking evicts least recently used entries.
+     */
+    void set_capacity(size_t bytes);
+    size_t capacity() const;
+
+    /**
+     * Find the longest cached prefix tokens[0, len) with len <= max_len for
+     * `model_id` and copy its state into `state`. Counts a hit or a miss.
+     * @param hashes scratch for the prefix hashes, at least max_len + 1
+     *               elements (the caller's per-generation arena)
+     * @return len, or 0 on a miss (state untouched)
+     */
+    size_t lookup(int model_id, const int* tokens, size_t max_len, State& state, uint64_t* hashes);
+
+    /**
+     * Cache `state`, the result of prefilling tokens[0, len) from a zero
+     * state. States larger than the whole capacity are not cached.
+     */
+    void insert(int model_id, const int* tokens, size_t len, const State& state);
+
+    // 模型释放或词表更换后对应的状态全部失效
+    void erase_model(int model_id);
+    void clear();
+
+    PrefixCacheStats stats() const;
+
+private:
+    struct Entry {
+        int model_id;
+        uint64_t hash;
+        std::vector<int> tokens;
+        State state;
+        size_t bytes;
+    };
+
+    void evict_locked(size_t budget);
+
+    mutable std::mutex mutex_;
+    size_t capacity_ = kDefaultCapacity;
+    std::list<Entry> entries_;  // 最近使用的在前
+    PrefixCacheStats stats_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_PREFIX_CACHE_H
@@ -0,0 +1,541 @@
+#include "regex_dfa.h"
+
+#include <algorithm>
+#include <bitset>
+#include <map>
+
+#include "logger.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+using ByteSet = std::bitset<256>;
+
+constexpr size_t kMaxNfaStates = 200000;
+constexpr int kMaxRepeat = 1000;
+
+struct Node {
+    enum Kind { kEmpty, kBytes, kConcat, kAlt, kRepeat };
+    Kind kind = kEmpty;
+    ByteSet bytes;
+    std::vector<int> children;
+    int min = 0;
+    int max = 0;  // -1 表示不限
+};
+
+// 递归下降解析为语法树，节点按下标引用；出错时返回 -1
+class Parser {
+public:
+    explicit Parser(const std::string& pattern) : p_(pattern) {}
+
+    int parse() {
+        const int root = parse_alt();
+        if (root >= 0 && pos_ != p_.size()) {
+            return fail("unmatched ')'");
+        }
+        return root;
+    }
+
+    const std::vector<Node>& nodes() const { return nodes_; }
+    const std::string& error() const { return error_; }
+    size_t error_pos() const { return error_pos_; }
+
+private:
+    int fail(const char* message) {
+        if (error_.empty()) {
+            error_ = message;
+            error_pos_ = pos_;
+        }
+        return -1;
+    }
+
+    bool failed(const char* message) {
+        fail(message);
+        return false;
+    }
+
+    int add(Node node) {
+        nodes_.push_back(std::move(node));
+        return static_cast<int>(nodes_.size()) - 1;
+    }
+
+    bool at_end() const { return pos_ >= p_.size(); }
+
+    int parse_alt() {
+        Node alt;
+        alt.kind = Node::kAlt;
+        for (;;) {
+            const int branch = parse_concat();
+            if (branch < 0) return -1;
+            alt.children.push_back(branch);
+            if (at_end() || p_[pos_] != '|') break;
+            ++pos_;
+        }
+        return alt.children.size() == 1 ? alt.children[0] : add(std::move(alt));
+    }
+
+    int parse_concat() {
+        Node concat;
+        concat.kind = Node::kConcat;
+        while (!at_end() && p_[pos_] != '|' && p_[pos_] != ')') {
+            const int item = parse_repeat();
+            if (item < 0) return -1;
+            concat.children.push_back(item);
+        }
+        if (concat.children.empty()) return add(Node());
+        return concat.children.size() == 1 ? concat.children[0] : add(std::move(concat));
+    }
+
+    int parse_repeat() {
+        int atom = parse_atom();
+        while (atom >= 0 && !at_end()) {
+            int min = 0;
+            int max = -1;
+            const char c = p_[pos_];
+            if (c == '*') {
+                ++pos_;
+            } else if (c == '+') {
+                min = 1;
+                ++pos_;
+            } else if (c == '?') {
+                max = 1;
+                ++pos_;
+            } else if (c == '{') {
+                const int r = parse_braces(&min, &max);
+                if (r < 0) return -1;
+                if (r == 0) break;
+            } else {
+                break;
+            }
+            // 非贪婪量词匹配的语言与贪婪的相同
+            if (!at_end() && p_[pos_] == '?') ++pos_;
+            Node repeat;
+            repeat.kind = Node::kRepeat;
+            repeat.children.push_back(atom);
+            repeat.min = min;
+            repeat.max = max;
+            atom = add(std::move(repeat));
+        }
+        return atom;
+    }
+
+    // {n} {n,} {n,m}：1 为量词，0 表示 '{' 按普通字符处理，-1 出错
+    int parse_braces(int* min, int* max) {
+        size_t i = pos_ + 1;
+        auto number = [&](int* out) {
+            const size_t begin = i;
+            long v = 0;
+            while (i < p_.size() && p_[i] >= '0' && p_[i] <= '9') {
+                v = std::min<long>(v * 10 + (p_[i++] - '0'), kMaxRepeat + 1);
+            }
+            *out = static_cast<int>(v);
+            return i > begin;
+        };
+        if (!number(min)) return 0;
+        *max = *min;
+        if (i < p_.size() && p_[i] == ',') {
+            ++i;
+            *max = -1;
+            if (i < p_.size() && p_[i] != '}' && !number(max)) return 0;
+        }
+        if (i >= p_.size() || p_[i] != '}') return 0;
+        pos_ = i + 1;
+        if (*min > kMaxRepeat || *max > kMaxRepeat || (*max >= 0 && *max < *min)) {
+            return fail("bad repeat count");
+        }
+        return 1;
+    }
+
+    int parse_atom() {
+        Node node;
+        node.kind = Node::kBytes;
+        const char c = p_[pos_++];
+        switch (c) {
+            case '(': {
+                if (p_.compare(pos_, 2, "?:") == 0) {
+                    pos_ += 2;
+                } else if (!at_end() && p_[pos_] == '?') {
+                    return fail("lookaround and named groups are not supported");
+                }
+                const int inner = parse_alt();
+                if (inner < 0) return -1;
+                if (at_end() || p_[pos_] != ')') return fail("missing ')'");
+                ++pos_;
+                return inner;
+            }
+            case '[':
+                if (!parse_class(&node.bytes)) return -1;
+                break;
+            case '.':
+                node.bytes.set();
+                node.bytes.reset('\n');
+                break;
+            case '^':
+                // 整个输出总是完整匹配，锚点只允许出现在两端
+                if (pos_ != 1) return fail("'^' is only supported at the start");
+                return add(Node());
+            case '$':
+                if (!at_end()) return fail("'$' is only supported at the end");
+                return add(Node());
+            case '*':
+            case '+':
+            case '?':
+                return fail("nothing to repeat");
+            case '\\':
+                if (!parse_escape(&node.bytes)) return -1;
+                break;
+            default:
+                node.bytes.set(static_cast<uint8_t>(c));
+                break;
+        }
+        return add(std::move(node));
+    }
+
+    // '\' 之后的部分
+    bool parse_escape(ByteSet* set) {
+        if (at_end()) return failed("trailing '\\'");
+        const char c = p_[pos_++];
+        ByteSet s;
+        switch (c) {
+            case 'd': case 'D':
+                for (int b = '0'; b <= '9'; ++b) s.set(b);
+                break;
+            case 'w': case 'W':
+                for (int b = '0'; b <= '9'; ++b) s.set(b);
+                for (int b = 'a'; b <= 'z'; ++b) s.set(b);
+                for (int b = 'A'; b <= 'Z'; ++b) s.set(b);
+                s.set('_');
+                break;
+            case 's': case 'S':
+                for (char b : {' ', '\t', '\n', '\r', '\f', '\v'}) s.set(static_cast<uint8_t>(b));
+                break;
+            case 'n': s.set('\n'); break;
+            case 'r': s.set('\r'); break;
+            case 't': s.set('\t'); break;
+            case 'f': s.set('\f'); break;
+            case 'v': s.set('\v'); break;
+            case '0': s.set(0); break;
+            case 'x': {
+                auto hex = [](char h) {
+                    if (h >= '0' && h <= '9') return h - '0';
+                    if (h >= 'a' && h <= 'f') return h - 'a' + 10;
+                    if (h >= 'A' && h <= 'F') return h - 'A' + 10;
+                    return -1;
+                };
+                if (pos_ + 2 > p_.size() || hex(p_[pos_]) < 0 || hex(p_[pos_ + 1]) < 0) {
+                    return failed("bad \\x escape");
+                }
+                s.set(static_cast<size_t>(hex(p_[pos_]) * 16 + hex(p_[pos_ + 1])));
+                pos_ += 2;
+                break;
+            }
+            case 'b': case 'B':
+                return failed("word boundaries are not supported");
+            default:
+                if (c >= '1' && c <= '9') return failed("backreferences are not supported");
+                s.set(static_cast<uint8_t>(c));
+                break;
+        }
+        if (c == 'D' || c == 'W' || c == 'S') s.flip();
+        *set |= s;
+        return true;
+    }
+
+    bool parse_class(ByteSet* set) {
+        bool negate = false;
+        if (!at_end() && p_[pos_] == '^') {
+            negate = true;
+            ++pos_;
+        }
+        bool first = true;
+        for (;;) {
+            if (at_end()) return failed("missing ']'");
+            char c = p_[pos_];
+            if (c == ']' && !first) {
+                ++pos_;
+                break;
+            }
+            first = false;
+            ++pos_;
+            if (c == '\\') {
+                // \d 等字符组不能作为范围端点
+                if (!at_end() && std::string("dDwWsS").find(p_[pos_]) != std::string::npos) {
+                    if (!parse_escape(set)) return false;
+                    continue;
+                }
+                ByteSet one;
+                if (!parse_escape(&one)) return false;
+                size_t b = 0;
+                while (!one.test(b)) ++b;
+                c = static_cast<char>(b);
+            }
+            const uint8_t lo = static_cast<uint8_t>(c);
+            if (pos_ + 1 < p_.size() && p_[pos_] == '-' && p_[pos_ + 1] != ']') {
+                ++pos_;
+                char h = p_[pos_++];
+                if (h == '\\') {
+                    ByteSet one;
+                    if (!parse_escape(&one) || one.count() != 1) return failed("bad class range");
+                    size_t b = 0;
+                    while (!one.test(b)) ++b;
+                    h = static_cast<char>(b);
+                }
+                const uint8_t hi = static_cast<uint8_t>(h);
+                if (hi < lo) return failed("bad class range");
+                for (int b = lo; b <= hi; ++b) set->set(static_cast<size_t>(b));
+            } else {
+                set->set(lo);
+            }
+        }
+        if (negate) set->flip();
+        return true;
+    }
+
+    const std::string& p_;
+    size_t pos_ = 0;
+    std::vector<Node> nodes_;
+    std::string error_;
+    size_t error_pos_ = 0;
+};
+
+// Thompson 构造：每个状态至多一条字节边（on -> next），外加若干 epsilon 边
+struct NfaState {
+    ByteSet on;
+    int next = -1;
+    std::vector<int> eps;
+};
+
+class NfaBuilder {
+public:
+    struct Frag {
+        int start;
+        int end;
+    };
+
+    explicit NfaBuilder(const std::vector<Node>& nodes) : nodes_(nodes) {}
+
+    std::vector<NfaState> states;
+    bool overflow = false;
+
+    Frag build(int index) {
+        const Node& node = nodes_[static_cast<size_t>(index)];
+        switch (node.kind) {
+            case Node::kBytes: {
+                const int s = add();
+                const int e = add();
+                states[s].on = node.bytes;
+                states[s].next = e;
+                return {s, e};
+            }
+            case Node::kConcat: {
+                Frag f = build(node.children[0]);
+                for (size_t i = 1; i < node.children.size() && !overflow; ++i) {
+                    const Frag g = build(node.children[i]);
+                    states[f.end].eps.push_back(g.start);
+                    f.end = g.end;
+                }
+                return f;
+            }
+            case Node::kAlt: {
+                const int s = add();
+                const int e = add();
+                for (size_t i = 0; i < node.children.size() && !overflow; ++i) {
+                    const Frag g = build(node.children[i]);
+                    states[s].eps.push_back(g.start);
+                    states[g.end].eps.push_back(e);
+                }
+                return {s, e};
+            }
+            case Node::kRepeat: {
+                const int s = add();
+                Frag f{s, s};
+                for (int i = 0; i < node.min && !overflow; ++i) {
+                    const Frag g = build(node.children[0]);
+                    states[f.end].eps.push_back(g.start);
+                    f.end = g.end;
+                }
+                if (node.max < 0) {
+                    const int loop = add();
+                    const int e = add();
+                    const Frag g = build(node.children[0]);
+                    states[loop].eps = {g.start, e};
+                    states[g.end].eps.push_back(loop);
+                    states[f.end].eps.push_back(loop);
+                    f.end = e;
+                }
+                for (int i = node.min; i < node.max && !overflow; ++i) {
+                    const int opt = add();
+                    const int e = add();
+                    const Frag g = build(node.children[0]);
+                    states[opt].eps = {g.start, e};
+                    states[g.end].eps.push_back(e);
+                    states[f.end].eps.push_back(opt);
+                    f.end = e;
+                }
+                return f;
+            }
+            case Node::kEmpty:
+                break;
+        }
+        const int s = add();
+        return {s, s};
+    }
+
+private:
+    // 超出上限后不再新建状态，只置 overflow，由调用方放弃结果
+    int add() {
+        if (states.size() >= kMaxNfaStates) {
+            overflow = true;
+            return 0;
+        }
+        states.emplace_back();
+        return static_cast<int>(states.size()) - 1;
+    }
+
+    const std::vector<Node>& nodes_;
+};
+
+class Closure {
+public:
+    explicit Closure(const std::vector<NfaState>& states) : states_(states), mark_(states.size(), 0) {}
+
+    // seeds 经 epsilon 边可达的全部状态，排好序
+    std::vector<int> operator()(const std::vector<int>& seeds) {
+        ++generation_;
+        std::vector<int> out;
+        stack_.assign(seeds.begin(), seeds.end());
+        while (!stack_.empty()) {
+            const int s = stack_.back();
+            stack_.pop_back();
+            if (mark_[static_cast<size_t>(s)] == generation_) continue;
+            mark_[static_cast<size_t>(s)] = generation_;
+            out.push_back(s);
+            for (int t : states_[static_cast<size_t>(s)].eps) stack_.push_back(t);
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+private:
+    const std::vector<NfaState>& states_;
+    std::vector<uint32_t> mark_;
+    uint32_t generation_ = 0;
+    std::vector<int> stack_;
+};
+
+} // namespace
+
+bool compile_regex(const std::string& pattern, Dfa* dfa) {
+    Parser parser(pattern);
+    const int root = parser.parse();
+    if (root < 0) {
+        RWKV_LOGE("Invalid regex at offset %zu: %s", parser.error_pos(), parser.error().c_str());
+        return false;
+    }
+    NfaBuilder builder(parser.nodes());
+    const NfaBuilder::Frag frag = builder.build(root);
+    if (builder.overflow) {
+        RWKV_LOGE("Regex is too large (more than %zu NFA states)", kMaxNfaStates);
+        return false;
+    }
+    const std::vector<NfaState>& nfa = builder.states;
+
+    // 子集构造
+    Closure closure(nfa);
+    std::map<std::vector<int>, int> ids;
+    std::vector<std::vector<int>> sets;
+    std::vector<int32_t> next;
+    std::vector<uint8_t> accepting;
+    auto intern = [&](std::vector<int> set) {
+        auto it = ids.find(set);
+        if (it != ids.end()) return it->second;
+        const int id = static_cast<int>(sets.size());
+        ids.emplace(set, id);
+        accepting.push_back(std::binary_search(set.begin(), set.end(), frag.end) ? 1 : 0);
+        sets.push_back(std::move(set));
+        next.resize(sets.size() * 256, -1);
+        return id;
+    };
+    intern(closure({frag.start}));
+    std::vector<int> targets;
+    std::vector<int> prev_targets;
+    for (size_t d = 0; d < sets.size(); ++d) {
+        if (sets.size() > static_cast<size_t>(kMaxDfaStates)) {
+            RWKV_LOGE("Regex needs more than %d DFA states", kMaxDfaStates);
+            return false;
+        }
+        int prev_id = -1;
+        prev_targets.clear();
+        for (int c = 0; c < 256; ++c) {
+            targets.clear();
+            for (int s : sets[d]) {
+                const NfaState& st = nfa[static_cast<size_t>(s)];
+                if (st.next >= 0 && st.on.test(static_cast<size_t>(c))) targets.push_back(st.next);
+            }
+            if (targets.empty()) {
+                prev_targets.clear();
+                prev_id = -1;
+                continue;
+            }
+            // 相邻字节的目标集合通常相同（字符组），省去一次闭包
+            if (prev_id < 0 || targets != prev_targets) {
+                prev_id = intern(closure(targets));
+                prev_targets = targets;
+            }
+            next[d * 256 + static_cast<size_t>(c)] = prev_id;
+        }
+    }
+
+    // 只保留还能到达接受状态的状态
+    const size_t n = sets.size();
+    std::vector<std::vector<int>> reverse(n);
+    for (size_t d = 0; d < n; ++d) {
+        for (int c = 0; c < 256; ++c) {
+            const int t = next[d * 256 + static_cast<size_t>(c)];
+            if (t >= 0) reverse[static_cast<size_t>(t)].push_back(static_cast<int>(d));
+        }
+    }
+    std::vector<uint8_t> live(n, 0);
+    std::vector<int> queue;
+    for (size_t d = 0; d < n; ++d) {
+        if (accepting[d]) {
+            live[d] = 1;
+            queue.push_back(static_cast<int>(d));
+        }
+    }
+    while (!queue.empty()) {
+        const int t = queue.back();
+        queue.pop_back();
+        for (int d : reverse[static_cast<size_t>(t)]) {
+            if (!live[static_cast<size_t>(d)]) {
+                live[static_cast<size_t>(d)] = 1;
+                queue.push_back(d);
+            }
+        }
+    }
+    if (!live[0]) {
+        RWKV_LOGE("Regex matches nothing");
+        return false;
+    }
+    std::vector<int> remap(n, -1);
+    int count = 0;
+    for (size_t d = 0; d < n; ++d) {
+        if (live[d]) remap[d] = count++;
+    }
+    dfa->next.assign(static_cast<size_t>(count) * 256, -1);
+    dfa->accepting.assign(static_cast<size_t>(count), 0);
+    dfa->start = remap[0];
+    for (size_t d = 0; d < n; ++d) {
+        if (remap[d] < 0) continue;
+        const size_t row = static_cast<size_t>(remap[d]) * 256;
+        dfa->accepting[static_cast<size_t>(remap[d])] = accepting[d];
+        for (int c = 0; c < 256; ++c) {
+            const int t = next[d * 256 + static_cast<size_t>(c)];
+            dfa->next[row + static_cast<size_t>(c)] = t >= 0 ? remap[static_cast<size_t>(t)] : -1;
+        }
+    }
+    return true;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,44 @@
+/**
+ * regex_dfa.h
+ *
+ * Compile a regular expression into a byte-level DFA for constrained
+ * decoding. The whole output must match (as if anchored with ^...$).
+ * Supported syntax: literals (UTF-8 text is matched byte by byte), '.',
+ * classes [a-z] / [^"], escapes \d \w \s \D \W \S \n \r \t \xHH, groups
+ * (...) and (?:...), '|', and the quantifiers * + ? {n} {n,} {n,m}.
+ * Backreferences and lookaround are not regular and are rejected.
+ */
+
+#ifndef RWKVMOBILE_REGEX_DFA_H
+#define RWKVMOBILE_REGEX_DFA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rwkvmobile {
+
+constexpr int kMaxDfaStates = 4096;
+
+/**
+ * Only live states (ones that can still reach a match) are kept; a
+ * transition that could never lead to a match is -1.
+ */
+struct Dfa {
+    std::vector<int32_t> next;       // [状态 x 256]
+    std::vector<uint8_t> accepting;  // 到此为止的输出已完整匹配
+    int start = 0;
+
+    int states() const { return static_cast<int>(accepting.size()); }
+    int step(int state, uint8_t c) const { return next[static_cast<size_t>(state) * 256 + c]; }
+};
+
+/**
+ * @return false on a syntax error, a pattern that matches nothing, or more
+ *         than kMaxDfaStates states (logged)
+ */
+bool compile_regex(const std::string& pattern, Dfa* dfa);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_REGEX_DFA_H
@@ -0,0 +1,217 @@
+#include "response_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace rwkvmobile {
+
+namespace {
+
+// 环形使用 blocks 个块时，写到 end 为止仍然保留的第一个字节（留一块给正在写的位置）
+uint64_t retained_begin(uint64_t end, size_t blocks) {
+    const uint64_t retained = static_cast<uint64_t>(blocks - 1) * ResponseStream::kBlockSize;
+    return end > retained ? end - retained : 0;
+}
+
+static_assert(std::atomic<char>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "readers copy without locks");
+
+// 逐字节的 relaxed 原子读写：与写者同时读到的字节可能新旧混杂，由拷贝之后的检查丢弃
+void store_bytes(std::atomic<char>* dst, const char* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i].store(src[i], std::memory_order_relaxed);
+}
+
+void load_bytes(char* dst, const std::atomic<char>* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = src[i].load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+ResponseStream::ResponseStream()
+    : blocks_(new std::atomic<Byte*>[kMaxBlocks]()),
+      records_(new std::atomic<uint64_t>[kTokenRecords * kRecordWords]()),
+      start_(std::chrono::steady_clock::now()) {}
+
+ResponseStream::~ResponseStream() {
+    for (size_t i = 0; i < kMaxBlocks; ++i) {
+        delete[] blocks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+void ResponseStream::reset(size_t capacity) {
+    size_t blocks = kMaxBlocks;
+    if (capacity > 0) {
+        blocks = std::min(kMaxBlocks, std::max<size_t>(2, (capacity + kBlockSize - 1) / kBlockSize + 1));
+    }
+    const uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    epoch_.store(epoch + 1);
+    // 读者读到下面清零（或之后追加）的保留位置时，一定也能看到 epoch_ 已经改变
+    std::atomic_thread_fence(std::memory_order_release);
+    reserved_.store(0, std::memory_order_relaxed);
+    end_.store(0, std::memory_order_relaxed);
+    tokens_reserved_.store(0, std::memory_order_relaxed);
+    tokens_.store(0, std::memory_order_relaxed);
+    if (blocks < blocks_in_use_.load(std::memory_order_relaxed)) {
+        // 容量变小：多出的块先摘下，没有读者时才真正释放
+        for (size_t i = blocks; i < kMaxBlocks; ++i) {
+            Byte* block = blocks_[i].exchange(nullptr);
+            if (block != nullptr) retired_.emplace_back(block);
+        }
+    }
+    blocks_in_use_.store(blocks, std::memory_order_relaxed);
+    // 与 enter_read 中“先登记再读 epoch_”配对（都是 seq_cst）
+    if (readers_.load() == 0) {
+        retired_.clear();
+    }
+    start_ = std::chrono::steady_clock::now();
+    epoch_.store(epoch + 2, std::memory_order_release);
+}
+
+ResponseStream::Byte* ResponseStream::block_for_write(uint64_t offset) {
+    std::atomic<Byte*>& slot = blocks_[(offset / kBlockSize) % blocks_in_use_.load(std::memory_order_relaxed)];
+    Byte* block = slot.load(std::memory_order_relaxed);
+    if (block == nullptr) {
+        block = new Byte[kBlockSize];
+        slot.store(block, std::memory_order_release);
+        ++block_allocations_;
+    }
+    return block;
+}
+
+void ResponseStream::append(int token_id, std::string_view bytes) {
+    const uint64_t offset = end_.load(std::memory_order_relaxed);
+    const uint64_t end = offset + bytes.size();
+    const uint64_t index = tokens_.load(std::memory_order_relaxed);
+    // 先声明要覆盖的范围，再写
+    reserved_.store(end, std::memory_order_relaxed);
+    tokens_reserved_.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (uint64_t pos = offset; pos < end;) {
+        const size_t in_block = static_cast<size_t>(pos % kBlockSize);
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(kBlockSize - in_block, end - pos));
+        store_bytes(block_for_write(pos) + in_block, bytes.data() + (pos - offset), n);
+        pos += n;
+    }
+    TokenRecord record;
+    record.index = index;
+    record.offset = offset;
+    record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now() - start_).count();
+    record.token_id = token_id;
+    record.length = static_cast<uint32_t>(bytes.size());
+    uint64_t words[kRecordWords];
+    memcpy(words, &record, sizeof(record));
+    std::atomic<uint64_t>* slot = &records_[(index % kTokenRecords) * kRecordWords];
+    for (size_t i = 0; i < kRecordWords; ++i) slot[i].store(words[i], std::memory_order_relaxed);
+
+    end_.store(end, std::memory_order_release);
+    tokens_.store(index + 1, std::memory_order_release);
+}
+
+bool ResponseStream::ends_with(std::string_view suffix) const {
+    const uint64_t end = end_.load(std::memory_order_relaxed);
+    const size_t blocks = blocks_in_use_.load(std::memory_order_relaxed);
+    if (suffix.empty() || suffix.size() > end - retained_begin(end, blocks)) {
+        return false;
+    }
+    uint64_t pos = end - suffix.size();
+    for (char c : suffix) {
+        const Byte* block = blocks_[(pos / kBlockSize) % blocks].load(std::memory_order_relaxed);
+        if (block[pos % kBlockSize].load(std::memory_order_relaxed) != c) return false;
+        ++pos;
+    }
+    return true;
+}
+
+bool ResponseStream::enter_read(uint64_t* epoch) const {
+    readers_.fetch_add(1);
+    *epoch = epoch_.load();
+    return (*epoch & 1) == 0;
+}
+
+ResponseStream::View ResponseStream::view() const {
+    for (;;) {
+        View v;
+        v.epoch = epoch_.load(std::memory_order_acquire);
+        if (v.epoch & 1) {
+            // reset 进行中：当作空回复，之后的 copy 会失败
+            return v;
+        }
+        v.end = end_.load(std::memory_order_acquire);
+        v.blocks = blocks_in_use_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (epoch_.load(std::memory_order_relaxed) == v.epoch) {
+            v.begin = retained_begin(v.end, v.blocks);
+            return v;
+        }
+    }
+}
+
+bool ResponseStream::copy(const View& v, uint64_t offset, size_t n, char* dst) const {
+    if (n == 0) {
+        return true;
+    }
+    uint64_t epoch = 0;
+    bool ok = enter_read(&epoch) && epoch == v.epoch;
+    for (uint64_t pos = offset; ok && pos < offset + n;) {
+        const Byte* block = blocks_[(pos / kBlockSize) % v.blocks].load(std::memory_order_acquire);
+        if (block == nullptr) {
+            ok = false;
+            break;
+        }
+        const size_t in_block = static_cast<size_t>(pos % kBlockSize);
+        const size_t len = static_cast<size_t>(std::min<uint64_t>(kBlockSize - in_block, offset + n - pos));
+        load_bytes(dst + (pos - offset), block + in_block, len);
+        pos += len;
+    }
+    if (ok) {
+        // 拷贝期间写者若覆盖了这些字节，一定已经推进 reserved_。先读 reserved_ 再核对 epoch_：
+        // 反过来的话，两次读取之间开始的下一次回复会把 reserved_ 清零，被覆盖的拷贝也能通过检查
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t reserved = reserved_.load(std::memory_order_acquire);
+        ok = epoch_.load(std::memory_order_relaxed) == v.epoch && offset >= retained_begin(reserved, v.blocks);
+    }
+    leave_read();
+    return ok;
+}
+
+int ResponseStream::read_tokens(uint64_t first, TokenRecord* out, int max) const {
+    uint64_t epoch = 0;
+    if (!enter_read(&epoch)) {
+        leave_read();
+        return 0;
+    }
+    const uint64_t count = tokens_.load(std::memory_order_acquire);
+    if (first > count) {
+        leave_read();
+        return -1;
+    }
+    uint64_t begin = std::max(first, count > kTokenRecords ? count - kTokenRecords : 0);
+    int n = static_cast<int>(std::min<uint64_t>(static_cast<uint64_t>(std::max(max, 0)), count - begin));
+    for (int i = 0; i < n; ++i) {
+        const uint64_t index = begin + static_cast<uint64_t>(i);
+        const std::atomic<uint64_t>* slot = &records_[(index % kTokenRecords) * kRecordWords];
+        uint64_t words[kRecordWords];
+        for (size_t w = 0; w < kRecordWords; ++w) words[w] = slot[w].load(std::memory_order_relaxed);
+        memcpy(&out[i], words, sizeof(words));
+    }
+    // 与 copy() 相同，先读 tokens_reserved_ 再核对 epoch_
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t reserved = tokens_reserved_.load(std::memory_order_acquire);
+    if (epoch_.load(std::memory_order_relaxed) != epoch) {
+        leave_read();
+        return -1;
+    }
+    // 去掉拷贝期间被新记录覆盖的最旧部分
+    const uint64_t valid = reserved > kTokenRecords ? reserved - kTokenRecords : 0;
+    if (begin < valid) {
+        const int drop = static_cast<int>(std::min<uint64_t>(valid - begin, static_cast<uint64_t>(n)));
+        memmove(out, out + drop, static_cast<size_t>(n - drop) * sizeof(TokenRecord));
+        n -= drop;
+    }
+    leave_read();
+    return n;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,124 @@
+/**
+ * response_stream.h
+ *
+ * Output of one session's generation: an append-only byte arena holding the
+ * response text plus a ring of fixed-size token records (token id, byte
+ * range, timestamp). The generation thread is the only writer; any number of
+ * reader threads copy out of it without taking a lock, so a slow UI reader
+ * never holds up decoding. Readers validate every copy afterwards (the
+ * generation counter and the write position, seqlock style) and report bytes
+ * or records that were recycled while they were reading. Bytes and records
+ * are stored as atomics and copied with relaxed loads and stores, so a copy
+ * that races with the writer is merely discarded, never undefined.
+ *
+ * The arena is made of 16 KB blocks that are allocated once and reused by
+ * later generations. In bounded mode only the newest `capacity` bytes are
+ * kept and the oldest block is recycled; otherwise up to 64 MB is kept.
+ */
+
+#ifndef RWKVMOBILE_RESPONSE_STREAM_H
+#define RWKVMOBILE_RESPONSE_STREAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace rwkvmobile {
+
+// 与 rwkv_mobile.h 中的 rwkvmobile_token_record_t 布局相同
+struct TokenRecord {
+    uint64_t index;         // 本次回复中的第几个 token
+    uint64_t offset;        // 该 token 的字节在回复中的起始位置
+    int64_t timestamp_us;   // 距本次生成开始的微秒数
+    int32_t token_id;
+    uint32_t length;        // 字节数
+};
+static_assert(sizeof(TokenRecord) == 32, "TokenRecord is part of the C API");
+
+class ResponseStream {
+public:
+    static constexpr size_t kBlockSize = 16 * 1024;
+    static constexpr size_t kMaxBlocks = 4096;       // 不限容量时最多保留 64 MB
+    static constexpr uint64_t kTokenRecords = 1024;  // 记录环保留最近的 token 数
+
+    // 读者看到的一致快照：[begin, end) 是仍然保留的字节
+    struct View {
+        uint64_t epoch = 0;
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        size_t blocks = kMaxBlocks;
+    };
+
+    ResponseStream();
+    ~ResponseStream();
+
+    ResponseStream(const ResponseStream&) = delete;
+    ResponseStream& operator=(const ResponseStream&) = delete;
+
+    // 写者（生成线程；reset 在开始生成之前调用）
+
+    /**
+     * Start a new response. Readers holding cursors into the previous one
+     * see their copies fail validation.
+     * @param capacity bytes to keep, rounded up to whole blocks; 0 keeps
+     *                 everything up to kMaxBlocks blocks
+     */
+    void reset(size_t capacity);
+    void append(int token_id, std::string_view bytes);
+    // 回复是否以 suffix 结尾（只由写者调用）
+    bool ends_with(std::string_view suffix) const;
+    // 累计新分配的块数（只由写者调用）
+    uint64_t block_allocations() const { return block_allocations_; }
+
+    // 读者（任意线程，不加锁）
+
+    View view() const;
+
+    /**
+     * Copy [offset, offset + n) of the response, which must lie in view `v`.
+     * @return false if the bytes were recycled or a new response started
+     *         while copying; dst then holds garbage
+     */
+    bool copy(const View& v, uint64_t offset, size_t n, char* dst) const;
+
+    /**
+     * Copy the records of tokens `first`, `first + 1`, ... Records older
+     * than the ring keeps are skipped, so out[0].index may exceed `first`.
+     * @return number of records copied, or -1 if `first` is past the last
+     *         token (a new response has started)
+     */
+    int read_tokens(uint64_t first, TokenRecord* out, int max) const;
+
+private:
+    // 读者进入/离开：reset 只在没有读者时释放缩小容量后多出的块
+    bool enter_read(uint64_t* epoch) const;
+    void leave_read() const { readers_.fetch_sub(1); }
+    // 字节与记录都可能被读者与写者同时访问，按原子变量存放（relaxed 读写，顺序由栅栏保证）
+    using Byte = std::atomic<char>;
+    static constexpr size_t kRecordWords = sizeof(TokenRecord) / sizeof(uint64_t);
+
+    Byte* block_for_write(uint64_t offset);
+
+    // epoch_ 在 reset 期间为奇数。写者先推进 reserved_ 再写字节、最后发布 end_，
+    // 读者拷贝后检查 reserved_，就能发现被覆盖的部分；token 记录同理
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<uint64_t> reserved_{0};
+    std::atomic<uint64_t> end_{0};
+    std::atomic<uint64_t> tokens_reserved_{0};
+    std::atomic<uint64_t> tokens_{0};
+    std::atomic<size_t> blocks_in_use_{kMaxBlocks};  // 环形使用的块数
+    std::unique_ptr<std::atomic<Byte*>[]> blocks_;
+    std::unique_ptr<std::atomic<uint64_t>[]> records_;  // 每条记录 kRecordWords 个字
+    mutable std::atomic<int> readers_{0};
+    std::vector<std::unique_ptr<Byte[]>> retired_;  // 等读者离开后释放
+    uint64_t block_allocations_ = 0;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_RESPONSE_STREAM_H
@@ -0,0 +1,483 @@
+#include "runtime.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "compiled_vocab.h"
+#include "logger.h"
+#include "packed_model.h"
+#include "platform.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+std::mutex g_cache_dir_mutex;
+std::string g_cache_dir;
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+// 设置了 cache_dir 时，需要转换的模型打包存入缓存，之后直接映射打包文件
+std::unique_ptr<Model> load_model_file(const std::string& path) {
+    const std::string cache_dir = get_cache_dir();
+    const std::string cached = cache_dir.empty() ? std::string() : packed_cache_path(cache_dir, path);
+    if (!cached.empty() && access(cached.c_str(), R_OK) == 0) {
+        std::unique_ptr<Model> model = Model::load(cached);
+        if (model) {
+            return model;
+        }
+        RWKV_LOGW("Ignoring unusable packed cache %s", cached.c_str());
+        remove(cached.c_str());
+    }
+    std::unique_ptr<Model> model = Model::load(path);
+    if (model && !cached.empty() && model->converted_bytes() > 0) {
+        if (model->save_packed(cached, cpu_features())) {
+            RWKV_LOGI("Packed model cached at %s", cached.c_str());
+        }
+    }
+    return model;
+}
+
+// 文本词表同样在首次加载后编译存入 cache_dir，之后直接映射编译文件
+bool load_tokenizer_file(const std::string& path, Tokenizer* tokenizer) {
+    const std::string cache_dir = get_cache_dir();
+    const std::string cached = cache_dir.empty() ? std::string() : compiled_vocab_cache_path(cache_dir, path);
+    if (!cached.empty() && access(cached.c_str(), R_OK) == 0) {
+        if (tokenizer->load(cached)) {
+            return true;
+        }
+        RWKV_LOGW("Ignoring unusable compiled vocab %s", cached.c_str());
+        remove(cached.c_str());
+    }
+    if (!tokenizer->load(path)) {
+        return false;
+    }
+    if (!cached.empty() && tokenizer->compiled_on_load() && tokenizer->save_compiled(cached)) {
+        RWKV_LOGI("Compiled vocab cached at %s", cached.c_str());
+    }
+    return true;
+}
+
+// 权重格式：后端名 "cpu" / "cpu-int8" / "cpu-int4"，或 extra 参数 weights=fp32|int8|int4
+bool parse_weight_type(const std::string& name, WeightType* type) {
+    if (name == "fp32") {
+        *type = WeightType::kF32;
+    } else if (name == "int8") {
+        *type = WeightType::kQ8;
+    } else if (name == "int4") {
+        *type = WeightType::kQ4;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_affinity(const std::string& name, ThreadAffinity* affinity) {
+    if (name == "none") {
+        *affinity = ThreadAffinity::kNone;
+    } else if (name == "performance") {
+        *affinity = ThreadAffinity::kPerformance;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_backend(const std::string& backend, WeightType* type) {
+    if (backend.empty() || backend == "cpu") {
+        *type = WeightType::kF32;
+        return true;
+    }
+    return backend.compare(0, 4, "cpu-") == 0 && parse_weight_type(backend.substr(4), type) &&
+           *type != WeightType::kF32;
+}
+
+} // namespace
+
+std::map<std::string, std::string> parse_extra_params(const char* extra) {
+    std::map<std::string, std::string> params;
+    if (extra == nullptr) {
+        return params;
+    }
+    std::string item;
+    for (const char* p = extra;; ++p) {
+        if (*p == '\0' || *p == ',' || *p == ';' || *p == '\n') {
+            size_t eq = item.find('=');
+            if (eq != std::string::npos) {
+                params[trim(item.substr(0, eq))] = trim(item.substr(eq + 1));
+            } else if (!trim(item).empty()) {
+                params[trim(item)] = "";
+            }
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return params;
+}
+
+void set_cache_dir(const std::string& path) {
+    std::lock_guard<std::mutex> lock(g_cache_dir_mutex);
+    g_cache_dir = path;
+}
+
+std::string get_cache_dir() {
+    std::lock_guard<std::mutex> lock(g_cache_dir_mutex);
+    return g_cache_dir;
+}
+
+Runtime::Runtime() : thread_pool_(new ThreadPool(0)), default_session_(new Session(*this)) {}
+
+Runtime::~Runtime() {
+    // 先停止并销毁全部会话，再释放它们共享的模型
+    std::vector<std::unique_ptr<Session>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions.swap(sessions_);
+    }
+    for (auto& session : sessions) {
+        session->stop_generation();
+    }
+    default_session_->stop_generation();
+    sessions.clear();
+    default_session_.reset();
+}
+
+const Model* Runtime::active_model() const {
+    auto it = models_.find(active_model_id_);
+    return it == models_.end() ? nullptr : it->second.get();
+}
+
+const Model* Runtime::draft_model() const {
+    auto it = models_.find(draft_model_id_);
+    return it == models_.end() ? nullptr : it->second.get();
+}
+
+bool Runtime::any_session_generating() {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    if (default_session_->is_generating()) {
+        return true;
+    }
+    for (const auto& session : sessions_) {
+        if (session->is_generating()) return true;
+    }
+    return false;
+}
+
+Session* Runtime::create_session() {
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    sessions_.emplace_back(new Session(*this));
+    return sessions_.back().get();
+}
+
+int Runtime::destroy_session(Session* session) {
+    std::unique_ptr<Session> owned;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto it = std::find_if(sessions_.begin(), sessions_.end(),
+                               [session](const std::unique_ptr<Session>& s) { return s.get() == session; });
+        if (it == sessions_.end()) {
+            return kErrorInvalidParameters;
+        }
+        owned = std::move(*it);
+        sessions_.erase(it);
+    }
+    // 析构时停止生成并等待生成线程结束，不持有 sessions_mutex_
+    owned.reset();
+    return kSuccess;
+}
+
+int Runtime::load_model(const std::string& path, const std::string& backend, const char* extra_params) {
+    WeightType weights = WeightType::kF32;
+    if (!parse_backend(backend, &weights)) {
+        RWKV_LOGE("Backend '%s' is not available in the CPU runtime", backend.c_str());
+        return kErrorUnsupported;
+    }
+    if (any_session_generating()) {
+        return kErrorBusy;
+    }
+
+    // 先校验全部参数，再读取文件，最后一起生效：任何一步失败都不改变当前的词表与配置
+    auto extra = parse_extra_params(extra_params);
+    int batch_size = batcher_.max_batch();
+    auto batch = extra.find("batch_size");
+    if (batch != extra.end()) {
+        batch_size = atoi(batch->second.c_str());
+        if (batch_size < 1) {
+            RWKV_LOGE("Invalid batch_size '%s'", batch->second.c_str());
+            return kErrorInvalidParameters;
+        }
+    }
+    int threads = thread_pool_->size();
+    auto threads_param = extra.find("threads");
+    if (threads_param != extra.end()) {
+        threads = atoi(threads_param->second.c_str());
+        if (threads < 1) {
+            RWKV_LOGE("Invalid threads '%s'", threads_param->second.c_str());
+            return kErrorInvalidParameters;
+        }
+    }
+    ThreadAffinity affinity = thread_pool_->affinity();
+    auto affinity_param = extra.find("affinity");
+    if (affinity_param != extra.end() && !parse_affinity(affinity_param->second, &affinity)) {
+        RWKV_LOGE("Invalid affinity '%s'", affinity_param->second.c_str());
+        return kErrorInvalidParameters;
+    }
+    int prefill_chunk = prefill_chunk_.load();
+    auto chunk = extra.find("prefill_chunk");
+    if (chunk != extra.end()) {
+        prefill_chunk = atoi(chunk->second.c_str());
+        if (prefill_chunk < 1) {
+            RWKV_LOGE("Invalid prefill_chunk '%s'", chunk->second.c_str());
+            return kErrorInvalidParameters;
+        }
+    }
+    auto weights_param = extra.find("weights");
+    if (weights_param != extra.end() && !parse_weight_type(weights_param->second, &weights)) {
+        RWKV_LOGE("Invalid weights '%s'", weights_param->second.c_str());
+        return kErrorInvalidParameters;
+    }
+
+    Tokenizer tokenizer;
+    auto tok = extra.find("tokenizer");
+    if (tok != extra.end() && !load_tokenizer_file(tok->second, &tokenizer)) {
+        return kErrorIO;
+    }
+
+    auto start = Clock::now();
+    std::unique_ptr<Model> model = load_model_file(path);
+    if (!model) {
+        return kErrorIO;
+    }
+    // 打包缓存保存 fp32 权重，量化在加载之后进行
+    if (!model->quantize(weights)) {
+        return kErrorUnsupported;
+    }
+    RWKV_LOGI("Model loaded in %.2f s", seconds_since(start));
+
+    // 各会话在下一次使用时按新模型重建状态
+    std::unique_lock<std::shared_mutex> lock(model_mutex_);
+    const int id = next_model_id_++;
+    models_[id] = std::move(model);
+    active_model_id_ = id;
+    if (tok != extra.end()) {
+        install_tokenizer(std::move(tokenizer));
+    }
+    batcher_.set_max_batch(batch_size);
+    if (threads != thread_pool_->size() || affinity != thread_pool_->affinity()) {
+        thread_pool_.reset(new ThreadPool(threads, affinity));
+    }
+    prefill_chunk_.store(prefill_chunk);
+    return id;
+}
+
+int Runtime::release_model(int model_id) {
+    if (any_session_generating()) {
+        return kErrorBusy;
+    }
+    std::unique_lock<std::shared_mutex> lock(model_mutex_);
+    auto it = models_.find(model_id);
+    if (it == models_.end()) {
+        return kErrorInvalidParameters;
+    }
+    models_.erase(it);
+    prefix_cache_.erase_model(model_id);
+    if (model_id == draft_model_id_) {
+        draft_model_id_ = -1;
+    }
+    if (model_id == active_model_id_) {
+        active_model_id_ = -1;
+        for (auto m = models_.rbegin(); m != models_.rend(); ++m) {
+            if (m->first != draft_model_id_) {
+                active_model_id_ = m->first;
+                break;
+            }
+        }
+    }
+    return kSuccess;
+}
+
+int Runtime::set_draft_model(int model_id, int draft_tokens) {
+    if (any_session_generating()) {
+        return kErrorBusy;
+    }
+    std::unique_lock<std::shared_mutex> lock(model_mutex_);
+    if (model_id < 0) {
+        draft_model_id_ = -1;
+        return kSuccess;
+    }
+    auto draft = models_.find(model_id);
+    if (draft == models_.end() || draft_tokens < 1 || draft_tokens > kMaxDraftTokens) {
+        return kErrorInvalidParameters;
+    }
+    // 草稿模型刚加载时会成为活动模型，改用最近加载的另一个模型验证
+    int target = active_model_id_;
+    if (target == model_id) {
+        target = -1;
+        for (auto m = models_.rbegin(); m != models_.rend(); ++m) {
+            if (m->first != model_id) {
+                target = m->first;
+                break;
+            }
+        }
+    }
+    if (target < 0) {
+        RWKV_LOGE("Speculative decoding needs another model to verify the drafts");
+        return kErrorInvalidParameters;
+    }
+    const int vocab = models_[target]->config().vocab_size;
+    if (draft->second->config().vocab_size != vocab) {
+        RWKV_LOGE("Draft model vocab size %d differs from the main model's %d",
+                  draft->second->config().vocab_size, vocab);
+        return kErrorInvalidParameters;
+    }
+    active_model_id_ = target;
+    draft_model_id_ = model_id;
+    draft_tokens_ = draft_tokens;
+    RWKV_LOGI("Speculative decoding: model %d drafts %d tokens for model %d", model_id, draft_tokens, target);
+    return kSuccess;
+}
+
+SpeculativeStats Runtime::speculative_stats() {
+    std::lock_guard<std::mutex> lock(speculative_mutex_);
+    return speculative_stats_;
+}
+
+PerfStats Runtime::perf_stats() {
+    std::lock_guard<std::mutex> lock(perf_mutex_);
+    return perf_stats_;
+}
+
+int Runtime::load_tokenizer(const std::string& path) {
+    if (any_session_generating()) {
+        return kErrorBusy;
+    }
+    Tokenizer tokenizer;
+    if (!load_tokenizer_file(path, &tokenizer)) {
+        return kErrorIO;
+    }
+    std::unique_lock<std::shared_mutex> lock(model_mutex_);
+    install_tokenizer(std::move(tokenizer));
+    return kSuccess;
+}
+
+void Runtime::install_tokenizer(Tokenizer tokenizer) {
+    tokenizer_ = std::move(tokenizer);
+    // 缓存的键是 token 序列，换词表后不再有效
+    prefix_cache_.clear();
+    // 约束的 token 掩码按新词表重新计算
+    std::lock_guard<std::mutex> config_lock(config_mutex_);
+    if (constraint_) {
+        constraint_ = TokenConstraint::create(constraint_->pattern(), tokenizer_);
+    }
+}
+
+int Runtime::set_threads(int threads, ThreadAffinity affinity) {
+    if (affinity != ThreadAffinity::kNone && affinity != ThreadAffinity::kPerformance) {
+        return kErrorInvalidParameters;
+    }
+    if (any_session_generating()) {
+        return kErrorBusy;
+    }
+    std::unique_ptr<ThreadPool> pool(new ThreadPool(threads, affinity));
+    std::unique_lock<std::shared_mutex> lock(model_mutex_);
+    thread_pool_ = std::move(pool);
+    RWKV_LOGI("Thread pool: %d threads, affinity %s", thread_pool_->size(),
+              affinity == ThreadAffinity::kPerformance ? "performance" : "none");
+    return kSuccess;
+}
+
+int Runtime::threads() {
+    std::shared_lock<std::shared_mutex> lock(model_mutex_);
+    return thread_pool_->size();
+}
+
+int Runtime::set_prefill_chunk(int tokens) {
+    if (tokens < 1) {
+        return kErrorInvalidParameters;
+    }
+    prefill_chunk_.store(tokens);
+    return kSuccess;
+}
+
+void Runtime::set_sampler_params(const SamplerParams& params) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    sampler_params_ = params;
+}
+
+SamplerParams Runtime::sampler_params() {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return sampler_params_;
+}
+
+int Runtime::set_constraint(const std::string& pattern) {
+    if (pattern.empty()) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        constraint_.reset();
+        return kSuccess;
+    }
+    std::shared_lock<std::shared_mutex> model_lock(model_mutex_);
+    if (tokenizer_.empty()) {
+        return kErrorNotLoaded;
+    }
+    std::shared_ptr<const TokenConstraint> constraint = TokenConstraint::create(pattern, tokenizer_);
+    if (!constraint) {
+        return kErrorInvalidParameters;
+    }
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    constraint_ = std::move(constraint);
+    return kSuccess;
+}
+
+std::string Runtime::constraint_pattern() {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return constraint_ ? constraint_->pattern() : std::string();
+}
+
+void Runtime::set_seed(uint64_t seed) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    seed_ = seed;
+    ++seed_epoch_;
+}
+
+uint64_t Runtime::seed() {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    return seed_;
+}
+
+void Runtime::set_bos_token(const std::string& token) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    bos_token_ = token;
+}
+
+void Runtime::set_eos_token(const std::string& token) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    eos_token_ = token;
+}
+
+void Runtime::set_user_role(const std::string& role) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    user_role_ = role;
+}
+
+void Runtime::set_response_role(const std::string& role) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    response_role_ = role;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,269 @@
+/**
+ * runtime.h
+ *
+ * The object behind an rwkvmobile_runtime_t handle: loaded models, the
+ * tokenizer and sampler settings shared by all of its sessions, plus the
+ * default session used by the single-chat API.
+ */
+
+#ifndef RWKVMOBILE_RUNTIME_H
+#define RWKVMOBILE_RUNTIME_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "decode_batcher.h"
+#include "model.h"
+#include "perf_stats.h"
+#include "prefix_cache.h"
+#include "sampler.h"
+#include "session.h"
+#include "thread_pool.h"
+#include "token_constraint.h"
+#include "tokenizer.h"
+
+namespace rwkvmobile {
+
+// 以下错误码与 rwkv_mobile.h 中的 RWKVMOBILE_* 保持一致
+constexpr int kSuccess = 0;
+constexpr int kErrorInvalidParameters = -1;
+constexpr int kErrorNotLoaded = -2;
+constexpr int kErrorIO = -3;
+constexpr int kErrorUnsupported = -4;
+constexpr int kErrorBusy = -5;
+
+constexpr int kDefaultPrefillChunk = 32;
+constexpr int kMaxDraftTokens = 16;
+
+// 最近一次生成的投机解码统计
+struct SpeculativeStats {
+    uint64_t passes = 0;    // 主模型验证前向次数
+    uint64_t drafted = 0;   // 草稿模型提出的 token 数
+    uint64_t accepted = 0;  // 其中被主模型接受的 token 数
+};
+
+/**
+ * Parse "key=value" pairs separated by ',', ';' or newlines.
+ */
+std::map<std::string, std::string> parse_extra_params(const char* extra);
+
+void set_cache_dir(const std::string& path);
+std::string get_cache_dir();
+
+class Runtime {
+public:
+    using TokenCallback = Session::TokenCallback;
+    using CompletionCallback = Session::CompletionCallback;
+
+    Runtime();
+    ~Runtime();
+
+    Runtime(const Runtime&) = delete;
+    Runtime& operator=(const Runtime&) = delete;
+
+    // 模型与词表，由全部会话共享
+    int load_model(const std::string& path, const std::string& backend, const char* extra_params);
+    int release_model(int model_id);
+    int load_tokenizer(const std::string& path);
+
+    /**
+     * Speculative decoding: the loaded model `model_id` proposes
+     * `draft_tokens` tokens per step and the active model verifies them in
+     * one chunked forward pass, rolling its state back to the last accepted
+     * token. Every emitted token is still sampled from the active model, so
+     * the output is unchanged; only the speed depends on the draft. The
+     * draft is never the active model: if it is, the most recently loaded
+     * other model becomes active.
+     * @param model_id  -1 turns speculative decoding off
+     * @return kErrorInvalidParameters for an unknown id, a vocab size that
+     *         differs from the active model, no other model to verify with,
+     *         or draft_tokens outside 1..kMaxDraftTokens; kErrorBusy while
+     *         generating
+     */
+    int set_draft_model(int model_id, int draft_tokens);
+
+    void set_qnn_library_path(const std::string& path) { qnn_library_path_ = path; }
+    void add_adsp_library_path(const std::string& path) { adsp_library_paths_.push_back(path); }
+
+    // 会话：只持有各自的循环状态，共享已加载的模型
+    Session* create_session();
+    int destroy_session(Session* session);
+
+    /**
+     * The implicit session behind the runtime-level state and generation
+     * calls below (kept for the single-chat API).
+     */
+    Session& default_session() { return *default_session_; }
+
+    // 以下调用作用于默认会话
+    int clear_state() { return default_session_->clear_state(); }
+    int load_initial_state(const std::string& path) { return default_session_->load_initial_state(path); }
+    int unload_initial_state() { return default_session_->unload_initial_state(); }
+    int state_snapshot_size(int codec) { return default_session_->state_snapshot_size(codec); }
+    int save_state(int codec, uint8_t* dst, int size) { return default_session_->save_state(codec, dst, size); }
+    int save_state(int codec, const std::string& path) { return default_session_->save_state(codec, path); }
+    int restore_state(const uint8_t* data, size_t size) { return default_session_->restore_state(data, size); }
+    int restore_state(const std::string& path) { return default_session_->restore_state(path); }
+
+    int gen_completion(std::string_view prompt, int max_tokens, std::string* out) {
+        return default_session_->gen_completion(prompt, max_tokens, out);
+    }
+    int gen_completion_async(std::string_view prompt, int max_tokens,
+                             TokenCallback on_token, CompletionCallback on_complete) {
+        return default_session_->gen_completion_async(prompt, max_tokens, std::move(on_token),
+                                                      std::move(on_complete));
+    }
+    int stop_generation() { return default_session_->stop_generation(); }
+    bool is_generating() const { return default_session_->is_generating(); }
+    const char* response_buffer_content() { return default_session_->response_buffer_content(); }
+    int copy_response(char* dst, int size) { return default_session_->copy_response(dst, size); }
+    int read_response_since(int offset, char* dst, int size) {
+        return default_session_->read_response_since(offset, dst, size);
+    }
+    int read_tokens(uint64_t first, TokenRecord* out, int max) const {
+        return default_session_->read_tokens(first, out, max);
+    }
+
+    /**
+     * Bound the response kept per session for the following generations:
+     * only the newest `bytes` (rounded up to 16 KB blocks) stay readable and
+     * the generation keeps its memory fixed however long it runs. 0 (the
+     * default) keeps up to 64 MB.
+     */
+    void set_response_capacity(size_t bytes) { response_capacity_.store(bytes); }
+
+    void set_prompt(const std::string& prompt) { default_session_->set_prompt(prompt); }
+    const char* prompt() { return default_session_->prompt(); }
+
+    // 采样与角色，由全部会话共享
+    void set_sampler_params(const SamplerParams& params);
+    SamplerParams sampler_params();
+    void set_seed(uint64_t seed);
+    uint64_t seed();
+
+    /**
+     * Constrain every reply to match the regex `pattern` (regex_dfa.h); an
+     * empty pattern removes the constraint. Needs a loaded tokenizer; the
+     * masks are rebuilt when another tokenizer is loaded.
+     * @return kErrorNotLoaded without a tokenizer, kErrorInvalidParameters
+     *         for a pattern that does not compile
+     */
+    int set_constraint(const std::string& pattern);
+    std::string constraint_pattern();
+
+    void set_bos_token(const std::string& token);
+    void set_eos_token(const std::string& token);
+    void set_user_role(const std::string& role);
+    void set_response_role(const std::string& role);
+
+    // 速度统计（最近一次生成，不区分会话）
+    float avg_decode_speed() const { return decode_speed_.load(); }
+    float avg_prefill_speed() const { return prefill_speed_.load(); }
+    float prefill_progress() const { return prefill_progress_.load(); }
+
+    /**
+     * Number of prompt tokens run through the model per forward pass during
+     * prefill (also the "prefill_chunk" load_model parameter). Progress is
+     * reported once per chunk; 1 prefills token by token.
+     * @return kErrorInvalidParameters if `tokens` < 1
+     */
+    int set_prefill_chunk(int tokens);
+    int prefill_chunk() const { return prefill_chunk_.load(); }
+
+    SpeculativeStats speculative_stats();
+
+    /**
+     * Performance counters of the last generation of any session (TTFT,
+     * token latency histogram, forward-pass breakdown, weight bytes, cache
+     * reuse, allocations).
+     */
+    PerfStats perf_stats();
+
+    /**
+     * Also time every matrix multiplication, WKV step and layer of the main
+     * model's forward passes (the matmul/wkv/layer breakdown of
+     * perf_stats()). Off by default: it reads the clock a few hundred times
+     * per token. Takes effect at the start of the next generation.
+     */
+    void set_kernel_profiling(bool enabled) { kernel_profiling_.store(enabled); }
+
+    /**
+     * Replace the thread pool that splits every forward pass (decode steps,
+     * prefill chunks, draft verification) across cores. Also the "threads"
+     * and "affinity" load_model parameters.
+     * @param threads  including the generating thread; < 1 uses all online
+     *                 cores, or all performance cores with kPerformance
+     * @return kErrorBusy while a session is generating
+     */
+    int set_threads(int threads, ThreadAffinity affinity);
+    int threads();
+
+    // 系统提示词前缀的状态缓存，由全部会话共享
+    void set_prefix_cache_capacity(size_t bytes) { prefix_cache_.set_capacity(bytes); }
+    PrefixCacheStats prefix_cache_stats() const { return prefix_cache_.stats(); }
+
+private:
+    friend class Session;
+
+    const Model* active_model() const;
+    const Model* draft_model() const;
+    bool any_session_generating();
+    // 换上新词表并清掉依赖旧词表的前缀缓存与约束；调用方持有 model_mutex_ 写锁
+    void install_tokenizer(Tokenizer tokenizer);
+
+    // 保护模型与词表；生成时持有读锁，加载/释放时持有写锁
+    std::shared_mutex model_mutex_;
+    std::map<int, std::unique_ptr<Model>> models_;
+    int next_model_id_ = 0;
+    int active_model_id_ = -1;
+    int draft_model_id_ = -1;  // 投机解码的草稿模型，-1 表示关闭
+    int draft_tokens_ = 4;
+    Tokenizer tokenizer_;
+
+    std::mutex config_mutex_;
+    SamplerParams sampler_params_;  // 会话在每次生成开始时复制一份
+    uint64_t seed_ = 42;
+    uint64_t seed_epoch_ = 0;       // 每次 set_seed 加一，会话据此重新设置自己的 Sampler
+    std::shared_ptr<const TokenConstraint> constraint_;  // 生成时会话各自持有一份引用
+    std::string bos_token_;
+    std::string eos_token_;
+    std::string user_role_ = "User";
+    std::string response_role_ = "Assistant";
+
+    std::string qnn_library_path_;
+    std::vector<std::string> adsp_library_paths_;
+
+    std::atomic<float> decode_speed_{0.f};
+    std::atomic<float> prefill_speed_{0.f};
+    std::atomic<float> prefill_progress_{0.f};
+    std::atomic<bool> kernel_profiling_{false};
+    std::mutex speculative_mutex_;
+    SpeculativeStats speculative_stats_;
+    std::mutex perf_mutex_;
+    PerfStats perf_stats_;
+
+    PrefixCache prefix_cache_;
+
+    // 多个会话同时解码时合并为一次批量前向（load_model 的 batch_size 参数）
+    DecodeBatcher batcher_;
+
+    // 前向中的矩阵乘法与 WKV 在此线程池上并行（load_model 的 threads / affinity 参数），
+    // 受 model_mutex_ 保护
+    std::unique_ptr<ThreadPool> thread_pool_;
+    std::atomic<int> prefill_chunk_{kDefaultPrefillChunk};
+    std::atomic<size_t> response_capacity_{0};
+
+    // 会话必须先于模型析构（析构时会等待生成线程结束）
+    std::mutex sessions_mutex_;
+    std::unique_ptr<Session> default_session_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_RUNTIME_H
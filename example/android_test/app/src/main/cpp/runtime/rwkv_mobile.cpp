@@ -0,0 +1,863 @@
+/**
+ * rwkv_mobile.cpp
+ *
+ * C API of the in-tree CPU runtime (see rwkv_mobile.h). Every entry point
+ * validates the handle and forwards to rwkvmobile::Runtime.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+
+#pragma GCC visibility push(default)
+#include "rwkv_mobile.h"
+#pragma GCC visibility pop
+
+#include "logger.h"
+#include "platform.h"
+#include "runtime.h"
+
+using rwkvmobile::Runtime;
+using rwkvmobile::Session;
+
+namespace {
+
+inline Runtime* as_runtime(rwkvmobile_runtime_t handle) {
+    return static_cast<Runtime*>(handle);
+}
+
+inline Session* as_session(rwkvmobile_session_t handle) {
+    return static_cast<Session*>(handle);
+}
+
+inline std::string safe_str(const char* s) {
+    return s == nullptr ? std::string() : std::string(s);
+}
+
+// 两者布局相同，见 response_stream.h
+static_assert(sizeof(rwkvmobile_token_record_t) == sizeof(rwkvmobile::TokenRecord) &&
+                  offsetof(rwkvmobile_token_record_t, offset) == offsetof(rwkvmobile::TokenRecord, offset) &&
+                  offsetof(rwkvmobile_token_record_t, timestamp_us) ==
+                      offsetof(rwkvmobile::TokenRecord, timestamp_us) &&
+                  offsetof(rwkvmobile_token_record_t, token_id) == offsetof(rwkvmobile::TokenRecord, token_id) &&
+                  offsetof(rwkvmobile_token_record_t, length) == offsetof(rwkvmobile::TokenRecord, length),
+              "rwkvmobile_token_record_t must match TokenRecord");
+
+static_assert(rwkvmobile::LatencyHistogram::kBuckets == RWKVMOBILE_PERF_LATENCY_BUCKETS,
+              "rwkvmobile_perf_stats_t histogram must match LatencyHistogram");
+
+inline rwkvmobile::TokenRecord* as_records(rwkvmobile_token_record_t* records) {
+    return reinterpret_cast<rwkvmobile::TokenRecord*>(records);
+}
+
+// gen_completion 的返回值由调用方通过 free_response_buffer 交还。交还的缓冲区留在池中供
+// 下一次生成复用，反复生成时不再申请内存；每块之前的头部记录其容量。magic 标明缓冲区
+// 正由调用方持有，交还时据此拒绝不是 gen_completion 返回的指针和重复交还
+struct alignas(std::max_align_t) ResponseBufferHeader {
+    uint64_t magic;
+    size_t capacity;
+};
+
+constexpr uint64_t kResponseBufferInUse = 0x52574b5652455350ull;   // "RWKVRESP"
+constexpr uint64_t kResponseBufferPooled = 0x52574b56504f4f4cull;  // "RWKVPOOL"
+
+constexpr int kResponseBufferPool = 4;
+constexpr size_t kMinResponseBuffer = 4096;
+
+std::mutex g_response_pool_mutex;
+ResponseBufferHeader* g_response_pool[kResponseBufferPool];
+int g_response_pool_size = 0;
+
+inline ResponseBufferHeader* header_of(char* buffer) {
+    return reinterpret_cast<ResponseBufferHeader*>(buffer) - 1;
+}
+
+char* acquire_response_buffer(size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(g_response_pool_mutex);
+        for (int i = 0; i < g_response_pool_size; ++i) {
+            ResponseBufferHeader* header = g_response_pool[i];
+            if (header->capacity >= size) {
+                g_response_pool[i] = g_response_pool[--g_response_pool_size];
+                header->magic = kResponseBufferInUse;
+                return reinterpret_cast<char*>(header + 1);
+            }
+        }
+    }
+    const size_t capacity = std::max(size, kMinResponseBuffer);
+    void* memory = ::operator new(sizeof(ResponseBufferHeader) + capacity, std::nothrow);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    ResponseBufferHeader* header = static_cast<ResponseBufferHeader*>(memory);
+    header->magic = kResponseBufferInUse;
+    header->capacity = capacity;
+    return reinterpret_cast<char*>(header + 1);
+}
+
+void release_response_buffer(char* buffer) {
+    if (buffer == nullptr) {
+        return;
+    }
+    ResponseBufferHeader* header = header_of(buffer);
+    {
+        std::lock_guard<std::mutex> lock(g_response_pool_mutex);
+        if (header->magic != kResponseBufferInUse) {
+            RWKV_LOGE("free_response_buffer: %p was not returned by gen_completion or was already freed",
+                      static_cast<void*>(buffer));
+            return;
+        }
+        header->magic = kResponseBufferPooled;
+        if (g_response_pool_size < kResponseBufferPool) {
+            g_response_pool[g_response_pool_size++] = header;
+            return;
+        }
+        // 池满时留下较大的缓冲区
+        int smallest = 0;
+        for (int i = 1; i < kResponseBufferPool; ++i) {
+            if (g_response_pool[i]->capacity < g_response_pool[smallest]->capacity) smallest = i;
+        }
+        if (g_response_pool[smallest]->capacity < header->capacity) {
+            std::swap(g_response_pool[smallest], header);
+        }
+    }
+    ::operator delete(header);
+}
+
+// 同步生成的结果先快照到线程自己的字符串里（其容量跨调用保留），再拷贝到池中的缓冲区
+char* copy_to_response_buffer(const std::string& s) {
+    char* buffer = acquire_response_buffer(s.size() + 1);
+    if (buffer != nullptr) {
+        memcpy(buffer, s.c_str(), s.size() + 1);
+    }
+    return buffer;
+}
+
+Session::TokenCallback wrap_token_callback(rwkvmobile_token_callback_t callback, void* user_data) {
+    if (callback == nullptr) {
+        return nullptr;
+    }
+    // token 指向词表的字节表，其后紧跟 NUL，可以直接作为 C 字符串传出
+    return [callback, user_data](std::string_view token) { callback(token.data(), user_data); };
+}
+
+Session::CompletionCallback wrap_completion_callback(rwkvmobile_completion_callback_t callback, void* user_data) {
+    if (callback == nullptr) {
+        return nullptr;
+    }
+    return [callback, user_data](int status) { callback(status, user_data); };
+}
+
+// 状态快照：runtime 版本作用于默认会话，与会话版本共用
+int save_state_to_buffer(Session* session, int codec, void* buffer, int buffer_size) {
+    if (session == nullptr || buffer == nullptr || buffer_size <= 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return session->save_state(codec, static_cast<uint8_t*>(buffer), buffer_size);
+}
+
+int save_state_to_file(Session* session, const char* state_path, int codec) {
+    if (session == nullptr || state_path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return session->save_state(codec, std::string(state_path));
+}
+
+int restore_state_from_buffer(Session* session, const void* buffer, int buffer_size) {
+    if (session == nullptr || buffer == nullptr || buffer_size <= 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return session->restore_state(static_cast<const uint8_t*>(buffer), static_cast<size_t>(buffer_size));
+}
+
+int restore_state_from_file(Session* session, const char* state_path) {
+    if (session == nullptr || state_path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return session->restore_state(std::string(state_path));
+}
+
+inline Session* default_session(rwkvmobile_runtime_t runtime) {
+    return runtime == nullptr ? nullptr : &as_runtime(runtime)->default_session();
+}
+
+const char kBackendNames[] = "cpu,cpu-int8,cpu-int4";
+
+} // namespace
+
+extern "C" {
+
+// ============================================================================
+// Device Information / Logging
+// ============================================================================
+
+const char* rwkvmobile_get_platform_name(void) {
+    return rwkvmobile::platform_name();
+}
+
+const char* rwkvmobile_get_soc_name(void) {
+    return rwkvmobile::soc_name();
+}
+
+const char* rwkvmobile_get_soc_partname(void) {
+    return rwkvmobile::soc_partname();
+}
+
+const char* rwkvmobile_get_htp_arch(void) {
+    return rwkvmobile::htp_arch();
+}
+
+const char* rwkvmobile_dump_log(void) {
+    return rwkvmobile::dump_log();
+}
+
+void rwkvmobile_set_loglevel(int loglevel) {
+    rwkvmobile::set_log_level(loglevel);
+}
+
+void rwkvmobile_set_cache_dir(const char* path) {
+    rwkvmobile::set_cache_dir(safe_str(path));
+}
+
+// ============================================================================
+// Runtime Lifecycle / Backend
+// ============================================================================
+
+rwkvmobile_runtime_t rwkvmobile_runtime_init(void) {
+    return new (std::nothrow) Runtime();
+}
+
+int rwkvmobile_runtime_release(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    delete as_runtime(runtime);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_get_available_backend_names(char* buffer, int buffer_size) {
+    const int len = static_cast<int>(sizeof(kBackendNames) - 1);
+    if (buffer == nullptr || buffer_size <= len) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    memcpy(buffer, kBackendNames, sizeof(kBackendNames));
+    return len;
+}
+
+int rwkvmobile_runtime_set_qnn_library_path(rwkvmobile_runtime_t runtime, const char* path) {
+    if (runtime == nullptr || path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_qnn_library_path(path);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_add_adsp_library_path(rwkvmobile_runtime_t runtime, const char* path) {
+    if (runtime == nullptr || path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->add_adsp_library_path(path);
+    return RWKVMOBILE_SUCCESS;
+}
+
+// ============================================================================
+// Model Loading
+// ============================================================================
+
+int rwkvmobile_runtime_load_model(rwkvmobile_runtime_t runtime,
+                                  const char* model_path,
+                                  const char* backend_name) {
+    return rwkvmobile_runtime_load_model_with_extra(runtime, model_path, backend_name, nullptr);
+}
+
+int rwkvmobile_runtime_load_model_with_extra(rwkvmobile_runtime_t runtime,
+                                             const char* model_path,
+                                             const char* backend_name,
+                                             const char* extra_params) {
+    if (runtime == nullptr || model_path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->load_model(model_path, safe_str(backend_name), extra_params);
+}
+
+int rwkvmobile_runtime_release_model(rwkvmobile_runtime_t runtime, int model_id) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->release_model(model_id);
+}
+
+int rwkvmobile_runtime_set_draft_model(rwkvmobile_runtime_t runtime, int model_id, int draft_tokens) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->set_draft_model(model_id, draft_tokens);
+}
+
+int rwkvmobile_runtime_get_speculative_stats(rwkvmobile_runtime_t runtime,
+                                             uint64_t* passes,
+                                             uint64_t* drafted,
+                                             uint64_t* accepted) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const rwkvmobile::SpeculativeStats stats = as_runtime(runtime)->speculative_stats();
+    if (passes) *passes = stats.passes;
+    if (drafted) *drafted = stats.drafted;
+    if (accepted) *accepted = stats.accepted;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_load_tokenizer(rwkvmobile_runtime_t runtime, const char* vocab_path) {
+    if (runtime == nullptr || vocab_path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->load_tokenizer(vocab_path);
+}
+
+// ============================================================================
+// State Management
+// ============================================================================
+
+int rwkvmobile_runtime_clear_state(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->clear_state();
+}
+
+int rwkvmobile_runtime_load_initial_state(rwkvmobile_runtime_t runtime, const char* state_path) {
+    if (runtime == nullptr || state_path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->load_initial_state(state_path);
+}
+
+int rwkvmobile_runtime_unload_initial_state(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->unload_initial_state();
+}
+
+int rwkvmobile_runtime_get_state_snapshot_size(rwkvmobile_runtime_t runtime, int codec) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->state_snapshot_size(codec);
+}
+
+int rwkvmobile_runtime_save_state_to_buffer(rwkvmobile_runtime_t runtime, int codec,
+                                            void* buffer, int buffer_size) {
+    return save_state_to_buffer(default_session(runtime), codec, buffer, buffer_size);
+}
+
+int rwkvmobile_runtime_save_state(rwkvmobile_runtime_t runtime, const char* state_path, int codec) {
+    return save_state_to_file(default_session(runtime), state_path, codec);
+}
+
+int rwkvmobile_runtime_restore_state_from_buffer(rwkvmobile_runtime_t runtime,
+                                                 const void* buffer, int buffer_size) {
+    return restore_state_from_buffer(default_session(runtime), buffer, buffer_size);
+}
+
+int rwkvmobile_runtime_restore_state(rwkvmobile_runtime_t runtime, const char* state_path) {
+    return restore_state_from_file(default_session(runtime), state_path);
+}
+
+// ============================================================================
+// Generation
+// ============================================================================
+
+int rwkvmobile_runtime_is_generating(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return 0;
+    }
+    return as_runtime(runtime)->is_generating() ? 1 : 0;
+}
+
+int rwkvmobile_runtime_stop_generation(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->stop_generation();
+}
+
+const char* rwkvmobile_runtime_gen_completion(rwkvmobile_runtime_t runtime,
+                                              const char* prompt,
+                                              int max_tokens) {
+    if (runtime == nullptr || prompt == nullptr || max_tokens < 0) {
+        return nullptr;
+    }
+    thread_local std::string out;
+    if (as_runtime(runtime)->gen_completion(prompt, max_tokens, &out) != RWKVMOBILE_SUCCESS) {
+        return nullptr;
+    }
+    return copy_to_response_buffer(out);
+}
+
+int rwkvmobile_runtime_gen_completion_to_buffer(rwkvmobile_runtime_t runtime,
+                                               const char* prompt,
+                                               int max_tokens,
+                                               char* buffer,
+                                               int buffer_size) {
+    if (runtime == nullptr || prompt == nullptr || max_tokens < 0 || buffer == nullptr || buffer_size <= 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const int ret = as_runtime(runtime)->gen_completion(prompt, max_tokens, nullptr);
+    if (ret != RWKVMOBILE_SUCCESS) {
+        return ret;
+    }
+    return as_runtime(runtime)->copy_response(buffer, buffer_size);
+}
+
+void rwkvmobile_runtime_free_response_buffer(char* buffer) {
+    release_response_buffer(buffer);
+}
+
+const char* rwkvmobile_runtime_get_response_buffer_content(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return nullptr;
+    }
+    return as_runtime(runtime)->response_buffer_content();
+}
+
+int rwkvmobile_runtime_read_response_since(rwkvmobile_runtime_t runtime,
+                                           int offset,
+                                           char* buffer,
+                                           int buffer_size) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->read_response_since(offset, buffer, buffer_size);
+}
+
+int rwkvmobile_runtime_read_tokens(rwkvmobile_runtime_t runtime,
+                                   uint64_t first,
+                                   rwkvmobile_token_record_t* records,
+                                   int max_records) {
+    if (runtime == nullptr || records == nullptr || max_records < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const int n = as_runtime(runtime)->read_tokens(first, as_records(records), max_records);
+    return n < 0 ? RWKVMOBILE_ERROR_INVALID_PARAMETERS : n;
+}
+
+int rwkvmobile_runtime_set_response_capacity(rwkvmobile_runtime_t runtime, uint64_t capacity_bytes) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_response_capacity(static_cast<size_t>(capacity_bytes));
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_gen_completion_async(rwkvmobile_runtime_t runtime,
+                                            const char* prompt,
+                                            int max_tokens,
+                                            rwkvmobile_token_callback_t token_callback,
+                                            rwkvmobile_completion_callback_t completion_callback,
+                                            void* user_data) {
+    if (runtime == nullptr || prompt == nullptr || max_tokens < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->gen_completion_async(prompt, max_tokens,
+                                                     wrap_token_callback(token_callback, user_data),
+                                                     wrap_completion_callback(completion_callback, user_data));
+}
+
+// ============================================================================
+// Sessions
+// ============================================================================
+
+rwkvmobile_session_t rwkvmobile_runtime_session_create(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return nullptr;
+    }
+    return as_runtime(runtime)->create_session();
+}
+
+int rwkvmobile_runtime_session_destroy(rwkvmobile_runtime_t runtime, rwkvmobile_session_t session) {
+    if (runtime == nullptr || session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->destroy_session(as_session(session));
+}
+
+int rwkvmobile_session_clear_state(rwkvmobile_session_t session) {
+    if (session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->clear_state();
+}
+
+int rwkvmobile_session_load_initial_state(rwkvmobile_session_t session, const char* state_path) {
+    if (session == nullptr || state_path == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->load_initial_state(state_path);
+}
+
+int rwkvmobile_session_unload_initial_state(rwkvmobile_session_t session) {
+    if (session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->unload_initial_state();
+}
+
+int rwkvmobile_session_set_prompt(rwkvmobile_session_t session, const char* prompt) {
+    if (session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_session(session)->set_prompt(safe_str(prompt));
+    return RWKVMOBILE_SUCCESS;
+}
+
+const char* rwkvmobile_session_get_prompt(rwkvmobile_session_t session) {
+    if (session == nullptr) {
+        return nullptr;
+    }
+    return as_session(session)->prompt();
+}
+
+int rwkvmobile_session_get_state_snapshot_size(rwkvmobile_session_t session, int codec) {
+    if (session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->state_snapshot_size(codec);
+}
+
+int rwkvmobile_session_save_state_to_buffer(rwkvmobile_session_t session, int codec,
+                                            void* buffer, int buffer_size) {
+    return save_state_to_buffer(as_session(session), codec, buffer, buffer_size);
+}
+
+int rwkvmobile_session_save_state(rwkvmobile_session_t session, const char* state_path, int codec) {
+    return save_state_to_file(as_session(session), state_path, codec);
+}
+
+int rwkvmobile_session_restore_state_from_buffer(rwkvmobile_session_t session,
+                                                 const void* buffer, int buffer_size) {
+    return restore_state_from_buffer(as_session(session), buffer, buffer_size);
+}
+
+int rwkvmobile_session_restore_state(rwkvmobile_session_t session, const char* state_path) {
+    return restore_state_from_file(as_session(session), state_path);
+}
+
+const char* rwkvmobile_session_gen_completion(rwkvmobile_session_t session,
+                                              const char* prompt,
+                                              int max_tokens) {
+    if (session == nullptr || prompt == nullptr || max_tokens < 0) {
+        return nullptr;
+    }
+    thread_local std::string out;
+    if (as_session(session)->gen_completion(prompt, max_tokens, &out) != RWKVMOBILE_SUCCESS) {
+        return nullptr;
+    }
+    return copy_to_response_buffer(out);
+}
+
+int rwkvmobile_session_gen_completion_async(rwkvmobile_session_t session,
+                                            const char* prompt,
+                                            int max_tokens,
+                                            rwkvmobile_token_callback_t token_callback,
+                                            rwkvmobile_completion_callback_t completion_callback,
+                                            void* user_data) {
+    if (session == nullptr || prompt == nullptr || max_tokens < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->gen_completion_async(prompt, max_tokens,
+                                                     wrap_token_callback(token_callback, user_data),
+                                                     wrap_completion_callback(completion_callback, user_data));
+}
+
+int rwkvmobile_session_stop_generation(rwkvmobile_session_t session) {
+    if (session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->stop_generation();
+}
+
+int rwkvmobile_session_is_generating(rwkvmobile_session_t session) {
+    if (session == nullptr) {
+        return 0;
+    }
+    return as_session(session)->is_generating() ? 1 : 0;
+}
+
+const char* rwkvmobile_session_get_response_buffer_content(rwkvmobile_session_t session) {
+    if (session == nullptr) {
+        return nullptr;
+    }
+    return as_session(session)->response_buffer_content();
+}
+
+int rwkvmobile_session_read_response_since(rwkvmobile_session_t session,
+                                           int offset,
+                                           char* buffer,
+                                           int buffer_size) {
+    if (session == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_session(session)->read_response_since(offset, buffer, buffer_size);
+}
+
+int rwkvmobile_session_read_tokens(rwkvmobile_session_t session,
+                                   uint64_t first,
+                                   rwkvmobile_token_record_t* records,
+                                   int max_records) {
+    if (session == nullptr || records == nullptr || max_records < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const int n = as_session(session)->read_tokens(first, as_records(records), max_records);
+    return n < 0 ? RWKVMOBILE_ERROR_INVALID_PARAMETERS : n;
+}
+
+// ============================================================================
+// Sampler / Seed
+// ============================================================================
+
+int rwkvmobile_runtime_set_sampler_params(rwkvmobile_runtime_t runtime,
+                                          float temperature,
+                                          float top_p,
+                                          int top_k) {
+    if (runtime == nullptr || temperature < 0.f || top_p < 0.f || top_k < 0) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    // 重复惩罚参数保持不变
+    rwkvmobile::SamplerParams params = as_runtime(runtime)->sampler_params();
+    params.temperature = temperature;
+    params.top_p = top_p;
+    params.top_k = top_k;
+    as_runtime(runtime)->set_sampler_params(params);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_get_sampler_params(rwkvmobile_runtime_t runtime,
+                                          float* temperature,
+                                          float* top_p,
+                                          int* top_k) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const rwkvmobile::SamplerParams params = as_runtime(runtime)->sampler_params();
+    if (temperature != nullptr) *temperature = params.temperature;
+    if (top_p != nullptr) *top_p = params.top_p;
+    if (top_k != nullptr) *top_k = params.top_k;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_penalty_params(rwkvmobile_runtime_t runtime,
+                                          float presence_penalty,
+                                          float frequency_penalty,
+                                          float penalty_decay) {
+    if (runtime == nullptr || !std::isfinite(presence_penalty) || !std::isfinite(frequency_penalty) ||
+        !(penalty_decay >= 0.f && penalty_decay <= 1.f)) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    rwkvmobile::SamplerParams params = as_runtime(runtime)->sampler_params();
+    params.presence_penalty = presence_penalty;
+    params.frequency_penalty = frequency_penalty;
+    params.penalty_decay = penalty_decay;
+    as_runtime(runtime)->set_sampler_params(params);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_get_penalty_params(rwkvmobile_runtime_t runtime,
+                                          float* presence_penalty,
+                                          float* frequency_penalty,
+                                          float* penalty_decay) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const rwkvmobile::SamplerParams params = as_runtime(runtime)->sampler_params();
+    if (presence_penalty != nullptr) *presence_penalty = params.presence_penalty;
+    if (frequency_penalty != nullptr) *frequency_penalty = params.frequency_penalty;
+    if (penalty_decay != nullptr) *penalty_decay = params.penalty_decay;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_constraint(rwkvmobile_runtime_t runtime, const char* regex) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->set_constraint(regex != nullptr ? regex : "");
+}
+
+int rwkvmobile_runtime_set_seed(rwkvmobile_runtime_t runtime, uint64_t seed) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_seed(seed);
+    return RWKVMOBILE_SUCCESS;
+}
+
+uint64_t rwkvmobile_runtime_get_seed(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return 0;
+    }
+    return as_runtime(runtime)->seed();
+}
+
+// ============================================================================
+// Prompt / Chat
+// ============================================================================
+
+int rwkvmobile_runtime_set_prompt(rwkvmobile_runtime_t runtime, const char* prompt) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_prompt(safe_str(prompt));
+    return RWKVMOBILE_SUCCESS;
+}
+
+const char* rwkvmobile_runtime_get_prompt(rwkvmobile_runtime_t runtime) {
+    if (runtime == nullptr) {
+        return nullptr;
+    }
+    return as_runtime(runtime)->prompt();
+}
+
+int rwkvmobile_runtime_set_bos_token(rwkvmobile_runtime_t runtime, const char* token) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_bos_token(safe_str(token));
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_eos_token(rwkvmobile_runtime_t runtime, const char* token) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_eos_token(safe_str(token));
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_user_role(rwkvmobile_runtime_t runtime, const char* role) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_user_role(safe_str(role));
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_response_role(rwkvmobile_runtime_t runtime, const char* role) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_response_role(safe_str(role));
+    return RWKVMOBILE_SUCCESS;
+}
+
+// ============================================================================
+// Speed / Performance Metrics
+// ============================================================================
+
+float rwkvmobile_runtime_get_avg_decode_speed(rwkvmobile_runtime_t runtime) {
+    return runtime == nullptr ? 0.f : as_runtime(runtime)->avg_decode_speed();
+}
+
+float rwkvmobile_runtime_get_avg_prefill_speed(rwkvmobile_runtime_t runtime) {
+    return runtime == nullptr ? 0.f : as_runtime(runtime)->avg_prefill_speed();
+}
+
+int rwkvmobile_runtime_get_prefix_cache_stats(rwkvmobile_runtime_t runtime,
+                                              uint64_t* hits,
+                                              uint64_t* misses,
+                                              uint64_t* reused_tokens,
+                                              uint64_t* cached_bytes) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const rwkvmobile::PrefixCacheStats stats = as_runtime(runtime)->prefix_cache_stats();
+    if (hits) *hits = stats.hits;
+    if (misses) *misses = stats.misses;
+    if (reused_tokens) *reused_tokens = stats.reused_tokens;
+    if (cached_bytes) *cached_bytes = stats.bytes;
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_get_perf_stats(rwkvmobile_runtime_t runtime, rwkvmobile_perf_stats_t* stats) {
+    if (runtime == nullptr || stats == nullptr || stats->size < 2 * sizeof(uint32_t)) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    const rwkvmobile::PerfStats perf = as_runtime(runtime)->perf_stats();
+    const rwkvmobile::PrefixCacheStats cache = as_runtime(runtime)->prefix_cache_stats();
+    const rwkvmobile::ForwardProfile& forward = perf.forward;
+
+    // 先填完整的一份，再按调用方的版本大小拷贝
+    rwkvmobile_perf_stats_t out = {};
+    out.version = RWKVMOBILE_PERF_STATS_VERSION;
+    out.size = static_cast<uint32_t>(std::min<size_t>(stats->size, sizeof(out)));
+    out.n_layer = static_cast<uint32_t>(std::min<size_t>(forward.layer_ns.size(), RWKVMOBILE_PERF_MAX_LAYERS));
+    out.latency_buckets = RWKVMOBILE_PERF_LATENCY_BUCKETS;
+    out.prompt_tokens = perf.prompt_tokens;
+    out.cached_prompt_tokens = perf.cached_tokens;
+    out.generated_tokens = perf.generated_tokens;
+    out.ttft_us = perf.ttft_us;
+    out.prefill_us = perf.prefill_us;
+    out.decode_us = perf.decode_us;
+    out.token_latency_p50_us = perf.token_latency.percentile(0.50);
+    out.token_latency_p90_us = perf.token_latency.percentile(0.90);
+    out.token_latency_p99_us = perf.token_latency.percentile(0.99);
+    out.token_latency_max_us = perf.token_latency.max();
+    out.forward_passes = forward.passes;
+    out.forward_us = forward.total_ns / 1000;
+    out.matmul_us = forward.matmul_ns / 1000;
+    out.wkv_us = forward.wkv_ns / 1000;
+    out.sampler_us = perf.sampler_ns / 1000;
+    out.weight_bytes_streamed = forward.weight_bytes;
+    out.prefix_cache_hits = cache.hits;
+    out.prefix_cache_misses = cache.misses;
+    out.arena_allocations = perf.arena_allocations;
+    out.response_allocations = perf.response_allocations;
+    for (uint32_t i = 0; i < out.n_layer; ++i) {
+        out.layer_us[i] = forward.layer_ns[i] / 1000;
+    }
+    memcpy(out.token_latency_histogram, perf.token_latency.counts(), sizeof(out.token_latency_histogram));
+
+    memcpy(stats, &out, out.size);
+    return static_cast<int>(out.size);
+}
+
+int rwkvmobile_runtime_set_kernel_profiling(rwkvmobile_runtime_t runtime, int enabled) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_kernel_profiling(enabled != 0);
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_prefix_cache_capacity(rwkvmobile_runtime_t runtime, uint64_t capacity_bytes) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    as_runtime(runtime)->set_prefix_cache_capacity(static_cast<size_t>(capacity_bytes));
+    return RWKVMOBILE_SUCCESS;
+}
+
+int rwkvmobile_runtime_set_prefill_chunk_size(rwkvmobile_runtime_t runtime, int chunk_size) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->set_prefill_chunk(chunk_size);
+}
+
+int rwkvmobile_runtime_set_threads(rwkvmobile_runtime_t runtime, int threads, int affinity) {
+    if (runtime == nullptr) {
+        return RWKVMOBILE_ERROR_INVALID_PARAMETERS;
+    }
+    return as_runtime(runtime)->set_threads(threads, static_cast<rwkvmobile::ThreadAffinity>(affinity));
+}
+
+float rwkvmobile_runtime_get_prefill_progress(rwkvmobile_runtime_t runtime) {
+    return runtime == nullptr ? 0.f : as_runtime(runtime)->prefill_progress();
+}
+
+} // extern "C"
@@ -0,0 +1,328 @@
+#include "safetensors.h"
+
+#include <cstring>
+
+#include "logger.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+// safetensors 头部是一个扁平的 JSON 对象，这里只实现解析它所需的最小子集
+class HeaderParser {
+public:
+    HeaderParser(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    bool parse(std::map<std::string, TensorInfo>& tensors,
+               std::map<std::string, std::string>& metadata,
+               std::map<std::string, std::pair<uint64_t, uint64_t>>& offsets) {
+        if (!expect('{')) return false;
+        skip_ws();
+        if (peek() == '}') {
+            ++p_;
+            return true;
+        }
+        while (true) {
+            std::string key;
+            if (!parse_string(key) || !expect(':')) return false;
+            if (key == "__metadata__") {
+                if (!parse_metadata(metadata)) return false;
+            } else {
+                TensorInfo info;
+                std::pair<uint64_t, uint64_t> range{0, 0};
+                if (!parse_tensor(info, range)) return false;
+                tensors[key] = info;
+                offsets[key] = range;
+            }
+            skip_ws();
+            if (peek() == ',') {
+                ++p_;
+                continue;
+            }
+            return expect('}');
+        }
+    }
+
+private:
+    char peek() const { return p_ < end_ ? *p_ : '\0'; }
+
+    void skip_ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+
+    bool expect(char c) {
+        skip_ws();
+        if (peek() != c) return false;
+        ++p_;
+        return true;
+    }
+
+    bool parse_string(std::string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ == '\\' && p_ + 1 < end_) {
+                ++p_;
+                switch (*p_) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'u':
+                        // 张量名不会包含非 ASCII 字符，\uXXXX 直接跳过
+                        p_ += (end_ - p_ > 4) ? 4 : 0;
+                        break;
+                    default: out += *p_; break;
+                }
+                ++p_;
+            } else {
+                out += *p_++;
+            }
+        }
+        if (p_ >= end_) return false;
+        ++p_;
+        return true;
+    }
+
+    bool parse_uint(uint64_t& out) {
+        skip_ws();
+        if (peek() < '0' || peek() > '9') return false;
+        out = 0;
+        while (peek() >= '0' && peek() <= '9') {
+            out = out * 10 + static_cast<uint64_t>(*p_++ - '0');
+        }
+        return true;
+    }
+
+    bool parse_uint_array(std::vector<uint64_t>& out) {
+        if (!expect('[')) return false;
+        out.clear();
+        skip_ws();
+        if (peek() == ']') {
+            ++p_;
+            return true;
+        }
+        while (true) {
+            uint64_t v;
+            if (!parse_uint(v)) return false;
+            out.push_back(v);
+            skip_ws();
+            if (peek() == ',') {
+                ++p_;
+                continue;
+            }
+            return expect(']');
+        }
+    }
+
+    bool parse_metadata(std::map<std::string, std::string>& metadata) {
+        if (!expect('{')) return false;
+        skip_ws();
+        if (peek() == '}') {
+            ++p_;
+            return true;
+        }
+        while (true) {
+            std::string key, value;
+            if (!parse_string(key) || !expect(':') || !parse_string(value)) return false;
+            metadata[key] = value;
+            skip_ws();
+            if (peek() == ',') {
+                ++p_;
+                continue;
+            }
+            return expect('}');
+        }
+    }
+
+    bool parse_tensor(TensorInfo& info, std::pair<uint64_t, uint64_t>& range) {
+        if (!expect('{')) return false;
+        while (true) {
+            std::string key;
+            if (!parse_string(key) || !expect(':')) return false;
+            if (key == "dtype") {
+                std::string dtype;
+                if (!parse_string(dtype)) return false;
+                if (dtype == "F32") info.dtype = DType::kF32;
+                else if (dtype == "F16") info.dtype = DType::kF16;
+                else if (dtype == "BF16") info.dtype = DType::kBF16;
+                else info.dtype = DType::kUnknown;
+            } else if (key == "shape") {
+                std::vector<uint64_t> shape;
+                if (!parse_uint_array(shape)) return false;
+                info.shape.assign(shape.begin(), shape.end());
+            } else if (key == "data_offsets") {
+                std::vector<uint64_t> offsets;
+                if (!parse_uint_array(offsets) || offsets.size() != 2) return false;
+                range = {offsets[0], offsets[1]};
+            } else {
+                return false;
+            }
+            skip_ws();
+            if (peek() == ',') {
+                ++p_;
+                continue;
+            }
+            return expect('}');
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+};
+
+} // namespace
+
+size_t dtype_size(DType dtype) {
+    switch (dtype) {
+        case DType::kF32: return 4;
+        case DType::kF16:
+        case DType::kBF16: return 2;
+        default: return 0;
+    }
+}
+
+int64_t TensorInfo::numel() const {
+    int64_t n = 1;
+    for (int64_t d : shape) n *= d;
+    return n;
+}
+
+bool SafeTensors::parse(const uint8_t* data, size_t size) {
+    tensors_.clear();
+    metadata_.clear();
+    if (size < 8) {
+        RWKV_LOGE("safetensors: file too small (%zu bytes)", size);
+        return false;
+    }
+    uint64_t header_size = 0;
+    for (int i = 7; i >= 0; --i) header_size = (header_size << 8) | data[i];
+    if (header_size > size - 8) {
+        RWKV_LOGE("safetensors: header size %llu exceeds file size",
+                  static_cast<unsigned long long>(header_size));
+        return false;
+    }
+
+    std::map<std::string, std::pair<uint64_t, uint64_t>> offsets;
+    const char* header = reinterpret_cast<const char*>(data + 8);
+    HeaderParser parser(header, header + header_size);
+    if (!parser.parse(tensors_, metadata_, offsets)) {
+        RWKV_LOGE("safetensors: malformed header");
+        tensors_.clear();
+        return false;
+    }
+
+    const uint8_t* payload = data + 8 + header_size;
+    const size_t payload_size = size - 8 - header_size;
+    for (auto& kv : tensors_) {
+        const auto& range = offsets[kv.first];
+        TensorInfo& info = kv.second;
+        if (info.dtype == DType::kUnknown) {
+            RWKV_LOGE("safetensors: unsupported dtype for %s", kv.first.c_str());
+            return false;
+        }
+        if (range.second < range.first || range.second > payload_size ||
+            range.second - range.first != static_cast<uint64_t>(info.numel()) * dtype_size(info.dtype)) {
+            RWKV_LOGE("safetensors: bad data range for %s", kv.first.c_str());
+            return false;
+        }
+        info.data = payload + range.first;
+        info.nbytes = range.second - range.first;
+    }
+    return true;
+}
+
+const TensorInfo* SafeTensors::find(const std::string& name) const {
+    auto it = tensors_.find(name);
+    return it == tensors_.end() ? nullptr : &it->second;
+}
+
+float fp16_to_fp32(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {
+            // 非规格化数：归一化尾数
+            exp = 127 - 15 + 1;
+            while ((mant & 0x400) == 0) {
+                mant <<= 1;
+                --exp;
+            }
+            mant &= 0x3ff;
+            bits = sign | (exp << 23) | (mant << 13);
+        }
+    } else if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+uint16_t fp32_to_fp16(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const int32_t exp = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = bits & 0x7fffff;
+    if (((bits >> 23) & 0xff) == 0xff) {
+        return sign | 0x7c00 | (mant ? 0x200 : 0);
+    }
+    if (exp >= 0x1f) {
+        return sign | 0x7c00;
+    }
+    if (exp <= 0) {
+        if (exp < -10) return sign;
+        mant |= 0x800000;
+        const int shift = 14 - exp;
+        uint32_t half = mant >> shift;
+        // 四舍六入五成双
+        const uint32_t rem = mant & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half & 1))) ++half;
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint16_t half = sign | static_cast<uint16_t>(exp << 10) | static_cast<uint16_t>(mant >> 13);
+    const uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) ++half;
+    return half;
+}
+
+float bf16_to_fp32(uint16_t h) {
+    const uint32_t bits = static_cast<uint32_t>(h) << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void convert_to_f32(DType dtype, const uint8_t* src, float* dst, size_t count) {
+    switch (dtype) {
+        case DType::kF32:
+            memcpy(dst, src, count * sizeof(float));
+            break;
+        case DType::kF16:
+            for (size_t i = 0; i < count; ++i) {
+                uint16_t h;
+                memcpy(&h, src + i * 2, 2);
+                dst[i] = fp16_to_fp32(h);
+            }
+            break;
+        case DType::kBF16:
+            for (size_t i = 0; i < count; ++i) {
+                uint16_t h;
+                memcpy(&h, src + i * 2, 2);
+                dst[i] = bf16_to_fp32(h);
+            }
+            break;
+        default:
+            memset(dst, 0, count * sizeof(float));
+            break;
+    }
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,69 @@
+/**
+ * safetensors.h
+ *
+ * Minimal reader for the safetensors container (the ".st" files produced by
+ * the RWKV converters). Only the header is parsed here; tensor payloads are
+ * returned as raw byte ranges into the caller-provided file image.
+ */
+
+#ifndef RWKVMOBILE_SAFETENSORS_H
+#define RWKVMOBILE_SAFETENSORS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace rwkvmobile {
+
+enum class DType {
+    kF32,
+    kF16,
+    kBF16,
+    kUnknown,
+};
+
+size_t dtype_size(DType dtype);
+
+struct TensorInfo {
+    DType dtype = DType::kUnknown;
+    std::vector<int64_t> shape;
+    const uint8_t* data = nullptr;
+    size_t nbytes = 0;
+
+    int64_t numel() const;
+};
+
+class SafeTensors {
+public:
+    /**
+     * Parse a safetensors image. `data` must stay alive for as long as the
+     * returned TensorInfo pointers are used.
+     * @return true on success
+     */
+    bool parse(const uint8_t* data, size_t size);
+
+    const TensorInfo* find(const std::string& name) const;
+    bool contains(const std::string& name) const { return find(name) != nullptr; }
+
+    const std::map<std::string, TensorInfo>& tensors() const { return tensors_; }
+    const std::map<std::string, std::string>& metadata() const { return metadata_; }
+
+private:
+    std::map<std::string, TensorInfo> tensors_;
+    std::map<std::string, std::string> metadata_;
+};
+
+/**
+ * Convert `count` elements of `dtype` starting at `src` to fp32.
+ */
+void convert_to_f32(DType dtype, const uint8_t* src, float* dst, size_t count);
+
+float fp16_to_fp32(uint16_t h);
+uint16_t fp32_to_fp16(float f);
+float bf16_to_fp32(uint16_t h);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_SAFETENSORS_H
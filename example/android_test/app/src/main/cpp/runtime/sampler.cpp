@@ -0,0 +1,402 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace rwkvmobile {
+
+namespace {
+
+// 非负 float 的位模式与数值同序：取高 11 位（8 位指数 + 3 位尾数）作为基数选择的桶号
+constexpr int kBucketShift = 20;
+constexpr int kBuckets = 1 << (31 - kBucketShift);
+
+inline int bucket_of(float p) {
+    uint32_t bits;
+    memcpy(&bits, &p, sizeof(bits));
+    return static_cast<int>(bits >> kBucketShift);
+}
+
+// exp 的向量实现（Cephes expf：按 ln2 拆出 2^n，余项用 6 次多项式），相对误差约 2 ulp。
+// 低于 -87.3 的输入（包括约束解码屏蔽掉的 -inf）结果为 0，保证这些 token 不会被采到
+#if defined(__SSE2__)
+
+inline __m128 exp4(__m128 x) {
+    const __m128 nonzero = _mm_cmpgt_ps(x, _mm_set1_ps(-87.3f));
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.3f)), _mm_set1_ps(88.3f));
+    const __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)));
+    const __m128 nf = _mm_cvtepi32_ps(n);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(nf, _mm_set1_ps(0.693359375f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(nf, _mm_set1_ps(-2.12194440e-4f)));
+    __m128 y = _mm_set1_ps(1.9875691500e-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.3981999507e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(8.3334519073e-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(4.1665795894e-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.6666665459e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(5.0000001201e-1f));
+    y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, r), r), r), _mm_set1_ps(1.f));
+    const __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+    return _mm_and_ps(_mm_mul_ps(y, pow2n), nonzero);
+}
+
+inline float hsum4(__m128 v) {
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+inline float hmax4(__m128 v) {
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+#elif defined(__aarch64__)
+
+inline float32x4_t exp4(float32x4_t x) {
+    const uint32x4_t nonzero = vcgtq_f32(x, vdupq_n_f32(-87.3f));
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-87.3f)), vdupq_n_f32(88.3f));
+    const int32x4_t n = vcvtnq_s32_f32(vmulq_n_f32(x, 1.44269504f));
+    const float32x4_t nf = vcvtq_f32_s32(n);
+    float32x4_t r = vfmsq_n_f32(x, nf, 0.693359375f);
+    r = vfmsq_n_f32(r, nf, -2.12194440e-4f);
+    float32x4_t y = vdupq_n_f32(1.9875691500e-4f);
+    y = vfmaq_f32(vdupq_n_f32(1.3981999507e-3f), y, r);
+    y = vfmaq_f32(vdupq_n_f32(8.3334519073e-3f), y, r);
+    y = vfmaq_f32(vdupq_n_f32(4.1665795894e-2f), y, r);
+    y = vfmaq_f32(vdupq_n_f32(1.6666665459e-1f), y, r);
+    y = vfmaq_f32(vdupq_n_f32(5.0000001201e-1f), y, r);
+    y = vaddq_f32(vfmaq_f32(r, vmulq_f32(y, r), r), vdupq_n_f32(1.f));
+    const float32x4_t pow2n = vreinterpretq_f32_s32(vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23));
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vmulq_f32(y, pow2n)), nonzero));
+}
+
+#endif
+
+float max_value(const float* x, int n) {
+    int i = 0;
+    float m = -INFINITY;
+#if defined(__SSE2__)
+    if (n >= 4) {
+        __m128 acc = _mm_loadu_ps(x);
+        for (i = 4; i + 4 <= n; i += 4) acc = _mm_max_ps(acc, _mm_loadu_ps(x + i));
+        m = hmax4(acc);
+    }
+#elif defined(__aarch64__)
+    if (n >= 4) {
+        float32x4_t acc = vld1q_f32(x);
+        for (i = 4; i + 4 <= n; i += 4) acc = vmaxq_f32(acc, vld1q_f32(x + i));
+        m = vmaxvq_f32(acc);
+    }
+#endif
+    for (; i < n; ++i) m = std::max(m, x[i]);
+    return m;
+}
+
+// temperature 与 softmax 的分子合成一遍：out[i] = exp((x[i] - shift) * scale)，返回总和
+float exp_sum(const float* x, int n, float shift, float scale, float* out) {
+    int i = 0;
+    float sum = 0.f;
+#if defined(__SSE2__)
+    const __m128 vshift = _mm_set1_ps(shift);
+    const __m128 vscale = _mm_set1_ps(scale);
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        const __m128 p = exp4(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), vshift), vscale));
+        _mm_storeu_ps(out + i, p);
+        acc = _mm_add_ps(acc, p);
+    }
+    sum = hsum4(acc);
+#elif defined(__aarch64__)
+    const float32x4_t vshift = vdupq_n_f32(shift);
+    float32x4_t acc = vdupq_n_f32(0.f);
+    for (; i + 4 <= n; i += 4) {
+        const float32x4_t p = exp4(vmulq_n_f32(vsubq_f32(vld1q_f32(x + i), vshift), scale));
+        vst1q_f32(out + i, p);
+        acc = vaddq_f32(acc, p);
+    }
+    sum = vaddvq_f32(acc);
+#endif
+    for (; i < n; ++i) {
+        out[i] = std::exp((x[i] - shift) * scale);
+        sum += out[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+void TokenOccurrences::add(int token, float decay) {
+    for (auto& e : entries_) e.second *= decay;
+    const size_t t = static_cast<size_t>(token);
+    if (t >= index_.size()) {
+        index_.resize(t + 1, -1);
+    }
+    if (index_[t] < 0) {
+        index_[t] = static_cast<int32_t>(entries_.size());
+        entries_.emplace_back(token, 1.f);
+    } else {
+        entries_[static_cast<size_t>(index_[t])].second += 1.f;
+    }
+}
+
+void TokenOccurrences::reserve(int vocab) {
+    const size_t n = static_cast<size_t>(vocab);
+    if (index_.size() < n) {
+        index_.resize(n, -1);
+    }
+    entries_.reserve(n);
+}
+
+void TokenOccurrences::clear() {
+    for (const auto& e : entries_) index_[static_cast<size_t>(e.first)] = -1;
+    entries_.clear();
+}
+
+int Sampler::argmax(const float* logits, int n) {
+    if (penalized_.empty()) {
+        return static_cast<int>(std::max_element(logits, logits + n) - logits);
+    }
+    probs_.assign(logits, logits + n);
+    for (const auto& p : penalized_) probs_[static_cast<size_t>(p.first)] = p.second;
+    return static_cast<int>(std::max_element(probs_.begin(), probs_.end()) - probs_.begin());
+}
+
+size_t Sampler::select_candidates(int n, int k, float mass) {
+    // 基数选择：按桶统计个数与概率质量，从最高的桶往下累计到够 k 个或够 mass 为止。
+    // 更高的桶里的 token 一定保留，无需排序；截断点只可能落在这个边界桶内
+    bucket_count_.assign(kBuckets, 0);
+    bucket_mass_.assign(kBuckets, 0.f);
+    for (int i = 0; i < n; ++i) {
+        const float p = probs_[static_cast<size_t>(i)];
+        const int b = bucket_of(p);
+        ++bucket_count_[b];
+        bucket_mass_[b] += p;
+    }
+    int boundary = 0;
+    uint32_t count = 0;
+    float cumulative = 0.f;
+    for (int b = kBuckets - 1; b >= 0; --b) {
+        count += bucket_count_[b];
+        cumulative += bucket_mass_[b];
+        if (count >= static_cast<uint32_t>(k) || cumulative >= mass) {
+            boundary = b;
+            break;
+        }
+    }
+
+    candidates_.clear();
+    const size_t above = count - bucket_count_[boundary];
+    // 一次按词表大小分配，候选数变多时不再扩容
+    candidates_.reserve(static_cast<size_t>(n));
+    candidates_.resize(count);
+    size_t head = 0;
+    size_t tail = above;
+    for (int i = 0; i < n; ++i) {
+        const float p = probs_[static_cast<size_t>(i)];
+        const int b = bucket_of(p);
+        if (b > boundary) {
+            candidates_[head++] = {p, i};
+        } else if (b == boundary) {
+            candidates_[tail++] = {p, i};
+        }
+    }
+    std::sort(candidates_.begin() + static_cast<std::ptrdiff_t>(above), candidates_.end(),
+              [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+    return above;
+}
+
+template <int N>
+int Sampler::sample_fixed(const float* logits, const SamplerParams& params,
+                          const TokenOccurrences* occurrences) {
+    static_assert(N % 4 == 0, "the SIMD passes have no scalar tail for N");
+    const float* x = logits;
+    float penalized[N];
+    if (occurrences != nullptr && !occurrences->empty() &&
+        (params.presence_penalty != 0.f || params.frequency_penalty != 0.f)) {
+        memcpy(penalized, logits, sizeof(penalized));
+        for (const auto& e : occurrences->entries()) {
+            if (e.first < 0 || e.first >= N) continue;
+            penalized[e.first] -= params.presence_penalty + params.frequency_penalty * e.second;
+        }
+        x = penalized;
+    }
+    const float max_logit = max_value(x, N);
+    if (params.temperature <= 0.f || params.top_k == 1) {
+        for (int i = 0; i < N; ++i) {
+            if (x[i] == max_logit) return i;
+        }
+        return 0;
+    }
+
+    float p[N];
+    const float sum = exp_sum(x, N, max_logit, 1.f / params.temperature, p);
+    const bool use_top_k = params.top_k > 0 && params.top_k < N;
+    const bool use_top_p = params.top_p > 0.f && params.top_p < 1.f;
+    if (!use_top_k && !use_top_p) {
+        std::uniform_real_distribution<float> dist(0.f, sum);
+        const float target = dist(rng_);
+        float cumulative = 0.f;
+        for (int i = 0; i < N; ++i) {
+            cumulative += p[i];
+            if (cumulative > target) return i;
+        }
+        return static_cast<int>(std::max_element(p, p + N) - p);
+    }
+
+    // 与 select_candidates 相同的基数选择；p <= 1，指数只有 128 个取值，直接按指数分桶，
+    // 计数放在栈上
+    constexpr int kShift = 23;
+    constexpr int kFixedBuckets = 128;
+    const int k = use_top_k ? params.top_k : N;
+    const float threshold = use_top_p ? params.top_p * sum : INFINITY;
+    uint16_t count[kFixedBuckets] = {};
+    float mass[kFixedBuckets] = {};
+    for (int i = 0; i < N; ++i) {
+        const int b = bucket_of(p[i]) >> (kShift - kBucketShift);
+        ++count[b];
+        mass[b] += p[i];
+    }
+    int boundary = 0;
+    int total = 0;
+    float cumulative = 0.f;
+    for (int b = kFixedBuckets - 1; b >= 0; --b) {
+        total += count[b];
+        cumulative += mass[b];
+        if (total >= k || cumulative >= threshold) {
+            boundary = b;
+            break;
+        }
+    }
+    const int above = total - count[boundary];
+    std::pair<float, int> c[N];
+    int head = 0;
+    int tail = above;
+    for (int i = 0; i < N; ++i) {
+        const int b = bucket_of(p[i]) >> (kShift - kBucketShift);
+        if (b > boundary) {
+            c[head++] = {p[i], i};
+        } else if (b == boundary) {
+            c[tail++] = {p[i], i};
+        }
+    }
+    std::sort(c + above, c + total,
+              [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+
+    int keep = total;
+    float kept_sum = 0.f;
+    for (int i = 0; i < above; ++i) kept_sum += c[i].first;
+    for (int i = above; i < total; ++i) {
+        if (i >= k) {
+            keep = i;
+            break;
+        }
+        kept_sum += c[i].first;
+        if (kept_sum >= threshold) {
+            keep = i + 1;
+            break;
+        }
+    }
+
+    std::uniform_real_distribution<float> dist(0.f, kept_sum);
+    const float target = dist(rng_);
+    cumulative = 0.f;
+    for (int i = 0; i < keep; ++i) {
+        cumulative += c[i].first;
+        if (cumulative > target) return c[i].second;
+    }
+    return c[0].second;
+}
+
+int Sampler::sample(const float* logits, int n, const SamplerParams& params,
+                    const TokenOccurrences* occurrences) {
+    if (n <= 0) {
+        return 0;
+    }
+    if (n == kByteVocabSize) {
+        return sample_fixed<kByteVocabSize>(logits, params, occurrences);
+    }
+    // 惩罚只涉及出现过的 token，先单独算出它们惩罚后的 logit
+    penalized_.clear();
+    if (occurrences != nullptr && (params.presence_penalty != 0.f || params.frequency_penalty != 0.f)) {
+        penalized_.reserve(static_cast<size_t>(n));
+        for (const auto& e : occurrences->entries()) {
+            if (e.first < 0 || e.first >= n) continue;
+            penalized_.emplace_back(e.first, logits[e.first] - params.presence_penalty -
+                                                 params.frequency_penalty * e.second);
+        }
+    }
+    if (params.temperature <= 0.f || params.top_k == 1) {
+        return argmax(logits, n);
+    }
+
+    // softmax(logits / T)
+    const float inv_t = 1.f / params.temperature;
+    float max_logit = max_value(logits, n);
+    for (const auto& p : penalized_) max_logit = std::max(max_logit, p.second);
+    probs_.resize(static_cast<size_t>(n));
+    float sum = exp_sum(logits, n, max_logit, inv_t, probs_.data());
+    for (const auto& p : penalized_) {
+        float& prob = probs_[static_cast<size_t>(p.first)];
+        sum -= prob;
+        prob = std::exp((p.second - max_logit) * inv_t);
+        sum += prob;
+    }
+
+    const bool use_top_k = params.top_k > 0 && params.top_k < n;
+    const bool use_top_p = params.top_p > 0.f && params.top_p < 1.f;
+    if (!use_top_k && !use_top_p) {
+        std::uniform_real_distribution<float> dist(0.f, sum);
+        const float target = dist(rng_);
+        float cumulative = 0.f;
+        for (int i = 0; i < n; ++i) {
+            cumulative += probs_[static_cast<size_t>(i)];
+            if (cumulative > target) {
+                return i;
+            }
+        }
+        return static_cast<int>(std::max_element(probs_.begin(), probs_.end()) - probs_.begin());
+    }
+
+    const float threshold = params.top_p * sum;
+    const size_t above = select_candidates(n, use_top_k ? params.top_k : n, use_top_p ? threshold : INFINITY);
+
+    // 边界桶之上的 token 个数不足 k、质量不足 top_p，全部保留；只在边界桶内按概率截断
+    size_t keep = candidates_.size();
+    float cumulative = 0.f;
+    for (size_t i = 0; i < above; ++i) cumulative += candidates_[i].first;
+    for (size_t i = above; i < keep; ++i) {
+        if (use_top_k && i >= static_cast<size_t>(params.top_k)) {
+            keep = i;
+            break;
+        }
+        cumulative += candidates_[i].first;
+        if (use_top_p && cumulative >= threshold) {
+            keep = i + 1;
+            break;
+        }
+    }
+
+    float kept_sum = 0.f;
+    for (size_t i = 0; i < keep; ++i) kept_sum += candidates_[i].first;
+    std::uniform_real_distribution<float> dist(0.f, kept_sum);
+    const float target = dist(rng_);
+    cumulative = 0.f;
+    for (size_t i = 0; i < keep; ++i) {
+        cumulative += candidates_[i].first;
+        if (cumulative > target) {
+            return candidates_[i].second;
+        }
+    }
+    // 浮点舍入没有落到任何候选时取第一个：它的概率一定大于 0
+    return candidates_[0].second;
+}
+
+} // namespace rwkvmobile
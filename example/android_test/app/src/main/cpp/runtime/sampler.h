@@ -0,0 +1,99 @@
+/**
+ * sampler.h
+ *
+ * Temperature / top-k / top-p sampling over the output logits, with
+ * presence and frequency penalties on the tokens generated so far.
+ * Temperature and softmax are one SIMD pass over the vocabulary; top-k and
+ * top-p pick their candidates with a radix select on the probabilities, so
+ * only the tokens next to the cut-off are ever sorted. Byte-level vocabs
+ * (kByteVocabSize logits, e.g. the ABC music vocab) take a path specialized
+ * on the vocab size that keeps everything in fixed-size stack arrays.
+ */
+
+#ifndef RWKVMOBILE_SAMPLER_H
+#define RWKVMOBILE_SAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace rwkvmobile {
+
+// 单字节词表（ABC 乐谱）的 logits 个数：id 0 为结束符，1..127 对应字节 0x01..0x7F
+constexpr int kByteVocabSize = 128;
+
+struct SamplerParams {
+    float temperature = 1.0f;
+    float top_p = 0.85f;
+    int top_k = 0;  // 0 表示不限制
+
+    // logit -= presence_penalty + frequency_penalty * 次数；每生成一个 token，已有次数乘以 penalty_decay
+    float presence_penalty = 0.f;
+    float frequency_penalty = 0.f;
+    float penalty_decay = 0.996f;
+};
+
+/**
+ * Decayed occurrence counts of the tokens generated so far. Only tokens
+ * that occurred are stored, so decaying and applying the penalties costs
+ * O(distinct tokens) rather than O(vocab).
+ */
+class TokenOccurrences {
+public:
+    // 已有次数全部乘以 decay，再给 token 加一
+    void add(int token, float decay);
+    void clear();
+    // 按词表大小一次分配好，生成过程中 add 不再分配
+    void reserve(int vocab);
+    bool empty() const { return entries_.empty(); }
+
+    // (token, 次数)
+    const std::vector<std::pair<int, float>>& entries() const { return entries_; }
+
+private:
+    std::vector<std::pair<int, float>> entries_;
+    // token -> entries_ 下标，-1 表示未出现；按 token id 直接索引，clear 只复位用过的项，
+    // 预热之后不再分配内存
+    std::vector<int32_t> index_;
+};
+
+class Sampler {
+public:
+    explicit Sampler(uint64_t seed = 42) { set_seed(seed); }
+
+    void set_seed(uint64_t seed) {
+        seed_ = seed;
+        rng_.seed(seed);
+    }
+    uint64_t seed() const { return seed_; }
+
+    /**
+     * Sample one token id from `logits` (size `n`). `logits` is not modified.
+     * @param occurrences  tokens to penalize per params (null: no penalties)
+     */
+    int sample(const float* logits, int n, const SamplerParams& params,
+               const TokenOccurrences* occurrences = nullptr);
+
+private:
+    int argmax(const float* logits, int n);
+    // 词表大小在编译期确定的版本：不用成员缓冲区，也不做基数选择
+    template <int N>
+    int sample_fixed(const float* logits, const SamplerParams& params, const TokenOccurrences* occurrences);
+    // 把可能进入 top-k / top-p 的 token 放进 candidates_：返回值之前的一定保留（无序），
+    // 之后是截断点所在的桶，按概率从大到小排序
+    size_t select_candidates(int n, int k, float mass);
+
+    uint64_t seed_ = 0;
+    std::mt19937_64 rng_;
+    std::vector<float> probs_;
+    std::vector<std::pair<int, float>> penalized_;  // (token, 惩罚后的 logit)
+    std::vector<uint32_t> bucket_count_;
+    std::vector<float> bucket_mass_;
+    std::vector<std::pair<float, int>> candidates_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_SAMPLER_H
@@ -0,0 +1,883 @@
+#include "session.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "runtime.h"
+#include "safetensors.h"
+#include "state_snapshot.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t micros_between(Clock::time_point start, Clock::time_point end) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+}
+
+bool is_utf8_continuation(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// s[0, n) 末尾若是不完整的多字节字符，返回去掉它之后的长度
+size_t utf8_complete_length(const char* s, size_t n) {
+    size_t i = n;
+    while (i > 0 && n - i < 3 && is_utf8_continuation(s[i - 1])) --i;
+    if (i == 0) {
+        return n;
+    }
+    const unsigned char lead = static_cast<unsigned char>(s[i - 1]);
+    const size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return n - (i - 1) < need ? i - 1 : n;
+}
+
+} // namespace
+
+Session::~Session() {
+    stop_generation();
+    {
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        shutdown_ = true;
+    }
+    job_cv_.notify_all();
+    if (worker_.joinable()) {
+        if (worker_.get_id() == std::this_thread::get_id()) {
+            // 在完成回调中销毁会话：回调返回后 worker_loop 不再访问本对象
+            *worker_destroyed_ = true;
+            worker_.detach();
+            {
+                std::lock_guard<std::mutex> lock(job_mutex_);
+                worker_busy_ = false;
+            }
+            job_cv_.notify_all();
+        } else {
+            // 已提交的任务照常结束（生成已被停止），完成回调一定会被调用
+            worker_.join();
+        }
+    }
+    if (decoder_.joinable()) {
+        decoder_.join();
+    }
+}
+
+void Session::wait_worker_idle() {
+    if (worker_.get_id() == std::this_thread::get_id()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(job_mutex_);
+    job_cv_.wait(lock, [this]() { return !worker_busy_; });
+}
+
+void Session::worker_loop() {
+    bool destroyed = false;
+    std::unique_lock<std::mutex> lock(job_mutex_);
+    worker_destroyed_ = &destroyed;
+    for (;;) {
+        job_cv_.wait(lock, [this]() { return has_job_ || shutdown_; });
+        if (!has_job_) {
+            return;
+        }
+        AsyncJob job = std::move(job_);
+        has_job_ = false;
+        int ret = kSuccess;
+        if (job.on_token) {
+            // 前向与采样在 decoder_ 上进行，token 经无锁环形队列交给本线程回调，
+            // 回调（JNI 的 UTF-16 转换与 Java 调用）不会拖慢下一个 token 的前向
+            stream_.reset();
+            decode_job_ = &job;
+            decoding_ = true;
+            lock.unlock();
+            job_cv_.notify_all();
+            std::string_view piece;
+            while (stream_.pop(&piece)) {
+                job.on_token(piece);
+            }
+            lock.lock();
+            job_cv_.wait(lock, [this]() { return !decoding_; });
+            ret = decode_status_;
+            lock.unlock();
+        } else {
+            lock.unlock();
+            ret = generate(job.prompt, job.max_tokens, nullptr);
+        }
+        generating_.store(false, std::memory_order_release);
+        if (job.on_complete) {
+            job.on_complete(ret);
+        }
+        if (destroyed) {
+            return;
+        }
+        lock.lock();
+        // 完成回调中可能已提交了下一个任务
+        worker_busy_ = has_job_;
+        job_cv_.notify_all();
+    }
+}
+
+void Session::decoder_loop() {
+    std::unique_lock<std::mutex> lock(job_mutex_);
+    for (;;) {
+        // 析构时等 worker_ 处理完剩下的任务再退出
+        job_cv_.wait(lock, [this]() { return decode_job_ != nullptr || (shutdown_ && !worker_busy_); });
+        if (decode_job_ == nullptr) {
+            return;
+        }
+        const AsyncJob* job = decode_job_;
+        decode_job_ = nullptr;
+        lock.unlock();
+        const int ret = generate(job->prompt, job->max_tokens, &stream_);
+        stream_.close();
+        lock.lock();
+        decode_status_ = ret;
+        decoding_ = false;
+        job_cv_.notify_all();
+    }
+}
+
+void Session::bind_model_locked(int model_id, const Model* model) {
+    if (model_id == model_id_) {
+        return;
+    }
+    model_id_ = model_id;
+    // 模型切换后维度可能不同，初始状态随之失效
+    has_initial_state_ = false;
+    initial_state_ = State();
+    state_ = State();
+    if (model != nullptr) {
+        const ModelConfig& cfg = model->config();
+        state_.init(cfg);
+        scratch_.init(cfg);
+        prefill_scratch_ = ForwardScratch();
+        logits_.assign(static_cast<size_t>(cfg.vocab_size), 0.f);
+    }
+    checkpoints_.clear();
+    verify_scratch_ = ForwardScratch();
+    reset_state_locked();
+}
+
+void Session::bind_draft_locked(int model_id, const Model* draft) {
+    if (model_id == draft_model_id_) {
+        return;
+    }
+    draft_model_id_ = model_id;
+    draft_state_ = State();
+    draft_checkpoints_.clear();
+    if (draft != nullptr) {
+        // 草稿从零状态开始，只影响接受率，不影响输出
+        const ModelConfig& cfg = draft->config();
+        draft_state_.init(cfg);
+        draft_scratch_.init(cfg);
+        draft_prefill_scratch_ = ForwardScratch();
+        draft_logits_.assign(static_cast<size_t>(cfg.vocab_size), 0.f);
+    }
+}
+
+void Session::reset_state_locked() {
+    if (has_initial_state_) {
+        state_ = initial_state_;
+    } else if (!state_.empty()) {
+        state_.reset();
+    }
+    state_is_fresh_ = true;
+    pending_token_ = -1;
+    if (!draft_state_.empty()) {
+        draft_state_.reset();
+    }
+}
+
+int Session::clear_state() {
+    if (is_generating()) {
+        return kErrorBusy;
+    }
+    std::shared_lock<std::shared_mutex> model_lock(runtime_.model_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    bind_model_locked(runtime_.active_model_id_, runtime_.active_model());
+    reset_state_locked();
+    return kSuccess;
+}
+
+int Session::load_initial_state(const std::string& path) {
+    if (is_generating()) {
+        return kErrorBusy;
+    }
+    std::shared_lock<std::shared_mutex> model_lock(runtime_.model_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Model* model = runtime_.active_model();
+    if (model == nullptr) {
+        return kErrorNotLoaded;
+    }
+    bind_model_locked(runtime_.active_model_id_, model);
+    const ModelConfig& cfg = model->config();
+
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        RWKV_LOGE("Failed to open state file %s", path.c_str());
+        return kErrorIO;
+    }
+    std::vector<uint8_t> file;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    file.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    const bool read_ok = fread(file.data(), 1, file.size(), fp) == file.size();
+    fclose(fp);
+    SafeTensors st;
+    if (!read_ok || !st.parse(file.data(), file.size())) {
+        return kErrorIO;
+    }
+
+    // state-tuning 导出的 time_state 形状为 [n_head, head_size(v), head_size(k)]，
+    // 运行时按 [k][v] 存储，因此需要转置
+    State state;
+    state.init(cfg);
+    const int H = cfg.n_head;
+    const int S = cfg.head_size;
+    std::vector<float> buf(static_cast<size_t>(H) * S * S);
+    for (int i = 0; i < cfg.n_layer; ++i) {
+        const std::string name = "blocks." + std::to_string(i) + ".att.time_state";
+        const TensorInfo* info = st.find(name);
+        if (info == nullptr || info->numel() != static_cast<int64_t>(buf.size())) {
+            RWKV_LOGE("State file %s: missing or mismatched %s", path.c_str(), name.c_str());
+            return kErrorInvalidParameters;
+        }
+        convert_to_f32(info->dtype, info->data, buf.data(), buf.size());
+        float* dst = state.att_kv.data() + static_cast<size_t>(i) * H * S * S;
+        for (int h = 0; h < H; ++h) {
+            for (int v = 0; v < S; ++v) {
+                for (int k = 0; k < S; ++k) {
+                    dst[(static_cast<size_t>(h) * S + k) * S + v] = buf[(static_cast<size_t>(h) * S + v) * S + k];
+                }
+            }
+        }
+    }
+
+    initial_state_ = std::move(state);
+    has_initial_state_ = true;
+    reset_state_locked();
+    RWKV_LOGI("Loaded initial state %s", path.c_str());
+    return kSuccess;
+}
+
+int Session::unload_initial_state() {
+    if (is_generating()) {
+        return kErrorBusy;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_initial_state_ = false;
+    initial_state_ = State();
+    reset_state_locked();
+    return kSuccess;
+}
+
+int Session::state_snapshot_size(int codec) {
+    if (!is_valid_state_codec(codec)) {
+        return kErrorInvalidParameters;
+    }
+    std::shared_lock<std::shared_mutex> model_lock(runtime_.model_mutex_);
+    const Model* model = runtime_.active_model();
+    if (model == nullptr) {
+        return kErrorNotLoaded;
+    }
+    return static_cast<int>(rwkvmobile::state_snapshot_size(model->config(), static_cast<StateCodec>(codec)));
+}
+
+// 编码到 dst（调用方缓冲区）或 *buffer（按需分配）
+int Session::encode_state(int codec, std::vector<uint8_t>* buffer, uint8_t* dst, int size) {
+    if (!is_valid_state_codec(codec)) {
+        return kErrorInvalidParameters;
+    }
+    if (is_generating()) {
+        return kErrorBusy;
+    }
+    std::shared_lock<std::shared_mutex> model_lock(runtime_.model_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Model* model = runtime_.active_model();
+    if (model == nullptr) {
+        return kErrorNotLoaded;
+    }
+    bind_model_locked(runtime_.active_model_id_, model);
+    const ModelConfig& cfg = model->config();
+    const StateCodec state_codec = static_cast<StateCodec>(codec);
+    const size_t total = rwkvmobile::state_snapshot_size(cfg, state_codec);
+    if (buffer != nullptr) {
+        buffer->resize(total);
+        dst = buffer->data();
+        size = static_cast<int>(total);
+    }
+    if (dst == nullptr || size < 0 || static_cast<size_t>(size) < total) {
+        return kErrorInvalidParameters;
+    }
+    StateSnapshotInfo info;
+    info.pending_token = pending_token_;
+    info.fresh = state_is_fresh_;
+    return static_cast<int>(write_state_snapshot(cfg, state_, info, state_codec, dst, total));
+}
+
+int Session::save_state(int codec, uint8_t* dst, int size) {
+    return encode_state(codec, nullptr, dst, size);
+}
+
+int Session::save_state(int codec, const std::string& path) {
+    std::vector<uint8_t> buffer;
+    const int n = encode_state(codec, &buffer, nullptr, 0);
+    if (n < 0) {
+        return n;
+    }
+    // 先写临时文件再改名，中途失败不会留下半个快照
+    return write_file_atomically(path, "state snapshot", buffer.data(), buffer.size()) ? kSuccess : kErrorIO;
+}
+
+int Session::restore_state(const uint8_t* data, size_t size) {
+    if (data == nullptr) {
+        return kErrorInvalidParameters;
+    }
+    if (is_generating()) {
+        return kErrorBusy;
+    }
+    std::shared_lock<std::shared_mutex> model_lock(runtime_.model_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Model* model = runtime_.active_model();
+    if (model == nullptr) {
+        return kErrorNotLoaded;
+    }
+    bind_model_locked(runtime_.active_model_id_, model);
+    StateSnapshotInfo info;
+    if (!read_state_snapshot(data, size, model->config(), state_, &info)) {
+        return kErrorInvalidParameters;
+    }
+    pending_token_ = info.pending_token;
+    state_is_fresh_ = info.fresh;
+    // 快照只包含主模型的状态，草稿在下一次生成时从零重建
+    bind_draft_locked(-1, nullptr);
+    return kSuccess;
+}
+
+int Session::restore_state(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return kErrorIO;
+    }
+    return restore_state(file.data(), file.size());
+}
+
+void Session::set_prompt(const std::string& prompt) {
+    std::lock_guard<std::mutex> lock(prompt_mutex_);
+    prompt_ = prompt;
+}
+
+const char* Session::prompt() {
+    std::lock_guard<std::mutex> lock(prompt_mutex_);
+    return prompt_.c_str();
+}
+
+int Session::generate(std::string_view prompt, int max_tokens, SpscRing<std::string_view>* stream) {
+    // 模型读锁：多个会话可同时生成，加载/释放模型需等待全部生成结束
+    std::shared_lock<std::shared_mutex> model_lock(runtime_.model_mutex_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Model* model = runtime_.active_model();
+    if (model == nullptr) {
+        RWKV_LOGE("No model loaded");
+        return kErrorNotLoaded;
+    }
+    const Tokenizer& tokenizer = runtime_.tokenizer_;
+    if (tokenizer.empty()) {
+        RWKV_LOGE("No tokenizer loaded");
+        return kErrorNotLoaded;
+    }
+    bind_model_locked(runtime_.active_model_id_, model);
+    // 投机解码只在不做批处理时使用；草稿状态在生成结束时与 state_ 同步，否则作废
+    const Model* draft = runtime_.batcher_.enabled() ? nullptr : runtime_.draft_model();
+    if (draft != nullptr && draft->config().vocab_size != model->config().vocab_size) {
+        draft = nullptr;
+    }
+    bind_draft_locked(draft != nullptr ? runtime_.draft_model_id_ : -1, draft);
+
+    // 性能统计：主模型的前向记录到 perf_.forward，结束时发布给 Runtime
+    const Clock::time_point generate_start = Clock::now();
+    const uint64_t arena_allocations = arena_.chunk_allocations();
+    const uint64_t response_allocations = response_.block_allocations();
+    perf_.prompt_tokens = perf_.cached_tokens = perf_.generated_tokens = 0;
+    perf_.ttft_us = perf_.prefill_us = perf_.decode_us = perf_.sampler_ns = 0;
+    perf_.token_latency.clear();
+    perf_.forward.reset(model->config().n_layer);
+    perf_.forward.kernel_timing = runtime_.kernel_profiling_.load(std::memory_order_relaxed);
+    scratch_.profile = prefill_scratch_.profile = verify_scratch_.profile = &perf_.forward;
+    auto publish_perf = [&]() {
+        perf_.arena_allocations = arena_.chunk_allocations() - arena_allocations;
+        perf_.response_allocations = response_.block_allocations() - response_allocations;
+        std::lock_guard<std::mutex> stats_lock(runtime_.perf_mutex_);
+        runtime_.perf_stats_ = perf_;
+    };
+
+    // 本次生成的临时数据都放在 arena 中，生成结束后不释放，下次生成时整体复位
+    arena_.reset();
+    ArenaString text{ArenaAllocator<char>(arena_)};
+    std::string_view stop_sequences[2];
+    int stop_count = 0;
+    SamplerParams params;
+    {
+        std::lock_guard<std::mutex> config_lock(runtime_.config_mutex_);
+        params = runtime_.sampler_params_;
+        if (seed_epoch_ != runtime_.seed_epoch_) {
+            sampler_.set_seed(runtime_.seed_);
+            seed_epoch_ = runtime_.seed_epoch_;
+        }
+        if (state_is_fresh_) {
+            text.append(runtime_.bos_token_);
+        }
+        if (!runtime_.eos_token_.empty()) {
+            stop_sequences[stop_count++] = arena_.copy(runtime_.eos_token_);
+        }
+        const std::string& role = runtime_.user_role_;
+        if (!role.empty()) {
+            char* seq = arena_.allocate_array<char>(role.size() + 3);
+            memcpy(seq, "\n\n", 2);
+            memcpy(seq + 2, role.data(), role.size());
+            seq[role.size() + 2] = ':';
+            stop_sequences[stop_count++] = std::string_view(seq, role.size() + 3);
+        }
+    }
+    if (state_is_fresh_) {
+        std::lock_guard<std::mutex> prompt_lock(prompt_mutex_);
+        text.append(prompt_);
+    }
+    const size_t system_text_len = state_is_fresh_ ? text.size() : 0;
+    text.append(prompt);
+
+    // 从零状态开始的对话可以复用前缀缓存中系统提示词的 prefill 结果
+    PrefixCache& cache = runtime_.prefix_cache_;
+    const bool cacheable = state_is_fresh_ && !has_initial_state_ && pending_token_ < 0 &&
+                           cache.capacity() > 0;
+
+    // 每个 token 至少一个字节，按文本长度分配即可
+    ArenaVector<int> tokens{ArenaAllocator<int>(arena_)};
+    tokens.resize(text.size() + 1);
+    size_t token_count = 0;
+    if (pending_token_ >= 0) {
+        tokens[token_count++] = pending_token_;
+        pending_token_ = -1;
+    }
+    token_count += tokenizer.encode(text, tokens.data() + token_count);
+    tokens.resize(token_count);
+    if (tokens.empty()) {
+        RWKV_LOGE("Empty prompt");
+        return kErrorInvalidParameters;
+    }
+    state_is_fresh_ = false;
+
+    size_t begin = 0;
+    size_t cache_len = 0;  // 在此位置把状态存入缓存，0 表示不存
+    if (cacheable) {
+        // 只有系统提示词单独编码的结果恰好是整段编码的前缀时才缓存，
+        // 保证与不使用缓存时的 token 序列完全一致
+        if (system_text_len > 0) {
+            int* system = arena_.allocate_array<int>(system_text_len);
+            const size_t system_len = tokenizer.encode(std::string_view(text).substr(0, system_text_len), system);
+            if (system_len > 0 && system_len < tokens.size() &&
+                std::equal(system, system + system_len, tokens.begin())) {
+                cache_len = system_len;
+            }
+        }
+        // 至少保留最后一个 token 用于计算 logits
+        begin = cache.lookup(model_id_, tokens.data(), tokens.size() - 1, state_,
+                             arena_.allocate_array<uint64_t>(tokens.size()));
+        if (begin > 0) {
+            RWKV_LOGD("Prefix cache hit: %zu of %zu prompt tokens reused", begin, tokens.size());
+        }
+    }
+
+    // prefill：每块 prompt token 一次前向，块内的矩阵乘法与 WKV 在线程池上并行
+    const size_t chunk = static_cast<size_t>(runtime_.prefill_chunk_.load());
+    if (chunk > 1 && prefill_scratch_.batch != static_cast<int>(chunk)) {
+        prefill_scratch_.init(model->config(), static_cast<int>(chunk));
+    }
+    ThreadPool* pool = runtime_.thread_pool_.get();
+    runtime_.prefill_progress_.store(static_cast<float>(begin) / static_cast<float>(tokens.size()));
+    perf_.prompt_tokens = tokens.size();
+    perf_.cached_tokens = begin;
+    auto start = Clock::now();
+    for (size_t i = begin; i < tokens.size();) {
+        size_t end = std::min(i + chunk, tokens.size());
+        // 在缓存位置切开，存入的状态恰好对应前 cache_len 个 token
+        if (i < cache_len && cache_len < end) {
+            end = cache_len;
+        }
+        float* out = end == tokens.size() ? logits_.data() : nullptr;
+        if (end - i == 1) {
+            model->forward(tokens[i], state_, scratch_, out, pool);
+        } else {
+            model->forward_chunk(tokens.data() + i, static_cast<int>(end - i), state_, prefill_scratch_, out, pool);
+        }
+        if (end == cache_len) {
+            cache.insert(model_id_, tokens.data(), cache_len, state_);
+        }
+        i = end;
+        runtime_.prefill_progress_.store(static_cast<float>(i) / static_cast<float>(tokens.size()));
+        if (stop_requested_.load(std::memory_order_relaxed)) {
+            bind_draft_locked(-1, nullptr);
+            perf_.prefill_us = micros_between(start, Clock::now());
+            publish_perf();
+            return kSuccess;
+        }
+    }
+    // 草稿模型 prefill 同样的 token（不经过前缀缓存，草稿很小）
+    if (draft != nullptr) {
+        if (chunk > 1 && draft_prefill_scratch_.batch != static_cast<int>(chunk)) {
+            draft_prefill_scratch_.init(draft->config(), static_cast<int>(chunk));
+        }
+        for (size_t i = 0; i < tokens.size();) {
+            const size_t end = std::min(i + chunk, tokens.size());
+            if (end - i == 1) {
+                draft->forward(tokens[i], draft_state_, draft_scratch_, nullptr, pool);
+            } else {
+                draft->forward_chunk(tokens.data() + i, static_cast<int>(end - i), draft_state_,
+                                     draft_prefill_scratch_, nullptr, pool);
+            }
+            i = end;
+        }
+    }
+    // 只统计实际送入模型的 token，命中缓存的部分不计入速度
+    perf_.prefill_us = micros_between(start, Clock::now());
+    if (perf_.prefill_us > 0) {
+        runtime_.prefill_speed_.store(static_cast<float>((tokens.size() - begin) * 1e6 / perf_.prefill_us));
+    }
+
+    // decode：开启批处理时，与其他正在解码的会话合并前向
+    DecodeBatcher& batcher = runtime_.batcher_;
+    std::optional<DecodeBatcher::Participant> participant;
+    if (batcher.enabled()) {
+        participant.emplace(batcher);
+    }
+    const int vocab = model->config().vocab_size;
+    // 重复惩罚按每次回复统计
+    occurrences_.clear();
+    occurrences_.reserve(vocab);
+    // 约束从每次回复的开头匹配
+    std::shared_ptr<const TokenConstraint> constraint;
+    {
+        std::lock_guard<std::mutex> config_lock(runtime_.config_mutex_);
+        constraint = runtime_.constraint_;
+    }
+    int constraint_state = constraint ? constraint->start_state() : -1;
+    // 采样下一个 token；约束无路可走（词表缺少需要的字节）时返回 -1
+    auto sample = [&](float* logits) {
+        const Clock::time_point sample_start = Clock::now();
+        if (constraint) {
+            if (constraint_state < 0 || !constraint->has_allowed(constraint_state)) {
+                return -1;
+            }
+            constraint->apply(constraint_state, logits, vocab);
+        }
+        const int id = sampler_.sample(logits, vocab, params, &occurrences_);
+        occurrences_.add(id, params.penalty_decay);
+        perf_.sampler_ns += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sample_start).count());
+        return id;
+    };
+    // 输出一个 token；返回 true 表示遇到停止序列
+    Clock::time_point last_emit = generate_start;
+    auto emit = [&](int id) {
+        const Clock::time_point now = Clock::now();
+        if (perf_.generated_tokens++ == 0) {
+            perf_.ttft_us = micros_between(generate_start, now);
+        } else {
+            perf_.token_latency.add(micros_between(last_emit, now));
+        }
+        last_emit = now;
+        const std::string_view piece = tokenizer.token_bytes(id);
+        if (constraint) {
+            constraint_state = constraint->advance(constraint_state, piece);
+        }
+        response_.append(id, piece);
+        bool stop = false;
+        for (int i = 0; i < stop_count; ++i) {
+            if (response_.ends_with(stop_sequences[i])) stop = true;
+        }
+        if (stream != nullptr) {
+            stream->push(piece);
+        }
+        return stop;
+    };
+
+    start = Clock::now();
+    int decoded = 0;
+    SpeculativeStats spec;
+    if (draft != nullptr && max_tokens > 0) {
+        // 投机解码：草稿模型贪心提出至多 k 个 token，主模型对 [上一个 token, 草稿...]
+        // 做一次分块前向得到每个位置的 logits，再逐个位置照常采样；采样结果与草稿不同时
+        // 本轮结束，主模型状态换成该位置的检查点。输出与逐个解码的分布完全相同
+        const int k_max = runtime_.draft_tokens_;
+        const ModelConfig& cfg = model->config();
+        if (verify_scratch_.batch < k_max + 1) {
+            verify_scratch_.init(cfg, k_max + 1);
+        }
+        verify_logits_.resize(static_cast<size_t>(k_max + 1) * vocab);
+        if (checkpoints_.size() < static_cast<size_t>(k_max)) {
+            checkpoints_.resize(static_cast<size_t>(k_max));
+        }
+        for (State& c : checkpoints_) {
+            if (c.empty()) c.init(cfg);
+        }
+        if (draft_checkpoints_.size() < static_cast<size_t>(k_max)) {
+            draft_checkpoints_.resize(static_cast<size_t>(k_max));
+        }
+        for (State& c : draft_checkpoints_) {
+            if (c.empty()) c.init(draft->config());
+        }
+
+        int verify[kMaxDraftTokens + 1];
+        int feed[kMaxDraftTokens + 1];  // 主模型已经处理、草稿模型还没有的 token，最后一个是 verify[0]
+        int feed_len = 0;
+        int id = sample(logits_.data());
+        bool done = id <= 0;
+        if (!done) {
+            ++decoded;
+            if (emit(id) || decoded == max_tokens) {
+                pending_token_ = id;
+                done = true;
+            }
+        }
+        feed[feed_len++] = id;
+        while (!done) {
+            if (stop_requested_.load(std::memory_order_relaxed)) {
+                pending_token_ = id;
+                break;
+            }
+            const int k = std::min(k_max, max_tokens - decoded - 1);
+            float* dl = draft_logits_.data();
+            for (int i = 0; i < feed_len; ++i) {
+                draft->forward(feed[i], draft_state_, draft_scratch_, i + 1 == feed_len && k > 0 ? dl : nullptr,
+                               pool);
+            }
+            // 草稿：已送入草稿模型的前 fed 个存有检查点（送入之前的状态）
+            verify[0] = id;
+            int n = 0;
+            int fed = 0;
+            int cs = constraint_state;
+            while (n < k) {
+                if (constraint) {
+                    if (cs < 0 || !constraint->has_allowed(cs)) break;
+                    constraint->apply(cs, dl, vocab);
+                }
+                const int d = static_cast<int>(std::max_element(dl, dl + vocab) - dl);
+                if (d == 0) break;
+                if (constraint) {
+                    cs = constraint->advance(cs, tokenizer.token_bytes(d));
+                }
+                verify[++n] = d;
+                if (n == k) break;
+                draft_checkpoints_[static_cast<size_t>(fed++)] = draft_state_;
+                draft->forward(d, draft_state_, draft_scratch_, dl, pool);
+            }
+
+            model->forward_verify(verify, n + 1, state_, verify_scratch_, verify_logits_.data(), checkpoints_.data(),
+                                  pool);
+            ++spec.passes;
+            spec.drafted += static_cast<uint64_t>(n);
+            int j = 0;
+            for (;; ++j) {
+                id = sample(verify_logits_.data() + static_cast<size_t>(j) * vocab);
+                if (id <= 0) {
+                    done = true;
+                    break;
+                }
+                const bool match = j < n && id == verify[j + 1];
+                if (match) ++spec.accepted;
+                ++decoded;
+                if (emit(id) || decoded == max_tokens) {
+                    pending_token_ = id;
+                    done = true;
+                    break;
+                }
+                if (!match) break;
+            }
+            // 回滚到 verify[0..j] 之后的状态
+            if (j < n) {
+                std::swap(state_, checkpoints_[static_cast<size_t>(j)]);
+            }
+            feed_len = 0;
+            if (j < fed) {
+                std::swap(draft_state_, draft_checkpoints_[static_cast<size_t>(j)]);
+            } else {
+                for (int i = fed + 1; i <= j; ++i) feed[feed_len++] = verify[i];
+            }
+            feed[feed_len++] = id;
+        }
+        // 让草稿模型与主模型停在同一位置（最后一个 token 是待送入的 pending_token_ 或结束符）
+        for (int i = 0; i + 1 < feed_len; ++i) {
+            draft->forward(feed[i], draft_state_, draft_scratch_, nullptr, pool);
+        }
+    } else {
+        for (int n = 0; n < max_tokens; ++n) {
+            if (stop_requested_.load(std::memory_order_relaxed)) {
+                break;
+            }
+            const int id = sample(logits_.data());
+            if (id <= 0) {
+                break;
+            }
+            ++decoded;
+            if (emit(id) || n + 1 == max_tokens) {
+                pending_token_ = id;
+                break;
+            }
+            if (participant) {
+                batcher.forward(model_id_, *model, id, state_, logits_.data(), pool);
+            } else {
+                model->forward(id, state_, scratch_, logits_.data(), pool);
+            }
+        }
+    }
+    perf_.decode_us = micros_between(start, Clock::now());
+    if (decoded > 0 && perf_.decode_us > 0) {
+        runtime_.decode_speed_.store(static_cast<float>(decoded * 1e6 / perf_.decode_us));
+    }
+    {
+        std::lock_guard<std::mutex> stats_lock(runtime_.speculative_mutex_);
+        runtime_.speculative_stats_ = spec;
+    }
+    publish_perf();
+    return kSuccess;
+}
+
+int Session::gen_completion(std::string_view prompt, int max_tokens, std::string* out) {
+    bool expected = false;
+    if (!generating_.compare_exchange_strong(expected, true)) {
+        return kErrorBusy;
+    }
+    wait_worker_idle();
+    stop_requested_.store(false);
+    reset_response();
+    const int ret = generate(prompt, max_tokens, nullptr);
+    if (out != nullptr) {
+        snapshot_response(out);
+    }
+    generating_.store(false, std::memory_order_release);
+    return ret;
+}
+
+int Session::gen_completion_async(std::string_view prompt, int max_tokens,
+                                  TokenCallback on_token, CompletionCallback on_complete) {
+    bool expected = false;
+    if (!generating_.compare_exchange_strong(expected, true)) {
+        return kErrorBusy;
+    }
+    wait_worker_idle();
+    stop_requested_.store(false);
+    reset_response();
+    if (!worker_.joinable()) {
+        worker_ = std::thread(&Session::worker_loop, this);
+        decoder_ = std::thread(&Session::decoder_loop, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        job_.prompt.assign(prompt.data(), prompt.size());
+        job_.max_tokens = max_tokens;
+        job_.on_token = std::move(on_token);
+        job_.on_complete = std::move(on_complete);
+        has_job_ = true;
+        worker_busy_ = true;
+    }
+    job_cv_.notify_all();
+    return kSuccess;
+}
+
+int Session::stop_generation() {
+    stop_requested_.store(true);
+    return kSuccess;
+}
+
+void Session::reset_response() {
+    response_.reset(runtime_.response_capacity_.load());
+}
+
+void Session::snapshot_response(std::string* out) {
+    ResponseStream::View v;
+    do {
+        v = response_.view();
+        out->resize(static_cast<size_t>(v.end - v.begin));
+    } while (!response_.copy(v, v.begin, out->size(), &(*out)[0]));
+    if (v.begin > 0) {
+        // 容量上限丢弃了开头，可能切在多字节字符中间
+        size_t skip = 0;
+        while (skip < out->size() && skip < 3 && is_utf8_continuation((*out)[skip])) ++skip;
+        out->erase(0, skip);
+    }
+}
+
+const char* Session::response_buffer_content() {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    snapshot_response(&response_snapshot_);
+    return response_snapshot_.c_str();
+}
+
+int Session::read_response(uint64_t offset, bool from_begin, bool hold_incomplete, char* dst, int size) {
+    for (;;) {
+        const ResponseStream::View v = response_.view();
+        if (from_begin) {
+            offset = v.begin;
+        } else if (offset > v.end || offset < v.begin) {
+            // 游标来自上一次生成，或所指的字节已因容量上限被丢弃
+            return kErrorInvalidParameters;
+        }
+        size_t n = static_cast<size_t>(std::min<uint64_t>(v.end - offset, static_cast<uint64_t>(size)));
+        if (!response_.copy(v, offset, n, dst)) {
+            continue;
+        }
+        size_t skip = 0;
+        if (from_begin && v.begin > 0) {
+            while (skip < n && skip < 3 && is_utf8_continuation(dst[skip])) ++skip;
+        }
+        if (offset + n < v.end) {
+            // 不在多字节字符中间截断
+            char next = 0;
+            if (!response_.copy(v, offset + n, 1, &next)) {
+                continue;
+            }
+            while (n > skip && is_utf8_continuation(next)) next = dst[--n];
+            // 调用方按缓冲区大小分段读取时每次都会走到这里，只在调试级别记录
+            if (from_begin) {
+                RWKV_LOGD("Response truncated to %zu of %llu bytes", n - skip,
+                          static_cast<unsigned long long>(v.end - v.begin));
+            }
+        } else if (hold_incomplete) {
+            n = skip + utf8_complete_length(dst + skip, n - skip);
+        }
+        if (skip > 0) {
+            memmove(dst, dst + skip, n - skip);
+        }
+        n -= skip;
+        if (n < static_cast<size_t>(size)) {
+            dst[n] = '\0';
+        }
+        return static_cast<int>(n);
+    }
+}
+
+int Session::copy_response(char* dst, int size) {
+    if (dst == nullptr || size <= 0) {
+        return 0;
+    }
+    return read_response(0, true, false, dst, size);
+}
+
+int Session::read_response_since(int offset, char* dst, int size) {
+    // 至少要放得下一个完整的 UTF-8 字符，否则回退后一个字节也读不出，游标永远不前进
+    if (dst == nullptr || size < 4 || offset < 0) {
+        return kErrorInvalidParameters;
+    }
+    // 生成仍在进行时，末尾不完整的字符留到下一次读取
+    return read_response(static_cast<uint64_t>(offset), false, is_generating(), dst, size);
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,208 @@
+/**
+ * session.h
+ *
+ * One conversation on a Runtime: its RWKV recurrent state, forward scratch
+ * buffers, response buffer and async generation threads. Sessions of the same
+ * runtime share the loaded model weights, the tokenizer and the sampler
+ * settings, so an extra chat costs only its state (a few MB).
+ */
+
+#ifndef RWKVMOBILE_SESSION_H
+#define RWKVMOBILE_SESSION_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "arena.h"
+#include "model.h"
+#include "perf_stats.h"
+#include "response_stream.h"
+#include "sampler.h"
+#include "spsc_ring.h"
+
+namespace rwkvmobile {
+
+class Runtime;
+
+class Session {
+public:
+    // 每生成一个 token 调用一次，参数为该 token 解码后的字节（指向词表，其后紧跟 NUL）；
+    // 在回调线程上调用，可能落后于解码线程
+    using TokenCallback = std::function<void(std::string_view token)>;
+    using CompletionCallback = std::function<void(int status)>;
+
+    explicit Session(Runtime& runtime) : runtime_(runtime) {}
+    ~Session();
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // 状态
+    int clear_state();
+    int load_initial_state(const std::string& path);
+    int unload_initial_state();
+
+    /**
+     * Size of a snapshot of this session's state with `codec`.
+     * @return bytes, or kErrorNotLoaded / kErrorInvalidParameters
+     */
+    int state_snapshot_size(int codec);
+
+    /**
+     * Snapshot the current state (plus the pending token) into `dst`.
+     * @return bytes written, or a negative error code (kErrorInvalidParameters
+     *         if `size` is smaller than state_snapshot_size())
+     */
+    int save_state(int codec, uint8_t* dst, int size);
+    int save_state(int codec, const std::string& path);
+
+    /**
+     * Replace the current state with a snapshot taken by save_state(); the
+     * file variant decodes straight from an mmap of the file.
+     */
+    int restore_state(const uint8_t* data, size_t size);
+    int restore_state(const std::string& path);
+
+    // 新状态（首次生成或 clear_state 之后）前置的系统提示词
+    void set_prompt(const std::string& prompt);
+    const char* prompt();
+
+    // 生成
+    // out 可为空，此时结果只保留在响应缓冲区中
+    int gen_completion(std::string_view prompt, int max_tokens, std::string* out);
+    int gen_completion_async(std::string_view prompt, int max_tokens,
+                             TokenCallback on_token, CompletionCallback on_complete);
+    int stop_generation();
+    bool is_generating() const { return generating_.load(std::memory_order_acquire); }
+
+    /**
+     * Snapshot of the text generated so far by the current/last generation.
+     * Valid until the next call.
+     */
+    const char* response_buffer_content();
+
+    /**
+     * Copy the response buffer into `dst` (at most `size` bytes, cut on a
+     * UTF-8 character boundary and NUL-terminated when there is room).
+     * @return number of bytes copied
+     */
+    int copy_response(char* dst, int size);
+
+    /**
+     * Copy the bytes appended to the response buffer since `offset` (a cursor
+     * previously advanced by this function's return values). Only whole UTF-8
+     * characters are copied; while generating, an incomplete trailing
+     * character is held back until the next read.
+     * @return number of bytes copied (advance the cursor by this much), or
+     *         kErrorInvalidParameters if `offset` is past the end of the
+     *         buffer (a new generation has started)
+     */
+    int read_response_since(int offset, char* dst, int size);
+
+    /**
+     * Copy the records (id, byte range, timestamp) of the generated tokens
+     * starting at token index `first`; see ResponseStream::read_tokens().
+     */
+    int read_tokens(uint64_t first, TokenRecord* out, int max) const {
+        return response_.read_tokens(first, out, max);
+    }
+
+private:
+    // 以下函数要求持有 mutex_ 与 Runtime 的模型读锁
+    void bind_model_locked(int model_id, const Model* model);
+    void reset_state_locked();
+    void bind_draft_locked(int model_id, const Model* draft);
+    int encode_state(int codec, std::vector<uint8_t>* buffer, uint8_t* dst, int size);
+    // stream 非空时每个生成的 token 推入其中，由调用 on_token 的线程取出
+    int generate(std::string_view prompt, int max_tokens, SpscRing<std::string_view>* stream);
+    // 异步生成的两个常驻线程的主循环
+    void worker_loop();
+    void decoder_loop();
+    // 等 worker_ 处理完已提交的任务（包括完成回调）；在 worker_ 上调用时直接返回
+    void wait_worker_idle();
+    void reset_response();
+    // 仍保留的全部回复（有容量上限时从第一个完整字符开始）
+    void snapshot_response(std::string* out);
+    // 从 offset 起拷贝回复，不截断多字节字符；hold_incomplete 时留下末尾不完整的字符
+    int read_response(uint64_t offset, bool from_begin, bool hold_incomplete, char* dst, int size);
+
+    Runtime& runtime_;
+
+    // 保护状态与缓冲区；生成过程中由生成线程持有
+    std::mutex mutex_;
+    int model_id_ = -1;           // state_ 所对应的模型，模型切换后重建
+    State state_;
+    State initial_state_;
+    bool has_initial_state_ = false;
+    bool state_is_fresh_ = true;
+    int pending_token_ = -1;      // 已采样但尚未送入模型的 token
+    ForwardScratch scratch_;
+    ForwardScratch prefill_scratch_;  // 分块 prefill 用，行数等于块长
+    std::vector<float> logits_;
+    TokenOccurrences occurrences_;  // 本次回复已生成的 token，用于重复惩罚
+    // 每个会话自己的随机数，并发生成互不影响；Runtime 的种子改变后在下一次生成开始时重新设置
+    Sampler sampler_;
+    uint64_t seed_epoch_ = UINT64_MAX;
+    PerfStats perf_;                // 当前/最近一次生成的统计，scratch 的 profile 指向其中的 forward
+
+    // 投机解码：草稿模型的状态与 state_ 对应同一段历史；检查点用于回滚到最后接受的 token
+    int draft_model_id_ = -1;     // draft_state_ 所对应的草稿模型，-1 表示需要重建
+    State draft_state_;
+    ForwardScratch draft_scratch_;
+    ForwardScratch draft_prefill_scratch_;
+    std::vector<float> draft_logits_;
+    std::vector<State> draft_checkpoints_;
+    std::vector<State> checkpoints_;
+    ForwardScratch verify_scratch_;  // 行数为草稿长度 + 1
+    std::vector<float> verify_logits_;
+
+    // 每次生成的临时数据（拼接后的文本、token、停止序列）放在 arena_ 中。
+    // stream_ 为解码线程与回调线程之间的队列，最多积压这么多 token，回调落后时解码线程才会等待
+    static constexpr size_t kTokenStreamCapacity = 256;
+    Arena arena_;
+    SpscRing<std::string_view> stream_{kTokenStreamCapacity};
+
+    std::mutex prompt_mutex_;
+    std::string prompt_;
+
+    // 异步生成：第一次调用时创建两个常驻线程，会话析构时结束，之后的生成不再创建线程。
+    // worker_ 取任务并调用 on_token / on_complete；有 on_token 时 decoder_ 运行前向与采样，
+    // token 经 stream_ 交给 worker_，否则 worker_ 自己运行。以下成员由 job_mutex_ 保护
+    struct AsyncJob {
+        std::string prompt;
+        int max_tokens = 0;
+        TokenCallback on_token;
+        CompletionCallback on_complete;
+    };
+    std::mutex job_mutex_;
+    std::condition_variable job_cv_;
+    AsyncJob job_;
+    bool has_job_ = false;                   // job_ 等待 worker_ 取走
+    bool worker_busy_ = false;               // 从提交任务到完成回调返回
+    const AsyncJob* decode_job_ = nullptr;   // 等待 decoder_ 取走
+    bool decoding_ = false;                  // decoder_ 正在运行 generate
+    int decode_status_ = 0;
+    bool shutdown_ = false;
+    bool* worker_destroyed_ = nullptr;       // 指向 worker_loop 的局部变量，见析构函数
+    std::thread worker_;
+    std::thread decoder_;
+
+    std::atomic<bool> generating_{false};
+    std::atomic<bool> stop_requested_{false};
+
+    // 回复只由生成线程写入，读取不加锁；response_snapshot_ 只在读者之间共享
+    ResponseStream response_;
+    std::mutex snapshot_mutex_;
+    std::string response_snapshot_;
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_SESSION_H
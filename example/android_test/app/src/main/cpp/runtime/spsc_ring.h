@@ -0,0 +1,141 @@
+/**
+ * spsc_ring.h
+ *
+ * Bounded single-producer/single-consumer queue. push/pop are one acquire
+ * load and one release store each; a side that has to wait spins briefly,
+ * then parks on a condition variable that the other side only touches when
+ * someone is actually parked. Used to hand generated tokens from the decode
+ * thread to the thread that runs the token callbacks.
+ */
+
+#ifndef RWKVMOBILE_SPSC_RING_H
+#define RWKVMOBILE_SPSC_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace rwkvmobile {
+
+template <typename T>
+class SpscRing {
+public:
+    // capacity 向上取整为 2 的幂
+    explicit SpscRing(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        mask_ = n - 1;
+        slots_.reset(new T[n]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // 生产者：满了返回 false
+    bool try_push(const T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > mask_) return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        wake_if_parked();
+        return true;
+    }
+
+    // 生产者：满了就等消费者腾出位置
+    void push(const T& value) {
+        for (int spins = 0; !try_push(value); ++spins) {
+            if (spins < kSpins) {
+                std::this_thread::yield();
+                continue;
+            }
+            park([&]() { return tail_.load() - head_.load() <= mask_; });
+        }
+    }
+
+    // 生产者：之后不再 push；消费者取完剩余元素后 pop 返回 false
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        wake_if_parked();
+    }
+
+    // 消费者：空了返回 false
+    bool try_pop(T* value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        *value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        wake_if_parked();
+        return true;
+    }
+
+    // 消费者：等到有元素（返回 true）或已关闭且取空（返回 false）
+    bool pop(T* value) {
+        for (int spins = 0;; ++spins) {
+            // 先读 closed_ 再 try_pop：关闭之前 push 的元素一定能取到
+            const bool closed = closed_.load(std::memory_order_acquire);
+            if (try_pop(value)) return true;
+            if (closed) return false;
+            if (spins < kSpins) {
+                std::this_thread::yield();
+                continue;
+            }
+            park([&]() { return closed_.load() || head_.load() != tail_.load(); });
+        }
+    }
+
+    // 清空并重新打开，以便复用同一个队列；只能在两端都不再使用时调用
+    void reset() {
+        tail_.store(0, std::memory_order_relaxed);
+        head_cache_ = 0;
+        head_.store(0, std::memory_order_relaxed);
+        tail_cache_ = 0;
+        closed_.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int kSpins = 64;
+
+    template <typename Ready>
+    void park(Ready ready) {
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        parked_.fetch_add(1);
+        park_cv_.wait(lock, ready);
+        parked_.fetch_sub(1);
+    }
+
+    void wake_if_parked() {
+        // 与 park 中 parked_ 的递增配对（都是 seq_cst），不会错过正要休眠的一方
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed) > 0) {
+            { std::lock_guard<std::mutex> lock(park_mutex_); }
+            park_cv_.notify_all();
+        }
+    }
+
+    std::unique_ptr<T[]> slots_;
+    size_t mask_ = 0;
+
+    // 生产者与消费者各自的位置及对方位置的缓存，分在不同缓存行
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;
+    alignas(64) std::atomic<bool> closed_{false};
+
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::atomic<int> parked_{0};
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_SPSC_RING_H
@@ -0,0 +1,206 @@
+#include "state_snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "safetensors.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'R', 'W', 'S', 'T'};
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kAlign = 64;
+constexpr uint32_t kInt8Group = 64;
+constexpr uint32_t kFlagFresh = 1u << 0;
+
+size_t align_up(size_t n) { return (n + kAlign - 1) / kAlign * kAlign; }
+
+void store_f32(uint8_t* p, float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    store_u32(p, bits);
+}
+
+float load_f32(const uint8_t* p) {
+    const uint32_t bits = load_u32(p);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+size_t groups_of(size_t count) { return (count + kInt8Group - 1) / kInt8Group; }
+
+size_t section_size(size_t count, StateCodec codec) {
+    switch (codec) {
+        case StateCodec::kF32: return align_up(count * 4);
+        case StateCodec::kF16: return align_up(count * 2);
+        case StateCodec::kInt8: return align_up(groups_of(count) * 4 + count);
+    }
+    return 0;
+}
+
+void encode_section(const float* src, size_t count, StateCodec codec, uint8_t* dst) {
+    switch (codec) {
+        case StateCodec::kF32:
+            if (kLittleEndian) {
+                memcpy(dst, src, count * 4);
+            } else {
+                for (size_t i = 0; i < count; ++i) store_f32(dst + i * 4, src[i]);
+            }
+            break;
+        case StateCodec::kF16:
+            for (size_t i = 0; i < count; ++i) {
+                const uint16_t h = fp32_to_fp16(src[i]);
+                dst[i * 2] = static_cast<uint8_t>(h);
+                dst[i * 2 + 1] = static_cast<uint8_t>(h >> 8);
+            }
+            break;
+        case StateCodec::kInt8: {
+            const size_t groups = groups_of(count);
+            int8_t* q = reinterpret_cast<int8_t*>(dst + groups * 4);
+            for (size_t g = 0; g < groups; ++g) {
+                const size_t begin = g * kInt8Group;
+                const size_t end = std::min(begin + kInt8Group, count);
+                float amax = 0.f;
+                for (size_t i = begin; i < end; ++i) amax = std::max(amax, std::fabs(src[i]));
+                const float scale = amax / 127.f;
+                const float inv = scale > 0.f ? 1.f / scale : 0.f;
+                store_f32(dst + g * 4, scale);
+                for (size_t i = begin; i < end; ++i) {
+                    q[i] = static_cast<int8_t>(std::lround(src[i] * inv));
+                }
+            }
+            break;
+        }
+    }
+}
+
+void decode_section(const uint8_t* src, size_t count, StateCodec codec, float* dst) {
+    switch (codec) {
+        case StateCodec::kF32:
+            if (kLittleEndian) {
+                memcpy(dst, src, count * 4);
+            } else {
+                for (size_t i = 0; i < count; ++i) dst[i] = load_f32(src + i * 4);
+            }
+            break;
+        case StateCodec::kF16:
+            for (size_t i = 0; i < count; ++i) {
+                dst[i] = fp16_to_fp32(static_cast<uint16_t>(src[i * 2] | (src[i * 2 + 1] << 8)));
+            }
+            break;
+        case StateCodec::kInt8: {
+            const size_t groups = groups_of(count);
+            const int8_t* q = reinterpret_cast<const int8_t*>(src + groups * 4);
+            for (size_t g = 0; g < groups; ++g) {
+                const float scale = load_f32(src + g * 4);
+                const size_t end = std::min((g + 1) * kInt8Group, count);
+                for (size_t i = g * kInt8Group; i < end; ++i) dst[i] = q[i] * scale;
+            }
+            break;
+        }
+    }
+}
+
+size_t embd_count(const ModelConfig& cfg) {
+    return static_cast<size_t>(cfg.n_layer) * cfg.n_embd;
+}
+
+size_t kv_count(const ModelConfig& cfg) {
+    return static_cast<size_t>(cfg.n_layer) * cfg.n_head * cfg.head_size * cfg.head_size;
+}
+
+} // namespace
+
+bool is_valid_state_codec(int codec) {
+    return codec >= static_cast<int>(StateCodec::kF32) && codec <= static_cast<int>(StateCodec::kInt8);
+}
+
+size_t state_snapshot_size(const ModelConfig& cfg, StateCodec codec) {
+    return kHeaderSize + 2 * section_size(embd_count(cfg), codec) + section_size(kv_count(cfg), codec);
+}
+
+size_t write_state_snapshot(const ModelConfig& cfg, const State& state, const StateSnapshotInfo& info,
+                            StateCodec codec, uint8_t* out, size_t size) {
+    const size_t total = state_snapshot_size(cfg, codec);
+    if (out == nullptr || size < total) {
+        return 0;
+    }
+    // 对齐填充与保留字段置零，保证相同状态的快照逐字节一致
+    memset(out, 0, total);
+    memcpy(out, kMagic, sizeof(kMagic));
+    store_u32(out + 4, kStateSnapshotVersion);
+    store_u32(out + 8, static_cast<uint32_t>(codec));
+    store_u32(out + 12, kInt8Group);
+    store_u32(out + 16, static_cast<uint32_t>(cfg.n_layer));
+    store_u32(out + 20, static_cast<uint32_t>(cfg.n_embd));
+    store_u32(out + 24, static_cast<uint32_t>(cfg.n_head));
+    store_u32(out + 28, static_cast<uint32_t>(cfg.head_size));
+    store_u32(out + 32, static_cast<uint32_t>(info.pending_token));
+    store_u32(out + 36, info.fresh ? kFlagFresh : 0u);
+    store_u64(out + 40, total);
+
+    uint8_t* p = out + kHeaderSize;
+    encode_section(state.att_x.data(), embd_count(cfg), codec, p);
+    p += section_size(embd_count(cfg), codec);
+    encode_section(state.att_kv.data(), kv_count(cfg), codec, p);
+    p += section_size(kv_count(cfg), codec);
+    encode_section(state.ffn_x.data(), embd_count(cfg), codec, p);
+    return total;
+}
+
+bool read_state_snapshot(const uint8_t* data, size_t size, const ModelConfig& cfg,
+                         State& state, StateSnapshotInfo* info) {
+    if (data == nullptr || size < kHeaderSize || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        RWKV_LOGE("Not an RWKV state snapshot");
+        return false;
+    }
+    const uint32_t version = load_u32(data + 4);
+    if (version == 0 || version > kStateSnapshotVersion) {
+        RWKV_LOGE("Unsupported state snapshot version %u", version);
+        return false;
+    }
+    const uint32_t codec_id = load_u32(data + 8);
+    if (!is_valid_state_codec(static_cast<int>(codec_id)) || load_u32(data + 12) != kInt8Group) {
+        RWKV_LOGE("Unsupported state snapshot codec %u", codec_id);
+        return false;
+    }
+    const StateCodec codec = static_cast<StateCodec>(codec_id);
+    if (load_u32(data + 16) != static_cast<uint32_t>(cfg.n_layer) ||
+        load_u32(data + 20) != static_cast<uint32_t>(cfg.n_embd) ||
+        load_u32(data + 24) != static_cast<uint32_t>(cfg.n_head) ||
+        load_u32(data + 28) != static_cast<uint32_t>(cfg.head_size)) {
+        RWKV_LOGE("State snapshot does not match the loaded model");
+        return false;
+    }
+    const size_t total = state_snapshot_size(cfg, codec);
+    if (load_u64(data + 40) != total || size < total) {
+        RWKV_LOGE("State snapshot is truncated (%zu of %zu bytes)", size, total);
+        return false;
+    }
+    const int pending = static_cast<int32_t>(load_u32(data + 32));
+    if (pending < -1 || pending >= cfg.vocab_size) {
+        RWKV_LOGE("State snapshot has an invalid pending token %d", pending);
+        return false;
+    }
+
+    state.init(cfg);
+    const uint8_t* p = data + kHeaderSize;
+    decode_section(p, embd_count(cfg), codec, state.att_x.data());
+    p += section_size(embd_count(cfg), codec);
+    decode_section(p, kv_count(cfg), codec, state.att_kv.data());
+    p += section_size(kv_count(cfg), codec);
+    decode_section(p, embd_count(cfg), codec, state.ffn_x.data());
+    if (info != nullptr) {
+        info->pending_token = pending;
+        info->fresh = (load_u32(data + 36) & kFlagFresh) != 0;
+    }
+    return true;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,76 @@
+/**
+ * state_snapshot.h
+ *
+ * Binary snapshot of a session's RWKV state, used to resume a conversation
+ * without prefilling it again. All fields are little-endian:
+ *
+ *   offset  size  field
+ *        0     4  magic "RWST"
+ *        4     4  format version (kStateSnapshotVersion)
+ *        8     4  codec (StateCodec)
+ *       12     4  int8 group size (elements per scale)
+ *       16    16  n_layer, n_embd, n_head, head_size
+ *       32     4  pending token (sampled but not yet fed), -1 if none
+ *       36     4  flags (bit 0: state is fresh, the system prompt is still due)
+ *       40     8  total snapshot size in bytes
+ *       48    16  reserved, zero
+ *
+ * followed by three sections, each starting on a 64-byte boundary:
+ * att_x [n_layer x n_embd], att_kv [n_layer x n_head x head_size^2] and
+ * ffn_x [n_layer x n_embd]. A section is the raw fp32 or fp16 values, or for
+ * int8 an fp32 scale per group followed by the quantized values. The layout
+ * only depends on the header, so a snapshot can be decoded straight out of
+ * an mmap-ed file.
+ */
+
+#ifndef RWKVMOBILE_STATE_SNAPSHOT_H
+#define RWKVMOBILE_STATE_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "model.h"
+
+namespace rwkvmobile {
+
+constexpr uint32_t kStateSnapshotVersion = 1;
+
+// 与 rwkv_mobile.h 中的 RWKVMOBILE_STATE_CODEC_* 保持一致
+enum class StateCodec : uint32_t {
+    kF32 = 0,
+    kF16 = 1,
+    kInt8 = 2,  // 每组一个 fp32 缩放系数的对称量化
+};
+
+bool is_valid_state_codec(int codec);
+
+// 快照中除张量外的会话信息
+struct StateSnapshotInfo {
+    int pending_token = -1;
+    bool fresh = true;
+};
+
+/**
+ * Size of a snapshot of a `cfg` model state encoded with `codec`.
+ */
+size_t state_snapshot_size(const ModelConfig& cfg, StateCodec codec);
+
+/**
+ * Encode `state` into `out`.
+ * @return number of bytes written, or 0 if `size` is too small
+ */
+size_t write_state_snapshot(const ModelConfig& cfg, const State& state, const StateSnapshotInfo& info,
+                            StateCodec codec, uint8_t* out, size_t size);
+
+/**
+ * Decode a snapshot into `state` (resized to `cfg`). Fails, leaving `state`
+ * untouched, if the data is truncated, of an unknown version or codec, or
+ * was taken from a model with different dimensions.
+ * @return true on success (reasons for failure are logged)
+ */
+bool read_state_snapshot(const uint8_t* data, size_t size, const ModelConfig& cfg,
+                         State& state, StateSnapshotInfo* info);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_STATE_SNAPSHOT_H
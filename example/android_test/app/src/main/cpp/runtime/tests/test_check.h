@@ -0,0 +1,46 @@
+/**
+ * test_check.h
+ *
+ * Minimal checks for the runtime self-tests. A failed CHECK prints the
+ * expression and its location and counts as a failure; main() returns
+ * test_result(), which ctest reads as the test outcome.
+ */
+
+#ifndef RWKVMOBILE_TEST_CHECK_H
+#define RWKVMOBILE_TEST_CHECK_H
+
+#include <cstdio>
+
+namespace rwkvmobile {
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+// 0 表示全部通过
+inline int test_result(const char* name) {
+    if (test_failures() != 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures());
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+} // namespace rwkvmobile
+
+// 失败时附带 printf 格式的说明
+#define CHECK_MSG(cond, ...)                                                   \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                      \
+            fputc('\n', stderr);                                               \
+            ++::rwkvmobile::test_failures();                                   \
+        }                                                                      \
+    } while (0)
+
+#define CHECK(cond) CHECK_MSG(cond, "%s", "")
+
+#endif // RWKVMOBILE_TEST_CHECK_H
@@ -0,0 +1,260 @@
+/**
+ * test_compiled_vocab.cpp
+ *
+ * The compiled vocab (double-array trie plus byte table) against a naive
+ * greedy longest-match tokenizer over a std::map: random vocabs with many
+ * shared prefixes, duplicate byte strings (the later id wins), missing
+ * single bytes (skipped), and the byte-level table path. Then the
+ * save -> mmap -> load round trip must give the same tokens and encodings,
+ * and a compiled file with a corrupted byte, checksum, version or length
+ * must be rejected.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "binary_io.h"
+#include "compiled_vocab.h"
+#include "logger.h"
+#include "test_check.h"
+#include "tokenizer.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+using Entries = std::vector<std::pair<std::string, int>>;
+
+// 按词表文本格式写出，每个字节都写成 \xNN
+bool write_text_vocab(const std::string& path, const Entries& entries) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    for (const auto& e : entries) {
+        fprintf(f, "%d b'", e.second);
+        for (unsigned char c : e.first) fprintf(f, "\\x%02x", c);
+        fprintf(f, "' %zu\n", e.first.size());
+    }
+    return fclose(f) == 0;
+}
+
+// 朴素的贪心最长匹配：从最长的长度往下试；无法编码的字节跳过
+class NaiveTokenizer {
+public:
+    explicit NaiveTokenizer(const Entries& entries) {
+        for (const auto& e : entries) {
+            tokens_[e.first] = e.second;
+            max_len_ = std::max(max_len_, e.first.size());
+        }
+    }
+
+    std::vector<int> encode(const std::string& text) const {
+        std::vector<int> ids;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t len = std::min(max_len_, text.size() - pos);
+            for (; len > 0; --len) {
+                const auto it = tokens_.find(text.substr(pos, len));
+                if (it != tokens_.end()) {
+                    ids.push_back(it->second);
+                    break;
+                }
+            }
+            pos += len > 0 ? len : 1;
+        }
+        return ids;
+    }
+
+    // 没有被同样字节的后来者覆盖的 id
+    bool live(const std::string& bytes, int id) const {
+        const auto it = tokens_.find(bytes);
+        return it != tokens_.end() && it->second == id;
+    }
+
+private:
+    std::map<std::string, int> tokens_;
+    size_t max_len_ = 0;
+};
+
+// 字母表很小，token 之间有大量公共前缀；单字节 token 缺 0x00 与 0x7f
+Entries make_vocab(std::mt19937& rng, int multi_byte) {
+    Entries entries;
+    int id = 1;
+    for (int c = 1; c < 256; ++c) {
+        if (c != 0x7f) entries.emplace_back(std::string(1, static_cast<char>(c)), id);
+        ++id;
+    }
+    const std::string alphabet = "abcde\xe4\xb8\xad";
+    std::uniform_int_distribution<int> length(2, 12);
+    std::uniform_int_distribution<size_t> letter(0, alphabet.size() - 1);
+    std::uniform_int_distribution<int> gap(1, 3);
+    for (int i = 0; i < multi_byte; ++i) {
+        std::string token;
+        const int len = length(rng);
+        for (int j = 0; j < len; ++j) token += alphabet[letter(rng)];
+        id += gap(rng);  // id 不连续
+        entries.emplace_back(token, id);
+    }
+    // 同样的字节再出现一次，以后出现的 id 为准
+    for (int i = 0; i < 50; ++i) {
+        entries.emplace_back(entries[256 + static_cast<size_t>(i) * 7].first, ++id);
+    }
+    return entries;
+}
+
+std::string random_text(std::mt19937& rng, const std::string& alphabet, size_t len) {
+    std::uniform_int_distribution<size_t> letter(0, alphabet.size() - 1);
+    std::uniform_int_distribution<int> any(0, 255);
+    std::string text;
+    for (size_t i = 0; i < len; ++i) {
+        // 偶尔混入任意字节（包括词表中没有的 0x00 与 0x7f）
+        text += i % 17 == 16 ? static_cast<char>(any(rng)) : alphabet[letter(rng)];
+    }
+    return text;
+}
+
+void check_encodings(const Tokenizer& tokenizer, const NaiveTokenizer& naive, const std::vector<std::string>& texts,
+                     const char* what) {
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const std::vector<int> got = tokenizer.encode(texts[i]);
+        const std::vector<int> want = naive.encode(texts[i]);
+        CHECK_MSG(got == want, "%s: text %zu encodes to %zu tokens, naive %zu", what, i, got.size(), want.size());
+        std::string kept;
+        for (unsigned char c : texts[i]) {
+            if (c != 0x00 && c != 0x7f) kept += static_cast<char>(c);
+        }
+        CHECK_MSG(tokenizer.decode(got) == kept, "%s: text %zu does not decode back", what, i);
+    }
+}
+
+void check_same_tokens(const Tokenizer& a, const Tokenizer& b, const char* what) {
+    CHECK_MSG(a.vocab_size() == b.vocab_size(), "%s: vocab size %d vs %d", what, a.vocab_size(), b.vocab_size());
+    for (int id = 0; id < a.vocab_size() && id < b.vocab_size(); ++id) {
+        if (a.token_bytes(id) != b.token_bytes(id)) {
+            CHECK_MSG(false, "%s: token %d differs", what, id);
+            return;
+        }
+    }
+}
+
+std::vector<uint8_t> read_file(const std::string& path) {
+    std::vector<uint8_t> data;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        return data;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    return data;
+}
+
+void check_trie(std::mt19937& rng) {
+    const Entries entries = make_vocab(rng, 3000);
+    const std::string text_path = "test_compiled_vocab.txt";
+    const std::string compiled_path = "test_compiled_vocab.rwkvvocab";
+    CHECK(write_text_vocab(text_path, entries));
+    Tokenizer text;
+    CHECK(text.load(text_path));
+    CHECK(text.compiled_on_load());
+    CHECK(!text.byte_level());
+    const NaiveTokenizer naive(entries);
+
+    for (const auto& e : entries) {
+        // 每个 token 单独编码是它自己（被覆盖的 id 编码成覆盖它的那个）
+        const std::vector<int> ids = text.encode(e.first);
+        CHECK_MSG(ids.size() == 1 && text.token_bytes(ids[0]) == e.first, "token %d does not encode to itself",
+                  e.second);
+        CHECK_MSG(!naive.live(e.first, e.second) || text.token_bytes(e.second) == e.first,
+                  "token %d has the wrong bytes", e.second);
+    }
+    std::vector<std::string> texts;
+    for (size_t len : {0, 1, 2, 5, 13, 64, 1000, 20000}) {
+        for (int i = 0; i < 4; ++i) texts.push_back(random_text(rng, "abcde\xe4\xb8\xad", len));
+    }
+    check_encodings(text, naive, texts, "text vocab");
+
+    // 保存 -> 映射 -> 加载
+    CHECK(text.save_compiled(compiled_path));
+    Tokenizer mapped;
+    CHECK(mapped.load(compiled_path));
+    CHECK(!mapped.compiled_on_load());
+    check_same_tokens(text, mapped, "mapped");
+    check_encodings(mapped, naive, texts, "mapped vocab");
+
+    std::vector<uint8_t> good = read_file(compiled_path);
+    std::vector<uint8_t> compiled;
+    CHECK(compile_vocab(entries, &compiled));
+    CHECK_MSG(good == compiled, "saved file differs from compile_vocab output");
+    CompiledVocab vocab;
+    CHECK(read_compiled_vocab(good.data(), good.size(), &vocab));
+
+    // 损坏的文件必须被拒绝：checksum 覆盖整个文件
+    const size_t positions[] = {4, 40, 41, 64, good.size() / 2, good.size() - 1};
+    for (size_t pos : positions) {
+        std::vector<uint8_t> bad = good;
+        bad[pos] ^= 0x01;
+        CHECK_MSG(!read_compiled_vocab(bad.data(), bad.size(), &vocab), "byte %zu flipped was accepted", pos);
+    }
+    for (size_t size : {size_t(0), size_t(8), size_t(63), good.size() - 8}) {
+        CHECK_MSG(!read_compiled_vocab(good.data(), size, &vocab), "%zu of %zu bytes accepted", size, good.size());
+    }
+    // 头部字段按小端存储
+    CHECK(load_u32(good.data() + 4) == kVocabLayoutVersion);
+    CHECK(load_u64(good.data() + 32) == good.size());
+    std::vector<uint8_t> bad = good;
+    store_u32(bad.data() + 4, kVocabLayoutVersion + 1);
+    CHECK(!read_compiled_vocab(bad.data(), bad.size(), &vocab));
+
+    // 映射加载也走同样的校验
+    std::vector<uint8_t> corrupt = good;
+    corrupt[good.size() / 2] ^= 0x80;
+    CHECK(write_file_atomically(compiled_path, "compiled vocab", corrupt.data(), corrupt.size()));
+    Tokenizer rejected;
+    CHECK(!rejected.load(compiled_path));
+
+    // 写不进去时返回 false，原文件不变
+    CHECK(!text.save_compiled("/nonexistent-dir/test_compiled_vocab.rwkvvocab"));
+
+    remove(text_path.c_str());
+    remove(compiled_path.c_str());
+}
+
+// 只有单字节 token 的词表走 256 项的查表路径
+void check_byte_level(std::mt19937& rng) {
+    Entries entries;
+    for (int c = 1; c < 256; ++c) {
+        if (c != 0x7f) entries.emplace_back(std::string(1, static_cast<char>(c)), c);
+    }
+    const std::string path = "test_compiled_vocab_bytes.txt";
+    CHECK(write_text_vocab(path, entries));
+    Tokenizer tokenizer;
+    CHECK(tokenizer.load(path));
+    CHECK(tokenizer.byte_level());
+    std::vector<std::string> texts;
+    for (size_t len : {0, 1, 100, 5000}) texts.push_back(random_text(rng, "xyz{}", len));
+    check_encodings(tokenizer, NaiveTokenizer(entries), texts, "byte-level vocab");
+    remove(path.c_str());
+}
+
+} // namespace
+
+int main() {
+    // 被拒绝的文件与跳过的字节会打日志，属于预期
+    set_log_level(kLogError + 1);
+    std::mt19937 rng(5);
+    check_trie(rng);
+    check_byte_level(rng);
+
+    std::vector<uint8_t> out;
+    CHECK(!compile_vocab({}, &out));
+    CHECK(!compile_vocab({{"a", 0}}, &out));
+    CHECK(!compile_vocab({{"a", -3}}, &out));
+    return test_result("test_compiled_vocab");
+}
@@ -0,0 +1,170 @@
+/**
+ * test_decode_batcher.cpp
+ *
+ * A batched decode step must produce the same logits and states as N
+ * independent single-session steps. Checks Model::forward_batch() against
+ * Model::forward() per sequence, then drives DecodeBatcher from N decoding
+ * threads (more threads than max_batch, with and without a pool, one
+ * session leaving early) and compares every step with a reference run.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "decode_batcher.h"
+#include "model.h"
+#include "test_check.h"
+#include "thread_pool.h"
+#include "tiny_model.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+// matmat 与 matvec 的累加顺序不同，只要求在浮点误差内一致
+constexpr float kTolerance = 1e-4f;
+
+float max_diff(const float* a, const float* b, size_t n) {
+    float diff = 0.f;
+    for (size_t i = 0; i < n; ++i) {
+        diff = std::max(diff, std::fabs(a[i] - b[i]) / std::max(1.f, std::fabs(b[i])));
+    }
+    return diff;
+}
+
+float state_diff(const State& a, const State& b) {
+    return std::max({max_diff(a.att_x.data(), b.att_x.data(), b.att_x.size()),
+                     max_diff(a.att_kv.data(), b.att_kv.data(), b.att_kv.size()),
+                     max_diff(a.ffn_x.data(), b.ffn_x.data(), b.ffn_x.size())});
+}
+
+// 每个会话各自的 token 序列
+std::vector<std::vector<int>> make_tokens(int sessions, int steps, int vocab, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> token(0, vocab - 1);
+    std::vector<std::vector<int>> tokens(sessions, std::vector<int>(steps));
+    for (auto& seq : tokens) {
+        for (int& t : seq) t = token(rng);
+    }
+    return tokens;
+}
+
+void check_forward_batch(const Model& model, ThreadPool* pool) {
+    const ModelConfig& cfg = model.config();
+    const int V = cfg.vocab_size;
+    for (int n : {1, 2, 3, 5}) {
+        const auto tokens = make_tokens(n, 4, V, 7 + n);
+        std::vector<State> batched(n), single(n);
+        for (int i = 0; i < n; ++i) {
+            batched[i].init(cfg);
+            single[i].init(cfg);
+        }
+        ForwardScratch batch_scratch, single_scratch;
+        batch_scratch.init(cfg, n);
+        single_scratch.init(cfg);
+        std::vector<float> batch_logits(static_cast<size_t>(n) * V), single_logits(V);
+
+        for (size_t step = 0; step < tokens[0].size(); ++step) {
+            std::vector<int> step_tokens(n);
+            std::vector<State*> states(n);
+            std::vector<float*> logits(n);
+            for (int i = 0; i < n; ++i) {
+                step_tokens[i] = tokens[i][step];
+                states[i] = &batched[i];
+                logits[i] = batch_logits.data() + static_cast<size_t>(i) * V;
+            }
+            model.forward_batch(step_tokens.data(), states.data(), n, batch_scratch, logits.data(), pool);
+            for (int i = 0; i < n; ++i) {
+                model.forward(step_tokens[i], single[i], single_scratch, single_logits.data(), pool);
+                const float logit_diff = max_diff(logits[i], single_logits.data(), V);
+                CHECK_MSG(logit_diff < kTolerance, "forward_batch n=%d step=%zu seq=%d pool=%d logits differ by %g",
+                          n, step, i, pool != nullptr, logit_diff);
+                const float diff = state_diff(batched[i], single[i]);
+                CHECK_MSG(diff < kTolerance, "forward_batch n=%d step=%zu seq=%d pool=%d state differs by %g",
+                          n, step, i, pool != nullptr, diff);
+            }
+        }
+    }
+}
+
+// 每个线程是一个解码中的会话；第 early 个会话只走一半步数就离开
+void check_batcher(const Model& model, int sessions, int max_batch, ThreadPool* pool, int early) {
+    const ModelConfig& cfg = model.config();
+    const int V = cfg.vocab_size;
+    const int steps = 6;
+    const auto tokens = make_tokens(sessions, steps, V, 100 + sessions * 10 + max_batch);
+
+    // 参考：逐会话单独 forward
+    std::vector<std::vector<float>> expected(sessions, std::vector<float>(static_cast<size_t>(steps) * V));
+    {
+        ForwardScratch scratch;
+        scratch.init(cfg);
+        for (int s = 0; s < sessions; ++s) {
+            State state;
+            state.init(cfg);
+            for (int step = 0; step < steps; ++step) {
+                model.forward(tokens[s][step], state, scratch, expected[s].data() + static_cast<size_t>(step) * V);
+            }
+        }
+    }
+
+    DecodeBatcher batcher;
+    batcher.set_max_batch(max_batch);
+    std::vector<std::vector<float>> actual(sessions, std::vector<float>(static_cast<size_t>(steps) * V, NAN));
+    std::vector<std::thread> threads;
+    for (int s = 0; s < sessions; ++s) {
+        threads.emplace_back([&, s] {
+            DecodeBatcher::Participant participant(batcher);
+            State state;
+            state.init(cfg);
+            const int n = s == early ? steps / 2 : steps;
+            for (int step = 0; step < n; ++step) {
+                batcher.forward(0, model, tokens[s][step], state, actual[s].data() + static_cast<size_t>(step) * V,
+                                pool);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    for (int s = 0; s < sessions; ++s) {
+        const int n = s == early ? steps / 2 : steps;
+        for (int step = 0; step < n; ++step) {
+            const size_t offset = static_cast<size_t>(step) * V;
+            const float diff = max_diff(actual[s].data() + offset, expected[s].data() + offset, V);
+            CHECK_MSG(diff < kTolerance, "batcher sessions=%d max_batch=%d pool=%d session=%d step=%d differs by %g",
+                      sessions, max_batch, pool != nullptr, s, step, diff);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    const char* path = "test_decode_batcher.st";
+    TinyModelShape shape;
+    CHECK(write_tiny_model(path, shape, 1));
+    std::unique_ptr<Model> model = Model::load(path);
+    CHECK(model != nullptr);
+    std::remove(path);
+    if (model == nullptr) {
+        return test_result("test_decode_batcher");
+    }
+
+    ThreadPool pool(3);
+    check_forward_batch(*model, nullptr);
+    check_forward_batch(*model, &pool);
+
+    check_batcher(*model, 1, 4, nullptr, -1);
+    check_batcher(*model, 4, 4, nullptr, -1);
+    check_batcher(*model, 5, 2, nullptr, -1);  // 会话多于 max_batch，分多批
+    check_batcher(*model, 4, 4, &pool, -1);
+    check_batcher(*model, 4, 4, nullptr, 1);   // 提前离开的会话不能让其余会话一直等待
+    check_batcher(*model, 3, 1, nullptr, -1);  // 未开启批处理，直接 forward
+
+    return test_result("test_decode_batcher");
+}
@@ -0,0 +1,222 @@
+/**
+ * test_quant_kernels.cpp
+ *
+ * Checks every quantized kernel set this CPU can run (avx2, avx512,
+ * dotprod, i8mm) against the scalar reference in kernels.cpp: dot_q8,
+ * dot_q4 and, where a set provides them, the 2x2 entries. Inputs are
+ * random and saturating (all +-127 activations, int4 nibbles 0 and 15)
+ * over group counts that do and do not fill the kernels' unrolling.
+ * Then matmat_quantized() over row slices, with the activations quantized
+ * once and shared by the threads of a pool, must match matmat() exactly.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "kernels.h"
+#include "kernels_quant.h"
+#include "platform.h"
+#include "test_check.h"
+#include "thread_pool.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+// 一行权重及其激活：int8 与 int4 两种权重共用激活
+struct Row {
+    std::vector<int8_t> q8;
+    std::vector<uint8_t> q4;
+    std::vector<float> ws;
+    std::vector<int8_t> x;
+    std::vector<float> xs;
+};
+
+Row make_row(int groups, std::mt19937& rng, bool saturate) {
+    const size_t n = static_cast<size_t>(groups) * kQuantGroup;
+    Row row;
+    row.q8.resize(n);
+    row.q4.resize(n / 2);
+    row.x.resize(n);
+    row.ws.resize(groups);
+    row.xs.resize(groups);
+    std::uniform_int_distribution<int> int8(-127, 127);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> sign(0, 1);
+    std::uniform_real_distribution<float> scale(1e-3f, 1e-1f);
+    for (size_t i = 0; i < n; ++i) {
+        row.q8[i] = static_cast<int8_t>(saturate ? (sign(rng) ? 127 : -127) : int8(rng));
+        row.x[i] = static_cast<int8_t>(saturate ? (sign(rng) ? 127 : -127) : int8(rng));
+    }
+    for (size_t i = 0; i < n / 2; ++i) {
+        // 饱和时每个 4 bit 取 0 或 15，即 -8 或 7
+        row.q4[i] = static_cast<uint8_t>(saturate ? (sign(rng) ? 0x0F : 0x00) | (sign(rng) ? 0xF0 : 0x00)
+                                                  : byte(rng));
+    }
+    for (int g = 0; g < groups; ++g) {
+        row.ws[g] = scale(rng);
+        row.xs[g] = scale(rng);
+    }
+    return row;
+}
+
+// 各组 |ws * xs * dot| 之和：浮点累加顺序不同带来的误差与它成比例
+double magnitude_q8(const Row& w, const Row& x, int groups) {
+    double sum = 0;
+    for (int g = 0; g < groups; ++g) {
+        int32_t acc = 0;
+        for (int i = 0; i < kQuantGroup; ++i) acc += w.q8[g * kQuantGroup + i] * x.x[g * kQuantGroup + i];
+        sum += std::fabs(static_cast<double>(acc) * w.ws[g] * x.xs[g]);
+    }
+    return sum;
+}
+
+double magnitude_q4(const Row& w, const Row& x, int groups) {
+    double sum = 0;
+    for (int g = 0; g < groups; ++g) {
+        const uint8_t* wg = w.q4.data() + g * (kQuantGroup / 2);
+        const int8_t* xg = x.x.data() + g * kQuantGroup;
+        int32_t acc = 0;
+        for (int i = 0; i < kQuantGroup / 2; ++i) {
+            acc += ((wg[i] & 0x0F) - 8) * xg[i] + ((wg[i] >> 4) - 8) * xg[i + kQuantGroup / 2];
+        }
+        sum += std::fabs(static_cast<double>(acc) * w.ws[g] * x.xs[g]);
+    }
+    return sum;
+}
+
+bool close(float got, float want, double magnitude) {
+    return std::fabs(static_cast<double>(got) - want) <= 1e-5 * magnitude + 1e-12;
+}
+
+void check_kernels(const QuantKernels& k, const QuantKernels& ref) {
+    static const int kGroups[] = {1, 2, 3, 4, 5, 8, 31, 64};
+    std::mt19937 rng(1234);
+    for (int groups : kGroups) {
+        for (int saturate = 0; saturate < 2; ++saturate) {
+            const Row w0 = make_row(groups, rng, saturate != 0);
+            const Row w1 = make_row(groups, rng, saturate != 0);
+            const Row x0 = make_row(groups, rng, saturate != 0);
+            const Row x1 = make_row(groups, rng, saturate != 0);
+
+            const float q8 = k.dot_q8(w0.q8.data(), w0.ws.data(), x0.x.data(), x0.xs.data(), groups);
+            const float q8_ref = ref.dot_q8(w0.q8.data(), w0.ws.data(), x0.x.data(), x0.xs.data(), groups);
+            CHECK_MSG(close(q8, q8_ref, magnitude_q8(w0, x0, groups)),
+                      "%s dot_q8 groups=%d saturate=%d: %.9g vs scalar %.9g", k.name, groups, saturate, q8, q8_ref);
+
+            const float q4 = k.dot_q4(w0.q4.data(), w0.ws.data(), x0.x.data(), x0.xs.data(), groups);
+            const float q4_ref = ref.dot_q4(w0.q4.data(), w0.ws.data(), x0.x.data(), x0.xs.data(), groups);
+            CHECK_MSG(close(q4, q4_ref, magnitude_q4(w0, x0, groups)),
+                      "%s dot_q4 groups=%d saturate=%d: %.9g vs scalar %.9g", k.name, groups, saturate, q4, q4_ref);
+
+            // 2x2：out = {w0·x0, w0·x1, w1·x0, w1·x1}
+            const Row* ws[4] = {&w0, &w0, &w1, &w1};
+            const Row* xs[4] = {&x0, &x1, &x0, &x1};
+            if (k.dot_q8_2x2 != nullptr) {
+                float out[4];
+                k.dot_q8_2x2(w0.q8.data(), w1.q8.data(), w0.ws.data(), w1.ws.data(), x0.x.data(), x1.x.data(),
+                             x0.xs.data(), x1.xs.data(), groups, out);
+                for (int i = 0; i < 4; ++i) {
+                    const float want = ref.dot_q8(ws[i]->q8.data(), ws[i]->ws.data(), xs[i]->x.data(),
+                                                  xs[i]->xs.data(), groups);
+                    CHECK_MSG(close(out[i], want, magnitude_q8(*ws[i], *xs[i], groups)),
+                              "%s dot_q8_2x2[%d] groups=%d saturate=%d: %.9g vs scalar %.9g", k.name, i, groups,
+                              saturate, out[i], want);
+                }
+            }
+            if (k.dot_q4_2x2 != nullptr) {
+                float out[4];
+                k.dot_q4_2x2(w0.q4.data(), w1.q4.data(), w0.ws.data(), w1.ws.data(), x0.x.data(), x1.x.data(),
+                             x0.xs.data(), x1.xs.data(), groups, out);
+                for (int i = 0; i < 4; ++i) {
+                    const float want = ref.dot_q4(ws[i]->q4.data(), ws[i]->ws.data(), xs[i]->x.data(),
+                                                  xs[i]->xs.data(), groups);
+                    CHECK_MSG(close(out[i], want, magnitude_q4(*ws[i], *xs[i], groups)),
+                              "%s dot_q4_2x2[%d] groups=%d saturate=%d: %.9g vs scalar %.9g", k.name, i, groups,
+                              saturate, out[i], want);
+                }
+            }
+        }
+    }
+}
+
+// 与 model.cpp 的 parallel_matmat 相同：激活量化一次，按权重行切给线程池
+void check_shared_activations(ThreadPool& pool) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    const int rows = 67, cols = 4 * kQuantGroup, ldx = cols + 5, ldy = rows + 3;
+    std::vector<float> weights(static_cast<size_t>(rows) * cols);
+    for (float& v : weights) v = uniform(rng);
+    for (WeightType type : {WeightType::kQ8, WeightType::kQ4}) {
+        std::vector<uint8_t> q;
+        std::vector<float> scales;
+        quantize_matrix(weights.data(), rows, cols, type, q, scales);
+        Matrix w;
+        w.q = q.data();
+        w.scales = scales.data();
+        w.type = type;
+        w.rows = rows;
+        w.cols = cols;
+        for (int n : {1, 2, 3, 8}) {
+            std::vector<float> x(static_cast<size_t>(n) * ldx);
+            for (float& v : x) v = uniform(rng);
+            std::vector<float> want(static_cast<size_t>(n) * ldy, 0.f), got(want.size(), 0.f);
+            matmat(w, x.data(), ldx, want.data(), ldy, n);
+
+            QuantizedActivations in;
+            quantize_activations(x.data(), ldx, n, cols, in);
+            pool.parallel_for(rows, [&](int begin, int end) {
+                matmat_quantized(row_slice(w, begin, end), in, got.data() + begin, ldy);
+            }, 5);
+            CHECK_MSG(got == want, "%s n=%d: row slices on shared activations differ from matmat",
+                      weight_type_name(type), n);
+
+            if (n == 1) {
+                // add = true 对应 matvec_add
+                std::vector<float> acc_want(rows, 0.5f), acc_got(rows, 0.5f);
+                matvec_add(w, x.data(), acc_want.data());
+                matmat_quantized(w, in, acc_got.data(), ldy, true);
+                CHECK_MSG(acc_got == acc_want, "%s: matmat_quantized(add) differs from matvec_add",
+                          weight_type_name(type));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    struct Candidate {
+        const char* name;
+        const QuantKernels* kernels;
+        uint32_t required;  // 需要的 CpuFeature 位
+    };
+    const Candidate candidates[] = {
+            {"avx2", quant_kernels_avx2(), kCpuAvx2},
+            {"avx512", quant_kernels_avx512(), kCpuAvx512},
+            {"dotprod", quant_kernels_dotprod(), kCpuDotProd},
+            {"i8mm", quant_kernels_i8mm(), kCpuDotProd | kCpuI8mm},
+    };
+    const QuantKernels& ref = *quant_kernels_scalar();
+    const uint32_t features = cpu_features();
+    int tested = 0;
+    for (const Candidate& c : candidates) {
+        if (c.kernels == nullptr) {
+            printf("%-8s not compiled for this target\n", c.name);
+        } else if ((features & c.required) != c.required) {
+            printf("%-8s not supported by this CPU (%s)\n", c.name, cpu_feature_names(features).c_str());
+        } else {
+            printf("%-8s checking\n", c.name);
+            check_kernels(*c.kernels, ref);
+            ++tested;
+        }
+    }
+    printf("selected kernel set: %s, %d set(s) checked\n", quant_kernel_name(), tested);
+
+    ThreadPool pool(3);
+    check_shared_activations(pool);
+    return test_result("test_quant_kernels");
+}
@@ -0,0 +1,252 @@
+/**
+ * test_response_stream.cpp
+ *
+ * Stress test of ResponseStream's single-writer / lock-free-reader protocol.
+ * One writer appends tokens whose bytes are a function of (epoch, offset)
+ * while reader threads copy random ranges and token records: every copy
+ * that passes validation must hold exactly the bytes written there, and
+ * every record run must be consecutive and match what was appended. Runs
+ * unbounded, at 20 KB and at the minimum capacity (overwritten copies must
+ * be rejected), checks that later generations reuse the arena's blocks,
+ * runs long generations at one to three blocks so the ring recycles the
+ * block a reader following the writer is copying from, and then alternates
+ * capacities so blocks are retired while readers are inside a copy. Built a
+ * second time with ThreadSanitizer (test_response_stream_tsan) without any
+ * suppressions: bytes and records are only accessed through atomics.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "response_stream.h"
+#include "test_check.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+constexpr int kReaders = 3;
+constexpr size_t kMaxCopy = 3000;
+constexpr int kMaxRecords = 64;
+
+// 回复中 offset 处的字节：与 epoch 有关，读到上一次回复的内容也能发现
+char byte_at(uint64_t epoch, uint64_t offset) {
+    return static_cast<char>((offset * 2654435761u >> 16) ^ (epoch * 37));
+}
+
+// 第 index 个 token 的长度与 id；偶尔有跨越整块的长 token
+size_t token_length(uint64_t index) {
+    return index % 2000 == 1999 ? ResponseStream::kBlockSize + 700 : 1 + static_cast<size_t>(index * 7 % 23);
+}
+
+int token_id(uint64_t index) {
+    return static_cast<int>(index * 31 % 65536);
+}
+
+// 写者：在当前回复后追加 count 个 token，返回回复的总字节数
+uint64_t append_tokens(ResponseStream& stream, uint64_t epoch, uint64_t* tokens, uint64_t end, int count) {
+    std::string bytes;
+    for (int i = 0; i < count; ++i) {
+        const uint64_t index = (*tokens)++;
+        bytes.resize(token_length(index));
+        for (size_t j = 0; j < bytes.size(); ++j) bytes[j] = byte_at(epoch, end + j);
+        stream.append(token_id(index), bytes);
+        end += bytes.size();
+        // 单核机器上让读者也能在写的过程中运行
+        if (index % 500 == 499) std::this_thread::yield();
+    }
+    return end;
+}
+
+bool bytes_match(const char* data, uint64_t epoch, uint64_t offset, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (data[i] != byte_at(epoch, offset + i)) return false;
+    }
+    return true;
+}
+
+// 一段记录必须与追加时一致且首尾相接；first 之前的记录不应返回
+bool records_match(const TokenRecord* records, int n, uint64_t first) {
+    for (int i = 0; i < n; ++i) {
+        const TokenRecord& r = records[i];
+        if (r.length != token_length(r.index) || r.token_id != token_id(r.index)) return false;
+        if (i == 0 && r.index < first) return false;
+        if (i > 0) {
+            const TokenRecord& prev = records[i - 1];
+            if (r.index != prev.index + 1 || r.offset != prev.offset + prev.length ||
+                r.timestamp_us < prev.timestamp_us) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+struct ReaderStats {
+    std::atomic<uint64_t> copies{0};
+    std::atomic<uint64_t> rejected{0};
+    std::atomic<uint64_t> wrong_bytes{0};
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> wrong_records{0};
+    std::atomic<int> running{0};
+};
+
+void reader(const ResponseStream& stream, const std::atomic<bool>& done, ReaderStats& stats, unsigned seed) {
+    stats.running.fetch_add(1);
+    std::mt19937 rng(seed);
+    std::vector<char> buffer(kMaxCopy);
+    TokenRecord records[kMaxRecords];
+    uint64_t next_token = 0;
+    while (!done.load(std::memory_order_acquire)) {
+        const ResponseStream::View v = stream.view();
+        if (v.end > v.begin) {
+            // 一半时间读任意位置，一半跟在写者后面读最新的字节（容量小时所在的块马上就会被回收）
+            const uint64_t span = std::min<uint64_t>(v.end - v.begin, (rng() & 1) ? v.end - v.begin : kMaxCopy);
+            const uint64_t offset = v.end - 1 - rng() % span;
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(v.end - offset, 1 + rng() % kMaxCopy));
+            if (stream.copy(v, offset, n, buffer.data())) {
+                stats.copies.fetch_add(1, std::memory_order_relaxed);
+                if (!bytes_match(buffer.data(), v.epoch, offset, n)) {
+                    stats.wrong_bytes.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                stats.rejected.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        // 一半时间跟着游标读，一半从头读（最旧的记录已被覆盖）
+        const uint64_t first = (rng() & 1) ? next_token : 0;
+        const int n = stream.read_tokens(first, records, 1 + static_cast<int>(rng() % kMaxRecords));
+        if (n < 0) {
+            next_token = 0;
+        } else if (n > 0) {
+            stats.records.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+            if (!records_match(records, n, first)) {
+                stats.wrong_records.fetch_add(1, std::memory_order_relaxed);
+            }
+            next_token = records[n - 1].index + 1;
+        }
+    }
+}
+
+// 单线程下的基本语义
+void check_basics() {
+    ResponseStream stream;
+    char buffer[64];
+    TokenRecord records[4];
+
+    stream.reset(0);
+    stream.append(7, "ab");
+    stream.append(8, "cde");
+    ResponseStream::View v = stream.view();
+    CHECK(v.begin == 0 && v.end == 5);
+    CHECK(stream.copy(v, 1, 3, buffer) && memcmp(buffer, "bcd", 3) == 0);
+    CHECK(stream.ends_with("de") && stream.ends_with("abcde") && !stream.ends_with("d") &&
+          !stream.ends_with("xabcde"));
+    CHECK(stream.read_tokens(0, records, 4) == 2);
+    CHECK(records[0].token_id == 7 && records[0].offset == 0 && records[0].length == 2);
+    CHECK(records[1].token_id == 8 && records[1].offset == 2 && records[1].length == 3);
+    CHECK(stream.read_tokens(2, records, 4) == 0);
+    CHECK(stream.read_tokens(3, records, 4) == -1);
+
+    // 新的回复开始后，旧的快照拷贝失败
+    stream.reset(0);
+    CHECK(!stream.copy(v, 0, 2, buffer));
+    CHECK(stream.view().end == 0 && stream.read_tokens(1, records, 4) == -1);
+
+    // 最小容量只保留最近的一块；更早的字节拷贝失败
+    stream.reset(1);
+    uint64_t tokens = 0;
+    const uint64_t epoch = stream.view().epoch;
+    const uint64_t end = append_tokens(stream, epoch, &tokens, 0, 4000);
+    v = stream.view();
+    CHECK(v.end == end && v.begin == end - ResponseStream::kBlockSize);
+    std::vector<char> block(ResponseStream::kBlockSize);
+    CHECK(stream.copy(v, v.begin, block.size(), block.data()) &&
+          bytes_match(block.data(), epoch, v.begin, block.size()));
+    CHECK(!stream.copy(v, v.begin - 1, 1, buffer));
+    CHECK(!stream.copy(v, 0, 1, buffer));
+
+    // 记录环只保留最近 kTokenRecords 个
+    const int n = stream.read_tokens(0, records, 4);
+    CHECK(n == 4 && records[0].index == tokens - ResponseStream::kTokenRecords &&
+          records_match(records, n, 0));
+}
+
+struct Generation {
+    size_t capacity;
+    int tokens;
+};
+
+void run_generations(ResponseStream& stream, const Generation* generations, int count, bool check_reuse,
+                     const char* what) {
+    std::atomic<bool> done{false};
+    ReaderStats stats;
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kReaders; ++i) {
+        readers.emplace_back(reader, std::cref(stream), std::cref(done), std::ref(stats), 100u + i);
+    }
+    // 读者都开始读之后再写，否则写者可能在读者启动前就已写完
+    while (stats.running.load() < kReaders) std::this_thread::yield();
+    uint64_t allocations = 0;
+    for (int g = 0; g < count; ++g) {
+        stream.reset(generations[g].capacity);
+        const uint64_t epoch = stream.view().epoch;
+        uint64_t tokens = 0;
+        const uint64_t end = append_tokens(stream, epoch, &tokens, 0, generations[g].tokens);
+        const ResponseStream::View v = stream.view();
+        CHECK_MSG(v.epoch == epoch && v.end == end, "%s generation %d: view %llu..%llu, wrote %llu", what, g,
+                  static_cast<unsigned long long>(v.begin), static_cast<unsigned long long>(v.end),
+                  static_cast<unsigned long long>(end));
+        // 第一次之后不再分配新的块
+        if (check_reuse && g > 0) {
+            CHECK_MSG(stream.block_allocations() == allocations, "%s generation %d allocated %llu new block(s)",
+                      what, g, static_cast<unsigned long long>(stream.block_allocations() - allocations));
+        }
+        allocations = stream.block_allocations();
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread& t : readers) t.join();
+
+    printf("  %s: %llu copies, %llu rejected, %llu records\n", what,
+           static_cast<unsigned long long>(stats.copies.load()),
+           static_cast<unsigned long long>(stats.rejected.load()),
+           static_cast<unsigned long long>(stats.records.load()));
+    CHECK_MSG(stats.wrong_bytes.load() == 0, "%s: %llu validated copies held wrong bytes", what,
+              static_cast<unsigned long long>(stats.wrong_bytes.load()));
+    CHECK_MSG(stats.wrong_records.load() == 0, "%s: %llu record runs did not match", what,
+              static_cast<unsigned long long>(stats.wrong_records.load()));
+    CHECK_MSG(stats.copies.load() > 0 && stats.records.load() > 0, "%s: readers never read anything", what);
+}
+
+} // namespace
+
+int main() {
+    check_basics();
+
+    ResponseStream stream;
+    // 不限容量、20 KB、最小容量各两次；第一次之后全部复用已分配的块
+    const Generation reuse[] = {
+            {0, 8000}, {0, 8000}, {20 * 1024, 8000}, {20 * 1024, 8000}, {1, 8000}, {1, 8000},
+    };
+    run_generations(stream, reuse, static_cast<int>(sizeof(reuse) / sizeof(reuse[0])), true, "reuse");
+
+    // 小容量下长时间生成：环形的块不断被回收，读者的拷贝与写者覆盖同一块
+    const size_t block = ResponseStream::kBlockSize;
+    const Generation small[] = {{1, 30000}, {block + 1, 30000}, {2 * block, 30000}};
+    run_generations(stream, small, static_cast<int>(sizeof(small) / sizeof(small[0])), false, "small capacity");
+
+    // 容量反复变大变小：缩小时摘下的块要等读者离开才释放
+    std::vector<Generation> churn;
+    for (int i = 0; i < 60; ++i) {
+        churn.push_back({i % 2 == 0 ? 0 : static_cast<size_t>(1), 2000});
+    }
+    run_generations(stream, churn.data(), static_cast<int>(churn.size()), false, "capacity churn");
+    return test_result("test_response_stream");
+}
@@ -0,0 +1,266 @@
+/**
+ * test_sampler.cpp
+ *
+ * Checks Sampler::sample() against a reference that sorts the whole
+ * vocabulary: for top-k, top-p and both, on the radix-select path (vocab
+ * sizes below, at and above the 2048 buckets) and on the sample_fixed<128>
+ * path, every sampled token must be in the reference candidate set and the
+ * sampled frequencies must match the candidates' renormalized
+ * probabilities. Covers ties at the cut-off (any of the tied tokens may be
+ * kept, but exactly as many as the reference keeps), all-equal logits,
+ * masked (-inf) tokens, penalties, and greedy decoding.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "sampler.h"
+#include "test_check.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+constexpr int kSamples = 8000;
+
+// 概率相对差在这个范围内视为并列（并列的 logit 在 SIMD 与标量 exp 中可能差 1-2 ulp）
+constexpr double kTieTolerance = 1e-5;
+
+struct Reference {
+    std::vector<int> order;     // 按概率从大到小
+    std::vector<double> probs;  // 未归一化，按 token 下标
+    int keep = 0;               // order 中保留的前 keep 个
+};
+
+std::vector<float> penalized_logits(const std::vector<float>& logits, const SamplerParams& params,
+                                    const TokenOccurrences* occurrences) {
+    std::vector<float> x = logits;
+    if (occurrences != nullptr) {
+        for (const auto& e : occurrences->entries()) {
+            x[e.first] -= params.presence_penalty + params.frequency_penalty * e.second;
+        }
+    }
+    return x;
+}
+
+// 全排序的参考实现
+Reference reference(const std::vector<float>& logits, const SamplerParams& params,
+                    const TokenOccurrences* occurrences) {
+    const std::vector<float> x = penalized_logits(logits, params, occurrences);
+    const int n = static_cast<int>(x.size());
+    const double max_logit = *std::max_element(x.begin(), x.end());
+    Reference ref;
+    ref.probs.resize(n);
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        ref.probs[i] = std::exp((static_cast<double>(x[i]) - max_logit) / params.temperature);
+        sum += ref.probs[i];
+    }
+    ref.order.resize(n);
+    std::iota(ref.order.begin(), ref.order.end(), 0);
+    std::stable_sort(ref.order.begin(), ref.order.end(), [&](int a, int b) { return ref.probs[a] > ref.probs[b]; });
+
+    const int k = params.top_k > 0 && params.top_k < n ? params.top_k : n;
+    const double threshold = params.top_p > 0.f && params.top_p < 1.f ? params.top_p * sum : INFINITY;
+    ref.keep = n;
+    double cumulative = 0.0;
+    for (int i = 0; i < n; ++i) {
+        if (i >= k) {
+            ref.keep = i;
+            break;
+        }
+        cumulative += ref.probs[ref.order[i]];
+        if (cumulative >= threshold) {
+            ref.keep = i + 1;
+            break;
+        }
+    }
+    return ref;
+}
+
+// 让截断点落在排序后第 keep - 1 与第 keep 个 token 之间的中点，避免浮点求和顺序影响结果
+float top_p_keeping(const std::vector<float>& logits, const SamplerParams& params, int keep) {
+    SamplerParams all = params;
+    all.top_k = 0;
+    all.top_p = 1.f;
+    const Reference ref = reference(logits, all, nullptr);
+    double sum = 0.0;
+    for (double p : ref.probs) sum += p;
+    double cumulative = 0.0;
+    for (int i = 0; i < keep - 1; ++i) cumulative += ref.probs[ref.order[i]];
+    return static_cast<float>((cumulative + 0.5 * ref.probs[ref.order[keep - 1]]) / sum);
+}
+
+bool within(double observed, double expected, double q) {
+    return std::fabs(observed - expected) <= 5.0 * std::sqrt(expected * (1.0 - q)) + 2.0;
+}
+
+void check_case(const char* what, const std::vector<float>& logits, const SamplerParams& params,
+                const TokenOccurrences* occurrences = nullptr) {
+    const int n = static_cast<int>(logits.size());
+    const Reference ref = reference(logits, params, occurrences);
+    const double cutoff = ref.probs[ref.order[ref.keep - 1]];
+    auto tied = [&](int t) { return std::fabs(ref.probs[t] - cutoff) <= cutoff * kTieTolerance; };
+    auto above = [&](int t) { return ref.probs[t] > cutoff * (1.0 + kTieTolerance); };
+
+    int n_above = 0;
+    int n_tied = 0;
+    double above_sum = 0.0;
+    for (int t = 0; t < n; ++t) {
+        if (above(t)) {
+            ++n_above;
+            above_sum += ref.probs[t];
+        } else if (tied(t)) {
+            ++n_tied;
+        }
+    }
+    const int kept_tied = ref.keep - n_above;
+    CHECK_MSG(kept_tied >= 1 && kept_tied <= n_tied, "%s: bad reference (%d of %d tied kept)", what, kept_tied,
+              n_tied);
+    const double kept_sum = above_sum + kept_tied * cutoff;
+
+    Sampler sampler(7);
+    std::vector<int> hits(n, 0);
+    for (int s = 0; s < kSamples; ++s) {
+        const int t = sampler.sample(logits.data(), n, params, occurrences);
+        if (t < 0 || t >= n) {
+            CHECK_MSG(false, "%s: sampled token %d out of range", what, t);
+            return;
+        }
+        ++hits[t];
+    }
+
+    int tied_seen = 0;
+    int tied_hits = 0;
+    for (int t = 0; t < n; ++t) {
+        if (above(t)) {
+            const double q = ref.probs[t] / kept_sum;
+            CHECK_MSG(within(hits[t], kSamples * q, q), "%s: token %d sampled %d times, expected %.1f", what, t,
+                      hits[t], kSamples * q);
+        } else if (tied(t)) {
+            tied_seen += hits[t] > 0;
+            tied_hits += hits[t];
+        } else {
+            CHECK_MSG(hits[t] == 0, "%s: token %d outside the top-k/top-p set sampled %d times", what, t, hits[t]);
+        }
+    }
+    // 并列的 token 可以任选，但个数必须与参考一致
+    CHECK_MSG(tied_seen <= kept_tied, "%s: %d tied tokens sampled, reference keeps %d", what, tied_seen, kept_tied);
+    const double q = kept_tied * cutoff / kept_sum;
+    CHECK_MSG(within(tied_hits, kSamples * q, q), "%s: tied tokens sampled %d times, expected %.1f", what, tied_hits,
+              kSamples * q);
+    if (kSamples * cutoff / kept_sum >= 50.0) {
+        CHECK_MSG(tied_seen == kept_tied, "%s: %d tied tokens sampled, reference keeps %d", what, tied_seen,
+                  kept_tied);
+    }
+}
+
+// 前 64 个 token（打乱位置）的 logit 以 1/16 的间隔从 0 降到 -4，其余远低于它们；
+// ties 个 token 与第 tie_at 名并列
+std::vector<float> make_logits(int n, uint32_t seed, int ties = 0, int tie_at = 0) {
+    std::mt19937 rng(seed);
+    std::vector<int> perm(n);
+    std::iota(perm.begin(), perm.end(), 0);
+    std::shuffle(perm.begin(), perm.end(), rng);
+    std::uniform_real_distribution<float> low(-20.f, -12.f);
+    std::vector<float> logits(n);
+    const int top = std::min(n, 64);
+    for (int i = 0; i < n; ++i) {
+        logits[perm[i]] = i < top ? -0.0625f * static_cast<float>(i) : low(rng);
+    }
+    for (int j = 1; j <= ties && tie_at + j < n; ++j) logits[perm[tie_at + j]] = logits[perm[tie_at]];
+    return logits;
+}
+
+void check_vocab(int n) {
+    char what[96];
+    SamplerParams params;
+    params.top_p = 1.f;
+
+    for (int k : {2, 5, 17, 40}) {
+        params.top_k = k;
+        params.temperature = 1.f;
+        snprintf(what, sizeof(what), "n=%d top_k=%d", n, k);
+        check_case(what, make_logits(n, n + k), params);
+    }
+    params.top_k = 0;
+    for (int keep : {1, 3, 12, 30}) {
+        const std::vector<float> logits = make_logits(n, 2 * n + keep);
+        params.temperature = 0.8f;
+        params.top_p = top_p_keeping(logits, params, std::min(keep, n));
+        snprintf(what, sizeof(what), "n=%d top_p keeping %d", n, std::min(keep, n));
+        check_case(what, logits, params);
+    }
+    {
+        // top-k 与 top-p 同时：先到的截断生效
+        const std::vector<float> logits = make_logits(n, 3 * n);
+        params.temperature = 1.3f;
+        params.top_p = top_p_keeping(logits, params, std::min(20, n));
+        params.top_k = 8;
+        snprintf(what, sizeof(what), "n=%d top_k=8 before top_p", n);
+        check_case(what, logits, params);
+        params.top_k = 30;
+        snprintf(what, sizeof(what), "n=%d top_p before top_k=30", n);
+        check_case(what, logits, params);
+    }
+
+    // 截断点上的并列：第 5 名与其后 4 个并列，只保留其中 top_k 要求的个数
+    params.temperature = 1.f;
+    params.top_p = 1.f;
+    for (int k : {5, 6, 9}) {
+        params.top_k = k;
+        snprintf(what, sizeof(what), "n=%d top_k=%d with ties at the cut-off", n, k);
+        check_case(what, make_logits(n, 4 * n + k, 4, 4), params);
+    }
+    // 全部并列
+    params.top_k = 10;
+    snprintf(what, sizeof(what), "n=%d all logits equal", n);
+    check_case(what, std::vector<float>(n, 0.5f), params);
+    // 被屏蔽的 token 不截断时也不能采到
+    params.top_k = 0;
+    std::vector<float> masked = make_logits(n, 5 * n);
+    for (int i = 0; i < n; i += 2) masked[i] = -INFINITY;
+    snprintf(what, sizeof(what), "n=%d masked tokens", n);
+    check_case(what, masked, params);
+
+    // 惩罚：被惩罚的 token 按惩罚后的 logit 参与截断
+    {
+        const std::vector<float> logits = make_logits(n, 6 * n);
+        const int best = static_cast<int>(std::max_element(logits.begin(), logits.end()) - logits.begin());
+        TokenOccurrences occurrences;
+        occurrences.reserve(n);
+        occurrences.add(best, 1.f);
+        occurrences.add(best, 1.f);
+        occurrences.add((best + 1) % n, 1.f);
+        params.presence_penalty = 0.5f;
+        params.frequency_penalty = 0.25f;
+        params.top_k = 6;
+        snprintf(what, sizeof(what), "n=%d penalties", n);
+        check_case(what, logits, params, &occurrences);
+
+        // 贪心：惩罚后的最大值；并列时取下标最小的
+        params.temperature = 0.f;
+        Sampler sampler;
+        const std::vector<float> x = penalized_logits(logits, params, &occurrences);
+        const int want = static_cast<int>(std::max_element(x.begin(), x.end()) - x.begin());
+        CHECK_MSG(sampler.sample(logits.data(), n, params, &occurrences) == want, "n=%d greedy with penalties", n);
+        std::vector<float> flat(n, 1.f);
+        flat[n - 1] = 2.f;
+        flat[n / 2] = 2.f;
+        CHECK_MSG(sampler.sample(flat.data(), n, params) == n / 2, "n=%d greedy tie", n);
+    }
+}
+
+} // namespace
+
+int main() {
+    // 128 走 sample_fixed<128>，其余走基数选择（2048 个桶：词表小于、等于与大于桶数）
+    for (int n : {kByteVocabSize, 7, 100, 1000, 2047, 2048, 5000}) {
+        check_vocab(n);
+    }
+    return test_result("test_sampler");
+}
@@ -0,0 +1,235 @@
+/**
+ * test_speculative.cpp
+ *
+ * Greedy generation on a Runtime with a draft model (set_draft_model) must
+ * give exactly the text of plain decoding, over two turns so that the state
+ * left behind by the verify-and-rollback loop is checked too. Drafts:
+ * the main model itself (every draft accepted), the main model with int4
+ * weights (some accepted, so both states are rolled back to checkpoints in
+ * the middle of a draft; the counts must match a simulation that rebuilds
+ * the draft state from the whole history) and a model that always proposes
+ * a token greedy decoding never picks (nothing accepted, rolled back after
+ * the first position every time). Also max_tokens shorter than a draft and
+ * the draft lengths 1 and kMaxDraftTokens.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "runtime.h"
+#include "test_check.h"
+#include "tiny_model.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+const char* const kModelPath = "test_speculative_model.st";
+const char* const kDraftPath = "test_speculative_draft.st";
+const char* const kVocabPath = "test_speculative_vocab.txt";
+
+const char* const kTurns[] = {"Tell me a story.", "And then?"};
+
+struct Draft {
+    const char* path = nullptr;  // nullptr 表示不用投机解码
+    const char* backend = "cpu";
+    int tokens = 4;
+};
+
+struct Run {
+    std::vector<std::string> replies;
+    std::vector<SpeculativeStats> stats;
+};
+
+Run generate(const Draft& draft, int max_tokens, const char* extra = nullptr) {
+    Run run;
+    Runtime runtime;
+    CHECK(runtime.load_tokenizer(kVocabPath) == kSuccess);
+    const int model_id = runtime.load_model(kModelPath, "cpu", extra);
+    CHECK(model_id >= 0);
+    if (draft.path != nullptr) {
+        // 草稿模型后加载，成为活动模型；set_draft_model 再把主模型换回来
+        const int draft_id = runtime.load_model(draft.path, draft.backend, extra);
+        CHECK(draft_id >= 0);
+        CHECK(runtime.set_draft_model(draft_id, draft.tokens) == kSuccess);
+    }
+    SamplerParams params;
+    params.temperature = 0.f;
+    runtime.set_sampler_params(params);
+    for (const char* turn : kTurns) {
+        std::string reply;
+        CHECK(runtime.gen_completion(turn, max_tokens, &reply) == kSuccess);
+        run.replies.push_back(reply);
+        run.stats.push_back(runtime.speculative_stats());
+    }
+    return run;
+}
+
+void check_same(const Run& expected, const Run& actual, const char* what) {
+    for (size_t i = 0; i < expected.replies.size(); ++i) {
+        CHECK_MSG(actual.replies[i] == expected.replies[i], "%s: turn %zu gives \"%s\", expected \"%s\"", what, i,
+                  actual.replies[i].c_str(), expected.replies[i].c_str());
+    }
+}
+
+// 贪心解码从不生成的 token；词表每个字节一个 token，id 等于字节值
+int unused_token(const Run& run, int vocab) {
+    std::vector<bool> used(static_cast<size_t>(vocab), false);
+    for (const std::string& reply : run.replies) {
+        for (unsigned char c : reply) used[c] = true;
+    }
+    for (int t = 1; t < vocab; ++t) {
+        if (!used[static_cast<size_t>(t)]) return t;
+    }
+    return -1;
+}
+
+// 草稿模型从零状态读完 history 后贪心提出的至多 k 个 token（遇到结束符 0 为止）
+std::vector<int> greedy_drafts(const Model& draft, const std::vector<int>& history, int k) {
+    const ModelConfig& cfg = draft.config();
+    State state;
+    state.init(cfg);
+    ForwardScratch scratch;
+    scratch.init(cfg);
+    std::vector<float> logits(static_cast<size_t>(cfg.vocab_size));
+    for (size_t i = 0; i < history.size(); ++i) {
+        draft.forward(history[i], state, scratch, i + 1 == history.size() ? logits.data() : nullptr);
+    }
+    std::vector<int> drafts;
+    while (static_cast<int>(drafts.size()) < k) {
+        const int d = static_cast<int>(std::max_element(logits.begin(), logits.end()) - logits.begin());
+        if (d == 0) break;
+        drafts.push_back(d);
+        draft.forward(d, state, scratch, logits.data());
+    }
+    return drafts;
+}
+
+/**
+ * Speculative stats the replies of `run` must have produced: each pass the
+ * draft proposes its greedy continuation of the whole history so far, and
+ * the leading drafts that equal the emitted tokens are accepted. Rebuilds
+ * the draft state from scratch every pass, so a draft state that the
+ * session failed to roll back shows up as different counts.
+ */
+std::vector<SpeculativeStats> expected_stats(const Model& draft, const Run& run, int k_max, int max_tokens) {
+    std::vector<SpeculativeStats> stats;
+    std::vector<int> history;
+    for (size_t t = 0; t < run.replies.size(); ++t) {
+        for (unsigned char c : std::string(kTurns[t])) history.push_back(c);
+        const std::string& reply = run.replies[t];
+        SpeculativeStats s;
+        int decoded = 0;
+        history.push_back(static_cast<unsigned char>(reply[0]));
+        ++decoded;
+        while (decoded < max_tokens) {
+            const std::vector<int> drafts = greedy_drafts(draft, history, std::min(k_max, max_tokens - decoded - 1));
+            ++s.passes;
+            s.drafted += drafts.size();
+            for (size_t j = 0;; ++j) {
+                const int id = static_cast<unsigned char>(reply[static_cast<size_t>(decoded)]);
+                const bool match = j < drafts.size() && id == drafts[j];
+                s.accepted += match;
+                history.push_back(id);
+                if (++decoded == max_tokens || !match) break;
+            }
+        }
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+} // namespace
+
+int main() {
+    // 加载与切换模型会打日志，属于预期
+    set_log_level(kLogError + 1);
+    const TinyModelShape shape;
+    CHECK(write_tiny_model(kModelPath, shape, 31));
+    CHECK(write_byte_vocab(kVocabPath, shape.vocab));
+
+    const int kMaxTokens = 48;
+    const Run reference = generate(Draft(), kMaxTokens);
+    for (const std::string& reply : reference.replies) {
+        // 回复太短（很早就采到结束符）说明模型不合适，测不到多轮验证
+        CHECK_MSG(reply.size() == static_cast<size_t>(kMaxTokens), "reference reply has only %zu bytes",
+                  reply.size());
+    }
+
+    // 全部接受：草稿就是主模型本身
+    for (int k : {1, 4, kMaxDraftTokens}) {
+        Draft draft;
+        draft.path = kModelPath;
+        draft.tokens = k;
+        const Run run = generate(draft, kMaxTokens);
+        char what[64];
+        snprintf(what, sizeof(what), "same-model draft of %d", k);
+        check_same(reference, run, what);
+        for (const SpeculativeStats& s : run.stats) {
+            CHECK_MSG(s.drafted > 0 && s.accepted == s.drafted, "%s: accepted %llu of %llu", what,
+                      static_cast<unsigned long long>(s.accepted), static_cast<unsigned long long>(s.drafted));
+        }
+    }
+
+    // 部分接受：同一权重量化成 int4，大多数位置与主模型一致。逐 token prefill、单线程，
+    // 草稿的每次前向都与 expected_stats 中的逐位相同，接受的个数必须完全一致
+    {
+        const char* extra = "prefill_chunk=1,threads=1";
+        const Run exact_reference = generate(Draft(), kMaxTokens, extra);
+        Draft draft;
+        draft.path = kModelPath;
+        draft.backend = "cpu-int4";
+        const Run run = generate(draft, kMaxTokens, extra);
+        check_same(exact_reference, run, "int4 draft");
+        std::unique_ptr<Model> model = Model::load(kModelPath);
+        CHECK(model != nullptr && model->quantize(WeightType::kQ4));
+        if (model != nullptr) {
+            const std::vector<SpeculativeStats> expected = expected_stats(*model, run, draft.tokens, kMaxTokens);
+            for (size_t i = 0; i < expected.size(); ++i) {
+                const SpeculativeStats& s = run.stats[i];
+                const SpeculativeStats& e = expected[i];
+                CHECK_MSG(s.passes == e.passes && s.drafted == e.drafted && s.accepted == e.accepted,
+                          "int4 draft: turn %zu passes/drafted/accepted %llu/%llu/%llu, expected %llu/%llu/%llu", i,
+                          static_cast<unsigned long long>(s.passes), static_cast<unsigned long long>(s.drafted),
+                          static_cast<unsigned long long>(s.accepted), static_cast<unsigned long long>(e.passes),
+                          static_cast<unsigned long long>(e.drafted), static_cast<unsigned long long>(e.accepted));
+                CHECK_MSG(s.accepted > 0 && s.accepted < s.drafted, "int4 draft: turn %zu accepted %llu of %llu", i,
+                          static_cast<unsigned long long>(s.accepted), static_cast<unsigned long long>(s.drafted));
+            }
+        }
+    }
+
+    // 全不接受：草稿总是提出贪心解码不会选的 token
+    {
+        const int token = unused_token(reference, shape.vocab);
+        CHECK(token > 0);
+        CHECK(write_tiny_model(kDraftPath, shape, 4, token));
+        Draft draft;
+        draft.path = kDraftPath;
+        const Run run = generate(draft, kMaxTokens);
+        check_same(reference, run, "rejected draft");
+        for (const SpeculativeStats& s : run.stats) {
+            CHECK_MSG(s.drafted > 0 && s.accepted == 0, "rejected draft: accepted %llu of %llu",
+                      static_cast<unsigned long long>(s.accepted), static_cast<unsigned long long>(s.drafted));
+        }
+    }
+
+    // max_tokens 小于草稿长度：最后一轮的草稿被截短，停在同一位置
+    for (int max_tokens : {1, 2, 3, 5}) {
+        Draft draft;
+        draft.path = kModelPath;
+        const Run short_reference = generate(Draft(), max_tokens);
+        char what[64];
+        snprintf(what, sizeof(what), "max_tokens=%d", max_tokens);
+        check_same(short_reference, generate(draft, max_tokens), what);
+    }
+
+    std::remove(kModelPath);
+    std::remove(kDraftPath);
+    std::remove(kVocabPath);
+    return test_result("test_speculative");
+}
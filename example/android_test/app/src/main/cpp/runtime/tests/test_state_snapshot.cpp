@@ -0,0 +1,195 @@
+/**
+ * test_state_snapshot.cpp
+ *
+ * Round trip of the state snapshot codecs: fp32 must decode bit-exactly,
+ * fp16 within half a unit in the last place of fp16, int8 within half a
+ * quantization step of each group (including an all-zero group and a short
+ * tail group). Snapshots of the same state must be byte-identical. Truncated
+ * snapshots and snapshots with a corrupted header field must be rejected
+ * without touching the destination state.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "state_snapshot.h"
+#include "test_check.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+constexpr size_t kInt8Group = 64;  // 与 state_snapshot.cpp 一致，头部 offset 12 记录该值
+
+ModelConfig make_config() {
+    ModelConfig cfg;
+    cfg.n_layer = 2;
+    cfg.n_embd = 40;  // n_layer * n_embd = 80：一整组加一个不满的尾组
+    cfg.n_ffn = 64;
+    cfg.n_head = 2;
+    cfg.head_size = 20;
+    cfg.vocab_size = 100;
+    return cfg;
+}
+
+// 每组的幅度不同，第二组全为 0（缩放系数为 0）
+void fill(std::vector<float>& v, std::mt19937& rng) {
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    for (size_t i = 0; i < v.size(); ++i) {
+        const size_t group = i / kInt8Group;
+        const float magnitude = group == 1 ? 0.f : std::ldexp(1.f, static_cast<int>(group % 9) - 4);
+        v[i] = uniform(rng) * magnitude;
+    }
+}
+
+State make_state(const ModelConfig& cfg, uint32_t seed) {
+    std::mt19937 rng(seed);
+    State state;
+    state.init(cfg);
+    fill(state.att_x, rng);
+    fill(state.att_kv, rng);
+    fill(state.ffn_x, rng);
+    return state;
+}
+
+// 每个值允许的误差
+float tolerance(StateCodec codec, const std::vector<float>& v, size_t i) {
+    switch (codec) {
+        case StateCodec::kF32:
+            return 0.f;
+        case StateCodec::kF16:
+            // 10 位尾数：相对误差不超过 2^-11；很小的值落在 fp16 次正规数，绝对误差 2^-25
+            return std::fabs(v[i]) * std::ldexp(1.f, -11) + std::ldexp(1.f, -25);
+        case StateCodec::kInt8: {
+            const size_t begin = i / kInt8Group * kInt8Group;
+            const size_t end = std::min(begin + kInt8Group, v.size());
+            float amax = 0.f;
+            for (size_t j = begin; j < end; ++j) amax = std::max(amax, std::fabs(v[j]));
+            return amax / 127.f * 0.5f * 1.001f;
+        }
+    }
+    return 0.f;
+}
+
+void check_close(StateCodec codec, const char* name, const std::vector<float>& expected,
+                 const std::vector<float>& actual) {
+    CHECK_MSG(actual.size() == expected.size(), "codec %u %s: %zu values, expected %zu",
+              static_cast<unsigned>(codec), name, actual.size(), expected.size());
+    if (actual.size() != expected.size()) return;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        const float err = std::fabs(actual[i] - expected[i]);
+        if (!(err <= tolerance(codec, expected, i))) {
+            CHECK_MSG(false, "codec %u %s[%zu]: %g decoded as %g", static_cast<unsigned>(codec), name, i,
+                      expected[i], actual[i]);
+            return;
+        }
+    }
+}
+
+bool same_state(const State& a, const State& b) {
+    return a.att_x == b.att_x && a.att_kv == b.att_kv && a.ffn_x == b.ffn_x;
+}
+
+void check_round_trip(const ModelConfig& cfg, StateCodec codec) {
+    const State state = make_state(cfg, 1);
+    const size_t size = state_snapshot_size(cfg, codec);
+    std::vector<uint8_t> buffer(size + 16);
+    StateSnapshotInfo info;
+    info.pending_token = 42;
+    info.fresh = false;
+
+    CHECK(write_state_snapshot(cfg, state, info, codec, buffer.data(), size - 1) == 0);
+    CHECK(write_state_snapshot(cfg, state, info, codec, buffer.data(), size) == size);
+    std::vector<uint8_t> again(size, 0xAA);
+    CHECK(write_state_snapshot(cfg, state, info, codec, again.data(), size) == size);
+    CHECK_MSG(memcmp(buffer.data(), again.data(), size) == 0, "codec %u: snapshots of one state differ",
+              static_cast<unsigned>(codec));
+
+    State decoded;
+    StateSnapshotInfo decoded_info;
+    CHECK(read_state_snapshot(buffer.data(), size, cfg, decoded, &decoded_info));
+    CHECK(decoded_info.pending_token == 42);
+    CHECK(!decoded_info.fresh);
+    check_close(codec, "att_x", state.att_x, decoded.att_x);
+    check_close(codec, "att_kv", state.att_kv, decoded.att_kv);
+    check_close(codec, "ffn_x", state.ffn_x, decoded.ffn_x);
+
+    // 多余的尾部字节不影响解码
+    State longer;
+    CHECK(read_state_snapshot(buffer.data(), buffer.size(), cfg, longer, nullptr));
+    CHECK(same_state(longer, decoded));
+}
+
+// 解码失败时目标状态必须保持原样
+void check_rejected(const uint8_t* data, size_t size, const ModelConfig& cfg, const char* what) {
+    State target = make_state(cfg, 9);
+    const State before = target;
+    StateSnapshotInfo info;
+    info.pending_token = 7;
+    CHECK_MSG(!read_state_snapshot(data, size, cfg, target, &info), "%s was accepted", what);
+    CHECK_MSG(same_state(target, before), "%s changed the state", what);
+    CHECK_MSG(info.pending_token == 7, "%s changed the info", what);
+}
+
+void check_invalid(const ModelConfig& cfg, StateCodec codec) {
+    const State state = make_state(cfg, 2);
+    const size_t size = state_snapshot_size(cfg, codec);
+    std::vector<uint8_t> good(size);
+    CHECK(write_state_snapshot(cfg, state, StateSnapshotInfo(), codec, good.data(), size) == size);
+
+    check_rejected(nullptr, size, cfg, "null data");
+    for (size_t cut : {size_t(0), size_t(4), size_t(63), size_t(64), size / 2, size - 1}) {
+        check_rejected(good.data(), cut, cfg, "truncated snapshot");
+    }
+
+    struct Corruption {
+        size_t offset;
+        uint32_t value;
+        const char* what;
+    };
+    const Corruption corruptions[] = {
+            {0, 0x54535752u ^ 0xFFu, "bad magic"},
+            {4, 0, "version 0"},
+            {4, kStateSnapshotVersion + 1, "future version"},
+            {8, 3, "unknown codec"},
+            {12, kInt8Group / 2, "other int8 group size"},
+            {16, static_cast<uint32_t>(cfg.n_layer + 1), "other n_layer"},
+            {20, static_cast<uint32_t>(cfg.n_embd - 1), "other n_embd"},
+            {24, static_cast<uint32_t>(cfg.n_head * 2), "other n_head"},
+            {28, static_cast<uint32_t>(cfg.head_size / 2), "other head_size"},
+            {32, static_cast<uint32_t>(cfg.vocab_size), "pending token out of range"},
+            {32, static_cast<uint32_t>(-2), "negative pending token"},
+            {40, static_cast<uint32_t>(size + 64), "wrong total size"},
+    };
+    for (const Corruption& c : corruptions) {
+        std::vector<uint8_t> bad = good;
+        store_u32(bad.data() + c.offset, c.value);
+        check_rejected(bad.data(), bad.size(), cfg, c.what);
+    }
+
+    // 另一个模型的快照
+    ModelConfig other = cfg;
+    other.n_embd = 48;
+    check_rejected(good.data(), good.size(), other, "snapshot of another model");
+}
+
+} // namespace
+
+int main() {
+    // 拒绝时的错误日志是预期的
+    set_log_level(kLogError + 1);
+    const ModelConfig cfg = make_config();
+    for (StateCodec codec : {StateCodec::kF32, StateCodec::kF16, StateCodec::kInt8}) {
+        check_round_trip(cfg, codec);
+        check_invalid(cfg, codec);
+    }
+    CHECK(!is_valid_state_codec(-1));
+    CHECK(!is_valid_state_codec(3));
+    return test_result("test_state_snapshot");
+}
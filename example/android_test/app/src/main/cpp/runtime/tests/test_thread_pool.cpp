@@ -0,0 +1,152 @@
+/**
+ * test_thread_pool.cpp
+ *
+ * Stress test of the work-stealing pool's job, steal and park protocol.
+ * Every job must cover [0, n) exactly once and fn must have finished on
+ * every index before parallel_for returns, across pool sizes, grains and
+ * ranges smaller than the pool; with uneven work (stealing), with pauses
+ * longer than the spin window (workers park and are woken), with several
+ * threads calling into one pool at once, and with pools destroyed while
+ * their workers spin or sleep. Built a second time with ThreadSanitizer
+ * (test_thread_pool_tsan) to catch races the counts cannot.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "test_check.h"
+#include "thread_pool.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+// 每个下标的执行次数；全部为 1 才算通过
+struct Coverage {
+    explicit Coverage(int n) : hits(new std::atomic<int>[n > 0 ? n : 1]), n(n) {
+        for (int i = 0; i < n; ++i) hits[i].store(0, std::memory_order_relaxed);
+    }
+
+    bool exactly_once() const {
+        for (int i = 0; i < n; ++i) {
+            if (hits[i].load(std::memory_order_relaxed) != 1) return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<std::atomic<int>[]> hits;
+    int n;
+};
+
+void spin_for(std::chrono::microseconds d) {
+    const auto until = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+// 普通的（非原子）写入：parallel_for 返回之后读到的必须是全部写完的结果
+void check_ranges(ThreadPool& pool, const char* what) {
+    static const int kSizes[] = {0, 1, 2, 3, 7, 8, 31, 64, 100, 1000, 4097};
+    static const int kGrains[] = {0, 1, 3, 16};
+    for (int n : kSizes) {
+        for (int grain : kGrains) {
+            Coverage coverage(n);
+            std::vector<int> values(n > 0 ? n : 1, -1);
+            pool.parallel_for(n, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    coverage.hits[i].fetch_add(1, std::memory_order_relaxed);
+                    values[i] = i * 3;
+                }
+            }, grain);
+            bool written = true;
+            for (int i = 0; i < n; ++i) written = written && values[i] == i * 3;
+            CHECK_MSG(coverage.exactly_once() && written, "%s: pool %d, n=%d grain=%d", what, pool.size(), n,
+                      grain);
+        }
+    }
+}
+
+// 前几个下标特别慢：其余线程必须把慢线程剩下的部分偷走
+void check_uneven(ThreadPool& pool) {
+    const int n = 256;
+    for (int round = 0; round < 20; ++round) {
+        Coverage coverage(n);
+        pool.parallel_for(n, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                if (i < 4) spin_for(std::chrono::microseconds(300));
+                coverage.hits[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        }, 1);
+        CHECK_MSG(coverage.exactly_once(), "uneven: pool %d round %d", pool.size(), round);
+    }
+}
+
+// 两次任务之间停得比自旋时间长，工作线程进入休眠后要被新任务唤醒
+void check_park(ThreadPool& pool) {
+    for (int round = 0; round < 50; ++round) {
+        std::this_thread::sleep_for(std::chrono::microseconds(round % 5 == 0 ? 2000 : 250));
+        Coverage coverage(64);
+        pool.parallel_for(64, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) coverage.hits[i].fetch_add(1, std::memory_order_relaxed);
+        }, 1);
+        CHECK_MSG(coverage.exactly_once(), "park: pool %d round %d", pool.size(), round);
+    }
+}
+
+// 多个线程同时调用同一个池：忙时调用方自己跑完整个范围
+void check_concurrent_callers(ThreadPool& pool) {
+    constexpr int kCallers = 4;
+    constexpr int kJobs = 300;
+    std::atomic<int> failures{0};
+    std::vector<std::thread> callers;
+    for (int c = 0; c < kCallers; ++c) {
+        callers.emplace_back([&, c]() {
+            for (int job = 0; job < kJobs; ++job) {
+                const int n = 1 + (job * 7 + c * 13) % 200;
+                Coverage coverage(n);
+                pool.parallel_for(n, [&](int begin, int end) {
+                    for (int i = begin; i < end; ++i) coverage.hits[i].fetch_add(1, std::memory_order_relaxed);
+                });
+                if (!coverage.exactly_once()) failures.fetch_add(1);
+            }
+        });
+    }
+    for (std::thread& t : callers) t.join();
+    CHECK_MSG(failures.load() == 0, "concurrent callers: pool %d, %d job(s) not covered exactly once", pool.size(),
+              failures.load());
+}
+
+// 刚创建、正在自旋或已休眠的池都要能正常析构
+void check_lifecycle() {
+    for (int round = 0; round < 40; ++round) {
+        ThreadPool pool(2 + round % 4);
+        if (round % 3 != 0) {
+            Coverage coverage(32);
+            pool.parallel_for(32, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) coverage.hits[i].fetch_add(1, std::memory_order_relaxed);
+            });
+            CHECK_MSG(coverage.exactly_once(), "lifecycle round %d", round);
+        }
+        if (round % 3 == 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+} // namespace
+
+int main() {
+    for (int threads : {1, 2, 3, 4, 8}) {
+        ThreadPool pool(threads);
+        check_ranges(pool, "ranges");
+        check_uneven(pool);
+        check_park(pool);
+        check_concurrent_callers(pool);
+        // 上面的任务之后再检查一遍，确认池的状态没有被破坏
+        check_ranges(pool, "ranges after stress");
+    }
+    check_lifecycle();
+    return test_result("test_thread_pool");
+}
@@ -0,0 +1,217 @@
+/**
+ * test_token_constraint.cpp
+ *
+ * Checks the constrained-decoding pieces against independent references:
+ * - compile_regex(): whole-string matching of the DFA agrees with
+ *   std::regex_match on every short string over a small alphabet plus
+ *   random longer ones;
+ * - TokenConstraint: in every state reachable through the vocab, the mask
+ *   apply() leaves open is exactly the set of tokens whose bytes keep the
+ *   DFA alive when stepped one byte at a time (end-of-text only in
+ *   accepting states), and advance() lands on the same state.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <queue>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "regex_dfa.h"
+#include "test_check.h"
+#include "token_constraint.h"
+#include "tokenizer.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+// std::regex (ECMAScript) 与本实现语义相同的子集；字母表不含 '\r'（ECMAScript 的 '.' 不匹配它）
+const char* const kPatterns[] = {
+        "a*b+",
+        "(ab|ba)*",
+        "[a-c]{2,4}",
+        "\\d+(\\.\\d{1,2})?",
+        "(?:yes|no)",
+        "\"[^\"]*\"",
+        "\\{\"a\":\\d+\\}",
+        "a?b?1?",
+        "(a|b)*abb",
+        "\\w\\s\\W",
+        "1{3}",
+        "b{2,}",
+        ".b",
+        "[^a]+\\n",
+        "(a|)(b|)c*",
+};
+
+const char kAlphabet[] = "ab1.{}\":_ \nyes";
+
+// DFA 逐字节前进；-1 表示离开了模式
+int walk(const Dfa& dfa, int state, const std::string& bytes) {
+    for (char c : bytes) {
+        if (state < 0) break;
+        state = dfa.step(state, static_cast<uint8_t>(c));
+    }
+    return state;
+}
+
+bool dfa_matches(const Dfa& dfa, const std::string& s) {
+    const int state = walk(dfa, dfa.start, s);
+    return state >= 0 && dfa.accepting[static_cast<size_t>(state)] != 0;
+}
+
+void check_regex(const char* pattern, std::mt19937& rng) {
+    Dfa dfa;
+    if (!compile_regex(pattern, &dfa)) {
+        CHECK_MSG(false, "compile_regex(\"%s\") failed", pattern);
+        return;
+    }
+    const std::regex reference(pattern, std::regex::ECMAScript);
+    const int letters = static_cast<int>(sizeof(kAlphabet) - 1);
+    auto check = [&](const std::string& s) {
+        const bool want = std::regex_match(s, reference);
+        CHECK_MSG(dfa_matches(dfa, s) == want, "pattern \"%s\" on \"%s\": std::regex says %d", pattern, s.c_str(),
+                  want);
+    };
+    // 长度不超过 4 的全部字符串
+    std::string s;
+    for (int len = 0; len <= 4; ++len) {
+        std::vector<int> digits(len, 0);
+        for (;;) {
+            s.clear();
+            for (int d : digits) s.push_back(kAlphabet[d]);
+            check(s);
+            int i = 0;
+            while (i < len && ++digits[i] == letters) digits[i++] = 0;
+            if (i == len) break;
+        }
+    }
+    // 更长的随机字符串，一半从模式中的字符里取，容易走到深处的状态
+    const std::string pattern_chars(pattern);
+    std::uniform_int_distribution<int> length(5, 16);
+    for (int n = 0; n < 2000; ++n) {
+        const std::string& pool = (n & 1) ? pattern_chars : std::string(kAlphabet);
+        std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+        s.clear();
+        for (int len = length(rng); len > 0; --len) s.push_back(pool[pick(rng)]);
+        check(s);
+    }
+}
+
+// 词表：全部可打印 ASCII 与 '\n' 的单字节 token，加上若干多字节 token（含一个 UTF-8 字符）
+bool write_vocab(const std::string& path) {
+    std::vector<std::string> tokens;
+    tokens.push_back("\n");
+    for (int c = 0x20; c < 0x7F; ++c) tokens.push_back(std::string(1, static_cast<char>(c)));
+    for (const char* t : {"ab", "ba", "abb", "aab", "bb", "12", "1.", ".5", "{\"", "\":", "\"a", "yes", "no",
+                          "ye", "111", "a1", " \n", "\"}", "\u4e2d"}) {
+        tokens.push_back(t);
+    }
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    int id = 1;
+    for (const std::string& t : tokens) {
+        fprintf(f, "%d b'", id++);
+        for (unsigned char c : t) fprintf(f, "\\x%02x", c);
+        fprintf(f, "' %zu\n", t.size());
+    }
+    return fclose(f) == 0;
+}
+
+void check_masks(const char* pattern, const Tokenizer& tokenizer) {
+    Dfa dfa;
+    std::unique_ptr<TokenConstraint> constraint = TokenConstraint::create(pattern, tokenizer);
+    if (!compile_regex(pattern, &dfa) || !constraint) {
+        CHECK_MSG(false, "pattern \"%s\" failed to compile", pattern);
+        return;
+    }
+    CHECK(constraint->start_state() == dfa.start);
+    CHECK(constraint->states() == dfa.states());
+
+    const int vocab = tokenizer.vocab_size();
+    const int n = vocab + 40;  // 词表之外的 logits 必须始终被屏蔽
+    std::vector<float> logits(n);
+    std::vector<uint8_t> seen(dfa.states(), 0);
+    std::queue<int> pending;
+    pending.push(dfa.start);
+    seen[static_cast<size_t>(dfa.start)] = 1;
+    int visited = 0;
+    while (!pending.empty()) {
+        const int state = pending.front();
+        pending.pop();
+        ++visited;
+        std::fill(logits.begin(), logits.end(), 0.f);
+        constraint->apply(state, logits.data(), n);
+
+        bool any = dfa.accepting[static_cast<size_t>(state)] != 0;
+        CHECK_MSG(std::isinf(logits[0]) != any, "\"%s\" state %d: end-of-text mask %d, accepting %d", pattern,
+                  state, !std::isinf(logits[0]), any);
+        for (int id = 1; id < vocab; ++id) {
+            const std::string bytes(tokenizer.token_bytes(id));
+            const int next = walk(dfa, state, bytes);
+            const bool allowed = next >= 0;
+            any = any || allowed;
+            CHECK_MSG(!std::isinf(logits[id]) == allowed, "\"%s\" state %d token %d: mask %d, DFA %d", pattern,
+                      state, id, !std::isinf(logits[id]), allowed);
+            CHECK_MSG(constraint->advance(state, bytes) == next, "\"%s\" state %d token %d: advance %d, DFA %d",
+                      pattern, state, id, constraint->advance(state, bytes), next);
+            if (allowed && !seen[static_cast<size_t>(next)]) {
+                seen[static_cast<size_t>(next)] = 1;
+                pending.push(next);
+            }
+        }
+        for (int id = vocab; id < n; ++id) {
+            CHECK_MSG(std::isinf(logits[id]), "\"%s\" state %d: logit %d past the vocab not masked", pattern, state,
+                      id);
+        }
+        CHECK_MSG(constraint->has_allowed(state) == any, "\"%s\" state %d: has_allowed %d, expected %d", pattern,
+                  state, constraint->has_allowed(state), any);
+    }
+    printf("  \"%s\": %d of %d DFA states reachable through the vocab\n", pattern, visited, dfa.states());
+}
+
+} // namespace
+
+int main() {
+    // 下面有故意写错的模式，不输出预期中的编译错误
+    set_log_level(kLogError + 1);
+    std::mt19937 rng(5);
+    for (const char* pattern : kPatterns) {
+        check_regex(pattern, rng);
+    }
+    // 非正则的语法必须报错
+    for (const char* bad : {"(a", "a)", "[ab", "*a", "(?=a)", "(a)\\1", "\\bword"}) {
+        Dfa dfa;
+        CHECK_MSG(!compile_regex(bad, &dfa), "compile_regex(\"%s\") should fail", bad);
+    }
+
+    const char* tmp = getenv("TMPDIR");
+    std::string dir = std::string(tmp != nullptr ? tmp : "/tmp") + "/rwkv_test_XXXXXX";
+    if (mkdtemp(&dir[0]) == nullptr) {
+        CHECK_MSG(false, "mkdtemp failed");
+        return test_result("test_token_constraint");
+    }
+    const std::string path = dir + "/vocab.txt";
+    Tokenizer tokenizer;
+    const bool loaded = write_vocab(path) && tokenizer.load(path);
+    remove(path.c_str());
+    rmdir(dir.c_str());
+    CHECK_MSG(loaded, "failed to write or load the test vocab");
+    if (loaded) {
+        for (const char* pattern : kPatterns) {
+            check_masks(pattern, tokenizer);
+        }
+    }
+    return test_result("test_token_constraint");
+}
@@ -0,0 +1,132 @@
+/**
+ * test_wkv_kernels.cpp
+ *
+ * Checks every WKV kernel this CPU can run (avx2, avx512, neon) against
+ * the scalar reference wkv_columns(): several tokens in a row from the
+ * same random state, comparing the output y and the updated state after
+ * each step. Head sizes cover the vector widths exactly, with scalar tails,
+ * odd sizes and sizes below one vector.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "kernels.h"
+#include "kernels_wkv.h"
+#include "platform.h"
+#include "test_check.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+constexpr int kSteps = 4;
+
+// 一个 head 的输入：r/k/v/u 取 [-1, 1]，w 为 exp(-exp(.)) 之后的衰减，取 (0.5, 1)
+struct Head {
+    int S;
+    std::vector<float> r, k, v, w, u;
+};
+
+Head make_head(int S, std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    std::uniform_real_distribution<float> decay(0.5f, 0.999f);
+    Head h;
+    h.S = S;
+    for (std::vector<float>* x : {&h.r, &h.k, &h.v, &h.u}) {
+        x->resize(S);
+        for (float& e : *x) e = unit(rng);
+    }
+    h.w.resize(S);
+    for (float& e : h.w) e = decay(rng);
+    return h;
+}
+
+// 第 i 个输出的量级 sum_j |r_j| * (|u_j k_j v_i| + |S_ji|)：FMA 与分开乘加的差别与它成比例
+double y_magnitude(const Head& h, const std::vector<float>& state, int i) {
+    double sum = 0;
+    for (int j = 0; j < h.S; ++j) {
+        sum += std::fabs(h.r[j]) * (std::fabs(h.u[j] * h.k[j] * h.v[i]) +
+                                    std::fabs(state[static_cast<size_t>(j) * h.S + i]));
+    }
+    return sum;
+}
+
+void check_kernel(const WkvKernel& kernel) {
+    static const int kHeadSizes[] = {1, 3, 4, 5, 8, 13, 16, 17, 31, 32, 33, 48, 64, 80, 128};
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+    for (int S : kHeadSizes) {
+        std::vector<float> state(static_cast<size_t>(S) * S);
+        for (float& e : state) e = unit(rng);
+        std::vector<float> ref_state = state;
+        std::vector<float> y(S), ref_y(S);
+        bool ok = true;
+        for (int step = 0; step < kSteps && ok; ++step) {
+            const Head h = make_head(S, rng);
+            std::vector<double> magnitude(S);
+            for (int i = 0; i < S; ++i) magnitude[i] = y_magnitude(h, ref_state, i);
+            const std::vector<float> before = ref_state;
+
+            kernel.step(S, h.r.data(), h.k.data(), h.v.data(), h.w.data(), h.u.data(), state.data(), y.data());
+            wkv_columns(S, 0, h.r.data(), h.k.data(), h.v.data(), h.w.data(), h.u.data(), ref_state.data(),
+                        ref_y.data());
+
+            for (int i = 0; i < S && ok; ++i) {
+                ok = std::fabs(static_cast<double>(y[i]) - ref_y[i]) <= 1e-5 * magnitude[i] + 1e-7;
+                CHECK_MSG(ok, "%s S=%d step=%d: y[%d] = %.9g vs scalar %.9g", kernel.name, S, step, i, y[i],
+                          ref_y[i]);
+            }
+            for (int j = 0; j < S && ok; ++j) {
+                for (int i = 0; i < S && ok; ++i) {
+                    const size_t idx = static_cast<size_t>(j) * S + i;
+                    const double scale = std::fabs(h.k[j] * h.v[i]) + std::fabs(h.w[j] * before[idx]);
+                    ok = std::fabs(static_cast<double>(state[idx]) - ref_state[idx]) <= 1e-5 * scale + 1e-7;
+                    CHECK_MSG(ok, "%s S=%d step=%d: state[%d][%d] = %.9g vs scalar %.9g", kernel.name, S, step, j,
+                              i, state[idx], ref_state[idx]);
+                }
+            }
+            // 下一步从参考状态继续，误差不累积
+            state = ref_state;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    struct Candidate {
+        const char* name;
+        const WkvKernel* kernel;
+        uint32_t required;  // 需要的 CpuFeature 位
+    };
+    const Candidate candidates[] = {
+            {"avx2", wkv_kernel_avx2(), kCpuAvx2},
+            {"avx512", wkv_kernel_avx512(), kCpuAvx512},
+            {"neon", wkv_kernel_neon(), kCpuNeon},
+    };
+    const uint32_t features = cpu_features();
+    int tested = 0;
+    for (const Candidate& c : candidates) {
+        if (c.kernel == nullptr) {
+            printf("%-8s not compiled for this target\n", c.name);
+        } else if ((features & c.required) != c.required) {
+            printf("%-8s not supported by this CPU (%s)\n", c.name, cpu_feature_names(features).c_str());
+        } else {
+            printf("%-8s checking\n", c.name);
+            check_kernel(*c.kernel);
+            ++tested;
+        }
+    }
+    printf("selected kernel: %s, %d kernel(s) checked\n", wkv_kernel_name(), tested);
+#if defined(__aarch64__)
+    // AArch64 基线即包含 NEON：没有编进来或没被选中说明构建配置有误，不能当作“无可测内核”通过
+    CHECK_MSG(wkv_kernel_neon() != nullptr, "neon kernel not compiled for aarch64");
+    CHECK_MSG(strcmp(wkv_kernel_name(), "neon") == 0, "aarch64 selected the %s kernel", wkv_kernel_name());
+#endif
+    return test_result("test_wkv_kernels");
+}
@@ -0,0 +1,130 @@
+/**
+ * tiny_model.h
+ *
+ * Writes a small RWKV-6 safetensors file with random fp32 weights, for the
+ * self-tests that need a whole model. The tensor names and layouts are the
+ * ones Model::load() reads; a forward pass takes microseconds.
+ */
+
+#ifndef RWKVMOBILE_TEST_TINY_MODEL_H
+#define RWKVMOBILE_TEST_TINY_MODEL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rwkvmobile {
+
+struct TinyModelShape {
+    int vocab = 128;
+    int n_embd = 32;
+    int n_head = 2;
+    int dim_mix = 4;
+    int dim_decay = 4;
+    int n_ffn = 64;
+    int n_layer = 2;
+};
+
+/**
+ * Random weights in [-0.5, 0.5) from `seed`; the same seed writes the same
+ * file. With `fixed_token` >= 0 the output head ignores the input and always
+ * ranks that token first (ln_out becomes a constant vector that only its
+ * head row matches).
+ * @return false if the file cannot be written
+ */
+inline bool write_tiny_model(const std::string& path, const TinyModelShape& m, uint32_t seed,
+                             int fixed_token = -1) {
+    const int C = m.n_embd;
+    std::vector<std::pair<std::string, std::vector<int>>> tensors;
+    auto add = [&](const std::string& name, std::vector<int> shape) { tensors.emplace_back(name, std::move(shape)); };
+    add("emb.weight", {m.vocab, C});
+    add("blocks.0.ln0.weight", {C});
+    add("blocks.0.ln0.bias", {C});
+    for (int i = 0; i < m.n_layer; ++i) {
+        const std::string p = "blocks." + std::to_string(i) + ".";
+        for (const char* n : {"ln1.weight", "ln1.bias", "ln2.weight", "ln2.bias"}) add(p + n, {C});
+        for (const char* n : {"x", "w", "k", "v", "r", "g"}) add(p + "att.time_maa_" + n, {1, 1, C});
+        add(p + "att.time_maa_w1", {C, 5 * m.dim_mix});
+        add(p + "att.time_maa_w2", {5, m.dim_mix, C});
+        add(p + "att.time_decay", {1, 1, C});
+        add(p + "att.time_decay_w1", {C, m.dim_decay});
+        add(p + "att.time_decay_w2", {m.dim_decay, C});
+        add(p + "att.time_faaaa", {m.n_head, C / m.n_head});
+        for (const char* n : {"receptance", "key", "value", "gate", "output"}) {
+            add(p + "att." + n + ".weight", {C, C});
+        }
+        add(p + "att.ln_x.weight", {C});
+        add(p + "att.ln_x.bias", {C});
+        add(p + "ffn.time_maa_k", {1, 1, C});
+        add(p + "ffn.time_maa_r", {1, 1, C});
+        add(p + "ffn.key.weight", {m.n_ffn, C});
+        add(p + "ffn.receptance.weight", {C, C});
+        add(p + "ffn.value.weight", {C, m.n_ffn});
+    }
+    add("ln_out.weight", {C});
+    add("ln_out.bias", {C});
+    add("head.weight", {m.vocab, C});
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(-0.5f, 0.5f);
+    std::string header = "{";
+    std::vector<float> data;
+    for (const auto& t : tensors) {
+        size_t count = 1;
+        std::string shape;
+        for (int d : t.second) {
+            count *= static_cast<size_t>(d);
+            shape += (shape.empty() ? "" : ",") + std::to_string(d);
+        }
+        const size_t begin = data.size();
+        for (size_t j = 0; j < count; ++j) data.push_back(uniform(rng));
+        if (fixed_token >= 0 && t.first == "ln_out.weight") {
+            std::fill(data.begin() + begin, data.end(), 0.f);
+        } else if (fixed_token >= 0 && t.first == "ln_out.bias") {
+            std::fill(data.begin() + begin, data.end(), 1.f);
+        } else if (fixed_token >= 0 && t.first == "head.weight") {
+            std::fill(data.begin() + begin, data.end(), 0.f);
+            std::fill(data.begin() + begin + static_cast<size_t>(fixed_token) * C,
+                      data.begin() + begin + static_cast<size_t>(fixed_token + 1) * C, 1.f);
+        }
+        if (header.size() > 1) header += ",";
+        header += "\"" + t.first + "\":{\"dtype\":\"F32\",\"shape\":[" + shape + "],\"data_offsets\":[" +
+                  std::to_string(begin * sizeof(float)) + "," + std::to_string(data.size() * sizeof(float)) + "]}";
+    }
+    header += "}";
+    // 与常见的 safetensors 文件一样用空格把数据起点补齐到 64 字节，权重可以原地映射
+    header.append((64 - (sizeof(uint64_t) + header.size()) % 64) % 64, ' ');
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    uint8_t size_le[8];
+    uint64_t size = header.size();
+    for (int i = 0; i < 8; ++i) size_le[i] = static_cast<uint8_t>(size >> (8 * i));
+    bool ok = fwrite(size_le, 1, 8, f) == 8 && fwrite(header.data(), 1, header.size(), f) == header.size() &&
+              fwrite(data.data(), sizeof(float), data.size(), f) == data.size();
+    ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+/**
+ * One token per byte value 1 .. vocab-1, in the text vocab format
+ * Tokenizer::load() reads.
+ */
+inline bool write_byte_vocab(const std::string& path, int vocab) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        return false;
+    }
+    for (int i = 1; i < vocab && i < 256; ++i) fprintf(f, "%d b'\\x%02x' 1\n", i, i);
+    return fclose(f) == 0;
+}
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_TEST_TINY_MODEL_H
@@ -0,0 +1,226 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "logger.h"
+#include "platform.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+// 空闲的工作线程先自旋这么久再休眠：覆盖一个 decode 步里相邻内核之间的间隙，
+// 不覆盖 token 之间的采样与回调
+constexpr auto kSpinDuration = std::chrono::microseconds(200);
+
+inline void cpu_relax() {
+#if defined(__SSE2__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+inline uint64_t pack(int begin, int end) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(begin)) << 32 | static_cast<uint32_t>(end);
+}
+
+inline void unpack(uint64_t range, int* begin, int* end) {
+    *begin = static_cast<int>(static_cast<uint32_t>(range >> 32));
+    *end = static_cast<int>(static_cast<uint32_t>(range));
+}
+
+// 第 part 份（共 parts 份）的范围 [begin, end)
+void split(int n, int parts, int part, int* begin, int* end) {
+    const int base = n / parts;
+    const int extra = n % parts;
+    *begin = part * base + (part < extra ? part : extra);
+    *end = *begin + base + (part < extra ? 1 : 0);
+}
+
+void pin_to_performance_cores() {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : performance_cores()) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        RWKV_LOGW("Failed to pin a worker thread to the performance cores");
+    }
+#endif
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(int threads, ThreadAffinity affinity) : affinity_(affinity) {
+    if (threads < 1) {
+        threads = affinity == ThreadAffinity::kPerformance
+                      ? static_cast<int>(performance_cores().size())
+                      : static_cast<int>(std::thread::hardware_concurrency());
+        if (threads < 1) threads = 1;
+    }
+    shares_.reset(new Share[static_cast<size_t>(threads)]);
+    workers_.reserve(threads - 1);
+    for (int i = 1; i < threads; ++i) {
+        workers_.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    stop_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+    }
+    park_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallel_for(int n, const RangeFn& fn, int grain) {
+    if (n <= 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> job_lock(job_mutex_, std::try_to_lock);
+    if (workers_.empty() || n == 1 || !job_lock.owns_lock()) {
+        fn(0, n);
+        return;
+    }
+
+    const int parts = size();
+    for (int p = 0; p < parts; ++p) {
+        int begin, end;
+        split(n, parts, p, &begin, &end);
+        shares_[p].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    fn_ = &fn;
+    grain_ = grain > 0 ? grain : std::max(1, n / (parts * 4));
+    const uint64_t job = ((state_.load(std::memory_order_relaxed) >> 1) + 1) << 1 | 1;
+    state_.store(job);
+    if (parked_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(park_mutex_); }
+        park_cv_.notify_all();
+    }
+
+    run_job(0);
+
+    // 关闭任务：之后不会再有工作线程加入；已加入的做完手上的部分就退出
+    state_.store(job & ~uint64_t(1));
+    for (uint32_t spins = 1; busy_.load() != 0; ++spins) {
+        cpu_relax();
+        if ((spins & 255) == 0) std::this_thread::yield();
+    }
+    fn_ = nullptr;
+}
+
+void ThreadPool::run_job(int index) {
+    const RangeFn& fn = *fn_;
+    int begin, end;
+    do {
+        while (take(index, &begin, &end)) {
+            fn(begin, end);
+        }
+    } while (steal(index));
+}
+
+bool ThreadPool::take(int index, int* begin, int* end) {
+    std::atomic<uint64_t>& range = shares_[index].range;
+    uint64_t cur = range.load(std::memory_order_acquire);
+    for (;;) {
+        int b, e;
+        unpack(cur, &b, &e);
+        if (b >= e) {
+            return false;
+        }
+        const int next = std::min(e, b + grain_);
+        if (range.compare_exchange_weak(cur, pack(next, e), std::memory_order_acq_rel)) {
+            *begin = b;
+            *end = next;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::steal(int index) {
+    const int parts = size();
+    for (int i = 1; i < parts; ++i) {
+        std::atomic<uint64_t>& victim = shares_[(index + i) % parts].range;
+        uint64_t cur = victim.load(std::memory_order_acquire);
+        for (;;) {
+            int b, e;
+            unpack(cur, &b, &e);
+            if (b >= e) {
+                break;
+            }
+            // 拿走后一半（只剩一块时整块拿走），放进自己的份额里继续按块取
+            const int mid = e - b > grain_ ? b + (e - b) / 2 : b;
+            if (victim.compare_exchange_weak(cur, pack(b, mid), std::memory_order_acq_rel)) {
+                shares_[index].range.store(pack(mid, e), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint64_t ThreadPool::wait_for_job(uint64_t seen_generation) {
+    auto spin_start = std::chrono::steady_clock::now();
+    for (uint32_t spins = 0;; ++spins) {
+        if (stop_.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        const uint64_t state = state_.load(std::memory_order_acquire);
+        if ((state >> 1) != seen_generation) {
+            if (state & 1) {
+                return state;
+            }
+            // 休眠期间开始并结束的任务
+            seen_generation = state >> 1;
+        }
+        cpu_relax();
+        if ((spins & 255) != 255) {
+            continue;
+        }
+        if (std::chrono::steady_clock::now() - spin_start < kSpinDuration) {
+            // 线程数多于空闲核心时把核心让给正在干活的线程
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        parked_.fetch_add(1);
+        park_cv_.wait(lock, [&]() { return stop_.load() || (state_.load() >> 1) != seen_generation; });
+        parked_.fetch_sub(1);
+        spin_start = std::chrono::steady_clock::now();
+    }
+}
+
+void ThreadPool::worker_loop(int index) {
+    if (affinity_ == ThreadAffinity::kPerformance) {
+        pin_to_performance_cores();
+    }
+    uint64_t seen = 0;
+    for (;;) {
+        const uint64_t job = wait_for_job(seen);
+        if (job == 0) {
+            return;
+        }
+        seen = job >> 1;
+        // 先登记再确认任务仍然开放：与 parallel_for 的“关闭后等 busy_ 归零”配对
+        busy_.fetch_add(1);
+        if (state_.load() == job) {
+            run_job(index);
+        }
+        busy_.fetch_sub(1);
+    }
+}
+
+} // namespace rwkvmobile
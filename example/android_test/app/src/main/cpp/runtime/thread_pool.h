@@ -0,0 +1,111 @@
+/**
+ * thread_pool.h
+ *
+ * Work-stealing pool used to split one kernel (the rows of a matrix
+ * product, the WKV heads of a layer) across cores, for decode steps as well
+ * as prefill chunks. The calling thread takes part in every job, so a pool
+ * of size N owns N - 1 worker threads. Between jobs the workers spin for a
+ * short while before parking, so the many small kernels of one decode step
+ * do not each pay a futex wake-up; between tokens they sleep.
+ */
+
+#ifndef RWKVMOBILE_THREAD_POOL_H
+#define RWKVMOBILE_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace rwkvmobile {
+
+// 与 rwkv_mobile.h 中的 RWKVMOBILE_AFFINITY_* 保持一致
+enum class ThreadAffinity : int {
+    kNone = 0,         // 由系统调度
+    kPerformance = 1,  // 工作线程只在 performance_cores() 上运行
+};
+
+// 不持有可调用对象的 void(int begin, int end) 引用。std::function 装不下捕获较多的 lambda 时
+// 会分配堆内存，而 decode 每一步要调用几十次 parallel_for
+class RangeFn {
+public:
+    // 隐式转换，调用处直接传 lambda；fn 须在调用期间有效
+    template <typename Fn, typename = std::enable_if_t<!std::is_same<std::decay_t<Fn>, RangeFn>::value>>
+    RangeFn(const Fn& fn)
+        : obj_(&fn), call_([](const void* obj, int begin, int end) { (*static_cast<const Fn*>(obj))(begin, end); }) {}
+
+    void operator()(int begin, int end) const { call_(obj_, begin, end); }
+
+private:
+    const void* obj_;
+    void (*call_)(const void*, int, int);
+};
+
+class ThreadPool {
+public:
+    /**
+     * @param threads  total number of threads including the caller; values
+     *                 below 1 use the number of online cores, or of
+     *                 performance cores with kPerformance
+     * @param affinity kPerformance pins the worker threads (not the caller)
+     *                 to the performance cluster
+     */
+    explicit ThreadPool(int threads, ThreadAffinity affinity = ThreadAffinity::kNone);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+    ThreadAffinity affinity() const { return affinity_; }
+
+    /**
+     * Run fn over [0, n) in parallel, returning when all of it is done.
+     * Every thread starts on its own contiguous share and takes it in
+     * pieces of `grain`; a thread that runs out steals the back half of
+     * another thread's remainder, so a slower core (or a worker that woke
+     * up late) does not hold up the job. Safe to call from several threads:
+     * while the pool is busy with another caller's job, fn runs over the
+     * whole range on the calling thread instead of waiting.
+     * @param grain smallest piece handed out; 0 picks a quarter of a share
+     */
+    void parallel_for(int n, const RangeFn& fn, int grain = 0);
+
+private:
+    // 一个线程剩余的范围，高 32 位 begin、低 32 位 end；各占一条缓存行
+    struct alignas(64) Share {
+        std::atomic<uint64_t> range{0};
+    };
+
+    void worker_loop(int index);
+    // 等到新任务开放（返回任务的 state_）或 stop_（返回 0）
+    uint64_t wait_for_job(uint64_t seen_generation);
+    void run_job(int index);
+    bool take(int index, int* begin, int* end);
+    bool steal(int index);
+
+    ThreadAffinity affinity_;
+    std::vector<std::thread> workers_;
+    std::unique_ptr<Share[]> shares_;
+    std::mutex job_mutex_;  // 同一时间只执行一个任务
+
+    // state_ = 任务序号 << 1 | 是否开放；fn_ 与 grain_ 在开放之前写好，
+    // 任务关闭且 busy_ 归零之后才会改动
+    std::atomic<uint64_t> state_{0};
+    std::atomic<int> busy_{0};  // 已加入当前任务的工作线程
+    const RangeFn* fn_ = nullptr;
+    int grain_ = 1;
+
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+    std::atomic<int> parked_{0};
+    std::atomic<bool> stop_{false};
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_THREAD_POOL_H
@@ -0,0 +1,134 @@
+#include "token_constraint.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "logger.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace rwkvmobile {
+
+namespace {
+
+// 32 个 logits 按掩码的 32 位选择：位为 0 的置为 -inf
+inline void select32(float* x, uint32_t bits) {
+#if defined(__SSE2__)
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128 ninf = _mm_set1_ps(-INFINITY);
+    for (int j = 0; j < 8; ++j, bits >>= 4) {
+        const __m128i nibble = _mm_set1_epi32(static_cast<int>(bits & 0xF));
+        const __m128 keep = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(nibble, lanes), lanes));
+        const __m128 v = _mm_loadu_ps(x + 4 * j);
+        _mm_storeu_ps(x + 4 * j, _mm_or_ps(_mm_and_ps(keep, v), _mm_andnot_ps(keep, ninf)));
+    }
+#elif defined(__aarch64__)
+    const uint32_t lane_bits[4] = {1, 2, 4, 8};
+    const uint32x4_t lanes = vld1q_u32(lane_bits);
+    const float32x4_t ninf = vdupq_n_f32(-INFINITY);
+    for (int j = 0; j < 8; ++j, bits >>= 4) {
+        const uint32x4_t keep = vtstq_u32(vdupq_n_u32(bits & 0xF), lanes);
+        vst1q_f32(x + 4 * j, vbslq_f32(keep, vld1q_f32(x + 4 * j), ninf));
+    }
+#else
+    for (int j = 0; j < 32; ++j) {
+        if (((bits >> j) & 1u) == 0) x[j] = -INFINITY;
+    }
+#endif
+}
+
+} // namespace
+
+std::unique_ptr<TokenConstraint> TokenConstraint::create(const std::string& pattern, const Tokenizer& tokenizer) {
+    if (tokenizer.empty()) {
+        RWKV_LOGE("A tokenizer must be loaded before setting a constraint");
+        return nullptr;
+    }
+    std::unique_ptr<TokenConstraint> constraint(new TokenConstraint());
+    if (!compile_regex(pattern, &constraint->dfa_)) {
+        return nullptr;
+    }
+    constraint->pattern_ = pattern;
+    constraint->build_masks(tokenizer);
+    RWKV_LOGI("Constraint compiled: %d DFA states, %zu KB of token masks", constraint->states(),
+              constraint->mask_bytes() / 1024);
+    return constraint;
+}
+
+void TokenConstraint::build_masks(const Tokenizer& tokenizer) {
+    const CompiledVocab& vocab = tokenizer.compiled();
+    const VocabUnit* units = vocab.units;
+    words_ = (vocab.vocab_size + 31) / 32;
+    const size_t states = static_cast<size_t>(dfa_.states());
+    masks_.assign(states * words_, 0);
+    allowed_.assign(states, 0);
+
+    // trie 的子节点表（CSR）：check 是父节点，边上的字节是 t - base[父]
+    std::vector<uint32_t> first(vocab.unit_count + 1, 0);
+    for (uint32_t t = 1; t < vocab.unit_count; ++t) {
+        if (units[t].check >= 0) ++first[static_cast<size_t>(units[t].check) + 1];
+    }
+    for (uint32_t u = 0; u < vocab.unit_count; ++u) first[u + 1] += first[u];
+    std::vector<std::pair<uint8_t, uint32_t>> children(first[vocab.unit_count]);
+    std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+    for (uint32_t t = 1; t < vocab.unit_count; ++t) {
+        if (units[t].check < 0) continue;
+        const auto parent = static_cast<uint32_t>(units[t].check);
+        children[cursor[parent]++] = {static_cast<uint8_t>(t - static_cast<uint32_t>(units[parent].base)), t};
+    }
+
+    // 每个 DFA 状态沿 trie 与 DFA 同步向下走，DFA 走不通的子树整棵跳过
+    std::vector<std::pair<uint32_t, int>> stack;
+    for (size_t s = 0; s < states; ++s) {
+        uint32_t* mask = &masks_[s * words_];
+        if (dfa_.accepting[s]) mask[0] |= 1u;
+        stack.assign(1, {0u, static_cast<int>(s)});
+        while (!stack.empty()) {
+            const auto [u, ds] = stack.back();
+            stack.pop_back();
+            for (uint32_t k = first[u]; k < first[u + 1]; ++k) {
+                const int ns = dfa_.step(ds, children[k].first);
+                if (ns < 0) continue;
+                const uint32_t t = children[k].second;
+                const int32_t id = units[t].id;
+                if (id != 0) mask[id >> 5] |= 1u << (id & 31);
+                stack.emplace_back(t, ns);
+            }
+        }
+        allowed_[s] = std::any_of(mask, mask + words_, [](uint32_t w) { return w != 0; }) ? 1 : 0;
+    }
+}
+
+void TokenConstraint::apply(int state, float* logits, int n) const {
+    const uint32_t* mask = &masks_[static_cast<size_t>(state) * words_];
+    int i = 0;
+    // 受约束时多数字全为 0 或全为 1，整字处理
+    for (size_t w = 0; w < words_ && i + 32 <= n; ++w, i += 32) {
+        const uint32_t bits = mask[w];
+        if (bits == ~0u) continue;
+        if (bits == 0) {
+            std::fill(logits + i, logits + i + 32, -INFINITY);
+            continue;
+        }
+        select32(logits + i, bits);
+    }
+    for (; i < n; ++i) {
+        const size_t w = static_cast<size_t>(i) >> 5;
+        if (w >= words_ || ((mask[w] >> (i & 31)) & 1u) == 0) logits[i] = -INFINITY;
+    }
+}
+
+int TokenConstraint::advance(int state, std::string_view bytes) const {
+    for (char c : bytes) {
+        state = dfa_.step(state, static_cast<uint8_t>(c));
+        if (state < 0) break;
+    }
+    return state;
+}
+
+} // namespace rwkvmobile
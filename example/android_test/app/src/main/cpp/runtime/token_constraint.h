@@ -0,0 +1,70 @@
+/**
+ * token_constraint.h
+ *
+ * Constrained decoding: a regex DFA (regex_dfa.h) combined with the vocab.
+ * For every DFA state a bitmask of the tokens whose bytes keep the output
+ * matchable is computed once, by walking the vocab trie alongside the DFA.
+ * Decoding then only masks the logits (a vectorized select against -inf)
+ * and advances the state by the sampled token's bytes. The end-of-text
+ * token 0 is allowed exactly in accepting states.
+ */
+
+#ifndef RWKVMOBILE_TOKEN_CONSTRAINT_H
+#define RWKVMOBILE_TOKEN_CONSTRAINT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "regex_dfa.h"
+#include "tokenizer.h"
+
+namespace rwkvmobile {
+
+class TokenConstraint {
+public:
+    /**
+     * Compile `pattern` and precompute the token masks for `tokenizer`.
+     * @return null on an invalid pattern (logged)
+     */
+    static std::unique_ptr<TokenConstraint> create(const std::string& pattern, const Tokenizer& tokenizer);
+
+    const std::string& pattern() const { return pattern_; }
+    int start_state() const { return dfa_.start; }
+    int states() const { return dfa_.states(); }
+    size_t mask_bytes() const { return masks_.size() * sizeof(uint32_t); }
+
+    /**
+     * Whether any token (including end-of-text) may follow in `state`. With
+     * a vocab that lacks some bytes the pattern can run into a dead end.
+     */
+    bool has_allowed(int state) const { return allowed_[static_cast<size_t>(state)] != 0; }
+
+    /**
+     * Set the logits of the tokens not allowed in `state` to -inf. Logits
+     * past the tokenizer's vocab are always masked.
+     */
+    void apply(int state, float* logits, int n) const;
+
+    /**
+     * State after emitting `bytes` from `state`; -1 if that leaves the
+     * pattern (never for a token allowed by apply()).
+     */
+    int advance(int state, std::string_view bytes) const;
+
+private:
+    TokenConstraint() = default;
+    void build_masks(const Tokenizer& tokenizer);
+
+    std::string pattern_;
+    Dfa dfa_;
+    size_t words_ = 0;              // 每个状态的掩码字数
+    std::vector<uint32_t> masks_;   // [状态 x words_]，第 i 位为 1 表示 token i 可选
+    std::vector<uint8_t> allowed_;  // 每个状态是否有可选 token
+};
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_TOKEN_CONSTRAINT_H
@@ -0,0 +1,262 @@
+#include "tokenizer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "logger.h"
+
+namespace rwkvmobile {
+
+namespace {
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+} // namespace
+
+bool parse_python_literal(const std::string& literal, std::string& out) {
+    out.clear();
+    size_t pos = 0;
+    bool is_bytes = false;
+    if (pos < literal.size() && literal[pos] == 'b') {
+        is_bytes = true;
+        ++pos;
+    }
+    if (pos >= literal.size() || (literal[pos] != '\'' && literal[pos] != '"')) {
+        return false;
+    }
+    const char quote = literal[pos++];
+    if (literal.size() < pos + 1 || literal.back() != quote) {
+        return false;
+    }
+    const size_t end = literal.size() - 1;
+
+    while (pos < end) {
+        char c = literal[pos++];
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= end) return false;
+        c = literal[pos++];
+        switch (c) {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'a': out += '\a'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'v': out += '\v'; break;
+            case '0': out += '\0'; break;
+            case '\\': out += '\\'; break;
+            case '\'': out += '\''; break;
+            case '"': out += '"'; break;
+            case 'x': {
+                if (pos + 2 > end) return false;
+                int hi = hex_value(literal[pos]), lo = hex_value(literal[pos + 1]);
+                if (hi < 0 || lo < 0) return false;
+                const uint32_t v = static_cast<uint32_t>(hi * 16 + lo);
+                // str 字面量中的 \xNN 表示码点 U+00NN，需要编码为 UTF-8
+                if (is_bytes) out += static_cast<char>(v);
+                else append_utf8(out, v);
+                pos += 2;
+                break;
+            }
+            case 'u':
+            case 'U': {
+                const size_t n = c == 'u' ? 4 : 8;
+                if (is_bytes || pos + n > end) return false;
+                uint32_t cp = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    int h = hex_value(literal[pos + i]);
+                    if (h < 0) return false;
+                    cp = cp * 16 + static_cast<uint32_t>(h);
+                }
+                append_utf8(out, cp);
+                pos += n;
+                break;
+            }
+            default:
+                out += '\\';
+                out += c;
+                break;
+        }
+    }
+    return true;
+}
+
+bool Tokenizer::load(const std::string& path) {
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(path)) {
+        RWKV_LOGE("Failed to open vocab %s", path.c_str());
+        return false;
+    }
+    if (is_compiled_vocab(file->data(), file->size())) {
+        CompiledVocab vocab;
+        if (!read_compiled_vocab(file->data(), file->size(), &vocab)) {
+            return false;
+        }
+        file_ = std::move(file);
+        buffer_.clear();
+        set_vocab(vocab);
+        RWKV_LOGI("Mapped compiled vocab %s (%u tokens)", path.c_str(), vocab_.token_count);
+        return true;
+    }
+
+    std::vector<std::pair<std::string, int>> tokens;
+    const char* text = reinterpret_cast<const char*>(file->data());
+    const size_t size = file->size();
+    std::string line;
+    int line_no = 0;
+    for (size_t pos = 0; pos < size;) {
+        const char* nl = static_cast<const char*>(memchr(text + pos, '\n', size - pos));
+        const size_t end = nl != nullptr ? static_cast<size_t>(nl - text) : size;
+        line.assign(text + pos, end - pos);
+        pos = end + 1;
+        ++line_no;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        const size_t first = line.find(' ');
+        const size_t last = line.rfind(' ');
+        if (first == std::string::npos || last <= first) {
+            RWKV_LOGE("%s:%d: malformed vocab line", path.c_str(), line_no);
+            return false;
+        }
+        const int id = atoi(line.substr(0, first).c_str());
+        const size_t expected_len = static_cast<size_t>(atoi(line.substr(last + 1).c_str()));
+        std::string bytes;
+        if (id <= 0 || !parse_python_literal(line.substr(first + 1, last - first - 1), bytes) ||
+            bytes.size() != expected_len) {
+            RWKV_LOGE("%s:%d: bad token literal", path.c_str(), line_no);
+            return false;
+        }
+        tokens.emplace_back(std::move(bytes), id);
+    }
+
+    std::vector<uint8_t> buffer;
+    CompiledVocab vocab;
+    if (!compile_vocab(tokens, &buffer) || !read_compiled_vocab(buffer.data(), buffer.size(), &vocab)) {
+        RWKV_LOGE("Failed to compile vocab %s", path.c_str());
+        return false;
+    }
+    file_.reset();
+    buffer_ = std::move(buffer);  // vector 移动后数据地址不变，vocab 仍然有效
+    set_vocab(vocab);
+    RWKV_LOGI("Loaded vocab %s (%u tokens)", path.c_str(), vocab_.token_count);
+    return true;
+}
+
+void Tokenizer::set_vocab(const CompiledVocab& vocab) {
+    vocab_ = vocab;
+    byte_ids_.fill(0);
+    byte_level_ = vocab.max_token_len == 1;
+    if (!byte_level_) {
+        return;
+    }
+    // 字节相同的 token 以 trie 中的为准，与逐字节走 trie 的结果一致
+    for (int c = 0; c < 256; ++c) {
+        const uint32_t t = static_cast<uint32_t>(vocab.units[0].base) + static_cast<uint32_t>(c);
+        if (t < vocab.unit_count && vocab.units[t].check == 0) byte_ids_[c] = vocab.units[t].id;
+    }
+}
+
+bool Tokenizer::save_compiled(const std::string& path) const {
+    if (empty()) {
+        return false;
+    }
+    if (file_) {
+        return write_compiled_vocab(path, file_->data(), file_->size());
+    }
+    return write_compiled_vocab(path, buffer_.data(), buffer_.size());
+}
+
+std::vector<int> Tokenizer::encode(std::string_view text) const {
+    std::vector<int> ids(text.size());
+    ids.resize(encode(text, ids.data()));
+    return ids;
+}
+
+size_t Tokenizer::encode(std::string_view text, int* ids) const {
+    if (empty()) {
+        return 0;
+    }
+    const auto* p = reinterpret_cast<const uint8_t*>(text.data());
+    const size_t n = text.size();
+    size_t count = 0;
+    if (byte_level_) {
+        // 查表，不在词表中的字节不计数（被下一个覆盖），循环里没有分支
+        for (size_t i = 0; i < n; ++i) {
+            const int id = byte_ids_[p[i]];
+            ids[count] = id;
+            count += id != 0;
+        }
+        if (count < n) {
+            RWKV_LOGW("%zu bytes not in vocab, skipped", n - count);
+        }
+        return count;
+    }
+
+    const VocabUnit* units = vocab_.units;
+    const uint32_t unit_count = vocab_.unit_count;
+    size_t pos = 0;
+    while (pos < n) {
+        // 沿 trie 向下走，记下最后一个结束 token 的位置，即最长匹配
+        uint32_t s = 0;
+        int id = 0;
+        size_t len = 0;
+        for (size_t i = pos; i < n; ++i) {
+            const uint32_t t = static_cast<uint32_t>(units[s].base) + p[i];
+            if (t >= unit_count || units[t].check != static_cast<int32_t>(s)) break;
+            s = t;
+            if (units[t].id != 0) {
+                id = units[t].id;
+                len = i + 1 - pos;
+            }
+        }
+        if (id == 0) {
+            // 词表覆盖所有单字节时不会走到这里；否则跳过无法编码的字节
+            RWKV_LOGW("Byte 0x%02x not in vocab, skipped", p[pos]);
+            ++pos;
+            continue;
+        }
+        ids[count++] = id;
+        pos += len;
+    }
+    return count;
+}
+
+std::string Tokenizer::decode(const std::vector<int>& ids) const {
+    size_t total = 0;
+    for (int id : ids) total += token_bytes(id).size();
+    std::string out;
+    out.reserve(total);
+    for (int id : ids) {
+        out += token_bytes(id);
+    }
+    return out;
+}
+
+} // namespace rwkvmobile
@@ -0,0 +1,91 @@
+/**
+ * tokenizer.h
+ *
+ * RWKV "trie" tokenizer: greedy longest-match over a byte vocabulary. Vocab
+ * files use the RWKV text format, one "<id> <python literal> <byte length>"
+ * entry per line (e.g. rwkv_vocab_v20230424.txt, b_rwkv_vocab_abc.txt), or
+ * the compiled format of compiled_vocab.h. Text vocabs are compiled in
+ * memory on load; compiled ones are mapped and used in place. Encoding is a
+ * walk down the double-array trie and decoding indexes the byte table, so
+ * neither allocates per token. Vocabs made only of single bytes (the ABC
+ * music vocab) skip the trie and encode through a 256-entry table.
+ */
+
+#ifndef RWKVMOBILE_TOKENIZER_H
+#define RWKVMOBILE_TOKENIZER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "compiled_vocab.h"
+#include "mapped_file.h"
+
+namespace rwkvmobile {
+
+class Tokenizer {
+public:
+    /**
+     * Load a text or compiled vocab.
+     * @return true on success
+     */
+    bool load(const std::string& path);
+
+    /**
+     * Write the compiled form of the loaded vocab to `path`.
+     * @return false if nothing is loaded or on I/O errors (logged)
+     */
+    bool save_compiled(const std::string& path) const;
+
+    // 是否由文本词表编译而来（而不是映射的编译文件）
+    bool compiled_on_load() const { return !buffer_.empty(); }
+
+    std::vector<int> encode(std::string_view text) const;
+    // 写入 ids（至少 text.size() 个元素：每个 token 至少一个字节），返回 token 数
+    size_t encode(std::string_view text, int* ids) const;
+    std::string decode(const std::vector<int>& ids) const;
+
+    /**
+     * Bytes of token `id`, empty for unknown ids. The view points into the
+     * byte table and is followed by a NUL.
+     */
+    std::string_view token_bytes(int id) const {
+        if (id <= 0 || static_cast<uint32_t>(id) >= vocab_.vocab_size) {
+            return std::string_view("", 0);
+        }
+        const uint32_t begin = vocab_.offsets[id];
+        return std::string_view(vocab_.bytes + begin, vocab_.offsets[id + 1] - begin - 1);
+    }
+
+    // 每个 token 都是单个字节
+    bool byte_level() const { return byte_level_; }
+
+    // 双数组 trie 与字节表（约束解码按 trie 预计算 token 掩码）
+    const CompiledVocab& compiled() const { return vocab_; }
+
+    int vocab_size() const { return static_cast<int>(vocab_.vocab_size); }
+    bool empty() const { return vocab_.vocab_size == 0; }
+
+private:
+    void set_vocab(const CompiledVocab& vocab);
+
+    std::unique_ptr<MappedFile> file_;  // 编译好的词表直接映射
+    std::vector<uint8_t> buffer_;       // 文本词表在内存中编译的结果
+    CompiledVocab vocab_;               // 指向 file_ 或 buffer_
+    bool byte_level_ = false;
+    std::array<int32_t, 256> byte_ids_{};  // byte_level_ 时字节 -> id，0 表示不在词表中
+};
+
+/**
+ * Decode one Python str/bytes literal (b'\x0a', '中', "it's", ...) into
+ * raw UTF-8 bytes.
+ * @return false if `literal` is not a well-formed literal
+ */
+bool parse_python_literal(const std::string& literal, std::string& out);
+
+} // namespace rwkvmobile
+
+#endif // RWKVMOBILE_TOKENIZER_H
@@ -0,0 +1,72 @@
+/**
+ * rwkv_repack: convert an RWKV-6 safetensors model into the packed format
+ * (packed_model.h) ahead of time, so the device maps it with no conversion.
+ *
+ *   rwkv_repack <model.st> <out.rwkvpack> [--native]
+ *   rwkv_repack --verify <model.rwkvpack>
+ *
+ * Packed files are portable by default; --native records this host's CPU
+ * features as required, as the runtime does for its own cache_dir copies.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "mapped_file.h"
+#include "model.h"
+#include "packed_model.h"
+#include "platform.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+int usage() {
+    fprintf(stderr,
+            "usage: rwkv_repack <model.st> <out.rwkvpack> [--native]\n"
+            "       rwkv_repack --verify <model.rwkvpack>\n");
+    return 2;
+}
+
+int verify(const char* path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return 1;
+    }
+    ModelConfig cfg;
+    std::map<std::string, PackedTensor> tensors;
+    if (!read_packed_model(file.data(), file.size(), &cfg, &tensors)) {
+        return 1;
+    }
+    if (!verify_packed_payload(file.data(), file.size())) {
+        fprintf(stderr, "%s: payload checksum mismatch\n", path);
+        return 1;
+    }
+    printf("%s: OK, layout v%u, %zu tensors, n_layer=%d n_embd=%d vocab=%d\n", path,
+           kPackedLayoutVersion, tensors.size(), cfg.n_layer, cfg.n_embd, cfg.vocab_size);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0) {
+        return verify(argv[2]);
+    }
+    if (argc < 3 || argc > 4 || (argc == 4 && strcmp(argv[3], "--native") != 0)) {
+        return usage();
+    }
+    const uint32_t features = argc == 4 ? cpu_features() : 0;
+
+    std::unique_ptr<Model> model = Model::load(argv[1]);
+    if (!model) {
+        return 1;
+    }
+    if (!model->save_packed(argv[2], features)) {
+        return 1;
+    }
+    printf("%s -> %s (requires: %s)\n", argv[1], argv[2], cpu_feature_names(features).c_str());
+    return verify(argv[2]);
+}
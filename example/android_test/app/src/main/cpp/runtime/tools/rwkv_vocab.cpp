@@ -0,0 +1,70 @@
+/**
+ * rwkv_vocab: compile an RWKV text vocab into the compiled format
+ * (compiled_vocab.h) ahead of time, so the device maps it with no parsing.
+ *
+ *   rwkv_vocab <vocab.txt> <out.rwkvvocab>
+ *   rwkv_vocab --verify <vocab.rwkvvocab | vocab.txt>
+ *
+ * --verify checks that every token encodes to exactly one token with the
+ * same bytes.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "compiled_vocab.h"
+#include "tokenizer.h"
+
+using namespace rwkvmobile;
+
+namespace {
+
+int usage() {
+    fprintf(stderr,
+            "usage: rwkv_vocab <vocab.txt> <out.rwkvvocab>\n"
+            "       rwkv_vocab --verify <vocab.rwkvvocab | vocab.txt>\n");
+    return 2;
+}
+
+int verify(const char* path) {
+    Tokenizer tokenizer;
+    if (!tokenizer.load(path)) {
+        return 1;
+    }
+    int tokens = 0;
+    for (int id = 1; id < tokenizer.vocab_size(); ++id) {
+        const std::string_view bytes = tokenizer.token_bytes(id);
+        if (bytes.empty()) continue;
+        ++tokens;
+        // 字节相同的 token 以后出现的为准，此时 id 可以不同，但必须仍是一个 token
+        const std::vector<int> ids = tokenizer.encode(bytes);
+        if (ids.size() != 1 || tokenizer.token_bytes(ids[0]) != bytes) {
+            fprintf(stderr, "%s: token %d does not encode to itself\n", path, id);
+            return 1;
+        }
+    }
+    printf("%s: OK, layout v%u, %d tokens, vocab size %d\n", path, kVocabLayoutVersion, tokens,
+           tokenizer.vocab_size());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0) {
+        return verify(argv[2]);
+    }
+    if (argc != 3) {
+        return usage();
+    }
+    Tokenizer tokenizer;
+    if (!tokenizer.load(argv[1])) {
+        return 1;
+    }
+    if (!tokenizer.save_compiled(argv[2])) {
+        return 1;
+    }
+    printf("%s -> %s\n", argv[1], argv[2]);
+    return verify(argv[2]);
+}
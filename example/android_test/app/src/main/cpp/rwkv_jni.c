@@ -1,6 +1,9 @@
 #include <jni.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "utf8_utf16.h"
 
 // Forward declarations of rwkv_mobile functions from librwkv_mobile.so
 // These are the C functions exported by the library
@@ -22,28 +25,53 @@ extern int rwkvmobile_runtime_get_available_backend_names(char* buffer, int buff
 // Model loading
 extern int rwkvmobile_runtime_load_model(void* runtime, const char* model_path, const char* backend_name);
 extern int rwkvmobile_runtime_load_model_with_extra(void* runtime, const char* model_path, const char* backend_name, const char* extra);
-extern int rwkvmobile_runtime_release_model(void* runtime);
+extern int rwkvmobile_runtime_release_model(void* runtime, int model_id);
 
 // State management
 extern int rwkvmobile_runtime_clear_state(void* runtime);
 extern int rwkvmobile_runtime_load_initial_state(void* runtime, const char* state_path);
 extern int rwkvmobile_runtime_unload_initial_state(void* runtime);
+extern int rwkvmobile_runtime_get_state_snapshot_size(void* runtime, int codec);
+extern int rwkvmobile_runtime_save_state_to_buffer(void* runtime, int codec, void* buffer, int buffer_size);
+extern int rwkvmobile_runtime_save_state(void* runtime, const char* state_path, int codec);
+extern int rwkvmobile_runtime_restore_state_from_buffer(void* runtime, const void* buffer, int buffer_size);
+extern int rwkvmobile_runtime_restore_state(void* runtime, const char* state_path);
 
 // Prompt/Generation
 extern int rwkvmobile_runtime_set_prompt(void* runtime, const char* prompt);
 extern const char* rwkvmobile_runtime_get_prompt(void* runtime);
-extern int rwkvmobile_runtime_gen_completion(void* runtime, char* buffer, int buffer_size);
-extern int rwkvmobile_runtime_gen_completion_async(void* runtime);
+extern const char* rwkvmobile_runtime_gen_completion(void* runtime, const char* prompt, int max_tokens);
+extern int rwkvmobile_runtime_gen_completion_to_buffer(void* runtime, const char* prompt, int max_tokens,
+                                                       char* buffer, int buffer_size);
+typedef void (*rwkvmobile_token_callback_t)(const char* token, void* user_data);
+typedef void (*rwkvmobile_completion_callback_t)(int status, void* user_data);
+extern int rwkvmobile_runtime_gen_completion_async(void* runtime, const char* prompt, int max_tokens,
+                                                   rwkvmobile_token_callback_t token_callback,
+                                                   rwkvmobile_completion_callback_t completion_callback,
+                                                   void* user_data);
 extern int rwkvmobile_runtime_stop_generation(void* runtime);
 extern int rwkvmobile_runtime_is_generating(void* runtime);
 
 // Response buffer
 extern const char* rwkvmobile_runtime_get_response_buffer_content(void* runtime);
-extern void rwkvmobile_runtime_free_response_buffer(void* runtime);
+extern void rwkvmobile_runtime_free_response_buffer(char* buffer);
+extern int rwkvmobile_runtime_read_response_since(void* runtime, int offset, char* buffer, int buffer_size);
+
+// Sessions (share the runtime's model, each holds its own RWKV state)
+extern void* rwkvmobile_runtime_session_create(void* runtime);
+extern int rwkvmobile_runtime_session_destroy(void* runtime, void* session);
+extern int rwkvmobile_session_clear_state(void* session);
+extern int rwkvmobile_session_set_prompt(void* session, const char* prompt);
+extern int rwkvmobile_session_gen_completion_async(void* session, const char* prompt, int max_tokens,
+                                                   rwkvmobile_token_callback_t token_callback,
+                                                   rwkvmobile_completion_callback_t completion_callback,
+                                                   void* user_data);
+extern int rwkvmobile_session_stop_generation(void* session);
+extern int rwkvmobile_session_read_response_since(void* session, int offset, char* buffer, int buffer_size);
 
 // Sampler params
-extern int rwkvmobile_runtime_set_sampler_params(void* runtime, float temperature, float top_p, float presence_penalty, float frequency_penalty);
-extern int rwkvmobile_runtime_get_sampler_params(void* runtime, float* temperature, float* top_p, float* presence_penalty, float* frequency_penalty);
+extern int rwkvmobile_runtime_set_sampler_params(void* runtime, float temperature, float top_p, int top_k);
+extern int rwkvmobile_runtime_get_sampler_params(void* runtime, float* temperature, float* top_p, int* top_k);
 
 // Penalty params
 extern int rwkvmobile_runtime_set_penalty_params(void* runtime, float presence_penalty, float frequency_penalty, float penalty_decay);
@@ -60,11 +88,15 @@ extern int rwkvmobile_runtime_eval_chat_with_history_async(void* runtime, const
 
 // Speed stats
 extern float rwkvmobile_runtime_get_avg_prefill_speed(void* runtime);
+extern int rwkvmobile_runtime_get_prefix_cache_stats(void* runtime, uint64_t* hits, uint64_t* misses,
+                                                     uint64_t* reused_tokens, uint64_t* cached_bytes);
+extern int rwkvmobile_runtime_set_prefix_cache_capacity(void* runtime, uint64_t capacity_bytes);
+extern int rwkvmobile_runtime_set_prefill_chunk_size(void* runtime, int chunk_size);
 extern float rwkvmobile_runtime_get_avg_decode_speed(void* runtime);
 
 // Seed
-extern void rwkvmobile_runtime_set_seed(void* runtime, unsigned int seed);
-extern unsigned int rwkvmobile_runtime_get_seed(void* runtime);
+extern int rwkvmobile_runtime_set_seed(void* runtime, uint64_t seed);
+extern uint64_t rwkvmobile_runtime_get_seed(void* runtime);
 
 // Prefill progress
 extern float rwkvmobile_runtime_get_prefill_progress(void* runtime);
@@ -73,12 +105,205 @@ extern float rwkvmobile_runtime_get_prefill_progress(void* runtime);
 // JNI Implementation
 // ============================================================================
 
-// Helper to create Java String from C string (handles NULL)
+// Helper to create Java String from C string (handles NULL).
+// NewStringUTF expects modified UTF-8 and mangles 4-byte characters, so the
+// text is decoded to UTF-16 and passed to NewString instead.
 static jstring createJString(JNIEnv *env, const char* str) {
     if (str == NULL) {
         return NULL;
     }
-    return (*env)->NewStringUTF(env, str);
+    size_t len = strlen(str);
+    jchar stackBuf[256];
+    jchar* dst = stackBuf;
+    if (len > sizeof(stackBuf) / sizeof(stackBuf[0])) {
+        dst = (jchar*)malloc(len * sizeof(jchar));
+        if (dst == NULL) return NULL;
+    }
+    size_t n = utf8_to_utf16(str, len, dst, 1, NULL);
+    jstring result = (*env)->NewString(env, dst, (jsize)n);
+    if (dst != stackBuf) free(dst);
+    return result;
+}
+
+// ============================================================================
+// Streaming callbacks (generation thread -> RwkvMobile.TokenListener)
+// ============================================================================
+
+static JavaVM* g_vm = NULL;
+static jmethodID g_onToken = NULL;     // TokenListener.onToken(Ljava/lang/String;)V
+static jmethodID g_onComplete = NULL;  // TokenListener.onComplete(I)V
+
+// Per-generation context, freed by the completion callback
+typedef struct {
+    jobject listener;  // global ref
+    JNIEnv* env;       // generation thread's env, resolved on first callback
+    int attached;      // whether we attached the thread ourselves
+    char* bytes;       // incomplete UTF-8 tail carried over + current token
+    size_t bytesCap;
+    size_t pendingLen; // length of the carried-over tail at the start of bytes
+    jchar* utf16;      // UTF-16 scratch reused for the whole generation
+    size_t utf16Cap;
+} StreamContext;
+
+// Attach the generation thread once and reuse the env for every token
+static JNIEnv* streamEnv(StreamContext* ctx) {
+    if (ctx->env != NULL) {
+        return ctx->env;
+    }
+    JNIEnv* env = NULL;
+    if ((*g_vm)->GetEnv(g_vm, (void**)&env, JNI_VERSION_1_6) == JNI_EDETACHED) {
+        JavaVMAttachArgs args = {JNI_VERSION_1_6, "rwkv_generate", NULL};
+#ifdef __ANDROID__
+        if ((*g_vm)->AttachCurrentThread(g_vm, &env, &args) != JNI_OK) return NULL;
+#else
+        if ((*g_vm)->AttachCurrentThread(g_vm, (void**)&env, &args) != JNI_OK) return NULL;
+#endif
+        ctx->attached = 1;
+    }
+    ctx->env = env;
+    return env;
+}
+
+// Decode the carried-over tail plus this token and pass it to onToken.
+// An incomplete trailing character is kept for the next token.
+static void emitText(JNIEnv* env, StreamContext* ctx, const char* token, size_t len, int final) {
+    size_t total = ctx->pendingLen + len;
+    if (ctx->bytesCap < total) {
+        char* grown = (char*)realloc(ctx->bytes, total);
+        if (grown == NULL) return;
+        ctx->bytes = grown;
+        ctx->bytesCap = total;
+    }
+    if (ctx->utf16Cap < total) {
+        jchar* grown = (jchar*)realloc(ctx->utf16, total * sizeof(jchar));
+        if (grown == NULL) return;
+        ctx->utf16 = grown;
+        ctx->utf16Cap = total;
+    }
+    memcpy(ctx->bytes + ctx->pendingLen, token, len);
+    size_t consumed = 0;
+    size_t n = utf8_to_utf16(ctx->bytes, total, ctx->utf16, final, &consumed);
+    ctx->pendingLen = total - consumed;
+    memmove(ctx->bytes, ctx->bytes + consumed, ctx->pendingLen);
+    if (n == 0) {
+        return;
+    }
+    jstring text = (*env)->NewString(env, ctx->utf16, (jsize)n);
+    if (text == NULL) {
+        (*env)->ExceptionClear(env);
+        return;
+    }
+    (*env)->CallVoidMethod(env, ctx->listener, g_onToken, text);
+    if ((*env)->ExceptionCheck(env)) {
+        (*env)->ExceptionDescribe(env);
+        (*env)->ExceptionClear(env);
+    }
+    // The generation thread never returns to Java, so free local refs eagerly
+    (*env)->DeleteLocalRef(env, text);
+}
+
+// streamEnv() failed: attach once more just to drop the listener's global ref
+static void releaseListener(StreamContext* ctx) {
+    JNIEnv* env = NULL;
+    if ((*g_vm)->GetEnv(g_vm, (void**)&env, JNI_VERSION_1_6) == JNI_OK) {
+        (*env)->DeleteGlobalRef(env, ctx->listener);
+        return;
+    }
+    JavaVMAttachArgs args = {JNI_VERSION_1_6, "rwkv_generate", NULL};
+#ifdef __ANDROID__
+    if ((*g_vm)->AttachCurrentThread(g_vm, &env, &args) != JNI_OK) return;
+#else
+    if ((*g_vm)->AttachCurrentThread(g_vm, (void**)&env, &args) != JNI_OK) return;
+#endif
+    (*env)->DeleteGlobalRef(env, ctx->listener);
+    (*g_vm)->DetachCurrentThread(g_vm);
+}
+
+static void onStreamToken(const char* token, void* userData) {
+    StreamContext* ctx = (StreamContext*)userData;
+    JNIEnv* env = streamEnv(ctx);
+    if (env == NULL || token == NULL) {
+        return;
+    }
+    emitText(env, ctx, token, strlen(token), 0);
+}
+
+static void onStreamComplete(int status, void* userData) {
+    StreamContext* ctx = (StreamContext*)userData;
+    JNIEnv* env = streamEnv(ctx);
+    if (env != NULL) {
+        // A character still incomplete at the end is emitted as U+FFFD
+        if (ctx->pendingLen > 0) {
+            emitText(env, ctx, "", 0, 1);
+        }
+        (*env)->CallVoidMethod(env, ctx->listener, g_onComplete, (jint)status);
+        if ((*env)->ExceptionCheck(env)) {
+            (*env)->ExceptionDescribe(env);
+            (*env)->ExceptionClear(env);
+        }
+        (*env)->DeleteGlobalRef(env, ctx->listener);
+        if (ctx->attached) {
+            (*g_vm)->DetachCurrentThread(g_vm);
+        }
+    } else {
+        releaseListener(ctx);
+    }
+    free(ctx->bytes);
+    free(ctx->utf16);
+    free(ctx);
+}
+
+// NULL listener leaves *out NULL (no streaming); returns 0 if Kotlin cannot be called back
+static int newStreamContext(JNIEnv* env, jobject listener, StreamContext** out) {
+    *out = NULL;
+    if (listener == NULL) return 1;
+    if (g_onToken == NULL || g_onComplete == NULL) return 0;
+    StreamContext* ctx = (StreamContext*)calloc(1, sizeof(StreamContext));
+    if (ctx == NULL) return 0;
+    ctx->listener = (*env)->NewGlobalRef(env, listener);
+    *out = ctx;
+    return 1;
+}
+
+// Generation did not start, so no callback will free the context
+static void deleteStreamContext(JNIEnv* env, StreamContext* ctx) {
+    if (ctx == NULL) return;
+    (*env)->DeleteGlobalRef(env, ctx->listener);
+    free(ctx);
+}
+
+// Resolve a direct ByteBuffer's address/capacity; NULL for heap buffers
+static char* directBuffer(JNIEnv* env, jobject buffer, int* capacity) {
+    if (buffer == NULL) return NULL;
+    void* address = (*env)->GetDirectBufferAddress(env, buffer);
+    jlong size = (*env)->GetDirectBufferCapacity(env, buffer);
+    if (address == NULL || size <= 0) return NULL;
+    *capacity = size > INT32_MAX ? INT32_MAX : (int)size;
+    return (char*)address;
+}
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+    (void)reserved;
+    g_vm = vm;
+    JNIEnv* env = NULL;
+    if ((*vm)->GetEnv(vm, (void**)&env, JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    // Resolve method IDs on the loader thread so worker threads never call FindClass
+    jclass listener = (*env)->FindClass(env, "com/example/rwkvmobiletest/RwkvMobile$TokenListener");
+    if (listener == NULL) {
+        (*env)->ExceptionClear(env);
+        return JNI_VERSION_1_6;
+    }
+    g_onToken = (*env)->GetMethodID(env, listener, "onToken", "(Ljava/lang/String;)V");
+    g_onComplete = (*env)->GetMethodID(env, listener, "onComplete", "(I)V");
+    if (g_onToken == NULL || g_onComplete == NULL) {
+        (*env)->ExceptionClear(env);
+        g_onToken = NULL;
+        g_onComplete = NULL;
+    }
+    (*env)->DeleteLocalRef(env, listener);
+    return JNI_VERSION_1_6;
 }
 
 // ============================================================================
@@ -184,8 +409,8 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1load_1model_1wit
 }
 
 JNIEXPORT jint JNICALL
-Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1release_1model(JNIEnv *env, jclass clazz, jlong runtime) {
-    return rwkvmobile_runtime_release_model((void*)(intptr_t)runtime);
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1release_1model(JNIEnv *env, jclass clazz, jlong runtime, jint modelId) {
+    return rwkvmobile_runtime_release_model((void*)(intptr_t)runtime, (int)modelId);
 }
 
 // ============================================================================
@@ -211,6 +436,51 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1unload_1initial_
     return rwkvmobile_runtime_unload_initial_state((void*)(intptr_t)runtime);
 }
 
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1state_1snapshot_1size(
+        JNIEnv *env, jclass clazz, jlong runtime, jint codec) {
+    return rwkvmobile_runtime_get_state_snapshot_size((void*)(intptr_t)runtime, (int)codec);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1save_1state(
+        JNIEnv *env, jclass clazz, jlong runtime, jstring statePath, jint codec) {
+    if (statePath == NULL) return -1;
+    const char* statePathStr = (*env)->GetStringUTFChars(env, statePath, NULL);
+    int result = rwkvmobile_runtime_save_state((void*)(intptr_t)runtime, statePathStr, (int)codec);
+    (*env)->ReleaseStringUTFChars(env, statePath, statePathStr);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1restore_1state(
+        JNIEnv *env, jclass clazz, jlong runtime, jstring statePath) {
+    if (statePath == NULL) return -1;
+    const char* statePathStr = (*env)->GetStringUTFChars(env, statePath, NULL);
+    int result = rwkvmobile_runtime_restore_state((void*)(intptr_t)runtime, statePathStr);
+    (*env)->ReleaseStringUTFChars(env, statePath, statePathStr);
+    return result;
+}
+
+// Snapshots go through direct ByteBuffers: several MB that must not be copied into a byte[]
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1save_1state_1direct(
+        JNIEnv *env, jclass clazz, jlong runtime, jint codec, jobject buffer) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL) return -1;
+    return rwkvmobile_runtime_save_state_to_buffer((void*)(intptr_t)runtime, (int)codec, address, capacity);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1restore_1state_1direct(
+        JNIEnv *env, jclass clazz, jlong runtime, jobject buffer, jint size) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL || size <= 0 || size > capacity) return -1;
+    return rwkvmobile_runtime_restore_state_from_buffer((void*)(intptr_t)runtime, address, (int)size);
+}
+
 // ============================================================================
 // Prompt/Generation
 // ============================================================================
@@ -230,18 +500,40 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1prompt(JNIE
     return createJString(env, result);
 }
 
-JNIEXPORT jint JNICALL
+JNIEXPORT jstring JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion(
-        JNIEnv *env, jclass clazz, jlong runtime, jbyteArray buffer, jint bufferSize) {
-    jbyte* bufferPtr = (*env)->GetByteArrayElements(env, buffer, NULL);
-    int result = rwkvmobile_runtime_gen_completion((void*)(intptr_t)runtime, (char*)bufferPtr, (int)bufferSize);
-    (*env)->ReleaseByteArrayElements(env, buffer, bufferPtr, 0);
-    return result;
+        JNIEnv *env, jclass clazz, jlong runtime, jstring prompt, jint maxTokens) {
+    if (prompt == NULL) return NULL;
+    const char* promptStr = (*env)->GetStringUTFChars(env, prompt, NULL);
+    if (promptStr == NULL) return NULL;
+    const char* result = rwkvmobile_runtime_gen_completion((void*)(intptr_t)runtime, promptStr, (int)maxTokens);
+    (*env)->ReleaseStringUTFChars(env, prompt, promptStr);
+    if (result == NULL) return NULL;
+    jstring text = createJString(env, result);
+    // The returned buffer belongs to the caller; hand it back for reuse
+    rwkvmobile_runtime_free_response_buffer((char*)result);
+    return text;
 }
 
 JNIEXPORT jint JNICALL
-Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion_1async(JNIEnv *env, jclass clazz, jlong runtime) {
-    return rwkvmobile_runtime_gen_completion_async((void*)(intptr_t)runtime);
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion_1async(
+        JNIEnv *env, jclass clazz, jlong runtime, jstring prompt, jint maxTokens, jobject listener) {
+    if (prompt == NULL) return -1;
+    StreamContext* ctx = NULL;
+    if (!newStreamContext(env, listener, &ctx)) return -1;
+
+    const char* promptStr = (*env)->GetStringUTFChars(env, prompt, NULL);
+    if (promptStr == NULL) {
+        deleteStreamContext(env, ctx);
+        return -1;
+    }
+    int result = rwkvmobile_runtime_gen_completion_async(
+        (void*)(intptr_t)runtime, promptStr, (int)maxTokens,
+        ctx ? onStreamToken : NULL, ctx ? onStreamComplete : NULL, ctx);
+    (*env)->ReleaseStringUTFChars(env, prompt, promptStr);
+
+    if (result != 0) deleteStreamContext(env, ctx);
+    return result;
 }
 
 JNIEXPORT jint JNICALL
@@ -264,9 +556,78 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1response_1b
     return createJString(env, result);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1free_1response_1buffer(JNIEnv *env, jclass clazz, jlong runtime) {
-    rwkvmobile_runtime_free_response_buffer((void*)(intptr_t)runtime);
+// Poll-style streaming: copies only the bytes appended after `offset`
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1read_1response_1since(
+        JNIEnv *env, jclass clazz, jlong runtime, jint offset, jobject buffer) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL) return -1;
+    return rwkvmobile_runtime_read_response_since((void*)(intptr_t)runtime, (int)offset, address, capacity);
+}
+
+// ============================================================================
+// Sessions
+// ============================================================================
+
+JNIEXPORT jlong JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1session_1create(JNIEnv *env, jclass clazz, jlong runtime) {
+    return (jlong)(intptr_t)rwkvmobile_runtime_session_create((void*)(intptr_t)runtime);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1session_1destroy(
+        JNIEnv *env, jclass clazz, jlong runtime, jlong session) {
+    return rwkvmobile_runtime_session_destroy((void*)(intptr_t)runtime, (void*)(intptr_t)session);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1clear_1state(JNIEnv *env, jclass clazz, jlong session) {
+    return rwkvmobile_session_clear_state((void*)(intptr_t)session);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1set_1prompt(
+        JNIEnv *env, jclass clazz, jlong session, jstring prompt) {
+    const char* promptStr = prompt != NULL ? (*env)->GetStringUTFChars(env, prompt, NULL) : NULL;
+    int result = rwkvmobile_session_set_prompt((void*)(intptr_t)session, promptStr);
+    if (promptStr != NULL) (*env)->ReleaseStringUTFChars(env, prompt, promptStr);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1gen_1completion_1async(
+        JNIEnv *env, jclass clazz, jlong session, jstring prompt, jint maxTokens, jobject listener) {
+    if (prompt == NULL) return -1;
+    StreamContext* ctx = NULL;
+    if (!newStreamContext(env, listener, &ctx)) return -1;
+
+    const char* promptStr = (*env)->GetStringUTFChars(env, prompt, NULL);
+    if (promptStr == NULL) {
+        deleteStreamContext(env, ctx);
+        return -1;
+    }
+    int result = rwkvmobile_session_gen_completion_async(
+        (void*)(intptr_t)session, promptStr, (int)maxTokens,
+        ctx ? onStreamToken : NULL, ctx ? onStreamComplete : NULL, ctx);
+    (*env)->ReleaseStringUTFChars(env, prompt, promptStr);
+
+    if (result != 0) deleteStreamContext(env, ctx);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1stop_1generation(JNIEnv *env, jclass clazz, jlong session) {
+    return rwkvmobile_session_stop_generation((void*)(intptr_t)session);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1read_1response_1since(
+        JNIEnv *env, jclass clazz, jlong session, jint offset, jobject buffer) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL) return -1;
+    return rwkvmobile_session_read_response_since((void*)(intptr_t)session, (int)offset, address, capacity);
 }
 
 // ============================================================================
@@ -276,26 +637,28 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1free_1response_1
 JNIEXPORT jint JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1sampler_1params(
         JNIEnv *env, jclass clazz, jlong runtime, 
-        jfloat temperature, jfloat topP, jfloat presencePenalty, jfloat frequencyPenalty) {
+        jfloat temperature, jfloat topP, jint topK) {
     return rwkvmobile_runtime_set_sampler_params(
         (void*)(intptr_t)runtime, 
-        (float)temperature, (float)topP, (float)presencePenalty, (float)frequencyPenalty
+        (float)temperature, (float)topP, (int)topK
     );
 }
 
 JNIEXPORT jfloatArray JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1sampler_1params(JNIEnv *env, jclass clazz, jlong runtime) {
-    float temperature, topP, presencePenalty, frequencyPenalty;
+    float temperature, topP;
+    int topK;
     int result = rwkvmobile_runtime_get_sampler_params(
         (void*)(intptr_t)runtime, 
-        &temperature, &topP, &presencePenalty, &frequencyPenalty
+        &temperature, &topP, &topK
     );
     
     if (result < 0) return NULL;
     
-    jfloatArray params = (*env)->NewFloatArray(env, 4);
-    jfloat values[4] = {temperature, topP, presencePenalty, frequencyPenalty};
-    (*env)->SetFloatArrayRegion(env, params, 0, 4, values);
+    jfloatArray params = (*env)->NewFloatArray(env, 3);
+    if (params == NULL) return NULL;
+    jfloat values[3] = {temperature, topP, (jfloat)topK};
+    (*env)->SetFloatArrayRegion(env, params, 0, 3, values);
     return params;
 }
 
@@ -391,6 +754,34 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1avg_1prefil
     return rwkvmobile_runtime_get_avg_prefill_speed((void*)(intptr_t)runtime);
 }
 
+// Returns [hits, misses, reusedTokens, cachedBytes]
+JNIEXPORT jlongArray JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1prefix_1cache_1stats(JNIEnv *env, jclass clazz, jlong runtime) {
+    uint64_t hits, misses, reusedTokens, cachedBytes;
+    if (rwkvmobile_runtime_get_prefix_cache_stats((void*)(intptr_t)runtime,
+                                                  &hits, &misses, &reusedTokens, &cachedBytes) < 0) {
+        return NULL;
+    }
+    jlongArray stats = (*env)->NewLongArray(env, 4);
+    if (stats == NULL) return NULL;
+    jlong values[4] = {(jlong)hits, (jlong)misses, (jlong)reusedTokens, (jlong)cachedBytes};
+    (*env)->SetLongArrayRegion(env, stats, 0, 4, values);
+    return stats;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1prefix_1cache_1capacity(
+        JNIEnv *env, jclass clazz, jlong runtime, jlong capacityBytes) {
+    if (capacityBytes < 0) return -1;
+    return rwkvmobile_runtime_set_prefix_cache_capacity((void*)(intptr_t)runtime, (uint64_t)capacityBytes);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1prefill_1chunk_1size(
+        JNIEnv *env, jclass clazz, jlong runtime, jint chunkSize) {
+    return rwkvmobile_runtime_set_prefill_chunk_size((void*)(intptr_t)runtime, chunkSize);
+}
+
 JNIEXPORT jfloat JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1avg_1decode_1speed(JNIEnv *env, jclass clazz, jlong runtime) {
     return rwkvmobile_runtime_get_avg_decode_speed((void*)(intptr_t)runtime);
@@ -400,14 +791,14 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1avg_1decode
 // Seed
 // ============================================================================
 
-JNIEXPORT void JNICALL
-Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1seed(JNIEnv *env, jclass clazz, jlong runtime, jint seed) {
-    rwkvmobile_runtime_set_seed((void*)(intptr_t)runtime, (unsigned int)seed);
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1seed(JNIEnv *env, jclass clazz, jlong runtime, jlong seed) {
+    return rwkvmobile_runtime_set_seed((void*)(intptr_t)runtime, (uint64_t)seed);
 }
 
-JNIEXPORT jint JNICALL
+JNIEXPORT jlong JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1seed(JNIEnv *env, jclass clazz, jlong runtime) {
-    return (jint)rwkvmobile_runtime_get_seed((void*)(intptr_t)runtime);
+    return (jlong)rwkvmobile_runtime_get_seed((void*)(intptr_t)runtime);
 }
 
 // ============================================================================
@@ -418,3 +809,49 @@ JNIEXPORT jfloat JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1prefill_1progress(JNIEnv *env, jclass clazz, jlong runtime) {
     return rwkvmobile_runtime_get_prefill_progress((void*)(intptr_t)runtime);
 }
+
+// ============================================================================
+// Direct ByteBuffer variants: native code writes straight into the buffer
+// (always from offset 0, position is ignored) and returns the byte count
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1available_1backend_1names_1direct(
+        JNIEnv *env, jclass clazz, jobject buffer) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL) return -1;
+    return rwkvmobile_runtime_get_available_backend_names(address, capacity);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion_1direct(
+        JNIEnv *env, jclass clazz, jlong runtime, jstring prompt, jint maxTokens, jobject buffer) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL || prompt == NULL) return -1;
+    const char* promptStr = (*env)->GetStringUTFChars(env, prompt, NULL);
+    if (promptStr == NULL) return -1;
+    int result = rwkvmobile_runtime_gen_completion_to_buffer(
+        (void*)(intptr_t)runtime, promptStr, (int)maxTokens, address, capacity);
+    (*env)->ReleaseStringUTFChars(env, prompt, promptStr);
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1dump_1log_1direct(
+        JNIEnv *env, jclass clazz, jobject buffer) {
+    int capacity = 0;
+    char* address = directBuffer(env, buffer, &capacity);
+    if (address == NULL) return -1;
+    const char* log = rwkvmobile_dump_log();
+    if (log == NULL) return 0;
+    // Keep the newest part of the log when it does not fit
+    size_t len = strlen(log);
+    if (len > (size_t)capacity) {
+        log += len - (size_t)capacity;
+        len = (size_t)capacity;
+    }
+    memcpy(address, log, len);
+    return (jint)len;
+}
@@ -1,11 +1,27 @@
 #include <jni.h>
 #include <string>
+#include <cstdint>
 #include <cstring>
-#include <android/log.h>
+#include <vector>
+
+#include "utf8_utf16.h"
 
 #define LOG_TAG "RWKV_JNI"
+#ifdef __ANDROID__
+#include <android/log.h>
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+// 主机构建 (JDK + in-tree runtime) 时输出到 stderr
+#include <cstdio>
+#define LOGE(...) do { fprintf(stderr, "[" LOG_TAG "] " __VA_ARGS__); fputc('\n', stderr); } while (0)
+#ifdef RWKV_JNI_QUIET
+// 微基准 (bench/) 中不输出普通日志，避免计时循环里的 stderr 写入
+#define LOGI(...) do { } while (0)
+#else
+#define LOGI(...) LOGE(__VA_ARGS__)
+#endif
+#endif
 
 // 声明 librwkv_mobile.so 中的 C 函数
 extern "C" {
@@ -18,17 +34,400 @@ extern "C" {
     
     // 日志
     void rwkvmobile_set_loglevel(int loglevel);
-    
+    void rwkvmobile_set_cache_dir(const char* path);
+
     // Runtime API
     typedef void* rwkvmobile_runtime_t;
     rwkvmobile_runtime_t rwkvmobile_runtime_init();
     int rwkvmobile_runtime_release(rwkvmobile_runtime_t runtime);
     int rwkvmobile_runtime_get_available_backend_names(char* buffer, int buffer_size);
+    int rwkvmobile_runtime_set_qnn_library_path(rwkvmobile_runtime_t runtime, const char* path);
+    int rwkvmobile_runtime_add_adsp_library_path(rwkvmobile_runtime_t runtime, const char* path);
+
+    // 模型与状态
+    int rwkvmobile_runtime_load_model(rwkvmobile_runtime_t runtime, const char* model_path,
+                                      const char* backend_name);
+    int rwkvmobile_runtime_load_model_with_extra(rwkvmobile_runtime_t runtime, const char* model_path,
+                                                 const char* backend_name, const char* extra_params);
+    int rwkvmobile_runtime_release_model(rwkvmobile_runtime_t runtime, int model_id);
+    int rwkvmobile_runtime_clear_state(rwkvmobile_runtime_t runtime);
+    int rwkvmobile_runtime_load_initial_state(rwkvmobile_runtime_t runtime, const char* state_path);
+    int rwkvmobile_runtime_unload_initial_state(rwkvmobile_runtime_t runtime);
+
+    // 生成控制与同步生成
+    int rwkvmobile_runtime_is_generating(rwkvmobile_runtime_t runtime);
+    int rwkvmobile_runtime_stop_generation(rwkvmobile_runtime_t runtime);
+    const char* rwkvmobile_runtime_gen_completion(rwkvmobile_runtime_t runtime, const char* prompt,
+                                                  int max_tokens);
+    void rwkvmobile_runtime_free_response_buffer(char* buffer);
+    const char* rwkvmobile_runtime_get_response_buffer_content(rwkvmobile_runtime_t runtime);
+
+    // 采样参数与对话格式
+    int rwkvmobile_runtime_set_sampler_params(rwkvmobile_runtime_t runtime, float temperature, float top_p,
+                                              int top_k);
+    int rwkvmobile_runtime_get_sampler_params(rwkvmobile_runtime_t runtime, float* temperature, float* top_p,
+                                              int* top_k);
+    int rwkvmobile_runtime_set_prompt(rwkvmobile_runtime_t runtime, const char* prompt);
+    const char* rwkvmobile_runtime_get_prompt(rwkvmobile_runtime_t runtime);
+    int rwkvmobile_runtime_set_bos_token(rwkvmobile_runtime_t runtime, const char* token);
+    int rwkvmobile_runtime_set_eos_token(rwkvmobile_runtime_t runtime, const char* token);
+    int rwkvmobile_runtime_set_user_role(rwkvmobile_runtime_t runtime, const char* role);
+    int rwkvmobile_runtime_set_response_role(rwkvmobile_runtime_t runtime, const char* role);
+
+    // 速度、进度与随机种子
+    float rwkvmobile_runtime_get_avg_decode_speed(rwkvmobile_runtime_t runtime);
+    float rwkvmobile_runtime_get_avg_prefill_speed(rwkvmobile_runtime_t runtime);
+    float rwkvmobile_runtime_get_prefill_progress(rwkvmobile_runtime_t runtime);
+    int rwkvmobile_runtime_set_seed(rwkvmobile_runtime_t runtime, uint64_t seed);
+    uint64_t rwkvmobile_runtime_get_seed(rwkvmobile_runtime_t runtime);
+
+    // 同步生成，直接写入调用方提供的缓冲区
+    int rwkvmobile_runtime_gen_completion_to_buffer(rwkvmobile_runtime_t runtime,
+                                                    const char* prompt,
+                                                    int max_tokens,
+                                                    char* buffer,
+                                                    int buffer_size);
+
+    // 增量读取响应缓冲区
+    int rwkvmobile_runtime_read_response_since(rwkvmobile_runtime_t runtime,
+                                               int offset,
+                                               char* buffer,
+                                               int buffer_size);
+
+    // token 记录（每条 32 字节，布局见 rwkv_mobile.h）与回复容量
+    typedef struct {
+        uint64_t index;
+        uint64_t offset;
+        int64_t timestamp_us;
+        int32_t token_id;
+        uint32_t length;
+    } rwkvmobile_token_record_t;
+    int rwkvmobile_runtime_read_tokens(rwkvmobile_runtime_t runtime, uint64_t first,
+                                       rwkvmobile_token_record_t* records, int max_records);
+    int rwkvmobile_runtime_set_response_capacity(rwkvmobile_runtime_t runtime, uint64_t capacity_bytes);
+
+    // 异步生成（回调）
+    typedef void (*rwkvmobile_token_callback_t)(const char* token, void* user_data);
+    typedef void (*rwkvmobile_completion_callback_t)(int status, void* user_data);
+    int rwkvmobile_runtime_gen_completion_async(rwkvmobile_runtime_t runtime,
+                                                const char* prompt,
+                                                int max_tokens,
+                                                rwkvmobile_token_callback_t token_callback,
+                                                rwkvmobile_completion_callback_t completion_callback,
+                                                void* user_data);
+
+    // 状态快照
+    int rwkvmobile_runtime_get_state_snapshot_size(rwkvmobile_runtime_t runtime, int codec);
+    int rwkvmobile_runtime_save_state_to_buffer(rwkvmobile_runtime_t runtime, int codec,
+                                                void* buffer, int buffer_size);
+    int rwkvmobile_runtime_save_state(rwkvmobile_runtime_t runtime, const char* state_path, int codec);
+    int rwkvmobile_runtime_restore_state_from_buffer(rwkvmobile_runtime_t runtime,
+                                                     const void* buffer, int buffer_size);
+    int rwkvmobile_runtime_restore_state(rwkvmobile_runtime_t runtime, const char* state_path);
+
+    // 前缀缓存
+    int rwkvmobile_runtime_get_prefix_cache_stats(rwkvmobile_runtime_t runtime,
+                                                  uint64_t* hits,
+                                                  uint64_t* misses,
+                                                  uint64_t* reused_tokens,
+                                                  uint64_t* cached_bytes);
+    int rwkvmobile_runtime_set_prefix_cache_capacity(rwkvmobile_runtime_t runtime, uint64_t capacity_bytes);
+
+    // 性能统计：桥接只用到开头的 version / size，其余字段（布局见 rwkv_mobile.h）由 runtime 按 size 填写
+    typedef struct {
+        uint32_t version;
+        uint32_t size;
+    } rwkvmobile_perf_stats_t;
+    int rwkvmobile_runtime_get_perf_stats(rwkvmobile_runtime_t runtime, rwkvmobile_perf_stats_t* stats);
+    int rwkvmobile_runtime_set_kernel_profiling(rwkvmobile_runtime_t runtime, int enabled);
+
+    int rwkvmobile_runtime_set_prefill_chunk_size(rwkvmobile_runtime_t runtime, int chunk_size);
+    int rwkvmobile_runtime_set_threads(rwkvmobile_runtime_t runtime, int threads, int affinity);
+
+    // 重复惩罚
+    int rwkvmobile_runtime_set_penalty_params(rwkvmobile_runtime_t runtime, float presence_penalty,
+                                              float frequency_penalty, float penalty_decay);
+    int rwkvmobile_runtime_get_penalty_params(rwkvmobile_runtime_t runtime, float* presence_penalty,
+                                              float* frequency_penalty, float* penalty_decay);
+
+    // 约束解码
+    int rwkvmobile_runtime_set_constraint(rwkvmobile_runtime_t runtime, const char* regex);
+
+    // 投机解码
+    int rwkvmobile_runtime_set_draft_model(rwkvmobile_runtime_t runtime, int model_id, int draft_tokens);
+    int rwkvmobile_runtime_get_speculative_stats(rwkvmobile_runtime_t runtime,
+                                                 uint64_t* passes,
+                                                 uint64_t* drafted,
+                                                 uint64_t* accepted);
+
+    // 会话：共享模型，各自持有 RWKV 状态
+    typedef void* rwkvmobile_session_t;
+    rwkvmobile_session_t rwkvmobile_runtime_session_create(rwkvmobile_runtime_t runtime);
+    int rwkvmobile_runtime_session_destroy(rwkvmobile_runtime_t runtime, rwkvmobile_session_t session);
+    int rwkvmobile_session_clear_state(rwkvmobile_session_t session);
+    int rwkvmobile_session_set_prompt(rwkvmobile_session_t session, const char* prompt);
+    int rwkvmobile_session_gen_completion_async(rwkvmobile_session_t session,
+                                                const char* prompt,
+                                                int max_tokens,
+                                                rwkvmobile_token_callback_t token_callback,
+                                                rwkvmobile_completion_callback_t completion_callback,
+                                                void* user_data);
+    int rwkvmobile_session_stop_generation(rwkvmobile_session_t session);
+    int rwkvmobile_session_read_response_since(rwkvmobile_session_t session,
+                                               int offset,
+                                               char* buffer,
+                                               int buffer_size);
+    int rwkvmobile_session_read_tokens(rwkvmobile_session_t session, uint64_t first,
+                                       rwkvmobile_token_record_t* records, int max_records);
+}
+
+// ============================================================================
+// 流式回调桥接：把生成线程上的 token 回调转发给 Kotlin 的 TokenListener
+// ============================================================================
+
+namespace {
+
+JavaVM* g_vm = nullptr;
+jmethodID g_on_token = nullptr;      // TokenListener.onToken(Ljava/lang/String;)V
+jmethodID g_on_complete = nullptr;   // TokenListener.onComplete(I)V
+
+// 一次异步生成的上下文，在 completion 回调中释放
+struct StreamContext {
+    jobject listener = nullptr;  // global ref
+    JNIEnv* env = nullptr;       // 生成线程的 JNIEnv，首次回调时获取
+    bool attached = false;       // 是否由我们 attach 到 JVM
+    std::string pending;         // 跨 token 的不完整 UTF-8 字符
+    std::vector<jchar> utf16;    // 转换用的 UTF-16 缓冲区，整个生成过程复用
+};
+
+// 把标准 UTF-8 转成 jstring。NewStringUTF 只接受 modified UTF-8，
+// 会破坏 emoji 等 4 字节字符，因此先解码为 UTF-16 再调用 NewString
+jstring new_string_utf8(JNIEnv* env, const char* s, size_t len) {
+    jchar stack[256];
+    std::vector<jchar> heap;
+    jchar* dst = stack;
+    if (len > sizeof(stack) / sizeof(stack[0])) {
+        heap.resize(len);
+        dst = heap.data();
+    }
+    const size_t n = utf8_to_utf16(s, len, dst, 1, nullptr);
+    return env->NewString(dst, static_cast<jsize>(n));
+}
+
+// 生成线程在整个生成过程中只 attach 一次
+JNIEnv* stream_env(StreamContext* ctx) {
+    if (ctx->env != nullptr) {
+        return ctx->env;
+    }
+    JNIEnv* env = nullptr;
+    if (g_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        JavaVMAttachArgs args{JNI_VERSION_1_6, const_cast<char*>("rwkv_generate"), nullptr};
+#ifdef __ANDROID__
+        jint ret = g_vm->AttachCurrentThread(&env, &args);
+#else
+        jint ret = g_vm->AttachCurrentThread(reinterpret_cast<void**>(&env), &args);
+#endif
+        if (ret != JNI_OK) {
+            LOGE("AttachCurrentThread failed: %d", ret);
+            return nullptr;
+        }
+        ctx->attached = true;
+    }
+    ctx->env = env;
+    return env;
+}
+
+// 解码 ctx->pending + bytes 并交给 onToken；不完整的尾部字符留到下一个 token
+void emit_text(JNIEnv* env, StreamContext* ctx, const char* bytes, size_t len, bool final) {
+    const char* src = bytes;
+    if (!ctx->pending.empty()) {
+        ctx->pending.append(bytes, len);
+        src = ctx->pending.data();
+        len = ctx->pending.size();
+    }
+    if (ctx->utf16.size() < len) {
+        ctx->utf16.resize(len);
+    }
+    size_t consumed = 0;
+    const size_t n = utf8_to_utf16(src, len, ctx->utf16.data(), final ? 1 : 0, &consumed);
+    std::string rest(src + consumed, len - consumed);
+    ctx->pending.swap(rest);
+    if (n == 0) {
+        return;
+    }
+    jstring text = env->NewString(ctx->utf16.data(), static_cast<jsize>(n));
+    if (text == nullptr) {
+        env->ExceptionClear();
+        return;
+    }
+    env->CallVoidMethod(ctx->listener, g_on_token, text);
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        env->ExceptionClear();
+    }
+    // 生成线程不会返回 Java，局部引用必须手动释放
+    env->DeleteLocalRef(text);
+}
+
+// stream_env() 失败时仍要释放 listener 的全局引用：再 attach 一次，删除后立即 detach
+void release_listener(StreamContext* ctx) {
+    JNIEnv* env = nullptr;
+    jint ret = g_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
+    if (ret == JNI_OK) {
+        env->DeleteGlobalRef(ctx->listener);
+        return;
+    }
+    JavaVMAttachArgs args{JNI_VERSION_1_6, const_cast<char*>("rwkv_generate"), nullptr};
+#ifdef __ANDROID__
+    ret = g_vm->AttachCurrentThread(&env, &args);
+#else
+    ret = g_vm->AttachCurrentThread(reinterpret_cast<void**>(&env), &args);
+#endif
+    if (ret != JNI_OK) {
+        LOGE("AttachCurrentThread failed: %d, listener global ref leaked", ret);
+        return;
+    }
+    env->DeleteGlobalRef(ctx->listener);
+    g_vm->DetachCurrentThread();
+}
+
+void on_stream_token(const char* token, void* user_data) {
+    auto* ctx = static_cast<StreamContext*>(user_data);
+    JNIEnv* env = stream_env(ctx);
+    if (env == nullptr || token == nullptr) {
+        return;
+    }
+    emit_text(env, ctx, token, strlen(token), false);
+}
+
+void on_stream_complete(int status, void* user_data) {
+    auto* ctx = static_cast<StreamContext*>(user_data);
+    JNIEnv* env = stream_env(ctx);
+    if (env != nullptr) {
+        // 生成结束时仍不完整的字符按 U+FFFD 输出
+        if (!ctx->pending.empty()) {
+            emit_text(env, ctx, "", 0, true);
+        }
+        env->CallVoidMethod(ctx->listener, g_on_complete, static_cast<jint>(status));
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        env->DeleteGlobalRef(ctx->listener);
+        if (ctx->attached) {
+            g_vm->DetachCurrentThread();
+        }
+    } else {
+        release_listener(ctx);
+    }
+    delete ctx;
+}
+
+// listener 为空时 *out 为 nullptr（不流式回调）；返回 false 表示无法回调 Kotlin
+bool new_stream_context(JNIEnv* env, jobject listener, StreamContext** out) {
+    *out = nullptr;
+    if (listener == nullptr) {
+        return true;
+    }
+    if (g_on_token == nullptr || g_on_complete == nullptr) {
+        LOGE("TokenListener methods not resolved");
+        return false;
+    }
+    auto* ctx = new StreamContext();
+    ctx->listener = env->NewGlobalRef(listener);
+    *out = ctx;
+    return true;
+}
+
+// 生成未能启动时释放上下文（回调不会被调用）
+void delete_stream_context(JNIEnv* env, StreamContext* ctx) {
+    if (ctx == nullptr) {
+        return;
+    }
+    env->DeleteGlobalRef(ctx->listener);
+    delete ctx;
+}
+
+// 解析 direct ByteBuffer 的地址与容量；非 direct buffer 返回 nullptr
+char* direct_buffer(JNIEnv* env, jobject buffer, int* capacity) {
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    void* address = env->GetDirectBufferAddress(buffer);
+    jlong size = env->GetDirectBufferCapacity(buffer);
+    if (address == nullptr || size <= 0) {
+        return nullptr;
+    }
+    *capacity = size > INT32_MAX ? INT32_MAX : static_cast<int>(size);
+    return static_cast<char*>(address);
+}
+
+// 把 direct ByteBuffer 当作 token 记录数组；*capacity 为能放下的条数
+rwkvmobile_token_record_t* token_records(JNIEnv* env, jobject buffer, int* capacity) {
+    int bytes = 0;
+    char* address = direct_buffer(env, buffer, &bytes);
+    if (address == nullptr) {
+        LOGE("Buffer is null or not a direct ByteBuffer");
+        return nullptr;
+    }
+    // ByteBuffer.allocateDirect 的地址按 8 字节对齐；slice() 之后可能不是
+    if (reinterpret_cast<uintptr_t>(address) % alignof(rwkvmobile_token_record_t) != 0) {
+        LOGE("Token record buffer is not 8-byte aligned");
+        return nullptr;
+    }
+    *capacity = bytes / static_cast<int>(sizeof(rwkvmobile_token_record_t));
+    return reinterpret_cast<rwkvmobile_token_record_t*>(address);
+}
+
+// 以 str 的 UTF-8 内容调用 fn；str 为空或取不到字符时返回 -1，不调用 fn
+template <typename Fn>
+jint with_utf8(JNIEnv* env, jstring str, Fn fn) {
+    if (str == nullptr) {
+        return -1;
+    }
+    const char* chars = env->GetStringUTFChars(str, nullptr);
+    if (chars == nullptr) {
+        return -1;
+    }
+    const int result = fn(chars);
+    env->ReleaseStringUTFChars(str, chars);
+    return static_cast<jint>(result);
 }
 
+// 运行时持有的字符串（prompt、回复内容）转成 jstring，空指针返回 null
+jstring new_string_or_null(JNIEnv* env, const char* s) {
+    return s != nullptr ? new_string_utf8(env, s, strlen(s)) : nullptr;
+}
+
+} // namespace
+
 // JNI 函数实现
 extern "C" {
 
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    g_vm = vm;
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    // 在加载线程上解析并缓存 jmethodID，生成线程无需 FindClass
+    jclass listener = env->FindClass("com/example/rwkvmobiletest/RwkvMobile$TokenListener");
+    if (listener == nullptr) {
+        env->ExceptionClear();
+        LOGE("TokenListener class not found, streaming disabled");
+        return JNI_VERSION_1_6;
+    }
+    g_on_token = env->GetMethodID(listener, "onToken", "(Ljava/lang/String;)V");
+    g_on_complete = env->GetMethodID(listener, "onComplete", "(I)V");
+    if (g_on_token == nullptr || g_on_complete == nullptr) {
+        env->ExceptionClear();
+        g_on_token = nullptr;
+        g_on_complete = nullptr;
+    }
+    env->DeleteLocalRef(listener);
+    return JNI_VERSION_1_6;
+}
+
 JNIEXPORT jstring JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1get_1platform_1name(
         JNIEnv *env, jobject /* this */) {
@@ -36,7 +435,7 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1get_1platform_1name(
     if (result == nullptr) {
         return env->NewStringUTF("Unknown");
     }
-    jstring jstr = env->NewStringUTF(result);
+    jstring jstr = new_string_utf8(env, result, strlen(result));
     // Note: 根据库的实现，可能需要 free(result) 或不需要
     return jstr;
 }
@@ -48,7 +447,7 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1get_1soc_1name(
     if (result == nullptr) {
         return env->NewStringUTF("Unknown");
     }
-    jstring jstr = env->NewStringUTF(result);
+    jstring jstr = new_string_utf8(env, result, strlen(result));
     return jstr;
 }
 
@@ -59,7 +458,7 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1get_1soc_1partname(
     if (result == nullptr) {
         return env->NewStringUTF("Unknown");
     }
-    jstring jstr = env->NewStringUTF(result);
+    jstring jstr = new_string_utf8(env, result, strlen(result));
     return jstr;
 }
 
@@ -70,7 +469,7 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1get_1htp_1arch(
     if (result == nullptr) {
         return env->NewStringUTF("Unknown");
     }
-    jstring jstr = env->NewStringUTF(result);
+    jstring jstr = new_string_utf8(env, result, strlen(result));
     return jstr;
 }
 
@@ -81,7 +480,7 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1dump_1log(
     if (result == nullptr) {
         return env->NewStringUTF("");
     }
-    jstring jstr = env->NewStringUTF(result);
+    jstring jstr = new_string_utf8(env, result, strlen(result));
     return jstr;
 }
 
@@ -91,6 +490,15 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1set_1loglevel(
     rwkvmobile_set_loglevel(static_cast<int>(level));
 }
 
+JNIEXPORT void JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1set_1cache_1dir(
+        JNIEnv *env, jobject /* this */, jstring path) {
+    with_utf8(env, path, [](const char* s) {
+        rwkvmobile_set_cache_dir(s);
+        return 0;
+    });
+}
+
 JNIEXPORT jlong JNICALL
 Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1init(
         JNIEnv *env, jobject /* this */) {
@@ -138,9 +546,704 @@ Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1available_1
     
     // 释放 byte array
     env->ReleaseByteArrayElements(buffer, bufferPtr, 0);
-    
+
     return static_cast<jint>(result);
 }
 
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1qnn_1library_1path(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring path) {
+    return with_utf8(env, path, [runtime](const char* s) {
+        return rwkvmobile_runtime_set_qnn_library_path(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1add_1adsp_1library_1path(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring path) {
+    return with_utf8(env, path, [runtime](const char* s) {
+        return rwkvmobile_runtime_add_adsp_library_path(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+// ============================================================================
+// 模型加载与状态
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1load_1model(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring modelPath, jstring backendName) {
+    return with_utf8(env, modelPath, [&](const char* path) {
+        return with_utf8(env, backendName, [&](const char* backend) {
+            const int result = rwkvmobile_runtime_load_model(
+                reinterpret_cast<rwkvmobile_runtime_t>(runtime), path, backend);
+            LOGI("load_model result: %d", result);
+            return result;
+        });
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1load_1model_1with_1extra(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring modelPath, jstring backendName,
+        jstring extraParams) {
+    return with_utf8(env, modelPath, [&](const char* path) {
+        return with_utf8(env, backendName, [&](const char* backend) {
+            // extraParams 可以为 null
+            const char* extra = extraParams != nullptr ? env->GetStringUTFChars(extraParams, nullptr) : nullptr;
+            if (extraParams != nullptr && extra == nullptr) {
+                return -1;
+            }
+            const int result = rwkvmobile_runtime_load_model_with_extra(
+                reinterpret_cast<rwkvmobile_runtime_t>(runtime), path, backend, extra);
+            if (extra != nullptr) {
+                env->ReleaseStringUTFChars(extraParams, extra);
+            }
+            LOGI("load_model_with_extra result: %d", result);
+            return result;
+        });
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1release_1model(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint modelId) {
+    return static_cast<jint>(rwkvmobile_runtime_release_model(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(modelId)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1clear_1state(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return static_cast<jint>(rwkvmobile_runtime_clear_state(reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1load_1initial_1state(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring statePath) {
+    return with_utf8(env, statePath, [runtime](const char* s) {
+        return rwkvmobile_runtime_load_initial_state(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1unload_1initial_1state(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return static_cast<jint>(rwkvmobile_runtime_unload_initial_state(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+// ============================================================================
+// 生成控制与同步生成
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1is_1generating(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return static_cast<jint>(rwkvmobile_runtime_is_generating(reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1stop_1generation(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return static_cast<jint>(rwkvmobile_runtime_stop_generation(reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring prompt, jint maxTokens) {
+    if (prompt == nullptr) {
+        LOGE("Prompt is null");
+        return nullptr;
+    }
+    const char* promptStr = env->GetStringUTFChars(prompt, nullptr);
+    if (promptStr == nullptr) {
+        return nullptr;
+    }
+    const char* result = rwkvmobile_runtime_gen_completion(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), promptStr, static_cast<int>(maxTokens));
+    env->ReleaseStringUTFChars(prompt, promptStr);
+    if (result == nullptr) {
+        return nullptr;
+    }
+    jstring text = new_string_utf8(env, result, strlen(result));
+    // 返回的缓冲区归调用方所有，交还给运行时复用
+    rwkvmobile_runtime_free_response_buffer(const_cast<char*>(result));
+    return text;
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1response_1buffer_1content(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return new_string_or_null(env, rwkvmobile_runtime_get_response_buffer_content(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+// ============================================================================
+// 采样参数与对话格式
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1sampler_1params(
+        JNIEnv *env, jobject /* this */, jlong runtime, jfloat temperature, jfloat topP, jint topK) {
+    return static_cast<jint>(rwkvmobile_runtime_set_sampler_params(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), temperature, topP, static_cast<int>(topK)));
+}
+
+// 返回 [temperature, topP, topK]
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1sampler_1params(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    float temperature = 0.f;
+    float topP = 0.f;
+    int topK = 0;
+    if (rwkvmobile_runtime_get_sampler_params(reinterpret_cast<rwkvmobile_runtime_t>(runtime),
+                                              &temperature, &topP, &topK) < 0) {
+        return nullptr;
+    }
+    jfloatArray params = env->NewFloatArray(3);
+    if (params == nullptr) {
+        return nullptr;
+    }
+    const jfloat values[3] = {temperature, topP, static_cast<jfloat>(topK)};
+    env->SetFloatArrayRegion(params, 0, 3, values);
+    return params;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1prompt(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring prompt) {
+    return with_utf8(env, prompt, [runtime](const char* s) {
+        return rwkvmobile_runtime_set_prompt(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+JNIEXPORT jstring JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1prompt(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return new_string_or_null(env, rwkvmobile_runtime_get_prompt(reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1bos_1token(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring token) {
+    return with_utf8(env, token, [runtime](const char* s) {
+        return rwkvmobile_runtime_set_bos_token(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1eos_1token(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring token) {
+    return with_utf8(env, token, [runtime](const char* s) {
+        return rwkvmobile_runtime_set_eos_token(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1user_1role(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring role) {
+    return with_utf8(env, role, [runtime](const char* s) {
+        return rwkvmobile_runtime_set_user_role(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1response_1role(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring role) {
+    return with_utf8(env, role, [runtime](const char* s) {
+        return rwkvmobile_runtime_set_response_role(reinterpret_cast<rwkvmobile_runtime_t>(runtime), s);
+    });
+}
+
+// ============================================================================
+// 速度、进度与随机种子
+// ============================================================================
+
+JNIEXPORT jfloat JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1avg_1decode_1speed(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return rwkvmobile_runtime_get_avg_decode_speed(reinterpret_cast<rwkvmobile_runtime_t>(runtime));
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1avg_1prefill_1speed(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return rwkvmobile_runtime_get_avg_prefill_speed(reinterpret_cast<rwkvmobile_runtime_t>(runtime));
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1prefill_1progress(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return rwkvmobile_runtime_get_prefill_progress(reinterpret_cast<rwkvmobile_runtime_t>(runtime));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1seed(
+        JNIEnv *env, jobject /* this */, jlong runtime, jlong seed) {
+    return static_cast<jint>(rwkvmobile_runtime_set_seed(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<uint64_t>(seed)));
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1seed(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    return static_cast<jlong>(rwkvmobile_runtime_get_seed(reinterpret_cast<rwkvmobile_runtime_t>(runtime)));
+}
+
+// ============================================================================
+// Direct ByteBuffer 版本：原生代码直接写入 buffer，不经过 Java 数组拷贝
+// 数据总是从 buffer 起始位置写入（忽略 position），返回写入的字节数
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1available_1backend_1names_1direct(
+        JNIEnv *env, jobject /* this */, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr) {
+        LOGE("Buffer is null or not a direct ByteBuffer");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_get_available_backend_names(address, capacity));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion_1direct(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring prompt, jint maxTokens, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr || prompt == nullptr) {
+        LOGE("Prompt is null or buffer is not a direct ByteBuffer");
+        return -1;
+    }
+    const char* promptStr = env->GetStringUTFChars(prompt, nullptr);
+    if (promptStr == nullptr) {
+        return -1;
+    }
+    int result = rwkvmobile_runtime_gen_completion_to_buffer(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), promptStr,
+        static_cast<int>(maxTokens), address, capacity);
+    env->ReleaseStringUTFChars(prompt, promptStr);
+    return static_cast<jint>(result);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1dump_1log_1direct(
+        JNIEnv *env, jobject /* this */, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr) {
+        LOGE("Buffer is null or not a direct ByteBuffer");
+        return -1;
+    }
+    const char* log = rwkvmobile_dump_log();
+    if (log == nullptr) {
+        return 0;
+    }
+    // 日志超出容量时保留最新的部分
+    size_t len = strlen(log);
+    if (len > static_cast<size_t>(capacity)) {
+        log += len - capacity;
+        len = static_cast<size_t>(capacity);
+    }
+    memcpy(address, log, len);
+    return static_cast<jint>(len);
+}
+
+// 轮询式流式读取：只拷贝 offset 之后新增的字节，返回写入的字节数
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1read_1response_1since(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint offset, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr) {
+        LOGE("Buffer is null or not a direct ByteBuffer");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_read_response_since(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(offset), address, capacity));
+}
+
+// token 记录直接写入 direct ByteBuffer（本机字节序，每条 32 字节），返回条数
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1read_1tokens(
+        JNIEnv *env, jobject /* this */, jlong runtime, jlong first, jobject buffer) {
+    int capacity = 0;
+    rwkvmobile_token_record_t* records = token_records(env, buffer, &capacity);
+    if (records == nullptr || first < 0) {
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_read_tokens(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<uint64_t>(first), records, capacity));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1response_1capacity(
+        JNIEnv *env, jobject /* this */, jlong runtime, jlong capacityBytes) {
+    if (capacityBytes < 0) {
+        LOGE("Invalid response capacity");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_set_response_capacity(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<uint64_t>(capacityBytes)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1gen_1completion_1async(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring prompt, jint maxTokens, jobject listener) {
+    rwkvmobile_runtime_t rt = reinterpret_cast<rwkvmobile_runtime_t>(runtime);
+    if (prompt == nullptr) {
+        LOGE("Prompt is null");
+        return -1;
+    }
+
+    StreamContext* ctx = nullptr;
+    if (!new_stream_context(env, listener, &ctx)) {
+        return -1;
+    }
+
+    const char* promptStr = env->GetStringUTFChars(prompt, nullptr);
+    if (promptStr == nullptr) {
+        delete_stream_context(env, ctx);
+        return -1;
+    }
+    int result = rwkvmobile_runtime_gen_completion_async(
+        rt, promptStr, static_cast<int>(maxTokens),
+        ctx != nullptr ? on_stream_token : nullptr,
+        ctx != nullptr ? on_stream_complete : nullptr,
+        ctx);
+    env->ReleaseStringUTFChars(prompt, promptStr);
+
+    if (result != 0) {
+        // 生成未启动，回调不会被调用
+        delete_stream_context(env, ctx);
+    }
+    LOGI("gen_completion_async result: %d", result);
+    return static_cast<jint>(result);
+}
+
+// ============================================================================
+// 状态快照：保存 prefill 之后的状态，恢复后无需重新 prefill
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1state_1snapshot_1size(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint codec) {
+    return static_cast<jint>(rwkvmobile_runtime_get_state_snapshot_size(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(codec)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1save_1state(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring statePath, jint codec) {
+    if (statePath == nullptr) {
+        LOGE("State path is null");
+        return -1;
+    }
+    const char* pathStr = env->GetStringUTFChars(statePath, nullptr);
+    int result = rwkvmobile_runtime_save_state(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), pathStr, static_cast<int>(codec));
+    env->ReleaseStringUTFChars(statePath, pathStr);
+    LOGI("save_state result: %d", result);
+    return static_cast<jint>(result);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1restore_1state(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring statePath) {
+    if (statePath == nullptr) {
+        LOGE("State path is null");
+        return -1;
+    }
+    const char* pathStr = env->GetStringUTFChars(statePath, nullptr);
+    int result = rwkvmobile_runtime_restore_state(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), pathStr);
+    env->ReleaseStringUTFChars(statePath, pathStr);
+    LOGI("restore_state result: %d", result);
+    return static_cast<jint>(result);
+}
+
+// 快照有数 MB，只接受 direct ByteBuffer，避免 byte[] 拷贝
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1save_1state_1direct(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint codec, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr) {
+        LOGE("Buffer is null or not a direct ByteBuffer");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_save_state_to_buffer(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(codec), address, capacity));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1restore_1state_1direct(
+        JNIEnv *env, jobject /* this */, jlong runtime, jobject buffer, jint size) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr || size <= 0 || size > capacity) {
+        LOGE("Buffer is not a direct ByteBuffer or size is out of range");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_restore_state_from_buffer(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), address, static_cast<int>(size)));
+}
+
+// ============================================================================
+// 前缀缓存
+// ============================================================================
+
+// 返回 [hits, misses, reusedTokens, cachedBytes]
+JNIEXPORT jlongArray JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1prefix_1cache_1stats(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    uint64_t values[4] = {0, 0, 0, 0};
+    if (rwkvmobile_runtime_get_prefix_cache_stats(reinterpret_cast<rwkvmobile_runtime_t>(runtime),
+                                                  &values[0], &values[1], &values[2], &values[3]) < 0) {
+        return nullptr;
+    }
+    jlongArray stats = env->NewLongArray(4);
+    if (stats == nullptr) {
+        return nullptr;
+    }
+    jlong out[4];
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<jlong>(values[i]);
+    env->SetLongArrayRegion(stats, 0, 4, out);
+    return stats;
+}
+
+// 统计结构体直接写进 direct ByteBuffer，Java 侧按 native 字节序读取
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1perf_1stats(
+        JNIEnv *env, jobject /* this */, jlong runtime, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr || capacity < static_cast<int>(sizeof(rwkvmobile_perf_stats_t))) {
+        LOGE("Perf stats buffer is null, too small or not a direct ByteBuffer");
+        return -1;
+    }
+    if (reinterpret_cast<uintptr_t>(address) % alignof(uint64_t) != 0) {
+        LOGE("Perf stats buffer is not 8-byte aligned");
+        return -1;
+    }
+    auto* stats = reinterpret_cast<rwkvmobile_perf_stats_t*>(address);
+    stats->size = static_cast<uint32_t>(capacity);
+    return static_cast<jint>(rwkvmobile_runtime_get_perf_stats(reinterpret_cast<rwkvmobile_runtime_t>(runtime), stats));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1prefix_1cache_1capacity(
+        JNIEnv *env, jobject /* this */, jlong runtime, jlong capacityBytes) {
+    if (capacityBytes < 0) {
+        LOGE("Invalid prefix cache capacity");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_runtime_set_prefix_cache_capacity(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<uint64_t>(capacityBytes)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1kernel_1profiling(
+        JNIEnv *env, jobject /* this */, jlong runtime, jboolean enabled) {
+    return static_cast<jint>(rwkvmobile_runtime_set_kernel_profiling(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), enabled == JNI_TRUE ? 1 : 0));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1prefill_1chunk_1size(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint chunkSize) {
+    return static_cast<jint>(rwkvmobile_runtime_set_prefill_chunk_size(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(chunkSize)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1threads(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint threads, jint affinity) {
+    return static_cast<jint>(rwkvmobile_runtime_set_threads(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(threads),
+        static_cast<int>(affinity)));
+}
+
+// ============================================================================
+// 投机解码
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1draft_1model(
+        JNIEnv *env, jobject /* this */, jlong runtime, jint modelId, jint draftTokens) {
+    return static_cast<jint>(rwkvmobile_runtime_set_draft_model(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), static_cast<int>(modelId), static_cast<int>(draftTokens)));
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1speculative_1stats(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    uint64_t values[3] = {0, 0, 0};
+    if (rwkvmobile_runtime_get_speculative_stats(reinterpret_cast<rwkvmobile_runtime_t>(runtime),
+                                                 &values[0], &values[1], &values[2]) < 0) {
+        return nullptr;
+    }
+    jlongArray stats = env->NewLongArray(3);
+    if (stats == nullptr) {
+        return nullptr;
+    }
+    jlong out[3];
+    for (int i = 0; i < 3; ++i) out[i] = static_cast<jlong>(values[i]);
+    env->SetLongArrayRegion(stats, 0, 3, out);
+    return stats;
+}
+
+// ============================================================================
+// 重复惩罚
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1penalty_1params(
+        JNIEnv *env, jobject /* this */, jlong runtime,
+        jfloat presencePenalty, jfloat frequencyPenalty, jfloat penaltyDecay) {
+    return static_cast<jint>(rwkvmobile_runtime_set_penalty_params(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), presencePenalty, frequencyPenalty, penaltyDecay));
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1get_1penalty_1params(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    float values[3];
+    if (rwkvmobile_runtime_get_penalty_params(reinterpret_cast<rwkvmobile_runtime_t>(runtime),
+                                              &values[0], &values[1], &values[2]) < 0) {
+        return nullptr;
+    }
+    jfloatArray params = env->NewFloatArray(3);
+    if (params == nullptr) {
+        return nullptr;
+    }
+    env->SetFloatArrayRegion(params, 0, 3, values);
+    return params;
+}
+
+// ============================================================================
+// 约束解码
+// ============================================================================
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1set_1constraint(
+        JNIEnv *env, jobject /* this */, jlong runtime, jstring regex) {
+    const char* regexStr = regex != nullptr ? env->GetStringUTFChars(regex, nullptr) : nullptr;
+    int result = rwkvmobile_runtime_set_constraint(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime), regexStr);
+    if (regexStr != nullptr) {
+        env->ReleaseStringUTFChars(regex, regexStr);
+    }
+    LOGI("set_constraint result: %d", result);
+    return static_cast<jint>(result);
+}
+
+// ============================================================================
+// 会话：同一 runtime 上的多个对话共享模型权重，各自持有 RWKV 状态
+// ============================================================================
+
+JNIEXPORT jlong JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1session_1create(
+        JNIEnv *env, jobject /* this */, jlong runtime) {
+    rwkvmobile_session_t session = rwkvmobile_runtime_session_create(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime));
+    LOGI("Session created: %p", session);
+    return reinterpret_cast<jlong>(session);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1runtime_1session_1destroy(
+        JNIEnv *env, jobject /* this */, jlong runtime, jlong session) {
+    int result = rwkvmobile_runtime_session_destroy(
+        reinterpret_cast<rwkvmobile_runtime_t>(runtime),
+        reinterpret_cast<rwkvmobile_session_t>(session));
+    LOGI("Session destroyed, result: %d", result);
+    return static_cast<jint>(result);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1clear_1state(
+        JNIEnv *env, jobject /* this */, jlong session) {
+    return static_cast<jint>(rwkvmobile_session_clear_state(
+        reinterpret_cast<rwkvmobile_session_t>(session)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1set_1prompt(
+        JNIEnv *env, jobject /* this */, jlong session, jstring prompt) {
+    const char* promptStr = prompt != nullptr ? env->GetStringUTFChars(prompt, nullptr) : nullptr;
+    int result = rwkvmobile_session_set_prompt(
+        reinterpret_cast<rwkvmobile_session_t>(session), promptStr);
+    if (promptStr != nullptr) {
+        env->ReleaseStringUTFChars(prompt, promptStr);
+    }
+    return static_cast<jint>(result);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1gen_1completion_1async(
+        JNIEnv *env, jobject /* this */, jlong session, jstring prompt, jint maxTokens, jobject listener) {
+    if (prompt == nullptr) {
+        LOGE("Prompt is null");
+        return -1;
+    }
+
+    StreamContext* ctx = nullptr;
+    if (!new_stream_context(env, listener, &ctx)) {
+        return -1;
+    }
+
+    const char* promptStr = env->GetStringUTFChars(prompt, nullptr);
+    if (promptStr == nullptr) {
+        delete_stream_context(env, ctx);
+        return -1;
+    }
+    int result = rwkvmobile_session_gen_completion_async(
+        reinterpret_cast<rwkvmobile_session_t>(session), promptStr, static_cast<int>(maxTokens),
+        ctx != nullptr ? on_stream_token : nullptr,
+        ctx != nullptr ? on_stream_complete : nullptr,
+        ctx);
+    env->ReleaseStringUTFChars(prompt, promptStr);
+
+    if (result != 0) {
+        delete_stream_context(env, ctx);
+    }
+    return static_cast<jint>(result);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1stop_1generation(
+        JNIEnv *env, jobject /* this */, jlong session) {
+    return static_cast<jint>(rwkvmobile_session_stop_generation(
+        reinterpret_cast<rwkvmobile_session_t>(session)));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1read_1response_1since(
+        JNIEnv *env, jobject /* this */, jlong session, jint offset, jobject buffer) {
+    int capacity = 0;
+    char* address = direct_buffer(env, buffer, &capacity);
+    if (address == nullptr) {
+        LOGE("Buffer is null or not a direct ByteBuffer");
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_session_read_response_since(
+        reinterpret_cast<rwkvmobile_session_t>(session), static_cast<int>(offset), address, capacity));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_rwkvmobiletest_RwkvMobile_rwkvmobile_1session_1read_1tokens(
+        JNIEnv *env, jobject /* this */, jlong session, jlong first, jobject buffer) {
+    int capacity = 0;
+    rwkvmobile_token_record_t* records = token_records(env, buffer, &capacity);
+    if (records == nullptr || first < 0) {
+        return -1;
+    }
+    return static_cast<jint>(rwkvmobile_session_read_tokens(
+        reinterpret_cast<rwkvmobile_session_t>(session), static_cast<uint64_t>(first), records, capacity));
+}
+
 } // extern "C"
 
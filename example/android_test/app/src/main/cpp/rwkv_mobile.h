@@ -17,6 +17,17 @@ extern "C" {
 // Opaque handle type for the runtime
 typedef void* rwkvmobile_runtime_t;
 
+// Opaque handle type for a session (one conversation) of a runtime
+typedef void* rwkvmobile_session_t;
+
+// Error codes returned by the runtime functions (0 = success)
+#define RWKVMOBILE_SUCCESS                   0
+#define RWKVMOBILE_ERROR_INVALID_PARAMETERS (-1)
+#define RWKVMOBILE_ERROR_NOT_LOADED         (-2)
+#define RWKVMOBILE_ERROR_IO                 (-3)
+#define RWKVMOBILE_ERROR_UNSUPPORTED        (-4)
+#define RWKVMOBILE_ERROR_BUSY               (-5)
+
 // ============================================================================
 // Device Information Functions
 // ============================================================================
@@ -62,7 +73,9 @@ const char* rwkvmobile_dump_log(void);
 void rwkvmobile_set_loglevel(int loglevel);
 
 /**
- * Set the cache directory
+ * Set the cache directory. Models whose weights need converting at load time
+ * (fp16/bf16 safetensors) are stored there in the packed format on first
+ * load, keyed by model hash and CPU features, and mapped directly afterwards.
  * @param path Cache directory path
  */
 void rwkvmobile_set_cache_dir(const char* path);
@@ -132,7 +145,21 @@ int rwkvmobile_runtime_load_model(rwkvmobile_runtime_t runtime,
  * @param runtime Runtime handle
  * @param model_path Path to the model file
  * @param backend_name Backend name
- * @param extra_params Extra parameters (implementation specific)
+ * @param extra_params Extra parameters as "key=value" pairs separated by ',' or ';'
+ *                     (e.g. "tokenizer=/path/to/rwkv_vocab_v20230424.txt").
+ *                     "batch_size=N" (default 1) lets up to N sessions that are
+ *                     decoding at the same time share one batched forward pass
+ *                     per token; it applies to the whole runtime.
+ *                     "prefill_chunk=N" (default 32) controls chunked prefill,
+ *                     see rwkvmobile_runtime_set_prefill_chunk_size().
+ *                     "threads=N" (default: all cores) and
+ *                     "affinity=none|performance" configure the thread pool
+ *                     shared by decode and prefill, see
+ *                     rwkvmobile_runtime_set_threads().
+ *                     "weights=fp32|int8|int4" quantizes the large projection
+ *                     matrices after loading (int8/int4 per group of 32 with
+ *                     an fp32 scale); it overrides the backend suffix of
+ *                     "cpu-int8" / "cpu-int4".
  * @return Model ID (>=0) on success, negative on error
  */
 int rwkvmobile_runtime_load_model_with_extra(rwkvmobile_runtime_t runtime,
@@ -148,6 +175,44 @@ int rwkvmobile_runtime_load_model_with_extra(rwkvmobile_runtime_t runtime,
  */
 int rwkvmobile_runtime_release_model(rwkvmobile_runtime_t runtime, int model_id);
 
+/**
+ * Enable speculative decoding with a second loaded model as the draft: it
+ * proposes draft_tokens tokens per step and the main model verifies them in
+ * one chunked forward pass, rolling its state back to the last accepted
+ * token. Output is sampled from the main model as before; only the speed
+ * changes. If the draft is the active model (it was loaded last), the most
+ * recently loaded other model becomes the main model. Both models must have
+ * the same vocab. Not used while batch_size > 1.
+ * @param runtime Runtime handle
+ * @param model_id Draft model ID from load_model, -1 to disable
+ * @param draft_tokens Tokens proposed per step (1..16)
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_set_draft_model(rwkvmobile_runtime_t runtime, int model_id, int draft_tokens);
+
+/**
+ * Speculative decoding statistics of the last generation (all 0 when it
+ * did not use a draft model). Acceptance rate is accepted / drafted; the
+ * effective speed is rwkvmobile_runtime_get_avg_decode_speed.
+ * @param runtime Runtime handle
+ * @param passes Out: main model verification passes (nullable)
+ * @param drafted Out: tokens proposed by the draft model (nullable)
+ * @param accepted Out: drafted tokens accepted by the main model (nullable)
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_get_speculative_stats(rwkvmobile_runtime_t runtime,
+                                             uint64_t* passes,
+                                             uint64_t* drafted,
+                                             uint64_t* accepted);
+
+/**
+ * Load the tokenizer vocabulary (RWKV "id literal length" text format)
+ * @param runtime Runtime handle
+ * @param vocab_path Path to the vocab file
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_load_tokenizer(rwkvmobile_runtime_t runtime, const char* vocab_path);
+
 // ============================================================================
 // State Management Functions
 // ============================================================================
@@ -174,6 +239,62 @@ int rwkvmobile_runtime_load_initial_state(rwkvmobile_runtime_t runtime, const ch
  */
 int rwkvmobile_runtime_unload_initial_state(rwkvmobile_runtime_t runtime);
 
+// State snapshot encodings (smaller snapshots trade a little precision)
+#define RWKVMOBILE_STATE_CODEC_F32  0
+#define RWKVMOBILE_STATE_CODEC_F16  1
+#define RWKVMOBILE_STATE_CODEC_INT8 2
+
+/**
+ * Get the size of a state snapshot of the loaded model
+ * @param runtime Runtime handle
+ * @param codec RWKVMOBILE_STATE_CODEC_*
+ * @return Size in bytes, or negative on error
+ */
+int rwkvmobile_runtime_get_state_snapshot_size(rwkvmobile_runtime_t runtime, int codec);
+
+/**
+ * Snapshot the current state (e.g. right after prefilling a long history
+ * with gen_completion(..., max_tokens = 0)) into a buffer. The snapshot is a
+ * versioned little-endian format that also records the model dimensions.
+ * @param runtime Runtime handle
+ * @param codec RWKVMOBILE_STATE_CODEC_*
+ * @param buffer Output buffer of at least get_state_snapshot_size() bytes
+ * @param buffer_size Size of buffer
+ * @return Bytes written, or negative on error
+ */
+int rwkvmobile_runtime_save_state_to_buffer(rwkvmobile_runtime_t runtime, int codec,
+                                            void* buffer, int buffer_size);
+
+/**
+ * Snapshot the current state into a file (written atomically)
+ * @param runtime Runtime handle
+ * @param state_path Output file path
+ * @param codec RWKVMOBILE_STATE_CODEC_*
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_save_state(rwkvmobile_runtime_t runtime, const char* state_path, int codec);
+
+/**
+ * Replace the current state with a snapshot, so generation continues where
+ * the snapshot was taken without prefilling again
+ * @param runtime Runtime handle
+ * @param buffer Snapshot data
+ * @param buffer_size Size of the snapshot data
+ * @return 0 on success, RWKVMOBILE_ERROR_INVALID_PARAMETERS if the snapshot is
+ *         corrupt or was taken with a model of different dimensions
+ */
+int rwkvmobile_runtime_restore_state_from_buffer(rwkvmobile_runtime_t runtime,
+                                                 const void* buffer, int buffer_size);
+
+/**
+ * Restore a snapshot file written by save_state (decoded from an mmap of
+ * the file, without reading it into memory first)
+ * @param runtime Runtime handle
+ * @param state_path Snapshot file path
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_restore_state(rwkvmobile_runtime_t runtime, const char* state_path);
+
 // ============================================================================
 // Generation Functions
 // ============================================================================
@@ -204,7 +325,27 @@ const char* rwkvmobile_runtime_gen_completion(rwkvmobile_runtime_t runtime,
                                                int max_tokens);
 
 /**
- * Free response buffer
+ * Generate completion synchronously into a caller-owned buffer
+ * @param runtime Runtime handle
+ * @param prompt Input prompt
+ * @param max_tokens Maximum tokens to generate
+ * @param buffer Destination buffer (e.g. a direct ByteBuffer's storage)
+ * @param buffer_size Size of the buffer in bytes
+ * @return Number of bytes written (truncated on a UTF-8 boundary if the
+ *         buffer is too small; NUL-terminated when there is room), or
+ *         negative on error
+ */
+int rwkvmobile_runtime_gen_completion_to_buffer(rwkvmobile_runtime_t runtime,
+                                                const char* prompt,
+                                                int max_tokens,
+                                                char* buffer,
+                                                int buffer_size);
+
+/**
+ * Free response buffer. Must only be given buffers returned by
+ * gen_completion; a few are kept and reused by later generations. Other
+ * pointers and buffers that were already freed are rejected (logged, not
+ * freed), as far as the header in front of the buffer can tell.
  * @param buffer Buffer to free
  */
 void rwkvmobile_runtime_free_response_buffer(char* buffer);
@@ -216,6 +357,66 @@ void rwkvmobile_runtime_free_response_buffer(char* buffer);
  */
 const char* rwkvmobile_runtime_get_response_buffer_content(rwkvmobile_runtime_t runtime);
 
+/**
+ * Read only the bytes appended to the response buffer since a cursor.
+ * Start with offset 0 when a generation begins and advance it by each
+ * return value; polling this way copies every byte once instead of the
+ * whole response per poll. Multi-byte UTF-8 characters are never split:
+ * an incomplete trailing character is held back while generating.
+ * @param runtime Runtime handle
+ * @param offset Byte cursor into the current response
+ * @param buffer Destination buffer
+ * @param buffer_size Size of the buffer in bytes; at least 4, so that one
+ *        whole UTF-8 character always fits
+ * @return Number of bytes written (0 if nothing new), or
+ *         RWKVMOBILE_ERROR_INVALID_PARAMETERS if buffer_size < 4, or offset
+ *         is past the end of the response (e.g. a new generation has
+ *         started) or has been discarded (see
+ *         rwkvmobile_runtime_set_response_capacity)
+ */
+int rwkvmobile_runtime_read_response_since(rwkvmobile_runtime_t runtime,
+                                           int offset,
+                                           char* buffer,
+                                           int buffer_size);
+
+// One generated token: its bytes are [offset, offset + length) of the response
+typedef struct {
+    uint64_t index;        // position of the token in the current response
+    uint64_t offset;
+    int64_t timestamp_us;  // microseconds since the generation started
+    int32_t token_id;
+    uint32_t length;
+} rwkvmobile_token_record_t;
+
+/**
+ * Read the records of the tokens generated so far, starting at token index
+ * `first`. Only the newest 1024 records are kept; older ones are skipped,
+ * so check records[0].index and continue from the last index + 1. Like the
+ * response buffer this never blocks the generating thread.
+ * @param runtime Runtime handle
+ * @param first Token index to start at (0 for the beginning)
+ * @param records Destination array
+ * @param max_records Capacity of the array
+ * @return Number of records written, or RWKVMOBILE_ERROR_INVALID_PARAMETERS
+ *         if first is past the last token (a new generation has started)
+ */
+int rwkvmobile_runtime_read_tokens(rwkvmobile_runtime_t runtime,
+                                   uint64_t first,
+                                   rwkvmobile_token_record_t* records,
+                                   int max_records);
+
+/**
+ * Bound the response buffer of every session for the following generations:
+ * only the newest capacity_bytes (rounded up to 16 KB) stay readable, so a
+ * very long generation runs in fixed memory. Readers whose cursor falls
+ * behind get RWKVMOBILE_ERROR_INVALID_PARAMETERS from read_response_since,
+ * and get_response_buffer_content returns the retained tail.
+ * @param runtime Runtime handle
+ * @param capacity_bytes Bytes to keep, 0 for unbounded (default; up to 64 MB)
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_set_response_capacity(rwkvmobile_runtime_t runtime, uint64_t capacity_bytes);
+
 // ============================================================================
 // Async Generation Functions (callbacks)
 // ============================================================================
@@ -225,7 +426,13 @@ typedef void (*rwkvmobile_token_callback_t)(const char* token, void* user_data);
 typedef void (*rwkvmobile_completion_callback_t)(int status, void* user_data);
 
 /**
- * Generate completion asynchronously
+ * Generate completion asynchronously. Both callbacks run on one background
+ * thread; the forward passes run on another and hand each token over
+ * through a lock-free queue, so a slow token_callback delays decoding only
+ * once it falls 256 tokens behind. completion_callback follows the last
+ * token_callback. The two threads belong to the session: the first async
+ * generation starts them and later ones reuse them until the session is
+ * destroyed.
  * @param runtime Runtime handle
  * @param prompt Input prompt
  * @param max_tokens Maximum tokens to generate
@@ -241,12 +448,152 @@ int rwkvmobile_runtime_gen_completion_async(rwkvmobile_runtime_t runtime,
                                              rwkvmobile_completion_callback_t completion_callback,
                                              void* user_data);
 
+// ============================================================================
+// Session Functions
+//
+// A session is one conversation with its own RWKV state, prompt and response
+// buffer. All sessions of a runtime share its loaded model, tokenizer and
+// sampler settings, so each extra session costs only its state. The
+// runtime-level state/generation functions above act on an implicit default
+// session. Different sessions may generate concurrently.
+// ============================================================================
+
+/**
+ * Create a session on a runtime
+ * @param runtime Runtime handle
+ * @return Session handle, or NULL on failure
+ */
+rwkvmobile_session_t rwkvmobile_runtime_session_create(rwkvmobile_runtime_t runtime);
+
+/**
+ * Destroy a session, stopping and waiting for its generation if running.
+ * Sessions still alive are destroyed by rwkvmobile_runtime_release.
+ * @param runtime Runtime handle the session was created on
+ * @param session Session handle
+ * @return 0 on success, RWKVMOBILE_ERROR_INVALID_PARAMETERS for an unknown session
+ */
+int rwkvmobile_runtime_session_destroy(rwkvmobile_runtime_t runtime, rwkvmobile_session_t session);
+
+/**
+ * Reset the session's state (to its initial state if one is loaded)
+ * @param session Session handle
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_session_clear_state(rwkvmobile_session_t session);
+
+/**
+ * Load an initial state (state-tuning time_state) for this session only
+ * @param session Session handle
+ * @param state_path Path to the safetensors state file
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_session_load_initial_state(rwkvmobile_session_t session, const char* state_path);
+
+/**
+ * Drop the session's initial state and reset to a zero state
+ * @param session Session handle
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_session_unload_initial_state(rwkvmobile_session_t session);
+
+/**
+ * Set the system prompt fed when the session starts from a fresh state
+ * @param session Session handle
+ * @param prompt Prompt text
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_session_set_prompt(rwkvmobile_session_t session, const char* prompt);
+
+/**
+ * Get the session's system prompt
+ * @param session Session handle
+ * @return Prompt string (owned by the session)
+ */
+const char* rwkvmobile_session_get_prompt(rwkvmobile_session_t session);
+
+/**
+ * Session variants of the state snapshot functions (see
+ * rwkvmobile_runtime_save_state_to_buffer and friends)
+ */
+int rwkvmobile_session_get_state_snapshot_size(rwkvmobile_session_t session, int codec);
+int rwkvmobile_session_save_state_to_buffer(rwkvmobile_session_t session, int codec,
+                                            void* buffer, int buffer_size);
+int rwkvmobile_session_save_state(rwkvmobile_session_t session, const char* state_path, int codec);
+int rwkvmobile_session_restore_state_from_buffer(rwkvmobile_session_t session,
+                                                 const void* buffer, int buffer_size);
+int rwkvmobile_session_restore_state(rwkvmobile_session_t session, const char* state_path);
+
+/**
+ * Generate completion synchronously on a session
+ * @param session Session handle
+ * @param prompt Input prompt
+ * @param max_tokens Maximum tokens to generate
+ * @return Generated text (caller should free with rwkvmobile_runtime_free_response_buffer)
+ */
+const char* rwkvmobile_session_gen_completion(rwkvmobile_session_t session,
+                                              const char* prompt,
+                                              int max_tokens);
+
+/**
+ * Generate completion asynchronously on a session
+ * (same callback contract as rwkvmobile_runtime_gen_completion_async)
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_session_gen_completion_async(rwkvmobile_session_t session,
+                                            const char* prompt,
+                                            int max_tokens,
+                                            rwkvmobile_token_callback_t token_callback,
+                                            rwkvmobile_completion_callback_t completion_callback,
+                                            void* user_data);
+
+/**
+ * Request the session's generation to stop
+ * @param session Session handle
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_session_stop_generation(rwkvmobile_session_t session);
+
+/**
+ * Check whether the session is generating
+ * @param session Session handle
+ * @return 1 if generating, 0 otherwise
+ */
+int rwkvmobile_session_is_generating(rwkvmobile_session_t session);
+
+/**
+ * Get the session's response buffer content
+ * @param session Session handle
+ * @return Response content string
+ */
+const char* rwkvmobile_session_get_response_buffer_content(rwkvmobile_session_t session);
+
+/**
+ * Read only the response bytes appended since a cursor
+ * (same contract as rwkvmobile_runtime_read_response_since)
+ * @return Number of bytes written, or negative on error
+ */
+int rwkvmobile_session_read_response_since(rwkvmobile_session_t session,
+                                           int offset,
+                                           char* buffer,
+                                           int buffer_size);
+
+/**
+ * Read the session's token records
+ * (same contract as rwkvmobile_runtime_read_tokens)
+ * @return Number of records written, or negative on error
+ */
+int rwkvmobile_session_read_tokens(rwkvmobile_session_t session,
+                                   uint64_t first,
+                                   rwkvmobile_token_record_t* records,
+                                   int max_records);
+
 // ============================================================================
 // Sampler Parameters
 // ============================================================================
 
 /**
- * Set sampler parameters
+ * Set sampler parameters. Shared by all sessions; each generation uses the
+ * values current when it starts.
  * @param runtime Runtime handle
  * @param temperature Temperature for sampling
  * @param top_p Top-p (nucleus) sampling
@@ -271,6 +618,50 @@ int rwkvmobile_runtime_get_sampler_params(rwkvmobile_runtime_t runtime,
                                            float* top_p,
                                            int* top_k);
 
+/**
+ * Set repetition penalties. Each generated token lowers its own logit for
+ * the rest of the reply by presence_penalty + frequency_penalty * count,
+ * where count is multiplied by penalty_decay after every token. Counts
+ * restart with each reply. Defaults: 0, 0, 0.996 (no penalty).
+ * @param runtime Runtime handle
+ * @param presence_penalty Flat penalty for any token already generated
+ * @param frequency_penalty Penalty per (decayed) occurrence
+ * @param penalty_decay Per-token decay of the counts, in [0, 1]
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_set_penalty_params(rwkvmobile_runtime_t runtime,
+                                          float presence_penalty,
+                                          float frequency_penalty,
+                                          float penalty_decay);
+
+/**
+ * Get repetition penalties
+ * @param runtime Runtime handle
+ * @param presence_penalty Output: presence penalty
+ * @param frequency_penalty Output: frequency penalty
+ * @param penalty_decay Output: penalty decay
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_get_penalty_params(rwkvmobile_runtime_t runtime,
+                                          float* presence_penalty,
+                                          float* frequency_penalty,
+                                          float* penalty_decay);
+
+/**
+ * Constrain generated text to a regular expression. Every reply (from its
+ * first token) then matches `regex` in full; generation ends when the reply
+ * is complete and cannot be extended. Supported syntax: literals, '.',
+ * [classes], \d \w \s, groups, '|', and * + ? {n,m}. JSON with bounded
+ * nesting can be written this way. The regex is compiled into a DFA and a
+ * token mask per DFA state, so constrained decoding costs about the same
+ * as unconstrained decoding. Needs a loaded tokenizer.
+ * @param runtime Runtime handle
+ * @param regex Pattern, or NULL / "" to remove the constraint
+ * @return 0 on success, RWKVMOBILE_ERROR_NOT_LOADED without a tokenizer,
+ *         RWKVMOBILE_ERROR_INVALID_PARAMETERS for an invalid pattern
+ */
+int rwkvmobile_runtime_set_constraint(rwkvmobile_runtime_t runtime, const char* regex);
+
 // ============================================================================
 // Prompt/Chat Functions
 // ============================================================================
@@ -336,10 +727,137 @@ float rwkvmobile_runtime_get_avg_decode_speed(rwkvmobile_runtime_t runtime);
 /**
  * Get average prefill speed (tokens per second)
  * @param runtime Runtime handle
- * @return Prefill speed in tokens/second
+ * @return Prefill speed in tokens/second. Only tokens actually run through
+ *         the model are counted; tokens restored from the prefix cache are
+ *         reported by rwkvmobile_runtime_get_prefix_cache_stats
  */
 float rwkvmobile_runtime_get_avg_prefill_speed(rwkvmobile_runtime_t runtime);
 
+/**
+ * Get prefix cache statistics. A chat that starts from a fresh state looks
+ * up the state after its system prompt (bos token + set_prompt text) in a
+ * cache shared by all sessions and prefills only the remainder on a hit.
+ * @param runtime Runtime handle
+ * @param hits Out: lookups that resumed from a cached prefix (nullable)
+ * @param misses Out: lookups that found nothing (nullable)
+ * @param reused_tokens Out: prompt tokens skipped thanks to hits (nullable)
+ * @param cached_bytes Out: memory currently used by cached states (nullable)
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_get_prefix_cache_stats(rwkvmobile_runtime_t runtime,
+                                              uint64_t* hits,
+                                              uint64_t* misses,
+                                              uint64_t* reused_tokens,
+                                              uint64_t* cached_bytes);
+
+#define RWKVMOBILE_PERF_STATS_VERSION   1
+#define RWKVMOBILE_PERF_MAX_LAYERS      64
+#define RWKVMOBILE_PERF_LATENCY_BUCKETS 96
+
+/**
+ * Performance counters of the last generation of any session. Versioned:
+ * the caller sets `size` to sizeof(rwkvmobile_perf_stats_t) as it was
+ * compiled; later versions only append fields, and the runtime fills at
+ * most `size` bytes and reports the version it wrote. All times are wall
+ * time; the forward-pass breakdown covers the main model on the
+ * generating thread (draft model passes and decode steps merged by
+ * batch_size > 1 are not broken down, but count in the totals).
+ */
+typedef struct {
+    uint32_t version;              // out: RWKVMOBILE_PERF_STATS_VERSION
+    uint32_t size;                 // in: sizeof(rwkvmobile_perf_stats_t); out: bytes written
+    uint32_t n_layer;              // entries of layer_us in use
+    uint32_t latency_buckets;      // entries of token_latency_histogram in use
+
+    uint64_t prompt_tokens;        // prompt tokens of the last generation
+    uint64_t cached_prompt_tokens; // of which restored from the prefix cache
+    uint64_t generated_tokens;
+    uint64_t ttft_us;              // start of the call to the first generated token
+    uint64_t prefill_us;
+    uint64_t decode_us;
+
+    // Interval between consecutive generated tokens
+    uint64_t token_latency_p50_us;
+    uint64_t token_latency_p90_us;
+    uint64_t token_latency_p99_us;
+    uint64_t token_latency_max_us;
+
+    // Where the main model's forward passes spent their time; matmul_us, wkv_us
+    // and layer_us stay 0 unless rwkvmobile_runtime_set_kernel_profiling() is on
+    uint64_t forward_passes;
+    uint64_t forward_us;
+    uint64_t matmul_us;            // projections and head
+    uint64_t wkv_us;               // WKV recurrence
+    uint64_t sampler_us;           // sampling, constraint masks and penalties
+    uint64_t weight_bytes_streamed;
+
+    uint64_t prefix_cache_hits;    // cumulative, see get_prefix_cache_stats
+    uint64_t prefix_cache_misses;
+    uint64_t arena_allocations;    // memory blocks the per-generation arena requested
+    uint64_t response_allocations; // response buffer blocks allocated
+
+    uint64_t layer_us[RWKVMOBILE_PERF_MAX_LAYERS];
+    // Bucket i counts intervals from 2^(i/4) * (1 + (i%4)/4) us up to the next bucket's start
+    uint32_t token_latency_histogram[RWKVMOBILE_PERF_LATENCY_BUCKETS];
+} rwkvmobile_perf_stats_t;
+
+/**
+ * Get the performance counters of the last generation
+ * @param runtime Runtime handle
+ * @param stats Out; stats->size must be set by the caller (at least 8)
+ * @return Bytes written, or negative on error
+ */
+int rwkvmobile_runtime_get_perf_stats(rwkvmobile_runtime_t runtime, rwkvmobile_perf_stats_t* stats);
+
+/**
+ * Also time every matrix multiplication, WKV step and layer of the forward
+ * passes (matmul_us, wkv_us and layer_us of the perf stats). Off by default
+ * since it reads the clock a few hundred times per token; takes effect at
+ * the start of the next generation
+ * @param runtime Runtime handle
+ * @param enabled Non-zero to turn the breakdown on
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_set_kernel_profiling(rwkvmobile_runtime_t runtime, int enabled);
+
+/**
+ * Bound the memory of the prefix cache (default 64 MB); least recently
+ * used states are evicted first
+ * @param runtime Runtime handle
+ * @param capacity_bytes Capacity in bytes, 0 disables the cache
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_set_prefix_cache_capacity(rwkvmobile_runtime_t runtime, uint64_t capacity_bytes);
+
+/**
+ * Set how many prompt tokens are prefilled per forward pass. Within a chunk
+ * every projection runs as a matrix-matrix product over all of its tokens
+ * and the work is split across the runtime's threads; prefill progress is
+ * updated once per chunk. 1 prefills token by token.
+ * @param runtime Runtime handle
+ * @param chunk_size Tokens per chunk, >= 1 (default 32)
+ * @return 0 on success, negative on error
+ */
+int rwkvmobile_runtime_set_prefill_chunk_size(rwkvmobile_runtime_t runtime, int chunk_size);
+
+// Thread placement of the runtime's worker threads
+#define RWKVMOBILE_AFFINITY_NONE        0
+#define RWKVMOBILE_AFFINITY_PERFORMANCE 1
+
+/**
+ * Resize the thread pool that splits every forward pass (decode steps,
+ * prefill chunks, speculative verification) across cores. Idle workers
+ * spin briefly between the kernels of one step and park between tokens;
+ * a worker that finishes early steals from the others.
+ * @param runtime Runtime handle
+ * @param threads Threads including the generating one; <= 0 uses all cores
+ *                (all performance cores with RWKVMOBILE_AFFINITY_PERFORMANCE)
+ * @param affinity RWKVMOBILE_AFFINITY_PERFORMANCE pins the workers to the
+ *                 cores with the highest maximum frequency (big cluster)
+ * @return 0 on success, RWKVMOBILE_ERROR_BUSY while generating, negative on error
+ */
+int rwkvmobile_runtime_set_threads(rwkvmobile_runtime_t runtime, int threads, int affinity);
+
 /**
  * Get prefill progress (0.0 to 1.0)
  * @param runtime Runtime handle
@@ -352,7 +870,9 @@ float rwkvmobile_runtime_get_prefill_progress(rwkvmobile_runtime_t runtime);
 // ============================================================================
 
 /**
- * Set random seed
+ * Set random seed. Every session samples with its own generator and
+ * re-seeds it from this value when its next generation starts, so a
+ * session's output is reproducible even while other sessions generate.
  * @param runtime Runtime handle
  * @param seed Seed value
  * @return 0 on success
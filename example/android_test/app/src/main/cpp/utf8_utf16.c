@@ -0,0 +1,94 @@
+#include "utf8_utf16.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define REPLACEMENT_CHAR 0xFFFD
+
+// Widen a run of ASCII bytes to UTF-16, 16 bytes per step where SIMD is
+// available. Returns the length of the run copied.
+static size_t ascii_run(const unsigned char* s, size_t n, uint16_t* d) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        if (_mm_movemask_epi8(v) != 0) break;
+        _mm_storeu_si128((__m128i*)(d + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(d + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(s + i);
+        if (vmaxvq_u8(v) >= 0x80) break;
+        vst1q_u16(d + i, vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(d + i + 8, vmovl_high_u8(v));
+    }
+#endif
+    while (i < n && s[i] < 0x80) {
+        d[i] = s[i];
+        ++i;
+    }
+    return i;
+}
+
+size_t utf8_to_utf16(const char* src, size_t len, uint16_t* dst, int final, size_t* consumed) {
+    const unsigned char* s = (const unsigned char*)src;
+    size_t i = 0;
+    size_t o = 0;
+    while (i < len) {
+        size_t run = ascii_run(s + i, len - i, dst + o);
+        i += run;
+        o += run;
+        if (i == len) break;
+
+        const unsigned char c = s[i];
+        size_t need;
+        uint32_t cp;
+        uint32_t min;
+        if (c >= 0xC2 && c <= 0xDF) {
+            need = 2; cp = c & 0x1F; min = 0x80;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            need = 3; cp = c & 0x0F; min = 0x800;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            need = 4; cp = c & 0x07; min = 0x10000;
+        } else {
+            // Stray continuation byte or invalid lead byte
+            dst[o++] = REPLACEMENT_CHAR;
+            ++i;
+            continue;
+        }
+
+        size_t k = 1;
+        while (k < need && i + k < len && (s[i + k] & 0xC0) == 0x80) {
+            cp = (cp << 6) | (s[i + k] & 0x3F);
+            ++k;
+        }
+        if (k < need) {
+            if (i + k == len && !final) {
+                // Incomplete character at the end: wait for more bytes
+                break;
+            }
+            dst[o++] = REPLACEMENT_CHAR;
+            i += k;
+            continue;
+        }
+        i += need;
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            dst[o++] = REPLACEMENT_CHAR;
+        } else if (cp >= 0x10000) {
+            cp -= 0x10000;
+            dst[o++] = (uint16_t)(0xD800 + (cp >> 10));
+            dst[o++] = (uint16_t)(0xDC00 + (cp & 0x3FF));
+        } else {
+            dst[o++] = (uint16_t)cp;
+        }
+    }
+    if (consumed != NULL) {
+        *consumed = i;
+    }
+    return o;
+}
@@ -0,0 +1,38 @@
+/**
+ * utf8_utf16.h
+ *
+ * Standard UTF-8 -> UTF-16 decoding for building jstrings with NewString.
+ * NewStringUTF expects *modified* UTF-8 and mangles 4-byte sequences
+ * (emoji, supplementary CJK), so generated text is converted here instead.
+ * Shared by rwkv_jni.cpp and the C bridge rwkv_jni.c.
+ */
+
+#ifndef RWKV_UTF8_UTF16_H
+#define RWKV_UTF8_UTF16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decode UTF-8 into UTF-16. ASCII runs take a SIMD fast path (SSE2/NEON).
+ * Invalid bytes, overlong forms and encoded surrogates become U+FFFD.
+ * @param src UTF-8 bytes
+ * @param len Number of bytes in src
+ * @param dst Output; must hold at least len code units
+ * @param final 0 while streaming: an incomplete sequence at the end of src
+ *        is not decoded and left for the next call; non-zero to decode it
+ *        as U+FFFD
+ * @param consumed Receives the number of bytes decoded (may be NULL)
+ * @return Number of UTF-16 code units written
+ */
+size_t utf8_to_utf16(const char* src, size_t len, uint16_t* dst, int final, size_t* consumed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RWKV_UTF8_UTF16_H
@@ -1,5 +1,12 @@
 package com.example.rwkvmobiletest
 
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.channels.awaitClose
+import kotlinx.coroutines.flow.Flow
+import kotlinx.coroutines.flow.buffer
+import kotlinx.coroutines.flow.callbackFlow
+import java.nio.ByteBuffer
+
 /**
  * JNI wrapper for librwkv_mobile.so
  * 
@@ -86,6 +93,15 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_dump_log(): String?
 
+    /**
+     * Copy the newest part of the native log into a direct ByteBuffer
+     * (written from offset 0, no intermediate Java array)
+     * @param buffer Direct ByteBuffer to receive UTF-8 log text
+     * @return Number of bytes written, or -1 if the buffer is not direct
+     */
+    @JvmStatic
+    external fun rwkvmobile_dump_log_direct(buffer: ByteBuffer): Int
+
     /**
      * Set log level
      * @param level Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR)
@@ -132,6 +148,14 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_runtime_get_available_backend_names(buffer: ByteArray, bufferSize: Int): Int
 
+    /**
+     * Get available backend names into a direct ByteBuffer (zero-copy)
+     * @param buffer Direct ByteBuffer, written from offset 0 up to its capacity
+     * @return Number of bytes written, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_get_available_backend_names_direct(buffer: ByteBuffer): Int
+
     /**
      * Set QNN library path
      * @param runtime Runtime handle
@@ -189,6 +213,28 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_runtime_release_model(runtime: Long, modelId: Int): Int
 
+    /**
+     * Enable speculative decoding: a second loaded model drafts tokens that
+     * the main model verifies in one chunked pass. Output is unchanged; if
+     * the draft was loaded last, the previously loaded model becomes the
+     * main model. Both models must share the vocab.
+     * @param runtime Runtime handle
+     * @param modelId Draft model ID from load_model, -1 to disable
+     * @param draftTokens Tokens proposed per step (1..16)
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_draft_model(runtime: Long, modelId: Int, draftTokens: Int): Int
+
+    /**
+     * Speculative decoding statistics of the last generation; acceptance
+     * rate is accepted / drafted, effective speed is get_avg_decode_speed
+     * @param runtime Runtime handle
+     * @return [passes, drafted, accepted], or null on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_get_speculative_stats(runtime: Long): LongArray?
+
     // ========================================================================
     // State Management Functions
     // ========================================================================
@@ -218,6 +264,55 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_runtime_unload_initial_state(runtime: Long): Int
 
+    /**
+     * Get the size of a state snapshot of the loaded model
+     * @param runtime Runtime handle
+     * @param codec One of the STATE_CODEC_* constants
+     * @return Size in bytes, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_get_state_snapshot_size(runtime: Long, codec: Int): Int
+
+    /**
+     * Save the current state (e.g. after prefilling a long history) to a file
+     * @param runtime Runtime handle
+     * @param statePath Output file path
+     * @param codec One of the STATE_CODEC_* constants
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_save_state(runtime: Long, statePath: String, codec: Int): Int
+
+    /**
+     * Restore a snapshot saved by [rwkvmobile_runtime_save_state]; generation
+     * continues from it without prefilling again
+     * @param runtime Runtime handle
+     * @param statePath Snapshot file path
+     * @return 0 on success, negative on error (e.g. snapshot of a different model)
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_restore_state(runtime: Long, statePath: String): Int
+
+    /**
+     * Save the current state into a direct ByteBuffer
+     * @param runtime Runtime handle
+     * @param codec One of the STATE_CODEC_* constants
+     * @param buffer Direct ByteBuffer of at least the snapshot size
+     * @return Bytes written, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_save_state_direct(runtime: Long, codec: Int, buffer: ByteBuffer): Int
+
+    /**
+     * Restore a snapshot from a direct ByteBuffer
+     * @param runtime Runtime handle
+     * @param buffer Direct ByteBuffer holding the snapshot from offset 0
+     * @param size Snapshot size in bytes
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_restore_state_direct(runtime: Long, buffer: ByteBuffer, size: Int): Int
+
     // ========================================================================
     // Generation Control Functions
     // ========================================================================
@@ -256,6 +351,174 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_runtime_get_response_buffer_content(runtime: Long): String?
 
+    /**
+     * Read only the response bytes appended since a cursor
+     * @param runtime Runtime handle
+     * @param offset Byte cursor; start at 0 and advance by each return value
+     * @param buffer Direct ByteBuffer of at least 4 bytes, written from offset 0 up to its capacity
+     * @return Number of bytes written (whole UTF-8 characters only), 0 if
+     *         nothing new, or negative if the cursor is stale / buffer not direct or too small
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_read_response_since(runtime: Long, offset: Int, buffer: ByteBuffer): Int
+
+    /**
+     * Read the records of the generated tokens into a direct ByteBuffer, 32 bytes each
+     * in native byte order: index (Long), offset (Long), timestampUs (Long), tokenId (Int),
+     * length (Int). Only the newest 1024 are kept; continue from the last index + 1.
+     * @param runtime Runtime handle
+     * @param first Token index to start at
+     * @param buffer 8-byte aligned direct ByteBuffer (ByteBuffer.allocateDirect)
+     * @return Number of records written, or negative if the cursor is stale / buffer invalid
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_read_tokens(runtime: Long, first: Long, buffer: ByteBuffer): Int
+
+    /**
+     * Keep only the newest capacityBytes of each response (0 = unbounded, the default),
+     * so very long generations run in fixed memory
+     * @param runtime Runtime handle
+     * @param capacityBytes Bytes to keep, rounded up to 16 KB
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_response_capacity(runtime: Long, capacityBytes: Long): Int
+
+    /**
+     * Generate completion synchronously, writing UTF-8 output straight into
+     * a direct ByteBuffer. Output longer than the buffer is cut on a
+     * character boundary.
+     * @param runtime Runtime handle
+     * @param prompt Input prompt
+     * @param maxTokens Maximum tokens to generate
+     * @param buffer Direct ByteBuffer, written from offset 0 up to its capacity
+     * @return Number of bytes written, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_gen_completion_direct(
+        runtime: Long,
+        prompt: String,
+        maxTokens: Int,
+        buffer: ByteBuffer
+    ): Int
+
+    /**
+     * Receives tokens pushed from the native generation thread.
+     * Both methods are called on that thread, never on the main thread.
+     */
+    interface TokenListener {
+        /**
+         * Text of one generated token. A character split across tokens is
+         * delivered whole with the token that completes it.
+         */
+        fun onToken(token: String)
+
+        /** Generation finished; status is 0 on success, negative on error */
+        fun onComplete(status: Int)
+    }
+
+    /**
+     * Generate completion asynchronously
+     * @param runtime Runtime handle
+     * @param prompt Input prompt
+     * @param maxTokens Maximum tokens to generate
+     * @param listener Token/completion callbacks, or null to poll the response buffer
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_gen_completion_async(
+        runtime: Long,
+        prompt: String,
+        maxTokens: Int,
+        listener: TokenListener?
+    ): Int
+
+    // ========================================================================
+    // Session Functions
+    // ========================================================================
+    // A session is one conversation on a runtime: it shares the runtime's
+    // loaded model and sampler settings and holds only its own RWKV state.
+    // The runtime_* state/generation functions act on the default session.
+
+    /**
+     * Create a session on the runtime
+     * @param runtime Runtime handle
+     * @return Session handle (0 on failure)
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_session_create(runtime: Long): Long
+
+    /**
+     * Destroy a session, stopping its generation first
+     * @param runtime Runtime handle that created the session
+     * @param session Session handle
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_session_destroy(runtime: Long, session: Long): Int
+
+    /**
+     * Clear the session's state
+     * @param session Session handle
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_session_clear_state(session: Long): Int
+
+    /**
+     * Set the system prompt prepended when the session's state is fresh
+     * @param session Session handle
+     * @param prompt System prompt
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_session_set_prompt(session: Long, prompt: String): Int
+
+    /**
+     * Generate completion asynchronously on a session; sessions of the same
+     * runtime may generate concurrently
+     * @param session Session handle
+     * @param prompt Input prompt
+     * @param maxTokens Maximum tokens to generate
+     * @param listener Token/completion callbacks, or null to poll the response buffer
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_session_gen_completion_async(
+        session: Long,
+        prompt: String,
+        maxTokens: Int,
+        listener: TokenListener?
+    ): Int
+
+    /**
+     * Stop the session's ongoing generation
+     * @param session Session handle
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_session_stop_generation(session: Long): Int
+
+    /**
+     * Same as [rwkvmobile_runtime_read_response_since], for a session's response buffer
+     * @param session Session handle
+     * @param offset Byte cursor; start at 0 and advance by each return value
+     * @param buffer Direct ByteBuffer, written from offset 0 up to its capacity
+     * @return Number of bytes written, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_session_read_response_since(session: Long, offset: Int, buffer: ByteBuffer): Int
+
+    /**
+     * Same as [rwkvmobile_runtime_read_tokens], for a session's token records
+     * @param session Session handle
+     * @param first Token index to start at
+     * @param buffer 8-byte aligned direct ByteBuffer
+     * @return Number of records written, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_session_read_tokens(session: Long, first: Long, buffer: ByteBuffer): Int
+
     // ========================================================================
     // Sampler Parameters
     // ========================================================================
@@ -284,6 +547,42 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_runtime_get_sampler_params(runtime: Long): FloatArray?
 
+    /**
+     * Set repetition penalties: each token generated in the current reply
+     * lowers its logit by presencePenalty + frequencyPenalty * count, and
+     * the counts decay by penaltyDecay per token
+     * @param runtime Runtime handle
+     * @param presencePenalty Flat penalty for tokens already generated (default 0)
+     * @param frequencyPenalty Penalty per occurrence (default 0)
+     * @param penaltyDecay Per-token decay of the counts, 0 to 1 (default 0.996)
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_penalty_params(
+        runtime: Long,
+        presencePenalty: Float,
+        frequencyPenalty: Float,
+        penaltyDecay: Float
+    ): Int
+
+    /**
+     * Get repetition penalties
+     * @param runtime Runtime handle
+     * @return Float array [presencePenalty, frequencyPenalty, penaltyDecay] or null on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_get_penalty_params(runtime: Long): FloatArray?
+
+    /**
+     * Constrain every reply to match a regular expression (e.g. ABC
+     * notation or bounded-depth JSON); needs a loaded tokenizer
+     * @param runtime Runtime handle
+     * @param regex Pattern, or null / "" to remove the constraint
+     * @return 0 on success, negative on error (invalid pattern, no tokenizer)
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_constraint(runtime: Long, regex: String?): Int
+
     // ========================================================================
     // Prompt/Chat Functions
     // ========================================================================
@@ -361,6 +660,74 @@ object RwkvMobile {
     @JvmStatic
     external fun rwkvmobile_runtime_get_avg_prefill_speed(runtime: Long): Float
 
+    /**
+     * Get prefix cache statistics (states after the system prompt, reused
+     * by chats that start with the same prompt)
+     * @param runtime Runtime handle
+     * @return [hits, misses, reusedTokens, cachedBytes], or null on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_get_prefix_cache_stats(runtime: Long): LongArray?
+
+    /**
+     * Performance counters of the last generation (rwkvmobile_perf_stats_t), written into
+     * a direct ByteBuffer in native byte order; only as much as fits the buffer is written
+     * (PERF_STATS_SIZE bytes for version PERF_STATS_VERSION). Layout:
+     * - 0: version, size, nLayer, latencyBuckets (Int each)
+     * - 16: Longs promptTokens, cachedPromptTokens, generatedTokens, ttftUs, prefillUs,
+     *   decodeUs, tokenLatencyP50Us, P90Us, P99Us, MaxUs, forwardPasses, forwardUs,
+     *   matmulUs, wkvUs, samplerUs, weightBytesStreamed, prefixCacheHits,
+     *   prefixCacheMisses, arenaAllocations, responseAllocations
+     * - PERF_STATS_LAYER_US_OFFSET: layerUs, 64 Longs (nLayer in use)
+     * - PERF_STATS_HISTOGRAM_OFFSET: token latency histogram, 96 Ints; bucket i starts at
+     *   2^(i/4) * (1 + (i%4)/4) µs
+     * @param runtime Runtime handle
+     * @param buffer 8-byte aligned direct ByteBuffer (ByteBuffer.allocateDirect(PERF_STATS_SIZE))
+     * @return Bytes written, or negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_get_perf_stats(runtime: Long, buffer: ByteBuffer): Int
+
+    /**
+     * Also time every matmul, WKV step and layer of the forward passes (matmulUs, wkvUs
+     * and layerUs of the perf stats, 0 otherwise). Off by default; costs a few hundred
+     * clock reads per token. Takes effect at the start of the next generation
+     * @param runtime Runtime handle
+     * @param enabled Whether to record the per-kernel breakdown
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_kernel_profiling(runtime: Long, enabled: Boolean): Int
+
+    /**
+     * Bound the memory of the prefix cache (default 64 MB)
+     * @param runtime Runtime handle
+     * @param capacityBytes Capacity in bytes, 0 disables the cache
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_prefix_cache_capacity(runtime: Long, capacityBytes: Long): Int
+
+    /**
+     * Set how many prompt tokens are prefilled per forward pass (default 32);
+     * progress is reported once per chunk
+     * @param runtime Runtime handle
+     * @param chunkSize Tokens per chunk, >= 1 (1 prefills token by token)
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_prefill_chunk_size(runtime: Long, chunkSize: Int): Int
+
+    /**
+     * Resize the thread pool used by decode and prefill; fails with -5 while generating
+     * @param runtime Runtime handle
+     * @param threads Threads including the generating one, <= 0 for all cores
+     * @param affinity AFFINITY_NONE, or AFFINITY_PERFORMANCE to pin workers to the big cores
+     * @return 0 on success, negative on error
+     */
+    @JvmStatic
+    external fun rwkvmobile_runtime_set_threads(runtime: Long, threads: Int, affinity: Int): Int
+
     /**
      * Get prefill progress (0.0 to 1.0)
      * @param runtime Runtime handle
@@ -398,6 +765,21 @@ object RwkvMobile {
     const val LOG_LEVEL_INFO = 1
     const val LOG_LEVEL_WARN = 2
     const val LOG_LEVEL_ERROR = 3
+
+    // rwkvmobile_runtime_get_perf_stats 的结构体版本与布局
+    const val PERF_STATS_VERSION = 1
+    const val PERF_STATS_SIZE = 1072
+    const val PERF_STATS_LAYER_US_OFFSET = 176
+    const val PERF_STATS_HISTOGRAM_OFFSET = 688
+
+    // State snapshot encodings; f16/int8 trade a little precision for size
+    const val STATE_CODEC_F32 = 0
+    const val STATE_CODEC_F16 = 1
+    const val STATE_CODEC_INT8 = 2
+
+    // Thread placement for rwkvmobile_runtime_set_threads
+    const val AFFINITY_NONE = 0
+    const val AFFINITY_PERFORMANCE = 1
     
     // ========================================================================
     // Kotlin-friendly Helper Functions
@@ -421,6 +803,42 @@ object RwkvMobile {
         }
     }
 
+    /**
+     * Get available backend names through a reusable direct ByteBuffer.
+     * The buffer's position/limit are reset to the written bytes.
+     */
+    fun getAvailableBackendNames(buffer: ByteBuffer): String? {
+        val result = rwkvmobile_runtime_get_available_backend_names_direct(buffer)
+        return if (result >= 0) decodeDirect(buffer, result) else null
+    }
+
+    /**
+     * Generate completion into a reusable direct ByteBuffer
+     */
+    fun generateInto(runtime: Long, prompt: String, maxTokens: Int, buffer: ByteBuffer): String? {
+        val result = rwkvmobile_runtime_gen_completion_direct(runtime, prompt, maxTokens, buffer)
+        return if (result >= 0) decodeDirect(buffer, result) else null
+    }
+
+    /**
+     * Read the native log through a reusable direct ByteBuffer
+     */
+    fun dumpLog(buffer: ByteBuffer): String? {
+        val result = rwkvmobile_dump_log_direct(buffer)
+        return if (result >= 0) decodeDirect(buffer, result) else null
+    }
+
+    /**
+     * Allocate a direct ByteBuffer suitable for the *_direct functions
+     */
+    fun allocateDirectBuffer(capacity: Int): ByteBuffer = ByteBuffer.allocateDirect(capacity)
+
+    private fun decodeDirect(buffer: ByteBuffer, length: Int): String {
+        buffer.clear()
+        buffer.limit(length)
+        return Charsets.UTF_8.decode(buffer).toString()
+    }
+
     /**
      * Get device information as a formatted string
      */
@@ -434,6 +852,65 @@ object RwkvMobile {
         }
     }
 
+    /**
+     * Stream generated text as it is produced. Each emission is the text of
+     * the new token(s); multi-byte characters split across tokens are held
+     * back natively until complete. Cancelling the collector stops generation.
+     */
+    fun generateStream(runtime: Long, prompt: String, maxTokens: Int): Flow<String> = callbackFlow {
+        val listener = object : TokenListener {
+            override fun onToken(token: String) {
+                trySend(token)
+            }
+
+            override fun onComplete(status: Int) {
+                if (status < 0) {
+                    close(IllegalStateException("Generation failed: $status"))
+                } else {
+                    close()
+                }
+            }
+        }
+        val result = rwkvmobile_runtime_gen_completion_async(runtime, prompt, maxTokens, listener)
+        if (result != 0) {
+            close(IllegalStateException("gen_completion_async returned $result"))
+        }
+        awaitClose {
+            if (rwkvmobile_runtime_is_generating(runtime) != 0) {
+                rwkvmobile_runtime_stop_generation(runtime)
+            }
+        }
+    }.buffer(Channel.UNLIMITED)
+
+    /**
+     * Polls the response of an async generation, returning only new text.
+     * Create one per generation; each poll copies just the appended bytes.
+     * [capacity] must hold the longest UTF-8 character (4 bytes).
+     */
+    class ResponseReader(private val runtime: Long, capacity: Int = 4096) {
+        init {
+            require(capacity >= 4) { "capacity must be at least 4 bytes, was $capacity" }
+        }
+
+        private val buffer = ByteBuffer.allocateDirect(capacity)
+        private var cursor = 0
+
+        /** Text appended since the last poll, or "" if nothing new */
+        fun poll(): String {
+            val result = StringBuilder()
+            while (true) {
+                val n = rwkvmobile_runtime_read_response_since(runtime, cursor, buffer)
+                if (n < 0) {
+                    throw IllegalStateException("read_response_since returned $n")
+                }
+                if (n == 0) break
+                cursor += n
+                result.append(decodeDirect(buffer, n))
+            }
+            return result.toString()
+        }
+    }
+
     /**
      * Data class for sampler parameters
      */